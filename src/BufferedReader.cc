@@ -24,6 +24,7 @@
 #include "memory/PinnedBuffer.hh"
 #include "BufferedReader.hh"
 #include "Utils.hh"
+#include <string.h>
 
 using namespace quarkdb;
 
@@ -136,3 +137,39 @@ LinkStatus BufferedReader::consume(size_t len, PinnedBuffer &buf) {
   buf = PinnedBuffer();
   return consumeInternal(len, buf.getInternalBuffer());
 }
+
+const char* BufferedReader::findLineEnd() {
+  size_t end = buffer_size;
+  if(buffers.size() == 1) {
+    end = position_write;
+  }
+
+  const char *start = buffers.front()->data() + position_read;
+  return (const char*) memchr(start, '\n', end - position_read);
+}
+
+LinkStatus BufferedReader::consumeLineInPlace(std::string_view &line) {
+  const char *lineEnd = findLineEnd();
+
+  if(!lineEnd && buffers.size() == 1) {
+    // Maybe the rest of the line is still sitting in the socket
+    LinkStatus rlen = readFromLink(buffer_size);
+    if(rlen < 0) return rlen;
+    if(rlen == 0) return 0;
+
+    lineEnd = findLineEnd();
+  }
+
+  if(!lineEnd) return 0;
+
+  const char *start = buffers.front()->data() + position_read;
+  size_t len = lineEnd - start + 1;
+
+  // Consuming this line would release the front buffer, and "line" would
+  // point to freed memory. Leave it for the slow path, it's rare enough.
+  if(position_read + len >= buffer_size) return 0;
+
+  line = std::string_view(start, len);
+  position_read += len;
+  return len;
+}
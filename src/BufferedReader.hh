@@ -27,6 +27,7 @@
 #include "memory/RingAllocator.hh"
 #include <deque>
 #include <string>
+#include <string_view>
 
 #include "Link.hh"
 
@@ -58,6 +59,17 @@ public:
   //----------------------------------------------------------------------------
   LinkStatus consume(size_t len, PinnedBuffer &buf);
 
+  //----------------------------------------------------------------------------
+  // Fast path for short, \n-terminated lines such as RESP headers: If the
+  // entire line is available within the front buffer, point "line" directly
+  // to it (including the trailing \n), consume it, and return its length.
+  //
+  // Returns 0 without consuming anything if the line is not fully contained in
+  // the front buffer - either not enough data has arrived yet, or the line
+  // straddles a buffer boundary. The caller should fall back to consume().
+  //----------------------------------------------------------------------------
+  LinkStatus consumeLineInPlace(std::string_view &line);
+
 private:
   Link *link;
 
@@ -91,6 +103,11 @@ private:
   // Internal consume function - does not check canConsume first
   //----------------------------------------------------------------------------
   LinkStatus consumeInternal(size_t len, std::string &str);
+
+  //----------------------------------------------------------------------------
+  // Search for \n within the readable part of the front buffer
+  //----------------------------------------------------------------------------
+  const char* findLineEnd();
 };
 
 }
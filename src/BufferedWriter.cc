@@ -23,6 +23,7 @@
 
 #include "BufferedWriter.hh"
 #include "Link.hh"
+#include "redis/RedisEncodedResponse.hh"
 using namespace quarkdb;
 
 BufferedWriter::BufferedWriter(Link *link_)
@@ -50,19 +51,33 @@ void BufferedWriter::flush() {
 }
 
 LinkStatus BufferedWriter::send(std::string &&raw) {
+  return send(std::string_view(raw));
+}
+
+LinkStatus BufferedWriter::send(const RedisEncodedResponse &resp) {
+  std::scoped_lock lock(mtx);
+
+  if(!resp.header.empty()) {
+    send(std::string_view(resp.header));
+  }
+
+  return send(std::string_view(resp.val));
+}
+
+LinkStatus BufferedWriter::send(std::string_view raw) {
   std::scoped_lock lock(mtx);
 
   if(!link) return 1;
-  if(!active) return link->Send(raw);
+  if(!active) return link->Send(raw.data(), raw.size());
 
   if(raw.size() + bufferedBytes > OUTPUT_BUFFER_SIZE) {
     this->flush();
     if(raw.size() > OUTPUT_BUFFER_SIZE) {
-      return link->Send(raw); // response too large for output buffer
+      return link->Send(raw.data(), raw.size()); // response too large for output buffer
     }
   }
 
-  memcpy(buffer + bufferedBytes, raw.c_str(), raw.size());
+  memcpy(buffer + bufferedBytes, raw.data(), raw.size());
   bufferedBytes += raw.size();
   return 1;
 }
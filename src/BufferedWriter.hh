@@ -25,10 +25,13 @@
 #define __QUARKDB_BUFFERED_WRITER_H__
 
 #include <mutex>
+#include <string>
+#include <string_view>
 
 namespace quarkdb {
 using LinkStatus = int;
 class Link;
+class RedisEncodedResponse;
 
 #define OUTPUT_BUFFER_SIZE (16*1024)
 
@@ -40,6 +43,8 @@ public:
   void setActive(bool newval);
   void flush();
   LinkStatus send(std::string &&raw);
+  LinkStatus send(std::string_view raw);
+  LinkStatus send(const RedisEncodedResponse &resp);
 private:
   Link *link;
 
@@ -78,6 +78,7 @@ struct cmdMapInit {
     redis_cmd_map["flushall"] = {RedisCommand::FLUSHALL, CommandType::WRITE};
     redis_cmd_map["set"] = {RedisCommand::SET, CommandType::WRITE};
     redis_cmd_map["del"] =  {RedisCommand::DEL, CommandType::WRITE};
+    redis_cmd_map["unlink"] =  {RedisCommand::UNLINK, CommandType::WRITE};
     redis_cmd_map["hset"] =  {RedisCommand::HSET, CommandType::WRITE};
     redis_cmd_map["hmset"] =  {RedisCommand::HMSET, CommandType::WRITE};
     redis_cmd_map["hsetnx"] = {RedisCommand::HSETNX, CommandType::WRITE};
@@ -109,6 +110,7 @@ struct cmdMapInit {
     redis_cmd_map["timestamped_lease_acquire"] = {RedisCommand::TIMESTAMPED_LEASE_ACQUIRE, CommandType::WRITE};
     redis_cmd_map["timestamped_lease_get"] = {RedisCommand::TIMESTAMPED_LEASE_GET, CommandType::WRITE};
     redis_cmd_map["timestamped_lease_release"] = {RedisCommand::TIMESTAMPED_LEASE_RELEASE, CommandType::WRITE};
+    redis_cmd_map["lazyfree_reclaim"] = {RedisCommand::LAZYFREE_RECLAIM, CommandType::WRITE};
     redis_cmd_map["vhset"] = {RedisCommand::VHSET, CommandType::WRITE};
     redis_cmd_map["vhdel"] = {RedisCommand::VHDEL, CommandType::WRITE};
 
@@ -143,8 +145,10 @@ struct cmdMapInit {
     redis_cmd_map["raft_set_fsync_policy"] = {RedisCommand::RAFT_SET_FSYNC_POLICY, CommandType::RAFT};
     redis_cmd_map["raft_observe_term"] = {RedisCommand::RAFT_OBSERVE_TERM, CommandType::RAFT};
     redis_cmd_map["raft_journal_manual_compaction"] = {RedisCommand::RAFT_JOURNAL_MANUAL_COMPACTION, CommandType::RAFT};
+    redis_cmd_map["raft_read_index"] = {RedisCommand::RAFT_READ_INDEX, CommandType::RAFT};
 
     redis_cmd_map["activate_stale_reads"] = {RedisCommand::ACTIVATE_STALE_READS, CommandType::RAFT};
+    redis_cmd_map["activate_follower_reads"] = {RedisCommand::ACTIVATE_FOLLOWER_READS, CommandType::RAFT};
 
     redis_cmd_map["quarkdb_info"] = {RedisCommand::QUARKDB_INFO, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_detach"] = {RedisCommand::QUARKDB_DETACH, CommandType::QUARKDB};
@@ -152,6 +156,9 @@ struct cmdMapInit {
     redis_cmd_map["quarkdb_start_resilvering"] = {RedisCommand::QUARKDB_START_RESILVERING, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_finish_resilvering"] = {RedisCommand::QUARKDB_FINISH_RESILVERING, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_resilvering_copy_file"] = {RedisCommand::QUARKDB_RESILVERING_COPY_FILE, CommandType::QUARKDB};
+    redis_cmd_map["quarkdb_resilvering_copy_chunk"] = {RedisCommand::QUARKDB_RESILVERING_COPY_CHUNK, CommandType::QUARKDB};
+    redis_cmd_map["quarkdb_resilvering_file_size"] = {RedisCommand::QUARKDB_RESILVERING_FILE_SIZE, CommandType::QUARKDB};
+    redis_cmd_map["quarkdb_resilvering_reuse_file"] = {RedisCommand::QUARKDB_RESILVERING_REUSE_FILE, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_cancel_resilvering"] = {RedisCommand::QUARKDB_CANCEL_RESILVERING, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_bulkload_finalize"] = {RedisCommand::QUARKDB_BULKLOAD_FINALIZE, CommandType::QUARKDB};
     redis_cmd_map["quarkdb_invalid_command"] = {RedisCommand::QUARKDB_INVALID_COMMAND, CommandType::QUARKDB};
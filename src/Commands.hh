@@ -25,6 +25,9 @@
 #define QUARKDB_COMMANDS_H
 
 #include <map>
+#include <string>
+#include <string_view>
+#include <cctype>
 
 namespace quarkdb {
 
@@ -49,6 +52,7 @@ enum class RedisCommand {
   SET,
   EXISTS,
   DEL,
+  UNLINK,
   KEYS,
   SCAN,
 
@@ -128,6 +132,8 @@ enum class RedisCommand {
   TIMESTAMPED_LEASE_ACQUIRE,
   TIMESTAMPED_LEASE_RELEASE,
 
+  LAZYFREE_RECLAIM,
+
   CONFIG_GET,
   CONFIG_SET,
   CONFIG_GETALL,
@@ -150,8 +156,10 @@ enum class RedisCommand {
   RAFT_SET_FSYNC_POLICY,
   RAFT_OBSERVE_TERM,
   RAFT_JOURNAL_MANUAL_COMPACTION,
+  RAFT_READ_INDEX,
 
   ACTIVATE_STALE_READS,
+  ACTIVATE_FOLLOWER_READS,
 
   QUARKDB_INFO,
   QUARKDB_DETACH,
@@ -159,6 +167,9 @@ enum class RedisCommand {
   QUARKDB_START_RESILVERING,
   QUARKDB_FINISH_RESILVERING,
   QUARKDB_RESILVERING_COPY_FILE,
+  QUARKDB_RESILVERING_COPY_CHUNK,
+  QUARKDB_RESILVERING_FILE_SIZE,
+  QUARKDB_RESILVERING_REUSE_FILE,
   QUARKDB_CANCEL_RESILVERING,
   QUARKDB_BULKLOAD_FINALIZE,
   QUARKDB_INVALID_COMMAND,                  // used in tests
@@ -119,6 +119,33 @@ static bool parseTraceLevel(const std::string &buffer, TraceLevel &trace) {
   return true;
 }
 
+//------------------------------------------------------------------------------
+// Parse "<class> <hard> <soft> <soft-seconds> <policy>"
+//------------------------------------------------------------------------------
+static bool parseOutputBufferLimit(ConfigurationReader &reader, std::vector<std::pair<ClientClass, OutputBufferLimit>> &out) {
+  std::string buffer;
+  ClientClass cls;
+
+  if(!fetchSingle(reader, buffer) || !parseClientClass(buffer, cls)) {
+    qdb_log("Unknown client class: " << quotes(buffer));
+    return false;
+  }
+
+  std::vector<std::string> words(4);
+  for(size_t i = 0; i < words.size(); i++) {
+    if(!fetchSingle(reader, words[i])) return false;
+  }
+
+  OutputBufferLimit limit;
+  if(!OutputBufferLimit::parse(words, limit)) {
+    qdb_log("Cannot parse output buffer limit: " << quotes(words[0] << " " << words[1] << " " << words[2] << " " << words[3]));
+    return false;
+  }
+
+  out.emplace_back(cls, limit);
+  return true;
+}
+
 bool Configuration::fromReader(ConfigurationReader &reader, Configuration &out) {
 
   while(!reader.eof()) {
@@ -165,6 +192,15 @@ bool Configuration::fromReader(ConfigurationReader &reader, Configuration &out)
     else if(StringUtils::startsWith(current, "require_password_for_localhost")) {
       success = fetchSingle(reader, buffer) && parseBool(buffer, out.requirePasswordForLocalhost);
     }
+    else if(StringUtils::startsWith(current, "client_output_buffer_limit")) {
+      success = parseOutputBufferLimit(reader, out.outputBufferLimits);
+    }
+    else if(StringUtils::startsWith(current, "reversed_key_index")) {
+      success = fetchSingle(reader, buffer) && parseBool(buffer, out.reversedKeyIndex);
+    }
+    else if(StringUtils::startsWith(current, "network_sharding")) {
+      success = fetchSingle(reader, buffer) && parseBool(buffer, out.networkSharding);
+    }
     else {
       qdb_warn("Error when parsing configuration - unknown option " << quotes(current));
       return false;
@@ -29,6 +29,7 @@
 
 #include "Common.hh"
 #include "utils/Macros.hh"
+#include "redis/OutputBufferLimits.hh"
 
 namespace quarkdb {
 
@@ -72,6 +73,9 @@ public:
   bool getWriteAheadLog() const { return writeAheadLog; }
   bool getRequirePasswordForLocalhost() const { return requirePasswordForLocalhost; }
   std::string getConfigurationPath() const { return configurationPath; }
+  const std::vector<std::pair<ClientClass, OutputBufferLimit>>& getOutputBufferLimits() const { return outputBufferLimits; }
+  bool getReversedKeyIndex() const { return reversedKeyIndex; }
+  bool getNetworkSharding() const { return networkSharding; }
 
   std::string extractPasswordOrDie() const;
 private:
@@ -85,7 +89,9 @@ private:
   bool requirePasswordForLocalhost = false;
   bool writeAheadLog = true;
   std::string configurationPath;
-
+  std::vector<std::pair<ClientClass, OutputBufferLimit>> outputBufferLimits;
+  bool reversedKeyIndex = false;
+  bool networkSharding = false;
 
   // raft options
   RaftServer myself;
@@ -32,14 +32,14 @@ LinkStatus PendingQueue::flushPending(const RedisEncodedResponse &msg) {
   std::scoped_lock lock(mtx);
   while(!pending.empty()) {
     if(conn) {
-      if(!pending.front().rawResp.empty()) {
-        conn->writer.send(std::move(pending.front().rawResp.val));
+      if(pending.front().holdsResponse()) {
+        sendHeldResponse(pending.front());
       }
       else {
-        conn->writer.send(Formatter::multiply(msg, pending.front().tx.expectedResponses() ).val);
+        conn->writer.send(Formatter::multiply(msg, pending.front().tx.expectedResponses()));
       }
     }
-    pending.pop();
+    popFrontNoLock();
   }
   if(conn) conn->writer.flush();
   lastIndex = -1;
@@ -66,24 +66,41 @@ void PendingQueue::punsubscribe(const std::string &item) {
   subscriptionTracker.removePattern(item);
 }
 
-bool PendingQueue::addMessageIfAttached(const std::string &channel, std::string_view payload) {
+bool PendingQueue::addMessageIfAttached(const std::string &channel, EncodedMessage &msg) {
   std::scoped_lock lock(mtx);
   if(!conn) return false;
 
   if(!subscriptionTracker.hasChannel(channel)) return true;
   Connection::FlushGuard guard(conn);
-  appendResponseNoLock(Formatter::message(supportsPushTypes, channel, payload));
-  return true;
+  if(slowConsumerDisconnected) return false;
+  appendSharedResponseNoLock(msg.get(supportsPushTypes), std::string(channel));
+  return !slowConsumerDisconnected;
 }
 
-bool PendingQueue::addPatternMessageIfAttached(const std::string &pattern, std::string_view channel, std::string_view payload) {
+bool PendingQueue::addPatternMessageIfAttached(const std::string &pattern, EncodedMessage &msg) {
   std::scoped_lock lock(mtx);
   if(!conn) return false;
 
   if(!subscriptionTracker.hasPattern(pattern)) return true;
   Connection::FlushGuard guard(conn);
-  appendResponseNoLock(Formatter::pmessage(supportsPushTypes, pattern, channel, payload));
-  return true;
+  if(slowConsumerDisconnected) return false;
+  appendSharedResponseNoLock(msg.get(supportsPushTypes), SSTR(pattern << "\n" << msg.getChannel()));
+  return !slowConsumerDisconnected;
+}
+
+bool PendingQueue::addMonitorMessageIfAttached(RedisEncodedResponse &&raw) {
+  std::scoped_lock lock(mtx);
+  if(!conn || slowConsumerDisconnected) return false;
+
+  Connection::FlushGuard guard(conn);
+  if(pending.empty()) {
+    return sendMessageNoLock(raw.release());
+  }
+
+  PendingRequest req;
+  req.heldBytes = raw.size();
+  req.rawResp = std::move(raw);
+  return holdMessageNoLock(std::move(req));
 }
 
 bool PendingQueue::appendIfAttachedNoLock(RedisEncodedResponse &&raw) {
@@ -99,17 +116,228 @@ bool PendingQueue::appendIfAttached(RedisEncodedResponse &&raw) {
 }
 
 LinkStatus PendingQueue::appendResponseNoLock(RedisEncodedResponse &&raw) {
-  if(!conn) qdb_throw("attempted to append a raw response to a pendingQueue while being detached from a Connection. Contents: '" << raw.val << "'");
+  if(!conn) qdb_throw("attempted to append a raw response to a pendingQueue while being detached from a Connection. Contents: '" << raw.header << raw.val << "'");
 
-  if(pending.empty()) return conn->writer.send(std::move(raw.val));
+  if(pending.empty()) return conn->writer.send(raw);
 
   // we're being blocked by a write, must queue
   PendingRequest req;
   req.rawResp = std::move(raw);
-  pending.push(std::move(req));
+  pending.push_back(std::move(req));
+  return 1;
+}
+
+LinkStatus PendingQueue::appendSharedResponseNoLock(const SharedEncodedResponse &shared, std::string &&coalesceKey) {
+  if(!conn) qdb_throw("attempted to append a shared response to a pendingQueue while being detached from a Connection. Contents: '" << shared.view() << "'");
+
+  if(pending.empty()) {
+    sendMessageNoLock(shared.view());
+    return 1;
+  }
+
+  // we're being blocked by a write, must queue - only a reference is held,
+  // the contents are shared with all other subscribers
+  PendingRequest req;
+  req.sharedResp = shared;
+  req.heldBytes = shared.view().size();
+  req.coalesceKey = std::move(coalesceKey);
+  holdMessageNoLock(std::move(req));
   return 1;
 }
 
+PendingQueue::~PendingQueue() {
+  OutputBufferLimits::heldBytes -= heldBytes;
+}
+
+void PendingQueue::popFrontNoLock() {
+  heldBytes -= pending.front().heldBytes;
+  OutputBufferLimits::heldBytes -= pending.front().heldBytes;
+  pending.pop_front();
+}
+
+void PendingQueue::setMonitor() {
+  std::scoped_lock lock(mtx);
+  monitor = true;
+}
+
+ClientClass PendingQueue::getClientClassNoLock() const {
+  if(monitor) return ClientClass::kMonitor;
+  if(!subscriptionTracker.empty()) return ClientClass::kPubSub;
+  return ClientClass::kNormal;
+}
+
+OutputBufferInfo PendingQueue::getOutputBufferInfo() {
+  std::scoped_lock lock(mtx);
+
+  OutputBufferInfo info;
+  info.clientClass = getClientClassNoLock();
+  info.heldBytes = heldBytes;
+  info.peakBytes = peakBytes;
+  info.queuedBytes = conn ? conn->link->getQueuedBytes() : 0;
+  info.droppedMessages = droppedMessages;
+  info.coalescedMessages = coalescedMessages;
+  return info;
+}
+
+//------------------------------------------------------------------------------
+// Check whether holding the given total amount of bytes would put us over the
+// limit, taking into account how long we've been above the soft limit.
+//------------------------------------------------------------------------------
+bool PendingQueue::exceedsLimitNoLock(const OutputBufferLimit &limit, size_t total) {
+  if(limit.hardLimit != 0 && total > limit.hardLimit) {
+    return true;
+  }
+
+  if(limit.softLimit == 0 || total <= limit.softLimit) {
+    overSoftLimit = false;
+    return false;
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(!overSoftLimit) {
+    overSoftLimit = true;
+    overSoftLimitSince = now;
+  }
+
+  return now - overSoftLimitSince >= limit.softSeconds;
+}
+
+//------------------------------------------------------------------------------
+// Make room for the given amount of incoming bytes - the message to hold,
+// plus whatever is still queued on the link: First drop any held messages
+// superseded by it, if a coalesce key is given, then the oldest held
+// messages, until we're within limits again.
+//------------------------------------------------------------------------------
+void PendingQueue::dropHeldNoLock(const OutputBufferLimit &limit, size_t incoming, const std::string *coalesceKey) {
+  size_t target = limit.softLimit != 0 ? limit.softLimit : limit.hardLimit;
+
+  for(size_t pass = 0; pass < 2; pass++) {
+    auto it = pending.begin();
+
+    while(it != pending.end() && heldBytes + incoming > target) {
+      bool superseded = (pass == 0 && coalesceKey && !it->coalesceKey.empty() && it->coalesceKey == *coalesceKey);
+
+      if(it->heldBytes == 0 || (pass == 0 && !superseded)) {
+        it++;
+        continue;
+      }
+
+      if(pass == 0) {
+        coalescedMessages++;
+        OutputBufferLimits::coalescedMessages++;
+      }
+      else {
+        droppedMessages++;
+        OutputBufferLimits::droppedMessages++;
+      }
+
+      heldBytes -= it->heldBytes;
+      OutputBufferLimits::heldBytes -= it->heldBytes;
+      it = pending.erase(it);
+    }
+  }
+
+  if(heldBytes + incoming <= target) {
+    overSoftLimit = false;
+  }
+}
+
+void PendingQueue::disconnectSlowConsumerNoLock() {
+  if(slowConsumerDisconnected) return;
+  slowConsumerDisconnected = true;
+  OutputBufferLimits::disconnects++;
+
+  qdb_warn("Disconnecting slow consumer " << conn->describe() << " (" << clientClassToString(getClientClassNoLock()) << "), holding " << heldBytes << " bytes of unsent messages");
+
+  // Free everything held, responses to our own requests excepted
+  for(auto it = pending.begin(); it != pending.end(); ) {
+    if(it->heldBytes == 0) {
+      it++;
+      continue;
+    }
+
+    heldBytes -= it->heldBytes;
+    OutputBufferLimits::heldBytes -= it->heldBytes;
+    it = pending.erase(it);
+  }
+
+  conn->requestClose();
+}
+
+//------------------------------------------------------------------------------
+// Send out a published message or MONITOR line right away, unless the link is
+// already sitting on more unsent bytes than our output buffer limits allow.
+// Bytes handed over to the link cannot be taken back, so short of
+// disconnecting, it's the incoming message which gets dropped. Returns false
+// if the connection had to be shut down.
+//------------------------------------------------------------------------------
+bool PendingQueue::sendMessageNoLock(std::string_view msg) {
+  OutputBufferLimit limit = OutputBufferLimits::get(getClientClassNoLock());
+
+  if(!limit.unlimited() && exceedsLimitNoLock(limit, heldBytes + conn->link->getQueuedBytes() + msg.size())) {
+    if(limit.policy == SlowConsumerPolicy::kDisconnect) {
+      disconnectSlowConsumerNoLock();
+      return false;
+    }
+
+    droppedMessages++;
+    OutputBufferLimits::droppedMessages++;
+    return true;
+  }
+
+  conn->writer.send(msg);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Hold a message in the queue, applying the slow-consumer policy if we're
+// over our output buffer limits. Bytes already queued on the link count
+// towards the limits as well. Returns false if the connection had to be
+// shut down.
+//------------------------------------------------------------------------------
+bool PendingQueue::holdMessageNoLock(PendingRequest &&req) {
+  OutputBufferLimit limit = OutputBufferLimits::get(getClientClassNoLock());
+  size_t queued = conn->link->getQueuedBytes();
+
+  if(!limit.unlimited() && exceedsLimitNoLock(limit, heldBytes + queued + req.heldBytes)) {
+    if(limit.policy == SlowConsumerPolicy::kDisconnect) {
+      disconnectSlowConsumerNoLock();
+      return false;
+    }
+
+    const std::string *coalesceKey = nullptr;
+    if(limit.policy == SlowConsumerPolicy::kCoalesce && !req.coalesceKey.empty()) {
+      coalesceKey = &req.coalesceKey;
+    }
+
+    dropHeldNoLock(limit, queued + req.heldBytes, coalesceKey);
+
+    if(limit.hardLimit != 0 && heldBytes + queued + req.heldBytes > limit.hardLimit) {
+      // Doesn't fit even with nothing else held
+      droppedMessages++;
+      OutputBufferLimits::droppedMessages++;
+      return true;
+    }
+  }
+
+  heldBytes += req.heldBytes;
+  peakBytes = std::max(peakBytes, heldBytes);
+  OutputBufferLimits::heldBytes += req.heldBytes;
+  pending.push_back(std::move(req));
+  return true;
+}
+
+void PendingQueue::sendHeldResponse(PendingRequest &req) {
+  if(!conn) return;
+
+  if(!req.sharedResp.empty()) {
+    conn->writer.send(req.sharedResp.view());
+  }
+  else {
+    conn->writer.send(req.rawResp);
+  }
+}
+
 LinkStatus PendingQueue::appendResponse(RedisEncodedResponse &&raw) {
   std::scoped_lock lock(mtx);
   return appendResponseNoLock(std::move(raw));
@@ -123,7 +351,7 @@ LinkStatus PendingQueue::addPendingTransaction(RedisDispatcher *dispatcher, Tran
     // This is a read, and we're not being blocked by any writes. Forward directly
     // to the state machine, no need to do any queueing.
     qdb_assert(!tx.containsWrites());
-    return conn->writer.send(dispatcher->dispatch(tx, 0).val);
+    return conn->writer.send(dispatcher->dispatch(tx, 0));
   }
 
   if(index > 0) {
@@ -137,7 +365,7 @@ LinkStatus PendingQueue::addPendingTransaction(RedisDispatcher *dispatcher, Tran
   PendingRequest penreq;
   penreq.tx = std::move(tx);
   penreq.index = index;
-  pending.push(std::move(penreq));
+  pending.push_back(std::move(penreq));
   return 1;
 }
 
@@ -153,8 +381,8 @@ LogIndex PendingQueue::dispatchPending(RedisDispatcher *dispatcher, LogIndex com
       return req.index;
     }
 
-    if(!req.rawResp.empty()) {
-      if(conn) conn->writer.send(std::move(req.rawResp.val));
+    if(req.holdsResponse()) {
+      sendHeldResponse(req);
     }
     else {
       if(req.index > 0) {
@@ -166,10 +394,10 @@ LogIndex PendingQueue::dispatchPending(RedisDispatcher *dispatcher, LogIndex com
       // we must dispatch the request even if the connection has died, since
       // writes increase lastApplied of the state machine
       RedisEncodedResponse response = dispatcher->dispatch(req.tx, req.index);
-      if(conn) conn->writer.send(std::move(response.val));
+      if(conn) conn->writer.send(response);
     }
 
-    pending.pop();
+    popFrontNoLock();
   }
 
   if(!found) qdb_throw("entry with index " << commitIndex << " not found");
@@ -178,6 +406,65 @@ LogIndex PendingQueue::dispatchPending(RedisDispatcher *dispatcher, LogIndex com
   return -1;
 }
 
+bool PendingQueue::stagePending(RedisDispatcher *dispatcher, StagingArea &stagingArea, LogIndex commitIndex, LogIndex &blockingIndex) {
+  std::scoped_lock lock(mtx);
+
+  // Skip over anything staged by earlier entries of the same group, as well
+  // as raw responses queued behind them
+  auto it = pending.begin();
+  while(it != pending.end() && it->holdsResponse()) it++;
+
+  if(it == pending.end() || it->index != commitIndex) {
+    qdb_throw("queue corruption: " << this << " expected entry with index " << commitIndex << " while staging");
+  }
+
+  if(!dispatcher->stageIntoGroup(stagingArea, it->tx, it->rawResp)) {
+    return false;
+  }
+
+  // Reads queued behind this write must see its effects, but not those of the
+  // next one - stage them too.
+  for(it++; it != pending.end(); it++) {
+    if(it->holdsResponse()) continue;
+
+    if(it->index > 0) {
+      if(it->index <= commitIndex) qdb_throw("queue corruption: " << this << " found entry with index " << it->index << " behind " << commitIndex);
+      blockingIndex = it->index;
+      return true;
+    }
+
+    qdb_assert(dispatcher->stageIntoGroup(stagingArea, it->tx, it->rawResp));
+  }
+
+  blockingIndex = -1;
+  return true;
+}
+
+void PendingQueue::releaseStaged(RedisDispatcher *dispatcher) {
+  std::scoped_lock lock(mtx);
+  Connection::FlushGuard guard(conn);
+
+  while(!pending.empty()) {
+    PendingRequest &req = pending.front();
+
+    if(req.holdsResponse()) {
+      sendHeldResponse(req);
+    }
+    else if(req.index > 0) {
+      // blocked by a write which is not part of the group
+      return;
+    }
+    else {
+      // a read which arrived after staging - the group is committed by now,
+      // serve it as usual
+      RedisEncodedResponse response = dispatcher->dispatch(req.tx, req.index);
+      if(conn) conn->writer.send(response);
+    }
+
+    popFrontNoLock();
+  }
+}
+
 void PendingQueue::activatePushTypes() {
   supportsPushTypes = true;
 }
@@ -201,10 +488,15 @@ std::string Connection::getName() const {
 }
 
 Connection::Connection(Link *l)
-: writer(l), parser(l), pendingQueue(new PendingQueue(this)),
+: link(l), writer(l), parser(l), pendingQueue(new PendingQueue(this)),
   description(l->describe()), uuid(l->getID()), localhost(l->isLocalhost()) {
 }
 
+void Connection::requestClose() {
+  closeRequested = true;
+  link->requestClose();
+}
+
 Connection::~Connection() {
   pendingQueue->detachConnection();
 }
@@ -270,6 +562,10 @@ LinkStatus Connection::noauth(std::string_view msg) {
 }
 
 LinkStatus Connection::processRequests(Dispatcher *dispatcher, const InFlightTracker &inFlightTracker) {
+  if(closeRequested) {
+    return -1;
+  }
+
   FlushGuard guard(this);
 
   while(inFlightTracker.isAcceptingRequests()) {
@@ -362,6 +658,18 @@ std::string Connection::describe() const {
   return description;
 }
 
+std::string Connection::describeWithHostname() const {
+  return link->describeWithHostname();
+}
+
+std::string Connection::getAddress() const {
+  return link->getAddress();
+}
+
+std::string Connection::getHostname() const {
+  return link->getHostname();
+}
+
 void Connection::activatePushTypes() {
   pendingQueue->activatePushTypes();
 }
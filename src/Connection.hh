@@ -31,8 +31,11 @@
 #include "redis/MultiHandler.hh"
 #include "redis/Authenticator.hh"
 #include "pubsub/SubscriptionTracker.hh"
+#include "pubsub/EncodedMessage.hh"
+#include "redis/OutputBufferLimits.hh"
 #include "utils/Synchronized.hh"
-#include <queue>
+#include <deque>
+#include <chrono>
 
 namespace rocksdb {
   class Status;
@@ -52,10 +55,24 @@ namespace quarkdb {
 
 class Connection;
 class RedisDispatcher;
+class StagingArea;
+
+//------------------------------------------------------------------------------
+// Output buffer state of a single connection, for CLIENT INFO.
+//------------------------------------------------------------------------------
+struct OutputBufferInfo {
+  ClientClass clientClass = ClientClass::kNormal;
+  size_t heldBytes = 0;
+  size_t peakBytes = 0;
+  size_t queuedBytes = 0;
+  int64_t droppedMessages = 0;
+  int64_t coalescedMessages = 0;
+};
+
 class PendingQueue {
 public:
   PendingQueue(Connection *c) : conn(c) {}
-  ~PendingQueue() {}
+  ~PendingQueue();
 
   void detachConnection() {
     std::scoped_lock lock(mtx);
@@ -66,6 +83,19 @@ public:
   LinkStatus appendResponse(RedisEncodedResponse &&raw);
   LinkStatus addPendingTransaction(RedisDispatcher *dispatcher, Transaction &&tx, LogIndex index = -1);
   LogIndex dispatchPending(RedisDispatcher *dispatcher, LogIndex commitIndex);
+
+  //----------------------------------------------------------------------------
+  // Group commit: Stage the write with the given index, plus any reads queued
+  // right behind it, into a shared StagingArea. Responses are held in the
+  // queue until releaseStaged() is called, after the entire group has been
+  // committed.
+  //
+  // Returns false, having staged nothing, if the write cannot join a group.
+  // Otherwise, blockingIndex is set to the index of the next write in the
+  // queue, or -1 if there's none.
+  //----------------------------------------------------------------------------
+  bool stagePending(RedisDispatcher *dispatcher, StagingArea &stagingArea, LogIndex commitIndex, LogIndex &blockingIndex);
+  void releaseStaged(RedisDispatcher *dispatcher);
   bool appendIfAttached(RedisEncodedResponse &&raw);
   bool appendIfAttachedNoLock(RedisEncodedResponse &&raw);
   size_t subscriptions = 0u;
@@ -76,14 +106,34 @@ public:
   void unsubscribe(const std::string &item);
   void punsubscribe(const std::string &item);
 
-  bool addMessageIfAttached(const std::string &channel, std::string_view payload);
-  bool addPatternMessageIfAttached(const std::string &pattern, std::string_view channel, std::string_view payload);
+  //----------------------------------------------------------------------------
+  // Deliver a published message, if we're still attached and subscribed to
+  // the given channel or pattern. The message is encoded on first use by any
+  // subscriber, and the encoded buffer shared with all the rest.
+  //----------------------------------------------------------------------------
+  bool addMessageIfAttached(const std::string &channel, EncodedMessage &msg);
+  bool addPatternMessageIfAttached(const std::string &pattern, EncodedMessage &msg);
+
+  //----------------------------------------------------------------------------
+  // Deliver a MONITOR line, if we're still attached.
+  //----------------------------------------------------------------------------
+  bool addMonitorMessageIfAttached(RedisEncodedResponse &&raw);
+
+  //----------------------------------------------------------------------------
+  // Output buffer accounting. Published messages and MONITOR lines which
+  // cannot be written out immediately are held in the queue, subject to the
+  // output buffer limits of our client class. Responses to our own requests
+  // are never dropped.
+  //----------------------------------------------------------------------------
+  void setMonitor();
+  OutputBufferInfo getOutputBufferInfo();
 
   void activatePushTypes();
   bool hasPushTypesActive() const;
 
 private:
   LinkStatus appendResponseNoLock(RedisEncodedResponse &&raw);
+  LinkStatus appendSharedResponseNoLock(const SharedEncodedResponse &shared, std::string &&coalesceKey);
   Connection *conn;
   std::mutex mtx;
 
@@ -108,14 +158,39 @@ private:
 
   struct PendingRequest {
     Transaction tx;
-    RedisEncodedResponse rawResp; // if not empty, we're just storing a raw, pre-formatted response
+    RedisEncodedResponse rawResp; // if not empty, we're just storing a raw, pre-formatted response, or the response of a staged request
+    SharedEncodedResponse sharedResp; // if not empty, we're storing a published message, shared with other subscribers
     LogIndex index = -1; // the corresponding entry in the raft journal - only relevant for write requests
+    size_t heldBytes = 0; // if not zero, this is a message subject to output buffer limits
+    std::string coalesceKey; // messages with the same key supersede one another under kCoalesce
+
+    bool holdsResponse() const {
+      return !rawResp.empty() || !sharedResp.empty();
+    }
   };
 
+  void sendHeldResponse(PendingRequest &req);
+  bool sendMessageNoLock(std::string_view msg);
+  void popFrontNoLock();
+  ClientClass getClientClassNoLock() const;
+  bool holdMessageNoLock(PendingRequest &&req);
+  bool exceedsLimitNoLock(const OutputBufferLimit &limit, size_t total);
+  void dropHeldNoLock(const OutputBufferLimit &limit, size_t incoming, const std::string *coalesceKey);
+  void disconnectSlowConsumerNoLock();
+
   LogIndex lastIndex = -1;
-  std::queue<PendingRequest> pending;
+  std::deque<PendingRequest> pending;
   SubscriptionTracker subscriptionTracker;
   std::atomic<bool> supportsPushTypes {false};
+
+  bool monitor = false;
+  bool slowConsumerDisconnected = false;
+  size_t heldBytes = 0;
+  size_t peakBytes = 0;
+  int64_t droppedMessages = 0;
+  int64_t coalescedMessages = 0;
+  bool overSoftLimit = false;
+  std::chrono::steady_clock::time_point overSoftLimitSince;
 };
 
 //------------------------------------------------------------------------------
@@ -132,6 +207,14 @@ public:
   std::string describe() const;
   std::string getID() const { return uuid; }
 
+  //----------------------------------------------------------------------------
+  // getHostname and describeWithHostname fall back to the numeric address
+  // until the reverse lookup has completed in the background - see Link.
+  //----------------------------------------------------------------------------
+  std::string getAddress() const;
+  std::string getHostname() const;
+  std::string describeWithHostname() const;
+
   LinkStatus raw(RedisEncodedResponse &&encoded);
   LinkStatus moved(int64_t shardId, const RaftServer &location);
   LinkStatus err(std::string_view msg);
@@ -153,9 +236,11 @@ public:
     // There's no function setting monitor back to false. This is intentional,
     // there's no going back after issuing 'MONITOR'.
     monitor = true;
+    pendingQueue->setMonitor();
   }
 
   bool raftStaleReads = false;
+  bool raftFollowerReads = false;
   bool raftAuthorization = false;
   bool authorization = false;
   std::unique_ptr<Authenticator> authenticator;
@@ -204,7 +289,19 @@ public:
   void setName(std::string_view name);
   std::string getName() const;
 
+  //----------------------------------------------------------------------------
+  // Thread-safe: Ask for this connection to be closed. The link is never
+  // touched from the calling thread - from now on, processRequests reports a
+  // link error, and whichever thread is serving the link closes it.
+  //
+  // Asio links are woken up right away. XrdLinks cannot be woken up from
+  // outside: They're only closed once the client sends something, and
+  // xrootd hands the link back to us.
+  //----------------------------------------------------------------------------
+  void requestClose();
+
 private:
+  Link *link;
   BufferedWriter writer;
 
   RedisRequest currentRequest;
@@ -216,6 +313,7 @@ private:
   bool localhost;
 
   Synchronized<std::string> clientName;
+  std::atomic<bool> closeRequested {false};
 
   MultiHandler multiHandler;
   friend class PendingQueue;
@@ -31,6 +31,7 @@
 #include "Dispatcher.hh"
 #include "Utils.hh"
 #include "Formatter.hh"
+#include <atomic>
 
 using namespace quarkdb;
 
@@ -128,21 +129,196 @@ RedisEncodedResponse RedisDispatcher::dispatch(StagingArea &stagingArea, Transac
 }
 
 RedisEncodedResponse RedisDispatcher::dispatch(Transaction &transaction, LogIndex commit) {
-  StagingArea stagingArea(store, !transaction.containsWrites());
+  if(!transaction.containsWrites()) {
+    StagingArea stagingArea(store, true);
+    RedisEncodedResponse resp = dispatch(stagingArea, transaction);
+    store.getRequestCounter().account(transaction);
+    return resp;
+  }
 
+  StagingArea stagingArea(store, getLockSet(transaction));
   RedisEncodedResponse resp = dispatch(stagingArea, transaction);
+  stagingArea.commit(commit);
+
+  VersionedHashRevisionTracker &revisionTracker = stagingArea.getRevisionTracker();
+  if(!revisionTracker.empty()) {
+    publisher.schedulePublishing(std::move(revisionTracker));
+  }
+
+  store.getRequestCounter().account(transaction);
+  return resp;
+}
+
+//------------------------------------------------------------------------------
+// Collect the keys a single write touches. Anything not listed here touches
+// state beyond its own keys - FLUSHALL, leases and the clock, configuration,
+// nested transactions - and needs the entire keyspace.
+//------------------------------------------------------------------------------
+static void collectLockedKeys(const RedisRequest &req, KeyLockSet &locks) {
+  switch(req.getCommand()) {
+    case RedisCommand::SET:
+    case RedisCommand::HSET:
+    case RedisCommand::HMSET:
+    case RedisCommand::HSETNX:
+    case RedisCommand::HINCRBY:
+    case RedisCommand::HINCRBYFLOAT:
+    case RedisCommand::HDEL:
+    case RedisCommand::SADD:
+    case RedisCommand::SREM:
+    case RedisCommand::DEQUE_PUSH_FRONT:
+    case RedisCommand::DEQUE_POP_FRONT:
+    case RedisCommand::DEQUE_PUSH_BACK:
+    case RedisCommand::DEQUE_POP_BACK:
+    case RedisCommand::DEQUE_TRIM_FRONT:
+    case RedisCommand::DEQUE_CLEAR:
+    case RedisCommand::LHSET:
+    case RedisCommand::LHDEL:
+    case RedisCommand::LHLOCDEL:
+    case RedisCommand::LHMSET:
+    case RedisCommand::VHSET:
+    case RedisCommand::VHDEL: {
+      if(req.size() < 2) break;
+      locks.add(req[1]);
+      return;
+    }
+    case RedisCommand::DEL:
+    case RedisCommand::UNLINK: {
+      if(req.size() < 2) break;
+      for(size_t i = 1; i < req.size(); i++) {
+        locks.add(req[i]);
+      }
+      return;
+    }
+    case RedisCommand::HINCRBYMULTI: {
+      if(req.size() < 2) break;
+      for(size_t i = 1; i < req.size(); i += 3) {
+        locks.add(req[i]);
+      }
+      return;
+    }
+    case RedisCommand::HCLONE:
+    case RedisCommand::SMOVE: {
+      if(req.size() < 3) break;
+      locks.add(req[1]);
+      locks.add(req[2]);
+      return;
+    }
+    case RedisCommand::LHDEL_WITH_FALLBACK:
+    case RedisCommand::CONVERT_HASH_FIELD_TO_LHASH: {
+      if(req.size() < 4) break;
+      locks.add(req[1]);
+      locks.add(req[3]);
+      return;
+    }
+    case RedisCommand::LHSET_AND_DEL_FALLBACK: {
+      if(req.size() < 6) break;
+      locks.add(req[1]);
+      locks.add(req[5]);
+      return;
+    }
+    default: {
+      break;
+    }
+  }
+
+  locks.lockEverything();
+}
 
-  if(transaction.containsWrites()) {
-    stagingArea.commit(commit);
+KeyLockSet RedisDispatcher::getLockSet(const RedisRequest &req) {
+  KeyLockSet locks;
 
-    VersionedHashRevisionTracker &revisionTracker = stagingArea.getRevisionTracker();
-    if(!revisionTracker.empty()) {
-      publisher.schedulePublishing(std::move(revisionTracker));
+  if(req.getCommandType() == CommandType::WRITE) {
+    collectLockedKeys(req, locks);
+  }
+
+  return locks;
+}
+
+KeyLockSet RedisDispatcher::getLockSet(const Transaction &transaction) {
+  KeyLockSet locks;
+
+  // A real MULTI / EXEC must look atomic to everyone, including to readers
+  // of keys it doesn't write to - don't bother, and lock everything.
+  // Phantom transactions are merely pipelined requests batched together,
+  // only the keys being written need protection.
+  if(!transaction.isPhantom() && transaction.size() > 1) {
+    locks.lockEverything();
+    return locks;
+  }
+
+  for(size_t i = 0; i < transaction.size(); i++) {
+    if(transaction[i].getCommandType() == CommandType::WRITE) {
+      collectLockedKeys(transaction[i], locks);
     }
   }
 
+  return locks;
+}
+
+//------------------------------------------------------------------------------
+// Changed through CONFIG SET while dispatching threads read it - atomic, but
+// it orders nothing else, so relaxed is enough.
+//------------------------------------------------------------------------------
+static std::atomic<size_t> groupCommitLimit {64};
+
+void RedisDispatcher::setGroupCommitLimit(size_t newval) {
+  groupCommitLimit.store(newval, std::memory_order_relaxed);
+}
+
+size_t RedisDispatcher::getGroupCommitLimit() {
+  return groupCommitLimit.load(std::memory_order_relaxed);
+}
+
+bool RedisDispatcher::isGroupable(const RedisRequest &req) {
+  // Versioned hashes bump their version only once per write batch.
+  return req.getCommand() != RedisCommand::VHSET && req.getCommand() != RedisCommand::VHDEL;
+}
+
+bool RedisDispatcher::isGroupable(const Transaction &transaction) {
+  for(size_t i = 0; i < transaction.size(); i++) {
+    if(!isGroupable(transaction[i])) return false;
+  }
+
+  return true;
+}
+
+bool RedisDispatcher::stageIntoGroup(StagingArea &stagingArea, RedisRequest &req, RedisEncodedResponse &resp) {
+  if(req.getCommandType() != CommandType::WRITE) {
+    // Journal markers, which also show up as INVALID
+    return false;
+  }
+
+  if(req.getCommand() == RedisCommand::TX_READWRITE) {
+    Transaction transaction;
+    qdb_assert(transaction.deserialize(req));
+    if(!isGroupable(transaction)) return false;
+
+    resp = dispatch(stagingArea, transaction);
+  }
+  else {
+    if(!isGroupable(req)) return false;
+    resp = dispatchWrite(stagingArea, req);
+  }
+
+  store.getRequestCounter().account(req);
+  return true;
+}
+
+bool RedisDispatcher::stageIntoGroup(StagingArea &stagingArea, Transaction &transaction, RedisEncodedResponse &resp) {
+  if(!isGroupable(transaction)) return false;
+
+  resp = dispatch(stagingArea, transaction);
   store.getRequestCounter().account(transaction);
-  return resp;
+  return true;
+}
+
+void RedisDispatcher::commitGroup(StagingArea &stagingArea, LogIndex firstIndex, LogIndex lastIndex) {
+  stagingArea.commit(firstIndex, lastIndex);
+
+  VersionedHashRevisionTracker &revisionTracker = stagingArea.getRevisionTracker();
+  if(!revisionTracker.empty()) {
+    publisher.schedulePublishing(std::move(revisionTracker));
+  }
 }
 
 RedisEncodedResponse RedisDispatcher::dispatchLHSET(StagingArea &stagingArea, std::string_view key, std::string_view field, std::string_view hint, std::string_view value) {
@@ -187,6 +363,26 @@ RedisEncodedResponse RedisDispatcher::dispatchWrite(StagingArea &stagingArea, Re
       if(!st.ok()) return Formatter::fromStatus(st);
       return Formatter::integer(count);
     }
+    case RedisCommand::UNLINK: {
+      if(request.size() <= 1) return errArgs(request);
+      int64_t count = 0;
+      rocksdb::Status st = store.unlink(stagingArea, request.begin()+1, request.end(), count);
+      if(!st.ok()) return Formatter::fromStatus(st);
+      return Formatter::integer(count);
+    }
+    case RedisCommand::LAZYFREE_RECLAIM: {
+      if(request.size() != 2) return errArgs(request);
+
+      int64_t batchSize = 0;
+      if(!ParseUtils::parseInt64(request[1], batchSize) || batchSize < 1) {
+        return Formatter::err("value is not an integer or out of range");
+      }
+
+      int64_t reclaimed = 0;
+      rocksdb::Status st = store.reclaim(stagingArea, batchSize, reclaimed);
+      if(!st.ok()) return Formatter::fromStatus(st);
+      return Formatter::integer(reclaimed);
+    }
     case RedisCommand::HSET: {
       if(request.size() != 4) return errArgs(request);
 
@@ -532,13 +728,13 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
       }
 
       std::string newcursor;
-      std::vector<std::string> vec;
-      rocksdb::Status st = store.scan(stagingArea, args.cursor, args.match, args.count, newcursor, vec);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.scan(stagingArea, args.cursor, args.match, args.count, newcursor, builder);
       if(!st.ok()) return Formatter::fromStatus(st);
 
       if(newcursor == "") newcursor = "0";
       else newcursor = "next:" + newcursor;
-      return Formatter::scan(newcursor, vec);
+      return builder.buildScanResponse(newcursor);
     }
     case RedisCommand::HGET: {
       if(request.size() != 3) return errArgs(request);
@@ -553,17 +749,17 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
     }
     case RedisCommand::HKEYS: {
       if(request.size() != 2) return errArgs(request);
-      std::vector<std::string> keys;
-      rocksdb::Status st = store.hkeys(stagingArea, request[1], keys);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.hkeys(stagingArea, request[1], builder);
       if(!st.ok()) return Formatter::fromStatus(st);
-      return Formatter::vector(keys);
+      return builder.buildResponse();
     }
     case RedisCommand::HGETALL: {
       if(request.size() != 2) return errArgs(request);
-      std::vector<std::string> vec;
-      rocksdb::Status st = store.hgetall(stagingArea, request[1], vec);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.hgetall(stagingArea, request[1], builder);
       if(!st.ok()) return Formatter::fromStatus(st);
-      return Formatter::vector(vec);
+      return builder.buildResponse();
     }
     case RedisCommand::HLEN: {
       if(request.size() != 2) return errArgs(request);
@@ -574,9 +770,9 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
     }
     case RedisCommand::HVALS: {
       if(request.size() != 2) return errArgs(request);
-      std::vector<std::string> values;
-      rocksdb::Status st = store.hvals(stagingArea, request[1], values);
-      return Formatter::vector(values);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.hvals(stagingArea, request[1], builder);
+      return builder.buildResponse();
     }
     case RedisCommand::HSCAN: {
       if(request.size() < 3) return errArgs(request);
@@ -587,13 +783,13 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
       }
 
       std::string newcursor;
-      std::vector<std::string> vec;
-      rocksdb::Status st = store.hscan(stagingArea, request[1], args.cursor, args.count, newcursor, vec);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.hscan(stagingArea, request[1], args.cursor, args.count, newcursor, builder);
       if(!st.ok()) return Formatter::fromStatus(st);
 
       if(newcursor == "") newcursor = "0";
       else newcursor = "next:" + newcursor;
-      return Formatter::scan(newcursor, vec);
+      return builder.buildScanResponse(newcursor);
     }
     case RedisCommand::SISMEMBER: {
       if(request.size() != 3) return errArgs(request);
@@ -604,10 +800,10 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
     }
     case RedisCommand::SMEMBERS: {
       if(request.size() != 2) return errArgs(request);
-      std::vector<std::string> members;
-      rocksdb::Status st = store.smembers(stagingArea, request[1], members);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.smembers(stagingArea, request[1], builder);
       if(!st.ok()) return Formatter::fromStatus(st);
-      return Formatter::vector(members);
+      return builder.buildResponse();
     }
     case RedisCommand::SCARD: {
       if(request.size() != 2) return errArgs(request);
@@ -625,13 +821,13 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
       }
 
       std::string newcursor;
-      std::vector<std::string> vec;
-      rocksdb::Status st = store.sscan(stagingArea, request[1], args.cursor, args.count, newcursor, vec);
+      ArrayResponseBuilder builder;
+      rocksdb::Status st = store.sscan(stagingArea, request[1], args.cursor, args.count, newcursor, builder);
       if(!st.ok()) return Formatter::fromStatus(st);
 
       if(newcursor == "") newcursor = "0";
       else newcursor = "next:" + newcursor;
-      return Formatter::scan(newcursor, vec);
+      return builder.buildScanResponse(newcursor);
     }
     case RedisCommand::DEQUE_LEN: {
       if(request.size() != 2) return errArgs(request);
@@ -808,11 +1004,11 @@ RedisEncodedResponse RedisDispatcher::dispatchRead(StagingArea &stagingArea, Red
     }
     case RedisCommand::VHGETALL: {
       if(request.size() != 2) return errArgs(request);
-      std::vector<std::string> vec;
+      ArrayResponseBuilder builder;
       uint64_t version = 0u;
-      rocksdb::Status st = store.vhgetall(stagingArea, request[1], vec, version);
+      rocksdb::Status st = store.vhgetall(stagingArea, request[1], builder, version);
       if(!st.ok()) return Formatter::fromStatus(st);
-      return Formatter::versionedVector(version, vec);
+      return builder.buildVersionedResponse(version);
     }
     case RedisCommand::TX_READONLY: {
       // Unpack transaction and process
@@ -878,14 +1074,17 @@ RedisEncodedResponse RedisDispatcher::dispatchReadWrite(StagingArea &stagingArea
 }
 
 RedisEncodedResponse RedisDispatcher::dispatchReadWriteAndCommit(RedisRequest &request, LogIndex commit) {
-  StagingArea stagingArea(store, request.getCommandType() == CommandType::READ);
-
-  RedisEncodedResponse response = dispatchReadWrite(stagingArea, request);
+  if(request.getCommandType() == CommandType::READ) {
+    StagingArea stagingArea(store, true);
+    RedisEncodedResponse response = dispatchReadWrite(stagingArea, request);
+    store.getRequestCounter().account(request);
+    return response;
+  }
 
   // Handle writes in a separate function, use batch write API
-  if(request.getCommandType() == CommandType::WRITE) {
-    stagingArea.commit(commit);
-  }
+  StagingArea stagingArea(store, getLockSet(request));
+  RedisEncodedResponse response = dispatchReadWrite(stagingArea, request);
+  stagingArea.commit(commit);
 
   store.getRequestCounter().account(request);
   return response;
@@ -28,6 +28,7 @@
 #include "Link.hh"
 #include "Commands.hh"
 #include "Connection.hh"
+#include "storage/KeyLockTable.hh"
 
 namespace quarkdb {
 
@@ -39,6 +40,16 @@ public:
   virtual LinkStatus dispatch(Connection *conn, Transaction &multiOp) = 0;
   virtual void notifyDisconnect(Connection *conn) = 0;
 
+  //----------------------------------------------------------------------------
+  // Submit a write originating from quarkdb itself, rather than a client.
+  // The response is discarded. Returns false if we can't accept writes right
+  // now, for example when not being the raft leader. Otherwise, index is set
+  // to the journal entry holding the write, once applied.
+  //----------------------------------------------------------------------------
+  virtual bool submitInternalWrite(RedisRequest &&req, LogIndex &index) {
+    return false;
+  }
+
   RedisEncodedResponse handlePing(RedisRequest &req);
   RedisEncodedResponse handleConversion(RedisRequest &req);
   virtual ~Dispatcher() {}
@@ -56,7 +67,40 @@ public:
 
   RedisEncodedResponse dispatch(RedisRequest &req, LogIndex commit);
   RedisEncodedResponse dispatch(Transaction &transaction, LogIndex commit);
+
+  //----------------------------------------------------------------------------
+  // Group commit: Consecutive writes can be staged into a single, externally
+  // owned StagingArea, and then committed together with commitGroup - one
+  // rocksdb write and one lastApplied update for the entire group.
+  //
+  // stageIntoGroup returns false without touching the StagingArea if the
+  // given request must be applied on its own, through dispatch(). This is the
+  // case for journal markers, and versioned hash writes: Their outcome depends
+  // on what else the write batch contains, so fusing them with other entries
+  // would change the result.
+  //----------------------------------------------------------------------------
+  bool stageIntoGroup(StagingArea &stagingArea, RedisRequest &req, RedisEncodedResponse &resp);
+  bool stageIntoGroup(StagingArea &stagingArea, Transaction &transaction, RedisEncodedResponse &resp);
+  void commitGroup(StagingArea &stagingArea, LogIndex firstIndex, LogIndex lastIndex);
+
+  //----------------------------------------------------------------------------
+  // Maximum number of entries fused into a single group. A limit of 1
+  // disables group commit.
+  //----------------------------------------------------------------------------
+  static void setGroupCommitLimit(size_t newval);
+  static size_t getGroupCommitLimit();
+
+  //----------------------------------------------------------------------------
+  // The write lock stripes needed to stage the given request or transaction.
+  // Global for anything which touches more than the keys it names.
+  //----------------------------------------------------------------------------
+  static KeyLockSet getLockSet(const RedisRequest &req);
+  static KeyLockSet getLockSet(const Transaction &transaction);
+
 private:
+  static bool isGroupable(const RedisRequest &req);
+  static bool isGroupable(const Transaction &transaction);
+
   RedisEncodedResponse dispatchReadOnly(StagingArea &stagingArea, Transaction &transaction);
   RedisEncodedResponse dispatch(StagingArea &stagingArea, Transaction &transaction);
   RedisEncodedResponse dispatchReadWrite(StagingArea &stagingArea, RedisRequest &req);
@@ -26,6 +26,7 @@
 #include "Common.hh"
 #include "Formatter.hh"
 #include "redis/ArrayResponseBuilder.hh"
+#include "redis/RespEncoder.hh"
 #include "redis/Transaction.hh"
 #include "utils/Statistics.hh"
 using namespace quarkdb;
@@ -35,7 +36,12 @@ RedisEncodedResponse Formatter::moved(int64_t shardId, const RaftServer &locatio
 }
 
 RedisEncodedResponse Formatter::err(std::string_view err) {
-  return RedisEncodedResponse(SSTR("-ERR " << err << "\r\n"));
+  std::string ret;
+  ret.reserve(5 + err.size() + 2);
+  ret.append("-ERR ");
+  ret.append(err);
+  ret.append("\r\n");
+  return RedisEncodedResponse(std::move(ret));
 }
 
 RedisEncodedResponse Formatter::errArgs(std::string_view cmd) {
@@ -44,27 +50,19 @@ RedisEncodedResponse Formatter::errArgs(std::string_view cmd) {
 }
 
 RedisEncodedResponse Formatter::pong() {
-  return RedisEncodedResponse(SSTR("+PONG\r\n"));
-}
-
-void Formatter::string(std::ostringstream &ss, std::string_view str) {
-  ss  << "$" << str.length() << "\r\n" << str << "\r\n";
+  return RedisEncodedResponse("+PONG\r\n");
 }
 
 RedisEncodedResponse Formatter::string(std::string_view str) {
-  std::ostringstream ss;
-  Formatter::string(ss, str);
-  return RedisEncodedResponse(ss.str());
-}
-
-void Formatter::status(std::ostringstream &ss, std::string_view str) {
-  ss << "+" << str << "\r\n";
+  RespEncoder encoder(RespEncoder::stringLength(str));
+  encoder.string(str);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::status(std::string_view str) {
-  std::ostringstream ss;
-  status(ss, str);
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::statusLength(str));
+  encoder.status(str);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::ok() {
@@ -75,18 +73,10 @@ RedisEncodedResponse Formatter::null() {
   return RedisEncodedResponse("$-1\r\n");
 }
 
-void Formatter::integer(std::ostringstream &ss, int64_t number) {
-  ss << ":" << number << "\r\n";
-}
-
-void Formatter::uint64(std::ostringstream &ss, uint64_t number) {
-  ss << ":" << number << "\r\n";
-}
-
 RedisEncodedResponse Formatter::integer(int64_t number) {
-  std::ostringstream ss;
-  integer(ss, number);
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::integerLength(number));
+  encoder.integer(number);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::fromStatus(const rocksdb::Status &status) {
@@ -95,50 +85,38 @@ RedisEncodedResponse Formatter::fromStatus(const rocksdb::Status &status) {
 }
 
 RedisEncodedResponse Formatter::vector(const std::vector<std::string> &vec) {
-  std::stringstream ss;
-  ss << "*" << vec.size() << "\r\n";
-  for(std::vector<std::string>::const_iterator it = vec.begin(); it != vec.end(); it++) {
-    ss << "$" << it->length() << "\r\n";
-    ss << *it << "\r\n";
-  }
-  return RedisEncodedResponse(ss.str());
-}
-
-void Formatter::statusVector(std::ostringstream &ss, const std::vector<std::string> &vec) {
-  ss << "*" << vec.size() << "\r\n";
-  for(std::vector<std::string>::const_iterator it = vec.begin(); it != vec.end(); it++) {
-    ss << "+" << *it << "\r\n";
-  }
+  RespEncoder encoder(RespEncoder::vectorLength(vec));
+  encoder.vector(vec);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::statusVector(const std::vector<std::string> &vec) {
-  std::ostringstream ss;
-  statusVector(ss, vec);
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::statusVectorLength(vec));
+  encoder.statusVector(vec);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::scan(std::string_view marker, const std::vector<std::string> &vec) {
-  std::stringstream ss;
-  ss << "*2\r\n";
-  ss << "$" << marker.length() << "\r\n";
-  ss << marker << "\r\n";
-
-  ss << "*" << vec.size() << "\r\n";
-  for(std::vector<std::string>::const_iterator it = vec.begin(); it != vec.end(); it++) {
-    ss << "$" << it->length() << "\r\n";
-    ss << *it << "\r\n";
-  }
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::headerLength(2) + RespEncoder::stringLength(marker) + RespEncoder::vectorLength(vec));
+  encoder.arrayHeader(2);
+  encoder.string(marker);
+  encoder.vector(vec);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::simpleRedisRequest(const RedisRequest &req) {
-  std::vector<std::string> vec;
+  size_t length = RespEncoder::headerLength(req.size());
+  for(size_t i = 0; i < req.size(); i++) {
+    length += RespEncoder::stringLength(req[i]);
+  }
 
+  RespEncoder encoder(length);
+  encoder.arrayHeader(req.size());
   for(size_t i = 0; i < req.size(); i++) {
-    vec.emplace_back(req[i]);
+    encoder.string(req[i]);
   }
 
-  return Formatter::vector(vec);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::redisRequest(const RedisRequest &req) {
@@ -184,14 +162,14 @@ RedisEncodedResponse Formatter::raftEntry(const RaftEntry &entry, bool raw, LogI
 }
 
 RedisEncodedResponse Formatter::raftEntries(const std::vector<RaftEntry> &entries, bool raw) {
-  std::stringstream ss;
-  ss << "*" << entries.size() << "\r\n";
+  RespEncoder encoder;
+  encoder.arrayHeader(entries.size());
 
   for(size_t i = 0; i < entries.size(); i++) {
-    ss << Formatter::raftEntry(entries[i], raw).val;
+    encoder.raw(Formatter::raftEntry(entries[i], raw).val);
   }
 
-  return RedisEncodedResponse(ss.str());
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::journalScan(LogIndex cursor, const std::vector<RaftEntryWithIndex> &entries) {
@@ -204,61 +182,68 @@ RedisEncodedResponse Formatter::journalScan(LogIndex cursor, const std::vector<R
     marker = SSTR("next:" << cursor);
   }
 
-  std::stringstream ss;
-  ss << "*2\r\n";
-  ss << "$" << marker.length() << "\r\n";
-  ss << marker << "\r\n";
+  RespEncoder encoder;
+  encoder.arrayHeader(2);
+  encoder.string(marker);
 
-  ss << "*" << entries.size() << "\r\n";
+  encoder.arrayHeader(entries.size());
   for(size_t i = 0; i < entries.size(); i++) {
-    ss << Formatter::raftEntry(entries[i].entry, false, entries[i].index).val;
+    encoder.raw(Formatter::raftEntry(entries[i].entry, false, entries[i].index).val);
   }
 
-  return RedisEncodedResponse(ss.str());
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::noauth(std::string_view str) {
-  return RedisEncodedResponse(SSTR("-NOAUTH " << str << "\r\n"));
+  std::string ret;
+  ret.reserve(8 + str.size() + 2);
+  ret.append("-NOAUTH ");
+  ret.append(str);
+  ret.append("\r\n");
+  return RedisEncodedResponse(std::move(ret));
 }
 
 RedisEncodedResponse Formatter::versionedVector(uint64_t num, const std::vector<std::string> &vec) {
-  std::ostringstream ss;
-  ss << "*2\r\n";
-  ss << ":" << num << "\r\n";
-
-  ss << "*" << vec.size() << "\r\n";
-  for(auto it = vec.begin(); it != vec.end(); it++) {
-    ss << "$" << it->length() << "\r\n";
-    ss << *it << "\r\n";
-  }
-
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::headerLength(2) + RespEncoder::uint64Length(num) + RespEncoder::vectorLength(vec));
+  encoder.arrayHeader(2);
+  encoder.uint64(num);
+  encoder.vector(vec);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::vhashRevision(uint64_t rev, const std::vector<std::pair<std::string_view, std::string_view>> &contents) {
-  std::ostringstream ss;
+  size_t length = RespEncoder::headerLength(2) + RespEncoder::uint64Length(rev) + RespEncoder::headerLength(contents.size()*2);
+  for(size_t i = 0; i < contents.size(); i++) {
+    length += RespEncoder::stringLength(contents[i].first) + RespEncoder::stringLength(contents[i].second);
+  }
 
-  ss << "*2\r\n";
-  Formatter::uint64(ss, rev);
+  RespEncoder encoder(length);
+  encoder.arrayHeader(2);
+  encoder.uint64(rev);
 
-  ss << "*" << contents.size()*2 << "\r\n";
+  encoder.arrayHeader(contents.size()*2);
   for(size_t i = 0; i < contents.size(); i++) {
-    Formatter::string(ss, contents[i].first);
-    Formatter::string(ss, contents[i].second);
+    encoder.string(contents[i].first);
+    encoder.string(contents[i].second);
   }
 
-  return RedisEncodedResponse(ss.str());
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::multiply(const RedisEncodedResponse &resp, size_t factor) {
   qdb_assert(factor >= 1);
 
-  std::ostringstream ss;
+  if(factor == 1) {
+    return resp;
+  }
+
+  RespEncoder encoder(resp.size() * factor);
   for(size_t i = 0; i < factor; i++) {
-    ss << resp.val;
+    encoder.raw(resp.header);
+    encoder.raw(resp.val);
   }
 
-  return RedisEncodedResponse(ss.str());
+  return encoder.build();
 }
 
 //------------------------------------------------------------------------------
@@ -279,20 +264,21 @@ RedisEncodedResponse Formatter::vectorsWithHeaders(const std::vector<std::string
 
   qdb_assert(headers.size() == data.size());
 
-  std::ostringstream ss;
-  ss << "*" << headers.size() << "\r\n";
-
+  size_t length = RespEncoder::headerLength(headers.size());
   for(size_t i = 0; i < headers.size(); i++) {
-    ss << "*2\r\n";
-    ss << "+" << headers[i] << "\r\n";
+    length += RespEncoder::headerLength(2) + RespEncoder::statusLength(headers[i]) + RespEncoder::statusVectorLength(data[i]);
+  }
 
-    ss << "*" << data[i].size() << "\r\n";
-    for(size_t j = 0; j < data[i].size(); j++) {
-      ss << "+" << data[i][j] << "\r\n";
-    }
+  RespEncoder encoder(length);
+  encoder.arrayHeader(headers.size());
+
+  for(size_t i = 0; i < headers.size(); i++) {
+    encoder.arrayHeader(2);
+    encoder.status(headers[i]);
+    encoder.statusVector(data[i]);
   }
 
-  return RedisEncodedResponse(ss.str());
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::stats(const Statistics &stats) {
@@ -337,60 +323,58 @@ RedisEncodedResponse Formatter::punsubscribe(bool pushType, std::string_view pat
 }
 
 RedisEncodedResponse Formatter::message(bool pushType, std::string_view channel, std::string_view payload) {
-  std::ostringstream ss;
+  RespEncoder encoder(RespEncoder::headerLength(4) + RespEncoder::stringLength("pubsub") + RespEncoder::stringLength("message") +
+    RespEncoder::stringLength(channel) + RespEncoder::stringLength(payload));
 
   if(pushType) {
-    ss << ">4\r\n" "$6\r\npubsub\r\n";
+    encoder.raw(">4\r\n" "$6\r\npubsub\r\n");
   }
   else {
-    ss << "*3\r\n";
+    encoder.raw("*3\r\n");
   }
 
-  ss << "$7\r\nmessage\r\n";
-  ss << "$" << channel.size() << "\r\n";
-  ss << channel << "\r\n";
-  ss << "$" << payload.size() << "\r\n";
-  ss << payload << "\r\n";
-  return RedisEncodedResponse(ss.str());
+  encoder.raw("$7\r\nmessage\r\n");
+  encoder.string(channel);
+  encoder.string(payload);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::pmessage(bool pushType, std::string_view pattern, std::string_view channel, std::string_view payload) {
-  std::ostringstream ss;
+  RespEncoder encoder(RespEncoder::headerLength(5) + RespEncoder::stringLength("pubsub") + RespEncoder::stringLength("pmessage") +
+    RespEncoder::stringLength(pattern) + RespEncoder::stringLength(channel) + RespEncoder::stringLength(payload));
 
   if(pushType) {
-    ss << ">5\r\n" "$6\r\npubsub\r\n";
+    encoder.raw(">5\r\n" "$6\r\npubsub\r\n");
   }
   else {
-    ss << "*4\r\n";
+    encoder.raw("*4\r\n");
   }
 
-  ss << "$8\r\npmessage\r\n";
-  ss << "$" << pattern.size() << "\r\n";
-  ss << pattern << "\r\n";
-  ss << "$" << channel.size() << "\r\n";
-  ss << channel << "\r\n";
-  ss << "$" << payload.size() << "\r\n";
-  ss << payload << "\r\n";
-  return RedisEncodedResponse(ss.str());
+  encoder.raw("$8\r\npmessage\r\n");
+  encoder.string(pattern);
+  encoder.string(channel);
+  encoder.string(payload);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::strstrint(std::string_view str1, std::string_view str2, int num) {
-  std::ostringstream ss;
-  ss << "*3\r\n";
-  Formatter::string(ss, str1);
-  Formatter::string(ss, str2);
-  Formatter::integer(ss, num);
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::headerLength(3) + RespEncoder::stringLength(str1) + RespEncoder::stringLength(str2) + RespEncoder::integerLength(num));
+  encoder.arrayHeader(3);
+  encoder.string(str1);
+  encoder.string(str2);
+  encoder.integer(num);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::pushStrstrstrint(std::string_view str1, std::string_view str2, std::string_view str3, int num) {
-  std::ostringstream ss;
-  ss << ">4\r\n";
-  Formatter::string(ss, str1);
-  Formatter::string(ss, str2);
-  Formatter::string(ss, str3);
-  Formatter::integer(ss, num);
-  return RedisEncodedResponse(ss.str());
+  RespEncoder encoder(RespEncoder::headerLength(4) + RespEncoder::stringLength(str1) + RespEncoder::stringLength(str2) +
+    RespEncoder::stringLength(str3) + RespEncoder::integerLength(num));
+  encoder.pushHeader(4);
+  encoder.string(str1);
+  encoder.string(str2);
+  encoder.string(str3);
+  encoder.integer(num);
+  return encoder.build();
 }
 
 RedisEncodedResponse Formatter::nodeHealth(const NodeHealth &nh) {
@@ -39,16 +39,8 @@ struct Statistics;
 class Formatter {
 public:
   //----------------------------------------------------------------------------
-  // Composable overloads
-  //----------------------------------------------------------------------------
-  static void statusVector(std::ostringstream &ss, const std::vector<std::string> &vec);
-  static void status(std::ostringstream &ss, std::string_view str);
-  static void string(std::ostringstream &ss, std::string_view str);
-  static void integer(std::ostringstream &ss, int64_t number);
-  static void uint64(std::ostringstream &ss, uint64_t number);
-
-  //----------------------------------------------------------------------------
-  // One-shot overloads
+  // One-shot overloads. To compose several elements into a single response,
+  // use RespEncoder or ArrayResponseBuilder.
   //----------------------------------------------------------------------------
   static RedisEncodedResponse moved(int64_t shardId, const RaftServer &srv);
   static RedisEncodedResponse err(std::string_view msg);
@@ -29,6 +29,8 @@
 #include "Utils.hh"
 #include "utils/Uuid.hh"
 #include "utils/Stacktrace.hh"
+#include "netio/AsioOutputQueue.hh"
+#include "netio/HostnameCache.hh"
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
@@ -59,11 +61,14 @@ Link::Link(const qclient::TlsConfig &tlsconfig_)
   uuid = generateUuid();
 }
 
-Link::Link(asio::ip::tcp::socket &socket, const std::string &hostname, qclient::TlsConfig tlsconfig_)
+Link::Link(asio::io_context &context, asio::ip::tcp::socket &socket, const std::string &address, HostnameCache *cache, qclient::TlsConfig tlsconfig_)
 : Link(tlsconfig_) {
   asioSocket = &socket;
+  asioOutput = std::make_shared<AsioOutputQueue>(context, socket);
   uuid = generateUuid();
-  host = hostname;
+  host = address;
+  hostnameCache = cache;
+
   if(connectionLogging) qdb_info("New link from " << describe());
 }
 
@@ -85,6 +90,7 @@ Link::Link(XrdLink *lp, qclient::TlsConfig tlsconfig_)
 
 Link::~Link() {
   if(connectionLogging) qdb_info("Shutting down link from " << describe());
+  if(asioOutput) asioOutput->detach();
   Close();
 }
 
@@ -92,6 +98,19 @@ std::string Link::describe() const {
   return SSTR(host << " [" << uuid << "]");
 }
 
+std::string Link::describeWithHostname() const {
+  return SSTR(getHostname() << " [" << uuid << "]");
+}
+
+std::string Link::getHostname() const {
+  std::string hostname;
+  if(hostnameCache && hostnameCache->lookup(host, hostname)) {
+    return hostname;
+  }
+
+  return host;
+}
+
 void Link::preventXrdLinkClose() {
   xrdLinkCloseDisabled = true;
 }
@@ -168,16 +187,16 @@ LinkStatus Link::asioRecv(char *buff, int blen, int timeout) {
 }
 
 LinkStatus Link::asioSend(const char *buff, int blen) {
-  asio::error_code ec;
-  int bytesWritten = asio::write(*asioSocket, asio::buffer(buff, blen), ec);
-  if(ec.value() != 0) {
+  if(!asioOutput->enqueue(buff, blen)) {
     return -1;
   }
 
-  return bytesWritten;
+  return blen;
 }
 
 LinkStatus Link::asioClose(int defer) {
+  asioOutput->shutdown();
+
   asio::error_code ignored_ec;
   asioSocket->shutdown(asio::ip::tcp::socket::shutdown_both, ignored_ec);
   return 0;
@@ -225,6 +244,30 @@ LinkStatus Link::fdClose(int defer) {
   return close(fd);
 }
 
+size_t Link::getQueuedBytes() const {
+  if(!asioOutput) return 0;
+  return asioOutput->getQueuedBytes();
+}
+
+bool Link::resumeWhenDrained(std::function<void()> callback) {
+  if(!asioOutput) return false;
+  return asioOutput->resumeWhenDrained(std::move(callback));
+}
+
+bool Link::closeWhenDrained(std::function<void()> callback) {
+  if(!asioOutput) return false;
+  return asioOutput->closeWhenDrained(std::move(callback));
+}
+
+asio::io_context::strand& Link::getAsioStrand() {
+  qdb_assert(asioOutput);
+  return asioOutput->getStrand();
+}
+
+void Link::requestClose() {
+  if(asioOutput) asioOutput->requestClose();
+}
+
 void Link::overrideHost(const std::string &newhost) {
   host = newhost;
 }
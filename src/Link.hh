@@ -28,9 +28,14 @@
 #include "Xrd/XrdLink.hh"
 #include <qclient/QClient.hh>
 #include <asio.hpp>
+#include <functional>
+#include <memory>
 
 namespace quarkdb {
 
+class AsioOutputQueue;
+class HostnameCache;
+
 //------------------------------------------------------------------------------
 // Return code from XrdLink.
 // 1 or higher means success. The value is typically the number of bytes read.
@@ -46,7 +51,12 @@ using LinkStatus = int;
 //------------------------------------------------------------------------------
 class Link {
 public:
-  Link(asio::ip::tcp::socket &socket, const std::string &hostname, qclient::TlsConfig tlsconfig_);
+  //----------------------------------------------------------------------------
+  // Link over an accepted asio socket, identified by the numeric address of
+  // the peer. Its hostname is only looked up when asked for, through the
+  // given cache.
+  //----------------------------------------------------------------------------
+  Link(asio::io_context &context, asio::ip::tcp::socket &socket, const std::string &address, HostnameCache *cache, qclient::TlsConfig tlsconfig_);
   Link(const qclient::TlsConfig &tlsconfig_);
 
   Link(XrdLink *lp, qclient::TlsConfig tlsconfig = {} );
@@ -63,12 +73,50 @@ public:
   std::string describe() const;
   std::string getID() const { return uuid; }
 
+  //----------------------------------------------------------------------------
+  // Same as describe(), but identifies the peer by hostname, if cached. Only
+  // for when somebody actually asks.
+  //----------------------------------------------------------------------------
+  std::string describeWithHostname() const;
+
+  //----------------------------------------------------------------------------
+  // Numeric address of the peer for asio links, hostname for XrdLinks.
+  //----------------------------------------------------------------------------
+  std::string getAddress() const { return host; }
+
+  //----------------------------------------------------------------------------
+  // Hostname of the peer. Never waits on the resolver: If it's not cached,
+  // returns the numeric address, and has it looked up in the background.
+  //----------------------------------------------------------------------------
+  std::string getHostname() const;
+
   bool isLocalhost() const;
   void overrideHost(const std::string &host);
 
   // Set global connection logging config
   static void setConnectionLogging(bool val);
 
+  //----------------------------------------------------------------------------
+  // Sending on an asio link never blocks, it only queues - these expose the
+  // state of the queue. Always zero / false on any other kind of link.
+  // See AsioOutputQueue.
+  //----------------------------------------------------------------------------
+  size_t getQueuedBytes() const;
+  bool resumeWhenDrained(std::function<void()> callback);
+  bool closeWhenDrained(std::function<void()> callback);
+
+  //----------------------------------------------------------------------------
+  // Asio links only: The strand on which all I/O of this link happens.
+  //----------------------------------------------------------------------------
+  asio::io_context::strand& getAsioStrand();
+
+  //----------------------------------------------------------------------------
+  // Thread-safe: For asio links, fail any further sends, and cancel any
+  // pending operation on the socket through the strand, so the poller wakes
+  // up. No-op on any other kind of link.
+  //----------------------------------------------------------------------------
+  void requestClose();
+
   // Prevent closing an underlying XrdLink, if any. Use this if
   // the xrootd machinery calls XrdProtocol::Reset, which takes care
   // of closing the link on its own.
@@ -83,11 +131,13 @@ private:
   bool dead = false;
   int fd = -1;
   asio::ip::tcp::socket *asioSocket = nullptr;
+  std::shared_ptr<AsioOutputQueue> asioOutput;
 
   bool xrdLinkCloseDisabled = false;
 
   std::string uuid;
   std::string host;
+  HostnameCache *hostnameCache = nullptr;
 
   LinkStatus asioRecv(char *buff, int blen, int timeout);
   LinkStatus asioSend(const char *buff, int blen);
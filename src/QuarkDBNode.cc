@@ -26,6 +26,7 @@
 #include "Version.hh"
 #include "Shard.hh"
 #include "ShardDirectory.hh"
+#include "netio/AsioPoller.hh"
 #include "utils/FileUtils.hh"
 #include "utils/ScopedAdder.hh"
 #include "utils/TimeFormatting.hh"
@@ -47,6 +48,13 @@ QuarkDBNode::QuarkDBNode(const Configuration &config, const RaftTimeouts &t,
 
   bootStart = std::chrono::steady_clock::now();
 
+  for(const auto &limit : configuration.getOutputBufferLimits()) {
+    qdb_info("Setting output buffer limit for " << clientClassToString(limit.first) << " clients: " << limit.second.toString());
+    OutputBufferLimits::set(limit.first, limit.second);
+  }
+
+  StateMachine::setReversedKeyIndex(configuration.getReversedKeyIndex());
+
   if(injectedDirectory) {
     shardDirectory = injectedDirectory; // no ownership!!!
   }
@@ -116,6 +124,23 @@ LinkStatus QuarkDBNode::dispatch(Connection *conn, RedisRequest &req) {
         if(req.size() != 2) return conn->errArgs(req[0]);
         return conn->string(conn->getName());
       }
+      else if(caseInsensitiveEquals(req[1], "info")) {
+        if(req.size() != 2) return conn->errArgs(req[0]);
+
+        OutputBufferInfo outputBuffer = conn->getQueue()->getOutputBufferInfo();
+        std::vector<std::string> ret;
+        ret.emplace_back(SSTR("ID " << conn->getID()));
+        ret.emplace_back(SSTR("NAME " << conn->getName()));
+        ret.emplace_back(SSTR("ADDRESS " << conn->getAddress()));
+        ret.emplace_back(SSTR("HOSTNAME " << conn->getHostname()));
+        ret.emplace_back(SSTR("CLASS " << clientClassToString(outputBuffer.clientClass)));
+        ret.emplace_back(SSTR("OUTPUT-BUFFER-BYTES " << outputBuffer.heldBytes));
+        ret.emplace_back(SSTR("OUTPUT-BUFFER-PEAK-BYTES " << outputBuffer.peakBytes));
+        ret.emplace_back(SSTR("OUTPUT-QUEUE-BYTES " << outputBuffer.queuedBytes));
+        ret.emplace_back(SSTR("OUTPUT-BUFFER-DROPPED " << outputBuffer.droppedMessages));
+        ret.emplace_back(SSTR("OUTPUT-BUFFER-COALESCED " << outputBuffer.coalescedMessages));
+        return conn->statusVector(ret);
+      }
 
       return conn->err("malformed request");
     }
@@ -149,7 +174,7 @@ LinkStatus QuarkDBNode::dispatch(Connection *conn, RedisRequest &req) {
       return conn->ok();
     }
     case RedisCommand::QUARKDB_INFO: {
-      return conn->statusVector(this->info().toVector());
+      return conn->statusVector(this->info(asioPoller).toVector());
     }
     case RedisCommand::QUARKDB_VERSION: {
       return conn->string(VERSION_FULL_STRING);
@@ -174,12 +199,15 @@ LinkStatus QuarkDBNode::dispatch(Connection *conn, RedisRequest &req) {
   }
 }
 
-QuarkDBInfo QuarkDBNode::info() {
+QuarkDBInfo QuarkDBNode::info(AsioPoller *poller) {
   return {configuration.getMode(), configuration.getDatabase(),
     configuration.getConfigurationPath(),
     VERSION_FULL_STRING, SSTR(ROCKSDB_MAJOR << "." << ROCKSDB_MINOR << "." << ROCKSDB_PATCH),
     SSTR(XrdVERSION), chooseWorstHealth(shard->getHealth().getIndicators()),
-    shard->monitors(), std::chrono::duration_cast<std::chrono::seconds>(bootEnd - bootStart).count(), std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - bootEnd).count()
+    shard->monitors(), std::chrono::duration_cast<std::chrono::seconds>(bootEnd - bootStart).count(), std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - bootEnd).count(),
+    shard->getLatencySummary(), shard->getReclamationStats(), shard->getKeyDescriptorCacheStats(),
+    OutputBufferLimits::getStats(), OutputBufferLimits::describe(),
+    poller ? poller->describe() : std::vector<std::string>()
   };
 }
 
@@ -195,5 +223,30 @@ std::vector<std::string> QuarkDBInfo::toVector() const {
   ret.emplace_back(SSTR("MONITORS " << monitors));
   ret.emplace_back(SSTR("BOOT-TIME " << bootTime << " (" << formatTime(std::chrono::seconds(bootTime)) << ")"));
   ret.emplace_back(SSTR("UPTIME " << uptime << " (" << formatTime(std::chrono::seconds(uptime)) << ")"));
+  ret.emplace_back(SSTR("RECLAMATION-PENDING-PREFIXES " << reclamation.pendingPrefixes));
+  ret.emplace_back(SSTR("RECLAMATION-PENDING-ELEMENTS " << reclamation.pendingElements));
+  ret.emplace_back(SSTR("RECLAMATION-RECLAIMED-ELEMENTS " << reclamation.reclaimedElements));
+  ret.emplace_back(SSTR("KEY-DESCRIPTOR-CACHE-ENTRIES " << descriptorCache.entries));
+  ret.emplace_back(SSTR("KEY-DESCRIPTOR-CACHE-HITS " << descriptorCache.hits));
+  ret.emplace_back(SSTR("KEY-DESCRIPTOR-CACHE-MISSES " << descriptorCache.misses));
+  ret.emplace_back(SSTR("KEY-DESCRIPTOR-CACHE-HIT-RATE " << descriptorCache.hitRate()));
+  ret.emplace_back(SSTR("OUTPUT-BUFFER-BYTES " << outputBuffers.heldBytes));
+  ret.emplace_back(SSTR("OUTPUT-QUEUE-BYTES " << outputBuffers.queuedBytes));
+  ret.emplace_back(SSTR("OUTPUT-BUFFER-DROPPED " << outputBuffers.droppedMessages));
+  ret.emplace_back(SSTR("OUTPUT-BUFFER-COALESCED " << outputBuffers.coalescedMessages));
+  ret.emplace_back(SSTR("OUTPUT-BUFFER-DISCONNECTS " << outputBuffers.disconnects));
+
+  for(size_t i = 0; i < outputBufferLimits.size(); i++) {
+    ret.emplace_back(SSTR("OUTPUT-BUFFER-LIMIT " << outputBufferLimits[i]));
+  }
+
+  for(size_t i = 0; i < networkShards.size(); i++) {
+    ret.emplace_back(SSTR("NETWORK-SHARD " << networkShards[i]));
+  }
+
+  for(size_t i = 0; i < latencies.size(); i++) {
+    ret.emplace_back(SSTR("LATENCY " << latencies[i]));
+  }
+
   return ret;
 }
@@ -31,6 +31,9 @@
 #include "raft/RaftTimeouts.hh"
 #include "auth/AuthenticationDispatcher.hh"
 #include "health/HealthIndicator.hh"
+#include "storage/LazyFreer.hh"
+#include "storage/KeyDescriptorCache.hh"
+#include "redis/OutputBufferLimits.hh"
 
 namespace quarkdb {
 
@@ -46,11 +49,17 @@ struct QuarkDBInfo {
   size_t monitors;
   int64_t bootTime;
   int64_t uptime;
+  std::vector<std::string> latencies;
+  ReclamationStats reclamation;
+  KeyDescriptorCacheStats descriptorCache;
+  OutputBufferStats outputBuffers;
+  std::vector<std::string> outputBufferLimits;
+  std::vector<std::string> networkShards;
 
   std::vector<std::string> toVector() const;
 };
 
-class Shard; class ShardDirectory;
+class Shard; class ShardDirectory; class AsioPoller;
 
 class QuarkDBNode : public Dispatcher {
 public:
@@ -69,6 +78,14 @@ public:
     return shard.get();
   }
 
+  //----------------------------------------------------------------------------
+  // The poller serving us, if any, for QUARKDB_INFO. Detach it before
+  // destroying the poller.
+  //----------------------------------------------------------------------------
+  void attachPoller(AsioPoller *poller) {
+    asioPoller = poller;
+  }
+
 private:
   bool isAuthenticated(Connection *conn) const;
 
@@ -78,7 +95,8 @@ private:
   Configuration configuration;
   ShardDirectory *shardDirectory;
 
-  QuarkDBInfo info();
+  QuarkDBInfo info(AsioPoller *poller);
+  std::atomic<AsioPoller*> asioPoller {nullptr};
 
   std::atomic<bool> shutdown {false};
   const RaftTimeouts timeouts;
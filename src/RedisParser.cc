@@ -82,40 +82,83 @@ int RedisParser::fetch(RedisRequest &req, bool authenticated) {
   return 1;
 }
 
-int RedisParser::readInteger(char prefix, int &retval) {
-  std::string prev;
+//------------------------------------------------------------------------------
+// Parse a complete integer line, such as "*3\r\n" or "$12\r\n", without any
+// allocations.
+//------------------------------------------------------------------------------
+static int parseIntegerLine(std::string_view line, char prefix, int &retval) {
+  if(line[0] != prefix) {
+    qdb_warn("Redis protocol error, expected an integer with preceeding " << quotes(prefix) << ", received " << quotes(line[0]) << " instead (byte in decimal: " << int(line[0]) << ")");
+    return -1;
+  }
 
-  while(prev[0] != '\n') {
-    int rlen = reader.consume(1, prev);
-    if(rlen <= 0) return rlen;
+  if(line.size() < 3 || line[line.size()-2] != '\r') {
+    qdb_warn("Redis protocol error, received \\n without preceeding \\r");
+    return -1;
+  }
 
-    current_integer.append(prev);
+  std::string_view digits = line.substr(1, line.size()-3);
+  bool negative = false;
+
+  if(!digits.empty() && digits[0] == '-') {
+    negative = true;
+    digits.remove_prefix(1);
   }
 
-  if(current_integer[0] != prefix) {
-    qdb_warn("Redis protocol error, expected an integer with preceeding " << quotes(prefix) << ", received " << quotes(current_integer[0]) << " instead (byte in decimal: " << int(current_integer[0]) << ")");
+  // Anything beyond 10 digits does not fit in an int anyway
+  if(digits.empty() || digits.size() > 10) {
+    qdb_warn("Redis protocol error, received an invalid integer");
     return -1;
   }
 
-  if(current_integer[current_integer.size()-2] != '\r') {
-    qdb_warn("Redis protocol error, received \\n without preceeding \\r");
-    return -1;
+  int64_t num = 0;
+  for(size_t i = 0; i < digits.size(); i++) {
+    if(digits[i] < '0' || digits[i] > '9') {
+      qdb_warn("Redis protocol error, received an invalid integer");
+      return -1;
+    }
+
+    num = (num * 10) + (digits[i] - '0');
   }
 
-  current_integer.erase(current_integer.size()-2, 2);
+  if(negative) num = -num;
 
-  char *endptr;
-  long num = strtol(current_integer.c_str()+1, &endptr, 10);
-  if(*endptr != '\0' || num == LONG_MIN || num == LONG_MAX) {
+  if(num < INT_MIN || num > INT_MAX) {
     qdb_warn("Redis protocol error, received an invalid integer");
     return -1;
   }
 
-  current_integer = "";
   retval = num;
   return 1; // success
 }
 
+int RedisParser::readInteger(char prefix, int &retval) {
+  if(current_integer.empty()) {
+    // Fast path: The entire line is already available within a single buffer,
+    // parse in-place.
+    std::string_view line;
+    int rlen = reader.consumeLineInPlace(line);
+    if(rlen < 0) return rlen;
+    if(rlen > 0) return parseIntegerLine(line, prefix, retval);
+  }
+
+  // Slow path: The integer is split across buffers, or has only partially
+  // arrived. Accumulate byte-by-byte into current_integer, which survives
+  // across calls.
+  std::string prev;
+
+  while(prev[0] != '\n') {
+    int rlen = reader.consume(1, prev);
+    if(rlen <= 0) return rlen;
+
+    current_integer.append(prev);
+  }
+
+  int rc = parseIntegerLine(current_integer, prefix, retval);
+  current_integer.clear();
+  return rc;
+}
+
 int RedisParser::readElement(PinnedBuffer &str, bool authenticated) {
   if(element_size == -1) {
     int retcode = readInteger('$', element_size);
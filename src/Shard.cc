@@ -27,7 +27,9 @@
 #include "StandaloneGroup.hh"
 #include "raft/RaftGroup.hh"
 #include "raft/RaftDispatcher.hh"
+#include "storage/LazyFreer.hh"
 #include "redis/LeaseFilter.hh"
+#include "utils/ParseUtils.hh"
 #include "utils/ScopedAdder.hh"
 #include "utils/VectorUtils.hh"
 #include "Version.hh"
@@ -46,6 +48,7 @@ void Shard::attach() {
     standaloneGroup.reset(new StandaloneGroup(*shardDirectory, false));
     dispatcher = standaloneGroup->getDispatcher();
     stateMachine = standaloneGroup->getStateMachine();
+    lazyFreer.reset(new LazyFreer(*stateMachine, *dispatcher));
   }
   else if(mode == Mode::raft) {
     raftGroup.reset(new RaftGroup(*shardDirectory, myself, timeouts, password));
@@ -77,6 +80,7 @@ void Shard::stopAcceptingRequests() {
 
 void Shard::detach() {
   if(!inFlightTracker.isAcceptingRequests()) return;
+  lazyFreer.reset();
   stopAcceptingRequests();
   qdb_info("All requests processed, detaching.");
 
@@ -101,21 +105,35 @@ RaftGroup* Shard::getRaftGroup() {
 void Shard::spinup() {
   raftGroup->spinup();
   dispatcher = static_cast<Dispatcher*>(raftGroup->dispatcher());
+  lazyFreer.reset(new LazyFreer(*stateMachine, *dispatcher));
 }
 
 void Shard::spindown() {
+  // The raft dispatcher is about to go away
+  lazyFreer.reset();
   raftGroup->spindown();
 }
 
 LinkStatus Shard::dispatch(Connection *conn, Transaction &transaction) {
-  commandMonitor.broadcast(conn->describe(), transaction);
+  commandMonitor.broadcast(conn, transaction);
 
   InFlightRegistration registration(inFlightTracker);
   if(!registration.ok()) {
     return conn->raw(Formatter::multiply(Formatter::err("unavailable"), transaction.expectedResponses()));
   }
 
-  return dispatcher->dispatch(conn, transaction);
+  // In raft mode, writes and the reads queued behind them are moved into the
+  // pending queue - the transaction is gone by the time dispatch returns.
+  std::vector<RedisCommand> commands;
+  commands.reserve(transaction.size());
+  for(size_t i = 0; i < transaction.size(); i++) {
+    commands.emplace_back(transaction[i].getCommand());
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  LinkStatus ret = dispatcher->dispatch(conn, transaction);
+  stateMachine->getRequestCounter().recordLatency(commands, LatencyStage::kDispatch, std::chrono::steady_clock::now() - start);
+  return ret;
 }
 
 NodeHealth Shard::getHealth() {
@@ -138,8 +156,35 @@ NodeHealth Shard::getHealth() {
   qdb_throw("should never reach here");
 }
 
+std::vector<std::string> Shard::getLatencySummary() {
+  InFlightRegistration registration(inFlightTracker);
+  if(!registration.ok()) {
+    return {};
+  }
+
+  return stateMachine->getRequestCounter().getLatencyTracker().describe();
+}
+
+ReclamationStats Shard::getReclamationStats() {
+  InFlightRegistration registration(inFlightTracker);
+  if(!registration.ok()) {
+    return {};
+  }
+
+  return stateMachine->getReclamationStats();
+}
+
+KeyDescriptorCacheStats Shard::getKeyDescriptorCacheStats() {
+  InFlightRegistration registration(inFlightTracker);
+  if(!registration.ok()) {
+    return {};
+  }
+
+  return stateMachine->getKeyDescriptorCacheStats();
+}
+
 LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
-  commandMonitor.broadcast(conn->describe(), req);
+  commandMonitor.broadcast(conn, req);
 
   if(req.getCommandType() == CommandType::RECOVERY) {
     return conn->err("recovery commands not allowed, not in recovery mode");
@@ -156,7 +201,11 @@ LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
     }
     case RedisCommand::QUARKDB_START_RESILVERING: {
       if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
-      if(req.size() != 2) return conn->errArgs(req[0]);
+
+      // An incremental resilvering gets back the list of files we could reuse,
+      // as a flat array of filename, size pairs.
+      bool incremental = (req.size() == 3 && caseInsensitiveEquals(req[2], "incremental"));
+      if(req.size() != 2 && !incremental) return conn->errArgs(req[0]);
 
       ResilveringEventID eventID(req[1]);
 
@@ -165,6 +214,34 @@ LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
         return conn->err(err);
       }
 
+      if(!incremental) {
+        return conn->ok();
+      }
+
+      std::vector<std::string> reply;
+      for(const ResilveringFileInfo &file : shardDirectory->listReusableFiles()) {
+        reply.emplace_back(file.filename);
+        reply.emplace_back(std::to_string(file.size));
+      }
+
+      return conn->vector(reply);
+    }
+    case RedisCommand::QUARKDB_RESILVERING_REUSE_FILE: {
+      if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
+      if(req.size() != 4) return conn->errArgs(req[0]);
+
+      ResilveringEventID eventID(req[1]);
+
+      uint64_t checksum;
+      if(!ParseUtils::parseUInt64(req[3], checksum)) {
+        return conn->err(SSTR("could not parse file checksum: " << req[3]));
+      }
+
+      std::string err;
+      if(!shardDirectory->resilveringReuse(eventID, req[2], checksum, err)) {
+        return conn->err(err);
+      }
+
       return conn->ok();
     }
     case RedisCommand::QUARKDB_RESILVERING_COPY_FILE: {
@@ -180,6 +257,43 @@ LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
 
       return conn->ok();
     }
+    case RedisCommand::QUARKDB_RESILVERING_COPY_CHUNK: {
+      if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
+      if(req.size() != 6) return conn->errArgs(req[0]);
+
+      ResilveringEventID eventID(req[1]);
+
+      int64_t offset;
+      if(!ParseUtils::parseInt64(req[3], offset)) {
+        return conn->err(SSTR("could not parse chunk offset: " << req[3]));
+      }
+
+      uint64_t checksum;
+      if(!ParseUtils::parseUInt64(req[4], checksum)) {
+        return conn->err(SSTR("could not parse chunk checksum: " << req[4]));
+      }
+
+      std::string err;
+      if(!shardDirectory->resilveringCopyChunk(eventID, req[2], offset, checksum, req[5], err)) {
+        return conn->err(err);
+      }
+
+      return conn->ok();
+    }
+    case RedisCommand::QUARKDB_RESILVERING_FILE_SIZE: {
+      if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
+      if(req.size() != 3) return conn->errArgs(req[0]);
+
+      ResilveringEventID eventID(req[1]);
+
+      int64_t size;
+      std::string err;
+      if(!shardDirectory->resilveringFileSize(eventID, req[2], size, err)) {
+        return conn->err(err);
+      }
+
+      return conn->integer(size);
+    }
     case RedisCommand::QUARKDB_FINISH_RESILVERING: {
       if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
       if(req.size() != 2) return conn->errArgs(req[0]);
@@ -247,12 +361,21 @@ LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
       return conn->raw(Formatter::nodeHealth(getHealth()));
     }
     case RedisCommand::COMMAND_STATS: {
-      if(req.size() != 1) return conn->errArgs(req[0]);
+      if(req.size() > 2) return conn->errArgs(req[0]);
       InFlightRegistration registration(inFlightTracker);
       if(!registration.ok()) {
         return conn->err("unavailable");
       }
 
+      if(req.size() == 2) {
+        if(!caseInsensitiveEquals(req[1], "reset")) {
+          return conn->err(SSTR("unknown argument '" << req[1] << "'"));
+        }
+
+        stateMachine->getRequestCounter().getLatencyTracker().reset();
+        return conn->ok();
+      }
+
       std::vector<std::string> headers;
       std::vector<std::vector<std::string>> data;
       stateMachine->getRequestCounter().fillHistorical(headers, data);
@@ -282,7 +405,9 @@ LinkStatus Shard::dispatch(Connection *conn, RedisRequest &req) {
         return conn->err("unavailable");
       }
 
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
       LinkStatus ret = dispatcher->dispatch(conn, req);
+      stateMachine->getRequestCounter().getLatencyTracker().record(req.getCommand(), LatencyStage::kDispatch, std::chrono::steady_clock::now() - start);
       return ret;
     }
   }
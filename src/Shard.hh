@@ -33,7 +33,9 @@
 
 namespace quarkdb {
 
-class RaftGroup; class ShardDirectory; class StandaloneGroup;
+class RaftGroup; class ShardDirectory; class StandaloneGroup; class LazyFreer;
+struct ReclamationStats;
+struct KeyDescriptorCacheStats;
 
 class Shard : public Dispatcher {
 public:
@@ -49,6 +51,17 @@ public:
   size_t monitors() { return commandMonitor.size(); }
   NodeHealth getHealth();
 
+  //----------------------------------------------------------------------------
+  // Per-command latency percentiles, empty if detached
+  //----------------------------------------------------------------------------
+  std::vector<std::string> getLatencySummary();
+
+  //----------------------------------------------------------------------------
+  // Progress of reclaiming unlinked containers, all zero if detached
+  //----------------------------------------------------------------------------
+  ReclamationStats getReclamationStats();
+  KeyDescriptorCacheStats getKeyDescriptorCacheStats();
+
 private:
   void detach();
   void attach();
@@ -60,6 +73,7 @@ private:
 
   std::unique_ptr<RaftGroup> raftGroup;
   std::unique_ptr<StandaloneGroup> standaloneGroup;
+  std::unique_ptr<LazyFreer> lazyFreer;
 
   StateMachine *stateMachine = nullptr;
   Dispatcher *dispatcher = nullptr;
@@ -25,8 +25,13 @@
 #include "utils/FileUtils.hh"
 #include "StateMachine.hh"
 #include "raft/RaftJournal.hh"
+#include "utils/DirectoryIterator.hh"
+#include "utils/StringUtils.hh"
+#include "../deps/xxhash/xxhash.hh"
 
 #include <sys/stat.h>
+#include <fstream>
+#include <unistd.h>
 
 using namespace quarkdb;
 
@@ -319,6 +324,153 @@ error:
   return false;
 }
 
+uint64_t ShardDirectory::resilveringChecksum(std::string_view contents) {
+  return XXH64(contents.data(), contents.size(), 0);
+}
+
+bool ShardDirectory::resilveringCopyChunk(const ResilveringEventID &id, std::string_view filename, int64_t offset, uint64_t checksum, std::string_view contents, std::string &err) {
+  std::string targetPath = pathJoin(getResilveringArena(id), filename);
+  int64_t currentSize = 0;
+
+  if(resilveringChecksum(contents) != checksum) {
+    err = SSTR("checksum mismatch for chunk of " << filename << " at offset " << offset);
+    goto error;
+  }
+
+  if(!resilveringFileSize(id, filename, currentSize, err)) {
+    goto error;
+  }
+
+  if(offset < 0 || offset > currentSize) {
+    err = SSTR("chunk of " << filename << " at offset " << offset << " would leave a gap, file size is " << currentSize);
+    goto error;
+  }
+
+  if(!mkpath(targetPath, 0755, err)) {
+    goto error;
+  }
+
+  // A fresh start must never write through a hard link to a reused file
+  if(offset == 0) {
+    ::unlink(targetPath.c_str());
+  }
+
+  if(!writeFileAt(targetPath, offset, contents, err)) {
+    goto error;
+  }
+
+  return true;
+
+error:
+  qdb_critical("error during resilveringCopyChunk: " << err);
+  return false;
+}
+
+bool ShardDirectory::resilveringFileSize(const ResilveringEventID &id, std::string_view filename, int64_t &size, std::string &err) {
+  std::string tmp;
+  if(!directoryExists(getResilveringArena(id), tmp)) {
+    err = SSTR("no resilvering in progress with id '" << id << "'");
+    return false;
+  }
+
+  std::string targetPath = pathJoin(getResilveringArena(id), filename);
+  if(!fileExists(targetPath, tmp)) {
+    size = 0;
+    return true;
+  }
+
+  return getFileSize(targetPath, size, err);
+}
+
+bool ShardDirectory::resilveringFileChecksum(const std::string &path, uint64_t &checksum, std::string &err) {
+  std::ifstream stream(path, std::ios::binary);
+  if(!stream.is_open()) {
+    err = SSTR("Unable to open " << path << " for reading");
+    return false;
+  }
+
+  XXH64_state_t *state = XXH64_createState();
+  XXH64_reset(state, 0);
+
+  std::vector<char> buffer(1024 * 1024);
+  while(stream) {
+    stream.read(buffer.data(), buffer.size());
+    XXH64_update(state, buffer.data(), stream.gcount());
+  }
+
+  checksum = XXH64_digest(state);
+  XXH64_freeState(state);
+
+  if(!stream.eof()) {
+    err = SSTR("Unable to read " << path);
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<ResilveringFileInfo> ShardDirectory::listReusableFiles() {
+  std::vector<ResilveringFileInfo> files;
+
+  for(const char *subdir : {"state-machine", "raft-journal"}) {
+    DirectoryIterator dirIterator(pathJoin(currentPath(), subdir));
+
+    struct dirent *entry;
+    while( (entry = dirIterator.next()) ) {
+      if(entry->d_type != DT_REG || !StringUtils::endsWith(entry->d_name, ".sst")) continue;
+
+      ResilveringFileInfo info;
+      info.filename = SSTR(subdir << "/" << entry->d_name);
+
+      // The DB is live, the file might have been compacted away just now
+      std::string err;
+      if(getFileSize(pathJoin(currentPath(), info.filename), info.size, err)) {
+        files.emplace_back(std::move(info));
+      }
+    }
+
+    if(!dirIterator.ok()) {
+      qdb_warn("Unable to list reusable files for resilvering: " << dirIterator.err());
+    }
+  }
+
+  return files;
+}
+
+bool ShardDirectory::resilveringReuse(const ResilveringEventID &id, std::string_view filename, uint64_t checksum, std::string &err) {
+  std::string source = pathJoin(currentPath(), filename);
+  std::string targetPath = pathJoin(getResilveringArena(id), filename);
+
+  if(!directoryExists(getResilveringArena(id), err)) {
+    err = SSTR("no resilvering in progress with id '" << id << "'");
+    return false;
+  }
+
+  uint64_t ourChecksum;
+  if(!resilveringFileChecksum(source, ourChecksum, err)) {
+    return false;
+  }
+
+  if(ourChecksum != checksum) {
+    err = SSTR("Unable to reuse " << filename << " for resilvering: contents differ");
+    return false;
+  }
+
+  if(!mkpath(targetPath, 0755, err)) {
+    return false;
+  }
+
+  ::unlink(targetPath.c_str());
+
+  if(::link(source.c_str(), targetPath.c_str()) != 0) {
+    int localerrno = errno;
+    err = SSTR("Unable to reuse " << filename << " for resilvering: " << strerror(localerrno));
+    return false;
+  }
+
+  return true;
+}
+
 // When calling this function, we assume caller has released any references
 // to the journal and state machine!
 bool ShardDirectory::resilveringFinish(const ResilveringEventID &id, std::string &err) {
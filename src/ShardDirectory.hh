@@ -47,6 +47,13 @@ private:
   const std::string path;
 };
 
+// A file the target of a resilvering already has, which the leader may tell
+// it to reuse instead of sending it over again.
+struct ResilveringFileInfo {
+  std::string filename; // relative to the shard's current contents
+  int64_t size;
+};
+
 using ShardID = std::string;
 using ResilveringEventID = std::string;
 using SnapshotID = std::string;
@@ -78,6 +85,30 @@ public:
 
   bool resilveringStart(const ResilveringEventID &id, std::string &err);
   bool resilveringCopy(const ResilveringEventID &id, std::string_view filename, std::string_view contents, std::string &err);
+
+  // Streaming resilvering: Files arrive in chunks, each carrying a checksum of
+  // its contents. A chunk must start at or before the current end of the file
+  // - anything past its offset is discarded, so a sender resuming after a
+  // network blip may safely resend chunks the target had already written.
+  bool resilveringCopyChunk(const ResilveringEventID &id, std::string_view filename, int64_t offset, uint64_t checksum, std::string_view contents, std::string &err);
+
+  // How much of the given file has arrived so far - zero if none of it.
+  bool resilveringFileSize(const ResilveringEventID &id, std::string_view filename, int64_t &size, std::string &err);
+
+  static uint64_t resilveringChecksum(std::string_view contents);
+
+  // Incremental resilvering: SST files are immutable, so any the target
+  // already has with the same name, size and contents need not be sent
+  // again - the target hard-links them from its current contents into the
+  // resilvering arena instead. Both sides number their files independently,
+  // so the same name and size prove nothing: The leader hands over the
+  // checksum of its entire copy, and the target refuses to reuse its own
+  // unless the checksums match.
+  std::vector<ResilveringFileInfo> listReusableFiles();
+  bool resilveringReuse(const ResilveringEventID &id, std::string_view filename, uint64_t checksum, std::string &err);
+
+  // Checksum of the entire contents of the given file.
+  static bool resilveringFileChecksum(const std::string &path, uint64_t &checksum, std::string &err);
   bool resilveringFinish(const ResilveringEventID &id, std::string &err);
   const ResilveringHistory& getResilveringHistory() const;
 
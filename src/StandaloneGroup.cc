@@ -26,6 +26,7 @@
 #include "StateMachine.hh"
 #include "redis/LeaseFilter.hh"
 #include "Dispatcher.hh"
+#include "storage/StagingArea.hh"
 #include "Version.hh"
 using namespace quarkdb;
 
@@ -89,5 +90,94 @@ LinkStatus StandaloneDispatcher::dispatch(Connection *conn, Transaction &tx) {
   ClockValue txTimestamp = stateMachine->getDynamicClock();
   LeaseFilter::transform(tx, txTimestamp);
 
-  return dispatcher.dispatch(conn, tx);
+  if(!tx.containsWrites() || stateMachine->inBulkLoad() || RedisDispatcher::getGroupCommitLimit() <= 1) {
+    return dispatcher.dispatch(conn, tx);
+  }
+
+  // Writes confined to a known set of keys only need their own lock stripes,
+  // and proceed in parallel with each other - rocksdb already batches
+  // concurrent commits into a single WAL write. Only writes which need the
+  // entire keyspace go through the group committer.
+  if(!RedisDispatcher::getLockSet(tx).isGlobal()) {
+    return dispatcher.dispatch(conn, tx);
+  }
+
+  return conn->raw(dispatchGrouped(tx));
+}
+
+bool StandaloneDispatcher::submitInternalWrite(RedisRequest &&req, LogIndex &index) {
+  if(stateMachine->inBulkLoad()) {
+    return false;
+  }
+
+  Transaction tx(std::move(req));
+  dispatcher.dispatch(tx, 0);
+
+  // Applied already, nothing to wait for
+  index = 0;
+  return true;
+}
+
+RedisEncodedResponse StandaloneDispatcher::dispatchGrouped(Transaction &tx) {
+  GroupedWrite self(tx);
+
+  std::unique_lock<std::mutex> lock(groupMtx);
+  groupQueue.push_back(&self);
+
+  while(!self.done) {
+    if(groupLeaderActive) {
+      groupCV.wait(lock);
+      continue;
+    }
+
+    // Become the leader, and take a group out of the queue - we might not be
+    // part of it, if the queue is longer than the limit.
+    groupLeaderActive = true;
+    std::vector<GroupedWrite*> group;
+
+    while(!groupQueue.empty() && group.size() < RedisDispatcher::getGroupCommitLimit()) {
+      group.push_back(groupQueue.front());
+      groupQueue.pop_front();
+    }
+
+    lock.unlock();
+    commitGroup(group);
+    lock.lock();
+
+    for(size_t i = 0; i < group.size(); i++) {
+      group[i]->done = true;
+    }
+
+    groupLeaderActive = false;
+    groupCV.notify_all();
+  }
+
+  return std::move(self.response);
+}
+
+void StandaloneDispatcher::commitGroup(std::vector<GroupedWrite*> &group) {
+  size_t i = 0;
+
+  while(i < group.size()) {
+    size_t staged = 0;
+
+    {
+      StagingArea stagingArea(*stateMachine);
+
+      for( ; i < group.size(); i++) {
+        if(!dispatcher.stageIntoGroup(stagingArea, group[i]->tx, group[i]->response)) break;
+        staged++;
+      }
+
+      if(staged != 0) {
+        dispatcher.commitGroup(stagingArea, 0, 0);
+      }
+    }
+
+    if(i < group.size()) {
+      // Cut short by a write which must be applied on its own
+      group[i]->response = dispatcher.dispatch(group[i]->tx, 0);
+      i++;
+    }
+  }
 }
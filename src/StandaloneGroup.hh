@@ -25,6 +25,8 @@
 #define QUARKDB_STANDALONE_GROUP_H
 
 #include <memory>
+#include <deque>
+#include <condition_variable>
 #include "Dispatcher.hh"
 #include "pubsub/Publisher.hh"
 #include "health/HealthIndicator.hh"
@@ -42,11 +44,34 @@ public:
   virtual LinkStatus dispatch(Connection *conn, RedisRequest &req) override final;
   virtual LinkStatus dispatch(Connection *conn, Transaction &req) override final;
   virtual void notifyDisconnect(Connection *conn) override final;
+  virtual bool submitInternalWrite(RedisRequest &&req, LogIndex &index) override final;
 
 private:
   StateMachine* stateMachine;
   RedisDispatcher dispatcher;
   Publisher* publisher;
+
+  //----------------------------------------------------------------------------
+  // Group commit for writes coming from different connections: The first
+  // writer to arrive becomes the group leader, and commits everything queued
+  // up in the meantime with a single write. The rest simply wait for their
+  // response.
+  //----------------------------------------------------------------------------
+  struct GroupedWrite {
+    GroupedWrite(Transaction &t) : tx(t) {}
+
+    Transaction &tx;
+    RedisEncodedResponse response;
+    bool done = false;
+  };
+
+  RedisEncodedResponse dispatchGrouped(Transaction &tx);
+  void commitGroup(std::vector<GroupedWrite*> &group);
+
+  std::mutex groupMtx;
+  std::condition_variable groupCV;
+  std::deque<GroupedWrite*> groupQueue;
+  bool groupLeaderActive = false;
 };
 
 class StandaloneGroup {
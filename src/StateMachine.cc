@@ -29,12 +29,14 @@
 #include "storage/KeyLocators.hh"
 #include "storage/StagingArea.hh"
 #include "storage/KeyDescriptorBuilder.hh"
+#include "storage/BulkIngester.hh"
 #include "storage/PatternMatching.hh"
 #include "storage/ExpirationEventIterator.hh"
 #include "storage/ReverseLocator.hh"
 #include "storage/InternalKeyParsing.hh"
 #include "storage/ConsistencyScanner.hh"
 #include "storage/ParanoidManifestChecker.hh"
+#include "redis/ArrayResponseBuilder.hh"
 #include "utils/IntToBinaryString.hh"
 #include "utils/TimeFormatting.hh"
 #include <sys/stat.h>
@@ -65,6 +67,16 @@ static rocksdb::Status malformed(std::string_view message) {
   return rocksdb::Status::InvalidArgument(message);
 }
 
+static bool bulkloadIngestion = true;
+
+void StateMachine::setBulkloadIngestion(bool value) {
+  bulkloadIngestion = value;
+}
+
+bool StateMachine::getBulkloadIngestion() {
+  return bulkloadIngestion;
+}
+
 StateMachine::StateMachine(std::string_view f, bool write_ahead_log, bool bulk_load)
 : filename(f), writeAheadLog(write_ahead_log), bulkLoad(bulk_load), timeKeeper(0u),
  requestCounter(std::chrono::seconds(10)) {
@@ -121,8 +133,10 @@ StateMachine::StateMachine(std::string_view f, bool write_ahead_log, bool bulk_l
   options.bottommost_compression = rocksdb::kZSTD;
 
   options.create_if_missing = !dirExists;
+  // rocksdb refuses range deletions when a row cache is configured, which
+  // DEL and FLUSHALL rely upon - give the same memory to the block cache.
+  table_options.block_cache = rocksdb::NewLRUCache(1024 * 1024 * 1024, 8);
   options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
-  options.row_cache = rocksdb::NewLRUCache(1024 * 1024 * 1024, 8);
 
   // Use multiple threads for compaction and flushing jobs
   options.IncreaseParallelism(std::max(2u, std::thread::hardware_concurrency() / 2));
@@ -154,10 +168,20 @@ StateMachine::StateMachine(std::string_view f, bool write_ahead_log, bool bulk_l
   if(!status.ok()) qdb_throw("Cannot open " << quotes(filename) << ":" << status.ToString());
 
   db.reset(tmpdb);
+
+  if(bulkLoad && bulkloadIngestion) {
+    // Staging files live next to the DB, never inside it - neither rocksdb
+    // nor resilvering should ever come across them.
+    bulkIngester.reset(new BulkIngester(db.get(), options, filename + "-bulkload-staging",
+      std::max(2u, std::thread::hardware_concurrency() / 2), BulkIngester::kDefaultChunkBytes));
+  }
+
   ensureCompatibleFormat(!dirExists);
   ensureBulkloadSanity(!dirExists);
   ensureClockSanity(!dirExists);
+  ensureReversedKeyIndex();
   loadExpirationCache();
+  loadReclamationBacklog();
   retrieveLastApplied();
 
   manifestChecker.reset(new ParanoidManifestChecker(filename));
@@ -191,9 +215,91 @@ void StateMachine::ensureClockSanity(bool justCreated) {
   timeKeeper.reset(binaryStringToUnsignedInt(value.c_str()));
 }
 
+static bool reversedKeyIndexEnabled = false;
+
+void StateMachine::setReversedKeyIndex(bool value) {
+  reversedKeyIndexEnabled = value;
+}
+
+bool StateMachine::getReversedKeyIndex() {
+  return reversedKeyIndexEnabled;
+}
+
+//------------------------------------------------------------------------------
+// Build or drop the reversed key index, depending on whether it's enabled.
+// The marker key is written in the same batch as the last index entries, so
+// a build interrupted half-way is simply started over on the next startup.
+//------------------------------------------------------------------------------
+void StateMachine::ensureReversedKeyIndex() {
+  bool enabled = reversedKeyIndexEnabled && !bulkLoad;
+
+  std::string value;
+  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), KeyConstants::kStateMachine_ReversedKeyIndex, &value);
+  if(!st.ok() && !st.IsNotFound()) qdb_throw("Error when reading __reversed-key-index: " << st.ToString());
+
+  bool present = st.ok();
+  const std::string indexStart(1, char(InternalKeyType::kReversedDescriptor));
+  const std::string indexEnd(1, char(InternalKeyType::kReversedDescriptor) + 1);
+
+  if(enabled && !present) {
+    qdb_info("Building reversed key index of " << quotes(filename) << ", this might take a while");
+
+    rocksdb::WriteBatch batch;
+    THROW_ON_ERROR(batch.DeleteRange(indexStart, indexEnd));
+
+    std::string searchPrefix(1, char(InternalKeyType::kDescriptor));
+    IteratorPtr iter(db->NewIterator(rocksdb::ReadOptions()));
+    ReversedDescriptorLocator locator;
+    int64_t indexed = 0;
+
+    for(iter->Seek(searchPrefix); iter->Valid(); iter->Next()) {
+      std::string_view key = iter->key().ToStringView();
+      if(!StringUtils::startsWith(key, searchPrefix)) break;
+
+      locator.reset(key.substr(1));
+      THROW_ON_ERROR(batch.Put(locator.toView(), ""));
+      indexed++;
+
+      if(batch.Count() >= 100000) {
+        commitBatch(batch);
+        batch.Clear();
+      }
+    }
+
+    THROW_ON_ERROR(batch.Put(KeyConstants::kStateMachine_ReversedKeyIndex, boolToString(true)));
+    commitBatch(batch);
+    qdb_info("Reversed key index built, " << indexed << " keys indexed");
+  }
+  else if(!enabled && present) {
+    qdb_info("Dropping reversed key index of " << quotes(filename));
+
+    rocksdb::WriteBatch batch;
+    THROW_ON_ERROR(batch.DeleteRange(indexStart, indexEnd));
+    THROW_ON_ERROR(batch.Delete(KeyConstants::kStateMachine_ReversedKeyIndex));
+    commitBatch(batch);
+  }
+
+  reversedKeyIndex = enabled;
+}
+
+void StateMachine::addToReversedKeyIndex(std::string_view redisKey, StagingArea &stagingArea) {
+  if(!reversedKeyIndex) return;
+
+  ReversedDescriptorLocator locator(redisKey);
+  stagingArea.put(locator.toView(), "");
+}
+
+void StateMachine::removeFromReversedKeyIndex(std::string_view redisKey, StagingArea &stagingArea) {
+  if(!reversedKeyIndex) return;
+
+  ReversedDescriptorLocator locator(redisKey);
+  stagingArea.del(locator.toView());
+}
+
 StateMachine::~StateMachine() {
   manifestChecker.reset();
   consistencyScanner.reset();
+  bulkIngester.reset();
 
   if(db) {
     qdb_info("Closing state machine " << quotes(filename));
@@ -214,10 +320,16 @@ void StateMachine::reset() {
     db->Delete(rocksdb::WriteOptions(), iter->key().ToString());
   }
 
+  descriptorCache.clear();
+
   ensureCompatibleFormat(true);
   ensureBulkloadSanity(true);
   ensureClockSanity(true);
+  ensureReversedKeyIndex();
   retrieveLastApplied();
+
+  pendingPrefixes = 0;
+  pendingElements = 0;
 }
 
 void StateMachine::hardSynchronizeDynamicClock() {
@@ -304,17 +416,45 @@ static KeyDescriptor constructDescriptor(rocksdb::Status &st, const std::string
   return KeyDescriptor(serialization);
 }
 
-KeyDescriptor StateMachine::getKeyDescriptor(StagingArea &stagingArea, std::string_view redisKey) {
+//------------------------------------------------------------------------------
+// Fetch a key descriptor, going through the descriptor cache whenever the
+// staging area allows it. Only existing keys are cached.
+//------------------------------------------------------------------------------
+KeyDescriptor StateMachine::fetchKeyDescriptor(StagingArea &stagingArea, DescriptorLocator &dlocator, bool forUpdate) {
+  std::string_view redisKey = dlocator.toView().substr(1);
+  bool cacheable = stagingArea.canUseDescriptorCache(redisKey);
+
+  KeyDescriptor descriptor;
+  if(cacheable && descriptorCache.get(redisKey, descriptor)) {
+    return descriptor;
+  }
+
   std::string tmp;
+  rocksdb::Status st;
+
+  if(forUpdate) {
+    st = stagingArea.getForUpdate(dlocator.toView(), tmp);
+  }
+  else {
+    st = stagingArea.get(dlocator.toView(), tmp);
+  }
+
+  descriptor = constructDescriptor(st, tmp);
+
+  if(cacheable && !descriptor.empty()) {
+    descriptorCache.put(redisKey, descriptor);
+  }
+
+  return descriptor;
+}
+
+KeyDescriptor StateMachine::getKeyDescriptor(StagingArea &stagingArea, std::string_view redisKey) {
   DescriptorLocator dlocator(redisKey);
-  rocksdb::Status st = stagingArea.get(dlocator.toView(), tmp);
-  return constructDescriptor(st, tmp);
+  return fetchKeyDescriptor(stagingArea, dlocator, false);
 }
 
 KeyDescriptor StateMachine::lockKeyDescriptor(StagingArea &stagingArea, DescriptorLocator &dlocator) {
-  std::string tmp;
-  rocksdb::Status st = stagingArea.getForUpdate(dlocator.toView(), tmp);
-  return constructDescriptor(st, tmp);
+  return fetchKeyDescriptor(stagingArea, dlocator, true);
 }
 
 bool StateMachine::assertKeyType(StagingArea &stagingArea, std::string_view key, KeyType keytype) {
@@ -335,7 +475,8 @@ rocksdb::Status StateMachine::hexists(StagingArea &stagingArea, std::string_view
   return this->hget(stagingArea, key, field, tmp);
 }
 
-rocksdb::Status StateMachine::hkeys(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &keys) {
+template<typename Container>
+rocksdb::Status StateMachine::hkeysImpl(StagingArea &stagingArea, std::string_view key, Container &keys) {
   if(!assertKeyType(stagingArea, key, KeyType::kHash)) return wrong_type();
 
   keys.clear();
@@ -343,14 +484,23 @@ rocksdb::Status StateMachine::hkeys(StagingArea &stagingArea, std::string_view k
 
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.getPrefix()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
     if(!StringUtils::startsWith(tmp, locator.toView())) break;
-    keys.push_back(std::string(tmp.begin()+locator.getPrefixSize(), tmp.end()));
+    keys.emplace_back(tmp.substr(locator.getPrefixSize()));
   }
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::hgetall(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &res) {
+rocksdb::Status StateMachine::hkeys(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &keys) {
+  return hkeysImpl(stagingArea, key, keys);
+}
+
+rocksdb::Status StateMachine::hkeys(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &keys) {
+  return hkeysImpl(stagingArea, key, keys);
+}
+
+template<typename Container>
+rocksdb::Status StateMachine::hgetallImpl(StagingArea &stagingArea, std::string_view key, Container &res) {
   if(!assertKeyType(stagingArea, key, KeyType::kHash)) return wrong_type();
 
   res.clear();
@@ -358,14 +508,22 @@ rocksdb::Status StateMachine::hgetall(StagingArea &stagingArea, std::string_view
 
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.getPrefix()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
     if(!StringUtils::startsWith(tmp, locator.toView())) break;
-    res.push_back(std::string(tmp.begin()+locator.getPrefixSize(), tmp.end()));
-    res.push_back(iter->value().ToString());
+    res.emplace_back(tmp.substr(locator.getPrefixSize()));
+    res.emplace_back(iter->value().ToStringView());
   }
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::hgetall(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &res) {
+  return hgetallImpl(stagingArea, key, res);
+}
+
+rocksdb::Status StateMachine::hgetall(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &res) {
+  return hgetallImpl(stagingArea, key, res);
+}
+
 void StateMachine::lhsetInternal(WriteOperation &operation, std::string_view key, std::string_view field, std::string_view hint, std::string_view value, bool &fieldcreated) {
   fieldcreated = false;
 
@@ -681,7 +839,8 @@ rocksdb::Status StateMachine::rawScan(StagingArea &stagingArea, std::string_view
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::hscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res) {
+template<typename Container>
+rocksdb::Status StateMachine::hscanImpl(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, Container &res) {
   if(!assertKeyType(stagingArea, key, KeyType::kHash)) return wrong_type();
 
   FieldLocator locator(KeyType::kHash, key, cursor);
@@ -690,23 +849,31 @@ rocksdb::Status StateMachine::hscan(StagingArea &stagingArea, std::string_view k
   newCursor = "";
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.toView()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
 
     if(!StringUtils::startsWith(tmp, locator.getPrefix())) break;
 
-    std::string fieldname = std::string(tmp.begin()+locator.getPrefixSize(), tmp.end());
+    std::string_view fieldname = tmp.substr(locator.getPrefixSize());
     if(res.size() >= count*2) {
       newCursor = fieldname;
       break;
     }
 
-    res.push_back(fieldname);
-    res.push_back(iter->value().ToString());
+    res.emplace_back(fieldname);
+    res.emplace_back(iter->value().ToStringView());
   }
 
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::hscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res) {
+  return hscanImpl(stagingArea, key, cursor, count, newCursor, res);
+}
+
+rocksdb::Status StateMachine::hscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, ArrayResponseBuilder &res) {
+  return hscanImpl(stagingArea, key, cursor, count, newCursor, res);
+}
+
 rocksdb::Status StateMachine::lhscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, std::string_view matchloc, size_t count, std::string &newCursor, std::vector<std::string> &results) {
   if(!assertKeyType(stagingArea, key, KeyType::kLocalityHash)) return wrong_type();
 
@@ -792,7 +959,8 @@ rocksdb::Status StateMachine::lhscan(StagingArea &stagingArea, std::string_view
 }
 
 
-rocksdb::Status StateMachine::sscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res) {
+template<typename Container>
+rocksdb::Status StateMachine::sscanImpl(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, Container &res) {
   if(!assertKeyType(stagingArea, key, KeyType::kSet)) return wrong_type();
 
   FieldLocator locator(KeyType::kSet, key, cursor);
@@ -801,22 +969,30 @@ rocksdb::Status StateMachine::sscan(StagingArea &stagingArea, std::string_view k
   newCursor = "";
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.toView()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
 
     if(!StringUtils::startsWith(tmp, locator.getPrefix())) break;
 
-    std::string fieldname = std::string(tmp.begin()+locator.getPrefixSize(), tmp.end());
+    std::string_view fieldname = tmp.substr(locator.getPrefixSize());
     if(res.size() >= count) {
       newCursor = fieldname;
       break;
     }
 
-    res.push_back(fieldname);
+    res.emplace_back(fieldname);
   }
 
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::sscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res) {
+  return sscanImpl(stagingArea, key, cursor, count, newCursor, res);
+}
+
+rocksdb::Status StateMachine::sscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, ArrayResponseBuilder &res) {
+  return sscanImpl(stagingArea, key, cursor, count, newCursor, res);
+}
+
 rocksdb::Status StateMachine::dequeScanBack(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res) {
   KeyDescriptor keyinfo = getKeyDescriptor(stagingArea, key);
   if(isWrongType(keyinfo, KeyType::kDeque)) return wrong_type();
@@ -868,7 +1044,8 @@ rocksdb::Status StateMachine::dequeScanBack(StagingArea &stagingArea, std::strin
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::hvals(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &vals) {
+template<typename Container>
+rocksdb::Status StateMachine::hvalsImpl(StagingArea &stagingArea, std::string_view key, Container &vals) {
   if(!assertKeyType(stagingArea, key, KeyType::kHash)) return wrong_type();
 
   FieldLocator locator(KeyType::kHash, key);
@@ -876,13 +1053,21 @@ rocksdb::Status StateMachine::hvals(StagingArea &stagingArea, std::string_view k
 
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.getPrefix()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
     if(!StringUtils::startsWith(tmp, locator.toView())) break;
-    vals.push_back(iter->value().ToString());
+    vals.emplace_back(iter->value().ToStringView());
   }
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::hvals(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &vals) {
+  return hvalsImpl(stagingArea, key, vals);
+}
+
+rocksdb::Status StateMachine::hvals(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &vals) {
+  return hvalsImpl(stagingArea, key, vals);
+}
+
 rocksdb::Status StateMachine::sadd(StagingArea &stagingArea, std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &added) {
   added = 0;
 
@@ -904,8 +1089,7 @@ rocksdb::Status StateMachine::sismember(StagingArea &stagingArea, std::string_vi
   if(!assertKeyType(stagingArea, key, KeyType::kSet)) return wrong_type();
   FieldLocator locator(KeyType::kSet, key, element);
 
-  std::string tmp;
-  return db->Get(stagingArea.snapshot->opts(), locator.toView(), &tmp);
+  return stagingArea.exists(locator.toView());
 }
 
 rocksdb::Status StateMachine::srem(StagingArea &stagingArea, std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &removed) {
@@ -955,7 +1139,8 @@ rocksdb::Status StateMachine::smove(StagingArea &stagingArea, std::string_view s
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::smembers(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &members) {
+template<typename Container>
+rocksdb::Status StateMachine::smembersImpl(StagingArea &stagingArea, std::string_view key, Container &members) {
   if(!assertKeyType(stagingArea, key, KeyType::kSet)) return wrong_type();
 
   FieldLocator locator(KeyType::kSet, key);
@@ -963,13 +1148,21 @@ rocksdb::Status StateMachine::smembers(StagingArea &stagingArea, std::string_vie
 
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.getPrefix()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
     if(!StringUtils::startsWith(tmp, locator.toView())) break;
-    members.push_back(std::string(tmp.begin()+locator.getPrefixSize(), tmp.end()));
+    members.emplace_back(tmp.substr(locator.getPrefixSize()));
   }
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::smembers(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &members) {
+  return smembersImpl(stagingArea, key, members);
+}
+
+rocksdb::Status StateMachine::smembers(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &members) {
+  return smembersImpl(stagingArea, key, members);
+}
+
 rocksdb::Status StateMachine::scard(StagingArea &stagingArea, std::string_view key, size_t &count) {
   count = 0;
 
@@ -1025,20 +1218,8 @@ StateMachine::WriteOperation::~WriteOperation() {
 StateMachine::WriteOperation::WriteOperation(StagingArea &staging, std::string_view key, const KeyType &type)
 : stagingArea(staging), redisKey(key), expectedType(type) {
 
-  std::string tmp;
-
   dlocator.reset(redisKey);
-  rocksdb::Status st = stagingArea.getForUpdate(dlocator.toView(), tmp);
-
-  if(st.IsNotFound()) {
-    keyinfo = KeyDescriptor();
-  }
-  else if(st.ok()) {
-    keyinfo = KeyDescriptor(tmp);
-  }
-  else {
-    qdb_throw("unexpected rocksdb status when inspecting KeyType entry " << dlocator.toString() << ": " << st.ToString());
-  }
+  keyinfo = stagingArea.stateMachine.fetchKeyDescriptor(stagingArea, dlocator, true);
 
   redisKeyExists = !keyinfo.empty();
   isValid = (keyinfo.empty()) || (keyinfo.getKeyType() == type);
@@ -1049,6 +1230,10 @@ StateMachine::WriteOperation::WriteOperation(StagingArea &staging, std::string_v
     if(expectedType == KeyType::kVersionedHash) {
       keyinfo.setStartIndex(0u);
     }
+
+    if(stagingArea.stateMachine.pendingPrefixes > 0) {
+      stagingArea.stateMachine.cancelReclamations(redisKey, expectedType, stagingArea);
+    }
   }
 
   finalized = !isValid;
@@ -1168,10 +1353,19 @@ rocksdb::Status StateMachine::WriteOperation::finalize(int64_t newsize, bool for
 
   if(newsize == 0 && keyinfo.getKeyType() != KeyType::kVersionedHash) {
     stagingArea.del(dlocator.toView());
+
+    if(redisKeyExists) {
+      stagingArea.stateMachine.removeFromReversedKeyIndex(redisKey, stagingArea);
+    }
   }
   else if(keyinfo.getSize() != newsize || forceUpdate) {
     keyinfo.setSize(newsize);
     stagingArea.put(dlocator.toView(), keyinfo.serialize());
+    stagingArea.stageDescriptor(redisKey, keyinfo);
+
+    if(!redisKeyExists) {
+      stagingArea.stateMachine.addToReversedKeyIndex(redisKey, stagingArea);
+    }
   }
 
   finalized = true;
@@ -1441,7 +1635,8 @@ rocksdb::Status StateMachine::vhlen(StagingArea &stagingArea, std::string_view k
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::vhgetall(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &res, uint64_t &version) {
+template<typename Container>
+rocksdb::Status StateMachine::vhgetallImpl(StagingArea &stagingArea, std::string_view key, Container &res, uint64_t &version) {
   KeyDescriptor keyinfo = getKeyDescriptor(stagingArea, key);
 
   if(keyinfo.empty()) {
@@ -1459,16 +1654,24 @@ rocksdb::Status StateMachine::vhgetall(StagingArea &stagingArea, std::string_vie
 
   IteratorPtr iter(stagingArea.getIterator());
   for(iter->Seek(locator.getPrefix()); iter->Valid(); iter->Next()) {
-    std::string tmp = iter->key().ToString();
+    std::string_view tmp = iter->key().ToStringView();
     if(!StringUtils::startsWith(tmp, locator.toView())) break;
-    res.push_back(std::string(tmp.begin()+locator.getPrefixSize(), tmp.end()));
-    res.push_back(iter->value().ToString());
+    res.emplace_back(tmp.substr(locator.getPrefixSize()));
+    res.emplace_back(iter->value().ToStringView());
   }
 
   version = keyinfo.getStartIndex();
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::vhgetall(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &res, uint64_t &version) {
+  return vhgetallImpl(stagingArea, key, res, version);
+}
+
+rocksdb::Status StateMachine::vhgetall(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &res, uint64_t &version) {
+  return vhgetallImpl(stagingArea, key, res, version);
+}
+
 rocksdb::Status StateMachine::hclone(StagingArea &stagingArea, std::string_view source, std::string_view target) {
   WriteOperation operation(stagingArea, target, KeyType::kHash);
   if(!operation.valid()) return wrong_type();
@@ -1739,6 +1942,47 @@ void StateMachine::remove_all_with_prefix(std::string_view prefix, int64_t &remo
   }
 }
 
+static int64_t rangeDeletionThreshold = 10000;
+
+void StateMachine::setRangeDeletionThreshold(int64_t newval) {
+  rangeDeletionThreshold = newval;
+}
+
+int64_t StateMachine::getRangeDeletionThreshold() {
+  return rangeDeletionThreshold;
+}
+
+//------------------------------------------------------------------------------
+// The smallest key greater than every key starting with the given prefix.
+// Container prefixes always end in "##", or a locality type marker.
+//------------------------------------------------------------------------------
+static std::string prefixEnd(std::string_view prefix) {
+  std::string end(prefix);
+  qdb_assert(!end.empty() && end.back() != char(0xFF));
+  end.back()++;
+  return end;
+}
+
+//------------------------------------------------------------------------------
+// Remove all elements of a container, whose keys all start with the given
+// prefix. Small containers are deleted one element at a time, which allows us
+// to cross-check the element count against the key descriptor. Past the
+// threshold, that's too expensive: Walking through millions of elements
+// stalls the apply thread for seconds, and leaves behind millions of point
+// tombstones. Drop the entire prefix with a single range tombstone instead -
+// the key descriptor holding the size is deleted by the caller right after.
+//------------------------------------------------------------------------------
+void StateMachine::remove_container_elements(std::string_view prefix, int64_t expected, StagingArea &stagingArea) {
+  if(expected > rangeDeletionThreshold) {
+    stagingArea.deleteRange(prefix, prefixEnd(prefix));
+    return;
+  }
+
+  int64_t count = 0;
+  remove_all_with_prefix(prefix, count, stagingArea);
+  if(count != expected) qdb_throw("mismatch between keyInfo counter and number of elements deleted by remove_all_with_prefix: " << count << " vs " << expected);
+}
+
 rocksdb::Status StateMachine::del(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &removed) {
   removed = 0;
 
@@ -1756,22 +2000,16 @@ rocksdb::Status StateMachine::del(StagingArea &stagingArea, const ReqIterator &s
     }
     else if(keyInfo.getKeyType() == KeyType::kHash || keyInfo.getKeyType() == KeyType::kSet || keyInfo.getKeyType() == KeyType::kDeque || keyInfo.getKeyType() == KeyType::kVersionedHash) {
       FieldLocator locator(keyInfo.getKeyType(), *it);
-      int64_t count = 0;
-      remove_all_with_prefix(locator.toView(), count, stagingArea);
-      if(count != keyInfo.getSize()) qdb_throw("mismatch between keyInfo counter and number of elements deleted by remove_all_with_prefix: " << count << " vs " << keyInfo.getSize());
+      remove_container_elements(locator.toView(), keyInfo.getSize(), stagingArea);
     }
     else if(keyInfo.getKeyType() == KeyType::kLocalityHash) {
       // wipe out fields
       LocalityFieldLocator fieldLocator(*it);
-      int64_t count = 0;
-      remove_all_with_prefix(fieldLocator.toView(), count, stagingArea);
-      if(count != keyInfo.getSize()) qdb_throw("mismatch between keyInfo counter and number of elements deleted by remove_all_with_prefix: " << count << " vs " << keyInfo.getSize());
+      remove_container_elements(fieldLocator.toView(), keyInfo.getSize(), stagingArea);
 
       // wipe out indexes
       LocalityIndexLocator indexLocator(*it);
-      count = 0;
-      remove_all_with_prefix(indexLocator.toView(), count, stagingArea);
-      if(count != keyInfo.getSize()) qdb_throw("mismatch between keyInfo counter and number of elements deleted by remove_all_with_prefix: " << count << " vs " << keyInfo.getSize());
+      remove_container_elements(indexLocator.toView(), keyInfo.getSize(), stagingArea);
     }
     else if(keyInfo.getKeyType() == KeyType::kLease) {
       THROW_ON_ERROR(lease_release(stagingArea, it->sv(), 0u));
@@ -1782,11 +2020,201 @@ rocksdb::Status StateMachine::del(StagingArea &stagingArea, const ReqIterator &s
 
     removed++;
     stagingArea.del(dlocator.toView());
+    removeFromReversedKeyIndex(*it, stagingArea);
   }
 
   return rocksdb::Status::OK();
 }
 
+//------------------------------------------------------------------------------
+// Containers up to this size are deleted on the spot by UNLINK, just like
+// DEL - deferring them would cost more than it saves.
+//------------------------------------------------------------------------------
+static constexpr int64_t kLazyFreeThreshold = 64;
+
+void StateMachine::scheduleReclamation(std::string_view prefix, int64_t elements, StagingArea &stagingArea) {
+  ReclamationLocator locator(prefix);
+  stagingArea.put(locator.toView(), intToBinaryString(elements));
+
+  pendingPrefixes++;
+  pendingElements += elements;
+}
+
+//------------------------------------------------------------------------------
+// A container is being re-created on top of a prefix still pending
+// reclamation: Its leftover elements would resurface as part of the new one,
+// drop them all at once.
+//------------------------------------------------------------------------------
+void StateMachine::cancelReclamation(std::string_view prefix, StagingArea &stagingArea) {
+  ReclamationLocator locator(prefix);
+
+  std::string value;
+  rocksdb::Status st = stagingArea.getForUpdate(locator.toView(), value);
+  if(st.IsNotFound()) return;
+  THROW_ON_ERROR(st);
+
+  stagingArea.deleteRange(prefix, prefixEnd(prefix));
+  stagingArea.del(locator.toView());
+
+  pendingPrefixes--;
+  pendingElements -= binaryStringToInt(value);
+}
+
+void StateMachine::cancelReclamations(std::string_view redisKey, KeyType keyType, StagingArea &stagingArea) {
+  if(keyType == KeyType::kHash || keyType == KeyType::kSet || keyType == KeyType::kDeque || keyType == KeyType::kVersionedHash) {
+    FieldLocator locator(keyType, redisKey);
+    cancelReclamation(locator.toView(), stagingArea);
+  }
+  else if(keyType == KeyType::kLocalityHash) {
+    LocalityFieldLocator fieldLocator(redisKey);
+    cancelReclamation(fieldLocator.toView(), stagingArea);
+
+    LocalityIndexLocator indexLocator(redisKey);
+    cancelReclamation(indexLocator.toView(), stagingArea);
+  }
+}
+
+rocksdb::Status StateMachine::unlink(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &removed) {
+  removed = 0;
+
+  for(ReqIterator it = start; it != end; it++) {
+    DescriptorLocator dlocator(*it);
+    KeyDescriptor keyInfo = lockKeyDescriptor(stagingArea, dlocator);
+    if(keyInfo.empty()) continue;
+
+    if(keyInfo.getKeyType() == KeyType::kHash || keyInfo.getKeyType() == KeyType::kSet || keyInfo.getKeyType() == KeyType::kDeque || keyInfo.getKeyType() == KeyType::kVersionedHash) {
+      if(keyInfo.getSize() > kLazyFreeThreshold) {
+        FieldLocator locator(keyInfo.getKeyType(), *it);
+        scheduleReclamation(locator.toView(), keyInfo.getSize(), stagingArea);
+
+        removed++;
+        stagingArea.del(dlocator.toView());
+        removeFromReversedKeyIndex(*it, stagingArea);
+        continue;
+      }
+    }
+    else if(keyInfo.getKeyType() == KeyType::kLocalityHash) {
+      if(keyInfo.getSize() > kLazyFreeThreshold) {
+        LocalityFieldLocator fieldLocator(*it);
+        scheduleReclamation(fieldLocator.toView(), keyInfo.getSize(), stagingArea);
+
+        LocalityIndexLocator indexLocator(*it);
+        scheduleReclamation(indexLocator.toView(), keyInfo.getSize(), stagingArea);
+
+        removed++;
+        stagingArea.del(dlocator.toView());
+        removeFromReversedKeyIndex(*it, stagingArea);
+        continue;
+      }
+    }
+
+    ReqIterator next = it;
+    next++;
+
+    int64_t count = 0;
+    THROW_ON_ERROR(del(stagingArea, it, next, count));
+    removed += count;
+  }
+
+  return rocksdb::Status::OK();
+}
+
+//------------------------------------------------------------------------------
+// Delete up to batchSize elements pending reclamation, going through the
+// pending prefixes in key order. Deterministic, given the same contents -
+// every replica deletes exactly the same keys.
+//------------------------------------------------------------------------------
+rocksdb::Status StateMachine::reclaim(StagingArea &stagingArea, int64_t batchSize, int64_t &reclaimed) {
+  reclaimed = 0;
+  std::string searchPrefix(1, char(InternalKeyType::kReclamation));
+
+  while(reclaimed < batchSize) {
+    std::string reclamationKey;
+    int64_t remaining;
+
+    {
+      IteratorPtr pending(stagingArea.getIterator());
+      pending->Seek(searchPrefix);
+
+      if(!pending->Valid() || !StringUtils::startsWith(pending->key().ToStringView(), searchPrefix)) {
+        break;
+      }
+
+      reclamationKey = pending->key().ToString();
+      remaining = binaryStringToInt(pending->value().ToStringView());
+    }
+
+    std::string_view prefix = std::string_view(reclamationKey).substr(1);
+    bool exhausted = true;
+    int64_t count = 0;
+
+    IteratorPtr iter(stagingArea.getIterator());
+    for(iter->Seek(prefix); iter->Valid(); iter->Next()) {
+      // iter->key() may get deleted from under our feet, better keep a copy
+      std::string key = iter->key().ToString();
+      if(!StringUtils::startsWith(key, prefix)) break;
+
+      if(reclaimed == batchSize) {
+        exhausted = false;
+        break;
+      }
+
+      stagingArea.del(key);
+      reclaimed++;
+      count++;
+    }
+
+    if(exhausted) {
+      stagingArea.del(reclamationKey);
+      pendingPrefixes--;
+      pendingElements -= remaining;
+    }
+    else {
+      int64_t newRemaining = std::max<int64_t>(remaining - count, 0);
+      stagingArea.put(reclamationKey, intToBinaryString(newRemaining));
+      pendingElements -= (remaining - newRemaining);
+    }
+
+    reclaimedElements += count;
+  }
+
+  return rocksdb::Status::OK();
+}
+
+KeyDescriptorCacheStats StateMachine::getKeyDescriptorCacheStats() {
+  return descriptorCache.getStats();
+}
+
+ReclamationStats StateMachine::getReclamationStats() const {
+  ReclamationStats stats;
+  stats.pendingPrefixes = pendingPrefixes;
+  stats.pendingElements = pendingElements;
+  stats.reclaimedElements = reclaimedElements;
+  return stats;
+}
+
+void StateMachine::loadReclamationBacklog() {
+  std::string searchPrefix(1, char(InternalKeyType::kReclamation));
+  IteratorPtr iter(db->NewIterator(rocksdb::ReadOptions()));
+
+  int64_t prefixes = 0;
+  int64_t elements = 0;
+
+  for(iter->Seek(searchPrefix); iter->Valid(); iter->Next()) {
+    if(!StringUtils::startsWith(iter->key().ToStringView(), searchPrefix)) break;
+
+    prefixes++;
+    elements += binaryStringToInt(iter->value().ToStringView());
+  }
+
+  pendingPrefixes = prefixes;
+  pendingElements = elements;
+
+  if(prefixes != 0) {
+    qdb_info("Found " << prefixes << " unlinked container prefixes pending reclamation, holding " << elements << " elements");
+  }
+}
+
 rocksdb::Status StateMachine::exists(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &count) {
   count = 0;
 
@@ -1821,7 +2249,8 @@ rocksdb::Status StateMachine::keys(StagingArea &stagingArea, std::string_view pa
   return rocksdb::Status::OK();
 }
 
-rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, std::vector<std::string> &results) {
+template<typename Container>
+rocksdb::Status StateMachine::scanImpl(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, Container &results) {
 
   // Any hits *must* start with patternPrefix. This will allow us in many
   // circumstances to eliminate checking large parts of the keyspace, without
@@ -1829,6 +2258,16 @@ rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cu
   // Best-case pattern is "sometext*", where there are no wasted iterations.
   std::string patternPrefix = extractPatternPrefix(pattern);
 
+  // Patterns such as "*:suffix" have no prefix to speak of - go through the
+  // reversed key index instead, if available, and the suffix is longer.
+  if(reversedKeyIndex) {
+    std::string patternSuffix = extractPatternSuffix(pattern);
+
+    if(patternSuffix.size() > patternPrefix.size()) {
+      return scanReversedImpl(stagingArea, cursor, pattern, patternSuffix, count, newcursor, results);
+    }
+  }
+
   DescriptorLocator locator;
   if(cursor.empty()) {
     locator.reset(patternPrefix);
@@ -1844,11 +2283,11 @@ rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cu
   for(iter->Seek(locator.toView()); iter->Valid(); iter->Next()) {
     iterations++;
 
-    std::string rkey = iter->key().ToString();
+    std::string_view rkey = iter->key().ToStringView();
 
     // Check if we should terminate the search
     if(rkey.size() == 0 || rkey[0] != char(InternalKeyType::kDescriptor)) break;
-    if(!StringUtils::isPrefix(patternPrefix, rkey.c_str()+1, rkey.size()-1)) {
+    if(!StringUtils::isPrefix(patternPrefix, rkey.data()+1, rkey.size()-1)) {
       // Take a shortcut and break scanning early,
       // since no more matches can possibly exist.
       break;
@@ -1860,7 +2299,50 @@ rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cu
     }
 
     if(emptyPattern || stringmatchlen(pattern.data(), pattern.length(), rkey.data()+1, rkey.length()-1, 0)) {
-      results.push_back(rkey.substr(1));
+      results.emplace_back(rkey.substr(1));
+    }
+  }
+
+  newcursor.clear();
+  return rocksdb::Status::OK();
+}
+
+//------------------------------------------------------------------------------
+// Same as scanImpl, but walk the reversed key index: Any hits *must* end with
+// patternSuffix, so they're all stored contiguously under its reversal. The
+// cursor is still the next redis key to examine, same as in scanImpl.
+//------------------------------------------------------------------------------
+template<typename Container>
+rocksdb::Status StateMachine::scanReversedImpl(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, std::string_view patternSuffix, size_t count, std::string &newcursor, Container &results) {
+  ReversedDescriptorLocator prefixLocator(patternSuffix);
+  std::string_view searchPrefix = prefixLocator.toView();
+
+  ReversedDescriptorLocator cursorLocator;
+  if(!cursor.empty()) {
+    cursorLocator.reset(cursor);
+  }
+
+  // Re-used across iterations, to avoid an allocation per key
+  std::string redisKey;
+  size_t iterations = 0;
+
+  IteratorPtr iter(stagingArea.getIterator());
+  for(iter->Seek(cursor.empty() ? searchPrefix : cursorLocator.toView()); iter->Valid(); iter->Next()) {
+    iterations++;
+
+    std::string_view rkey = iter->key().ToStringView();
+    if(!StringUtils::startsWith(rkey, searchPrefix)) break;
+
+    // Un-reverse, skipping the leading key type
+    redisKey.assign(rkey.rbegin(), rkey.rend()-1);
+
+    if(iterations > count) {
+      newcursor = redisKey;
+      return rocksdb::Status::OK();
+    }
+
+    if(stringmatchlen(pattern.data(), pattern.length(), redisKey.data(), redisKey.length(), 0)) {
+      results.emplace_back(std::string_view(redisKey));
     }
   }
 
@@ -1868,12 +2350,29 @@ rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cu
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, std::vector<std::string> &results) {
+  return scanImpl(stagingArea, cursor, pattern, count, newcursor, results);
+}
+
+rocksdb::Status StateMachine::scan(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, ArrayResponseBuilder &results) {
+  return scanImpl(stagingArea, cursor, pattern, count, newcursor, results);
+}
+
 rocksdb::Status StateMachine::flushall(StagingArea &stagingArea) {
   std::scoped_lock lock(mExpirationCacheMutex);
 
-  int64_t tmp;
-  remove_all_with_prefix("", tmp, stagingArea);
+  // Two range tombstones wipe out everything, except for internal and
+  // configuration keys. Nothing sorts after the configuration prefix.
+  static_assert(char(InternalKeyType::kInternal) + 1 == '`');
+  static_assert(char(InternalKeyType::kConfiguration) == '~');
+
+  stagingArea.deleteRange("", "_");
+  stagingArea.deleteRange("`", "~");
   mExpirationCache.clear();
+
+  // Anything pending reclamation is gone, too
+  pendingPrefixes = 0;
+  pendingElements = 0;
   return rocksdb::Status::OK();
 }
 
@@ -2001,10 +2500,27 @@ rocksdb::Status StateMachine::manualCompaction() {
 }
 
 void StateMachine::finalizeBulkload() {
-  qdb_event("Finalizing bulkload, issuing manual compaction...");
+  if(bulkIngester) {
+    qdb_event("Finalizing bulkload, ingesting the remaining SST files...");
+    bulkIngester->flush();
+  }
+
+  qdb_event("Issuing manual compaction...");
   THROW_ON_ERROR(manualCompaction());
   qdb_event("Manual compaction was successful. Building key descriptors...");
-  KeyDescriptorBuilder builder(*this);
+  KeyDescriptorBuilder builder(*this, bulkIngester.get());
+
+  if(bulkIngester) {
+    // rocksdb puts each descriptor file into the lowest level it overlaps
+    // nothing in, which is the bottommost one only if nothing written since
+    // the compaction above covers the same range. Either way the descriptors
+    // are readable right away, and regular compactions tidy up the rest.
+    bulkIngester->flush();
+
+    BulkIngesterStats stats = bulkIngester->getStats();
+    qdb_event("Bulk ingestion complete: " << stats.keys << " keys (" << stats.overwrittenKeys << " overwritten), " << stats.bytes << " bytes, " << stats.ingestedFiles << " SST files");
+  }
+
   THROW_ON_ERROR(db->Put(rocksdb::WriteOptions(), KeyConstants::kStateMachine_InBulkload, boolToString(false)));
   qdb_event("All done, bulkload is over. Restart quarkdb in standalone mode.");
 }
@@ -2062,22 +2578,33 @@ void StateMachine::forceResetLastApplied(LogIndex newLastApplied) {
   lastApplied = newLastApplied;
 }
 
-void StateMachine::commitTransaction(rocksdb::WriteBatchWithIndex &wb, LogIndex index) {
+void StateMachine::commitTransaction(rocksdb::WriteBatchWithIndex &wb, LogIndex firstIndex, LogIndex lastIndex,
+  const StagedDescriptors &stagedDescriptors, bool descriptorsRangeDeleted) {
   std::scoped_lock lock(lastAppliedMtx);
 
-  if(index <= 0 && lastApplied > 0) qdb_throw("provided invalid index for version-tracked database: " << index << ", current last applied: " << lastApplied);
+  if(lastIndex < firstIndex) qdb_throw("provided invalid index range for transaction: [" << firstIndex << ", " << lastIndex << "]");
+  if(firstIndex <= 0 && lastApplied > 0) qdb_throw("provided invalid index for version-tracked database: " << firstIndex << ", current last applied: " << lastApplied);
 
-  if(index > 0) {
-    if(index != lastApplied+1) qdb_throw("attempted to perform illegal lastApplied update: " << lastApplied << " ==> " << index);
-    THROW_ON_ERROR(wb.Put(KeyConstants::kStateMachine_LastApplied, intToBinaryString(index)));
+  if(firstIndex > 0) {
+    if(firstIndex != lastApplied+1) qdb_throw("attempted to perform illegal lastApplied update: " << lastApplied << " ==> " << firstIndex);
+    THROW_ON_ERROR(wb.Put(KeyConstants::kStateMachine_LastApplied, intToBinaryString(lastIndex)));
   }
 
   rocksdb::WriteOptions opts;
   opts.disableWAL = !writeAheadLog;
 
   rocksdb::Status st = db->Write(opts, wb.GetWriteBatch() );
-  if(index > 0 && st.ok()) lastApplied = index;
-  if(!st.ok()) qdb_throw("unable to commit transaction with index " << index << ": " << st.ToString());
+  if(firstIndex > 0 && st.ok()) lastApplied = lastIndex;
+  if(!st.ok()) qdb_throw("unable to commit transaction with indexes [" << firstIndex << ", " << lastIndex << "]: " << st.ToString());
+
+  // The write locks of every key touched are still being held, nobody could
+  // have looked up any of the old descriptors in the meantime.
+  if(descriptorsRangeDeleted) {
+    descriptorCache.clear();
+  }
+  else {
+    descriptorCache.apply(stagedDescriptors);
+  }
 
   // Notify that last applied has changed
   lastAppliedCV.notify_all();
@@ -2092,6 +2619,15 @@ void StateMachine::commitTransaction(rocksdb::WriteBatchWithIndex &wb, LogIndex
   return st; \
 }
 
+// Same as above, but lock only the stripes covering the given keys, allowing
+// writes to unrelated keys to proceed in parallel.
+#define CHAIN_LOCKED(index, locks, func, ...) { \
+  StagingArea stagingArea(*this, locks); \
+  auto st = this->func(stagingArea, ## __VA_ARGS__); \
+  stagingArea.commit(index); \
+  return st; \
+}
+
 #define CHAIN_READ(func, ...) { \
   StagingArea stagingArea(*this, true); \
   return this->func(stagingArea, ## __VA_ARGS__); \
@@ -2195,43 +2731,61 @@ rocksdb::Status StateMachine::rawScanTombstones(std::string_view seek, size_t co
 //------------------------------------------------------------------------------
 
 rocksdb::Status StateMachine::hset(std::string_view key, std::string_view field, std::string_view value, bool &fieldcreated, LogIndex index) {
-  CHAIN(index, hset, key, field, value, fieldcreated);
+  CHAIN_LOCKED(index, KeyLockSet(key), hset, key, field, value, fieldcreated);
 }
 
 rocksdb::Status StateMachine::hmset(std::string_view key, const ReqIterator &start, const ReqIterator &end, LogIndex index) {
-  CHAIN(index, hmset, key, start, end);
+  CHAIN_LOCKED(index, KeyLockSet(key), hmset, key, start, end);
 }
 
 rocksdb::Status StateMachine::hsetnx(std::string_view key, std::string_view field, std::string_view value, bool &fieldcreated, LogIndex index) {
-  CHAIN(index, hsetnx, key, field, value, fieldcreated);
+  CHAIN_LOCKED(index, KeyLockSet(key), hsetnx, key, field, value, fieldcreated);
 }
 
 rocksdb::Status StateMachine::hincrby(std::string_view key, std::string_view field, std::string_view incrby, int64_t &result, LogIndex index) {
-  CHAIN(index, hincrby, key, field, incrby, result);
+  CHAIN_LOCKED(index, KeyLockSet(key), hincrby, key, field, incrby, result);
 }
 
 rocksdb::Status StateMachine::hincrbyfloat(std::string_view key, std::string_view field, std::string_view incrby, double &result, LogIndex index) {
-  CHAIN(index, hincrbyfloat, key, field, incrby, result);
+  CHAIN_LOCKED(index, KeyLockSet(key), hincrbyfloat, key, field, incrby, result);
 }
 
 rocksdb::Status StateMachine::hdel(std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index) {
-  CHAIN(index, hdel, key, start, end, removed);
+  CHAIN_LOCKED(index, KeyLockSet(key), hdel, key, start, end, removed);
 }
 
 rocksdb::Status StateMachine::sadd(std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &added, LogIndex index) {
-  CHAIN(index, sadd, key, start, end, added);
+  CHAIN_LOCKED(index, KeyLockSet(key), sadd, key, start, end, added);
 }
 
 rocksdb::Status StateMachine::srem(std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index) {
-  CHAIN(index, srem, key, start, end, removed);
+  CHAIN_LOCKED(index, KeyLockSet(key), srem, key, start, end, removed);
 }
 
 rocksdb::Status StateMachine::set(std::string_view key, std::string_view value, LogIndex index) {
-  CHAIN(index, set, key, value);
+  CHAIN_LOCKED(index, KeyLockSet(key), set, key, value);
 }
 
 rocksdb::Status StateMachine::del(const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index) {
-  CHAIN(index, del, start, end, removed);
+  KeyLockSet locks;
+  for(auto it = start; it != end; it++) {
+    locks.add(it->sv());
+  }
+
+  CHAIN_LOCKED(index, std::move(locks), del, start, end, removed);
+}
+
+rocksdb::Status StateMachine::unlink(const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index) {
+  KeyLockSet locks;
+  for(auto it = start; it != end; it++) {
+    locks.add(it->sv());
+  }
+
+  CHAIN_LOCKED(index, std::move(locks), unlink, start, end, removed);
+}
+
+rocksdb::Status StateMachine::reclaim(int64_t batchSize, int64_t &reclaimed, LogIndex index) {
+  CHAIN(index, reclaim, batchSize, reclaimed);
 }
 
 rocksdb::Status StateMachine::flushall(LogIndex index) {
@@ -2239,19 +2793,19 @@ rocksdb::Status StateMachine::flushall(LogIndex index) {
 }
 
 rocksdb::Status StateMachine::dequePopFront(std::string_view key, std::string &item, LogIndex index) {
-  CHAIN(index, dequePopFront, key, item);
+  CHAIN_LOCKED(index, KeyLockSet(key), dequePopFront, key, item);
 }
 
 rocksdb::Status StateMachine::dequePopBack(std::string_view key, std::string &item, LogIndex index) {
-  CHAIN(index, dequePopBack, key, item);
+  CHAIN_LOCKED(index, KeyLockSet(key), dequePopBack, key, item);
 }
 
 rocksdb::Status StateMachine::dequePushFront(std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &length, LogIndex index) {
-  CHAIN(index, dequePushFront, key, start, end, length);
+  CHAIN_LOCKED(index, KeyLockSet(key), dequePushFront, key, start, end, length);
 }
 
 rocksdb::Status StateMachine::dequePushBack(std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &length, LogIndex index) {
-  CHAIN(index, dequePushBack, key, start, end, length);
+  CHAIN_LOCKED(index, KeyLockSet(key), dequePushBack, key, start, end, length);
 }
 
 rocksdb::Status StateMachine::configSet(std::string_view key, std::string_view value, LogIndex index) {
@@ -2259,7 +2813,7 @@ rocksdb::Status StateMachine::configSet(std::string_view key, std::string_view v
 }
 
 rocksdb::Status StateMachine::lhset(std::string_view key, std::string_view field, std::string_view hint, std::string_view value, bool &fieldcreated, LogIndex index) {
-  CHAIN(index, lhset, key, field, hint, value, fieldcreated);
+  CHAIN_LOCKED(index, KeyLockSet(key), lhset, key, field, hint, value, fieldcreated);
 }
 
 LeaseAcquisitionStatus StateMachine::lease_acquire(std::string_view key, std::string_view value, ClockValue clockUpdate, uint64_t duration, LeaseInfo &info, LogIndex index) {
@@ -2275,9 +2829,9 @@ rocksdb::Status StateMachine::lease_release(std::string_view key, ClockValue clo
 }
 
 rocksdb::Status StateMachine::dequeTrimFront(std::string_view key, std::string_view maxToKeep, int64_t &itemsRemoved, LogIndex index) {
-  CHAIN(index, dequeTrimFront, key, maxToKeep, itemsRemoved);
+  CHAIN_LOCKED(index, KeyLockSet(key), dequeTrimFront, key, maxToKeep, itemsRemoved);
 }
 
 rocksdb::Status StateMachine::vhset(std::string_view key, std::string_view field, std::string_view value, uint64_t &version, LogIndex index) {
-  CHAIN(index, vhset, key, field, value, version);
+  CHAIN_LOCKED(index, KeyLockSet(key), vhset, key, field, value, version);
 }
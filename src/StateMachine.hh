@@ -30,7 +30,10 @@
 #include "utils/Macros.hh"
 #include "utils/RequestCounter.hh"
 #include "storage/KeyDescriptor.hh"
+#include "storage/KeyDescriptorCache.hh"
 #include "storage/KeyLocators.hh"
+#include "storage/KeyLockTable.hh"
+#include "storage/LazyFreer.hh"
 #include "storage/KeyConstants.hh"
 #include "storage/LeaseInfo.hh"
 #include "storage/ExpirationEventCache.hh"
@@ -47,6 +50,7 @@ namespace quarkdb {
 
 class ConsistencyScanner;
 class ParanoidManifestChecker;
+class BulkIngester;
 
 enum class LeaseAcquisitionStatus {
   kKeyTypeMismatch,
@@ -55,7 +59,7 @@ enum class LeaseAcquisitionStatus {
   kFailedDueToOtherOwner
 };
 
-class StagingArea;
+class StagingArea; class ArrayResponseBuilder;
 
 class StateMachine {
 public:
@@ -74,6 +78,15 @@ public:
   rocksdb::Status del(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &removed);
   rocksdb::Status flushall(StagingArea &stagingArea);
 
+  //----------------------------------------------------------------------------
+  // UNLINK: Same as DEL, but the elements of large containers are only marked
+  // as pending reclamation, instead of being deleted right away. reclaim()
+  // deletes up to batchSize of those per call - the LazyFreer issues it in the
+  // background, through the usual replicated write path.
+  //----------------------------------------------------------------------------
+  rocksdb::Status unlink(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &removed);
+  rocksdb::Status reclaim(StagingArea &stagingArea, int64_t batchSize, int64_t &reclaimed);
+
   // hashes
   rocksdb::Status hset(StagingArea &stagingArea, std::string_view key, std::string_view field, std::string_view value, bool &fieldcreated);
   rocksdb::Status hmset(StagingArea &stagingArea, std::string_view key, const ReqIterator &start, const ReqIterator &end);
@@ -122,6 +135,7 @@ public:
 
   // generic
   rocksdb::Status scan(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, std::vector<std::string> &results);
+  rocksdb::Status scan(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, ArrayResponseBuilder &results);
   rocksdb::Status rawScan(StagingArea &stagingArea, std::string_view key, size_t count, std::vector<std::string> &elements);
   rocksdb::Status keys(StagingArea &stagingArea, std::string_view pattern, std::vector<std::string> &result);
   rocksdb::Status exists(StagingArea &stagingArea, const ReqIterator &start, const ReqIterator &end, int64_t &count);
@@ -137,6 +151,12 @@ public:
   rocksdb::Status hvals(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &vals);
   rocksdb::Status hscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newcursor, std::vector<std::string> &results);
 
+  // hashes, streaming the results straight into a response
+  rocksdb::Status hkeys(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &keys);
+  rocksdb::Status hgetall(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &res);
+  rocksdb::Status hvals(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &vals);
+  rocksdb::Status hscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newcursor, ArrayResponseBuilder &results);
+
   // locality hashes
   rocksdb::Status lhget(StagingArea &stagingArea, std::string_view key, std::string_view field, std::string_view hint, std::string &value);
   rocksdb::Status lhlen(StagingArea &stagingArea, std::string_view key, size_t &len);
@@ -151,9 +171,12 @@ public:
   rocksdb::Status sscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, std::vector<std::string> &res);
   rocksdb::Status smembers(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &members);
   rocksdb::Status sismember(StagingArea &stagingArea, std::string_view key, std::string_view element);
+  rocksdb::Status sscan(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, ArrayResponseBuilder &res);
+  rocksdb::Status smembers(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &members);
 
   // versioned hashes
   rocksdb::Status vhgetall(StagingArea &stagingArea, std::string_view key, std::vector<std::string> &res, uint64_t &version);
+  rocksdb::Status vhgetall(StagingArea &stagingArea, std::string_view key, ArrayResponseBuilder &res, uint64_t &version);
   rocksdb::Status vhlen(StagingArea &stagingArea, std::string_view key, size_t &len);
 
   // misc
@@ -191,6 +214,8 @@ public:
   rocksdb::Status set(std::string_view key, std::string_view value, LogIndex index = 0);
   rocksdb::Status get(std::string_view key, std::string &value);
   rocksdb::Status del(const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index = 0);
+  rocksdb::Status unlink(const ReqIterator &start, const ReqIterator &end, int64_t &removed, LogIndex index = 0);
+  rocksdb::Status reclaim(int64_t batchSize, int64_t &reclaimed, LogIndex index = 0);
   rocksdb::Status exists(const ReqIterator &start, const ReqIterator &end, int64_t &count);
   rocksdb::Status keys(std::string_view pattern, std::vector<std::string> &result);
   rocksdb::Status scan(std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, std::vector<std::string> &results);
@@ -269,6 +294,15 @@ public:
 
   rocksdb::Status manualCompaction();
   void finalizeBulkload();
+
+  //----------------------------------------------------------------------------
+  // In bulkload mode, write out sorted SST files and ingest them, instead of
+  // going through the memtable. Takes effect for state machines opened
+  // afterwards.
+  //----------------------------------------------------------------------------
+  static void setBulkloadIngestion(bool value);
+  static bool getBulkloadIngestion();
+
   IteratorPtr getRawIterator();
   void commitBatch(rocksdb::WriteBatch &batch);
   bool waitUntilTargetLastApplied(LogIndex targetLastApplied, std::chrono::milliseconds duration);
@@ -290,6 +324,33 @@ public:
   //----------------------------------------------------------------------------
   std::string getPhysicalLocation() const;
 
+  //----------------------------------------------------------------------------
+  // Containers with more elements than this are deleted through a single
+  // range tombstone, instead of one tombstone per element.
+  //----------------------------------------------------------------------------
+  static void setRangeDeletionThreshold(int64_t newval);
+  static int64_t getRangeDeletionThreshold();
+
+  //----------------------------------------------------------------------------
+  // Maintain a secondary index of all redis keys, stored reversed, so that
+  // SCAN and KEYS can seek straight to patterns with a literal suffix, such
+  // as "*:suffix", instead of scanning the entire keyspace. Takes effect the
+  // next time a state machine is opened: The index is built or dropped then.
+  //----------------------------------------------------------------------------
+  static void setReversedKeyIndex(bool value);
+  static bool getReversedKeyIndex();
+  bool hasReversedKeyIndex() const { return reversedKeyIndex; }
+
+  //----------------------------------------------------------------------------
+  // Containers unlinked but not yet fully reclaimed
+  //----------------------------------------------------------------------------
+  ReclamationStats getReclamationStats() const;
+
+  //----------------------------------------------------------------------------
+  // Decoded key descriptors, cached in front of rocksdb for writers
+  //----------------------------------------------------------------------------
+  KeyDescriptorCacheStats getKeyDescriptorCacheStats();
+
 private:
   ClockValue maybeAdvanceClock(StagingArea &stagingArea, ClockValue newValue);
   friend class StagingArea;
@@ -306,8 +367,38 @@ private:
     DISALLOW_COPY_AND_ASSIGN(Snapshot);
   };
 
-  void commitTransaction(rocksdb::WriteBatchWithIndex &wb, LogIndex index);
+  //----------------------------------------------------------------------------
+  // Commit the given write batch, which may contain the writes of several
+  // consecutive journal entries [firstIndex, lastIndex]. lastApplied is
+  // bumped only once, straight to lastIndex.
+  //----------------------------------------------------------------------------
+  void commitTransaction(rocksdb::WriteBatchWithIndex &wb, LogIndex firstIndex, LogIndex lastIndex,
+    const StagedDescriptors &stagedDescriptors, bool descriptorsRangeDeleted);
   bool assertKeyType(StagingArea &stagingArea, std::string_view key, KeyType keytype);
+
+  //----------------------------------------------------------------------------
+  // Implementations of container reads, generic over where the results are
+  // collected: Either a std::vector<std::string>, or an ArrayResponseBuilder
+  // encoding them straight into a response.
+  //----------------------------------------------------------------------------
+  template<typename Container>
+  rocksdb::Status scanImpl(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, size_t count, std::string &newcursor, Container &results);
+  template<typename Container>
+  rocksdb::Status scanReversedImpl(StagingArea &stagingArea, std::string_view cursor, std::string_view pattern, std::string_view patternSuffix, size_t count, std::string &newcursor, Container &results);
+  template<typename Container>
+  rocksdb::Status hkeysImpl(StagingArea &stagingArea, std::string_view key, Container &keys);
+  template<typename Container>
+  rocksdb::Status hgetallImpl(StagingArea &stagingArea, std::string_view key, Container &res);
+  template<typename Container>
+  rocksdb::Status hvalsImpl(StagingArea &stagingArea, std::string_view key, Container &vals);
+  template<typename Container>
+  rocksdb::Status hscanImpl(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newcursor, Container &results);
+  template<typename Container>
+  rocksdb::Status sscanImpl(StagingArea &stagingArea, std::string_view key, std::string_view cursor, size_t count, std::string &newCursor, Container &res);
+  template<typename Container>
+  rocksdb::Status smembersImpl(StagingArea &stagingArea, std::string_view key, Container &members);
+  template<typename Container>
+  rocksdb::Status vhgetallImpl(StagingArea &stagingArea, std::string_view key, Container &res, uint64_t &version);
   rocksdb::Status dequePop(StagingArea &stagingArea, Direction direction, std::string_view key, std::string &item);
   rocksdb::Status dequePush(StagingArea &stagingArea, Direction direction, std::string_view key, const ReqIterator &start, const ReqIterator &end, int64_t &length);
 
@@ -360,36 +451,59 @@ private:
 
   KeyDescriptor getKeyDescriptor(StagingArea &stagingArea, std::string_view redisKey);
   KeyDescriptor lockKeyDescriptor(StagingArea &stagingArea, DescriptorLocator &dlocator);
+  KeyDescriptor fetchKeyDescriptor(StagingArea &stagingArea, DescriptorLocator &dlocator, bool forUpdate);
 
   void retrieveLastApplied();
   void ensureCompatibleFormat(bool justCreated);
   void ensureBulkloadSanity(bool justCreated);
   void ensureClockSanity(bool justCreated);
+  void ensureReversedKeyIndex();
+  void addToReversedKeyIndex(std::string_view redisKey, StagingArea &stagingArea);
+  void removeFromReversedKeyIndex(std::string_view redisKey, StagingArea &stagingArea);
   void remove_all_with_prefix(std::string_view prefix, int64_t &removed, StagingArea &stagingArea);
+  void remove_container_elements(std::string_view prefix, int64_t expected, StagingArea &stagingArea);
+  void scheduleReclamation(std::string_view prefix, int64_t elements, StagingArea &stagingArea);
+  void cancelReclamation(std::string_view prefix, StagingArea &stagingArea);
+  void cancelReclamations(std::string_view redisKey, KeyType keyType, StagingArea &stagingArea);
   void lhsetInternal(WriteOperation &operation, std::string_view key, std::string_view field, std::string_view hint, std::string_view value, bool &fieldcreated);
 
   std::atomic<LogIndex> lastApplied;
   std::condition_variable lastAppliedCV;
   std::mutex lastAppliedMtx;
 
-  std::mutex writeMtx;
+  KeyLockTable writeLocks;
   std::unique_ptr<rocksdb::DB> db;
   std::unique_ptr<ParanoidManifestChecker> manifestChecker;
   std::unique_ptr<ConsistencyScanner> consistencyScanner;
+  std::unique_ptr<BulkIngester> bulkIngester;
 
   const std::string filename;
   bool writeAheadLog;
   bool bulkLoad;
+  bool reversedKeyIndex = false;
 
   Timekeeper timeKeeper;
   RequestCounter requestCounter;
 
   std::shared_ptr<WriteStallWarner> writeStallWarner;
 
+  KeyDescriptorCache descriptorCache;
+
   ExpirationEventCache mExpirationCache;
   std::recursive_mutex mExpirationCacheMutex;
   void loadExpirationCache();
 
+  //----------------------------------------------------------------------------
+  // Reclamation backlog, loaded on startup and kept up-to-date as containers
+  // are unlinked and reclaimed. Locality hashes occupy two prefixes, the rest
+  // of the containers one. While pendingPrefixes is zero, creating a new
+  // container can skip checking for leftover elements under its prefix.
+  //----------------------------------------------------------------------------
+  std::atomic<int64_t> pendingPrefixes {0};
+  std::atomic<int64_t> pendingElements {0};
+  std::atomic<int64_t> reclaimedElements {0};
+  void loadReclamationBacklog();
+
   //----------------------------------------------------------------------------
   // Return health information regarding free space
   //----------------------------------------------------------------------------
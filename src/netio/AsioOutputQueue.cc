@@ -0,0 +1,254 @@
+// ----------------------------------------------------------------------
+// File: AsioOutputQueue.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "netio/AsioOutputQueue.hh"
+#include "redis/OutputBufferLimits.hh"
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+AsioOutputQueue::AsioOutputQueue(asio::io_context &context, asio::ip::tcp::socket &socket)
+: mSocket(&socket), mStrand(context) {
+  mGathered.reserve(kMaxBuffersPerWrite);
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+AsioOutputQueue::~AsioOutputQueue() {
+  OutputBufferLimits::queuedBytes -= mQueuedBytes;
+}
+
+//------------------------------------------------------------------------------
+// Append to the queue, and kick off a write if there's none in flight
+//------------------------------------------------------------------------------
+bool AsioOutputQueue::enqueue(const char *buff, size_t len) {
+  std::scoped_lock lock(mMtx);
+  if(mFailed || mDetached) return false;
+
+  // Merge into the last buffer, as long as it's not part of the write in
+  // flight - growing it could move its contents from under the socket.
+  if(mQueue.size() > mBuffersInFlight && mQueue.back().size() + len <= kMergeLimit) {
+    mQueue.back().append(buff, len);
+  }
+  else {
+    mQueue.emplace_back(buff, len);
+  }
+
+  mQueuedBytes += len;
+  OutputBufferLimits::queuedBytes += len;
+
+  if(mQueuedBytes > kHighWatermark) {
+    mCongested = true;
+  }
+
+  if(!mWriting) {
+    mWriting = true;
+    asio::post(mStrand, std::bind(&AsioOutputQueue::startWrite, shared_from_this()));
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Bytes queued, but not yet written into the socket
+//------------------------------------------------------------------------------
+size_t AsioOutputQueue::getQueuedBytes() const {
+  return mQueuedBytes;
+}
+
+//------------------------------------------------------------------------------
+// Store drain callback, if congested
+//------------------------------------------------------------------------------
+bool AsioOutputQueue::resumeWhenDrained(std::function<void()> callback) {
+  std::scoped_lock lock(mMtx);
+  if(!mCongested) return false;
+
+  mDrainCallback = std::move(callback);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Store close callback, if there's anything left to write
+//------------------------------------------------------------------------------
+bool AsioOutputQueue::closeWhenDrained(std::function<void()> callback) {
+  std::scoped_lock lock(mMtx);
+  if(mFailed || mDetached || (!mWriting && mQueue.empty())) return false;
+
+  mClosing = true;
+  mDrainCallback = std::move(callback);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Shutdown
+//------------------------------------------------------------------------------
+void AsioOutputQueue::shutdown() {
+  std::function<void()> callback;
+
+  {
+    std::scoped_lock lock(mMtx);
+    if(mFailed || mDetached) return;
+
+    mFailed = true;
+    releaseNoLock();
+    std::swap(callback, mDrainCallback);
+  }
+
+  if(callback) {
+    asio::post(mStrand, callback);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Request close from any thread - the socket may only be touched on the strand
+//------------------------------------------------------------------------------
+void AsioOutputQueue::requestClose() {
+  asio::post(mStrand, std::bind(&AsioOutputQueue::handleCloseRequest, shared_from_this()));
+}
+
+void AsioOutputQueue::handleCloseRequest() {
+  shutdown();
+
+  std::scoped_lock lock(mMtx);
+  if(mDetached) return;
+
+  std::error_code ec;
+  mSocket->cancel(ec);
+}
+
+//------------------------------------------------------------------------------
+// Detach
+//------------------------------------------------------------------------------
+void AsioOutputQueue::detach() {
+  std::scoped_lock lock(mMtx);
+  if(mDetached) return;
+
+  mDetached = true;
+  releaseNoLock();
+  mDrainCallback = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Drop everything queued, apart from the buffers of a write in flight - those
+// must outlive it, handleWrite frees them.
+//------------------------------------------------------------------------------
+void AsioOutputQueue::releaseNoLock() {
+  OutputBufferLimits::queuedBytes -= mQueuedBytes;
+  mQueuedBytes = 0;
+  mCongested = false;
+
+  while(mQueue.size() > mBuffersInFlight) {
+    mQueue.pop_back();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Start the next write - always called on the strand
+//------------------------------------------------------------------------------
+void AsioOutputQueue::startWrite() {
+  std::scoped_lock lock(mMtx);
+  startWriteNoLock();
+}
+
+void AsioOutputQueue::startWriteNoLock() {
+  if(mFailed || mDetached || mQueue.empty()) {
+    mWriting = false;
+    return;
+  }
+
+  mGathered.clear();
+  for(auto it = mQueue.begin(); it != mQueue.end() && mGathered.size() < kMaxBuffersPerWrite; it++) {
+    size_t offset = (it == mQueue.begin()) ? mFrontOffset : 0;
+    mGathered.emplace_back(it->data() + offset, it->size() - offset);
+  }
+
+  mBuffersInFlight = mGathered.size();
+  mSocket->async_write_some(mGathered, asio::bind_executor(mStrand,
+    std::bind(&AsioOutputQueue::handleWrite, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+}
+
+//------------------------------------------------------------------------------
+// Handle write completion - always called on the strand
+//------------------------------------------------------------------------------
+void AsioOutputQueue::handleWrite(const std::error_code &ec, size_t bytesWritten) {
+  std::function<void()> callback;
+
+  {
+    std::scoped_lock lock(mMtx);
+    mBuffersInFlight = 0;
+
+    if(mFailed || mDetached) {
+      // Already accounted for, the socket might not even exist anymore
+      mQueue.clear();
+      mFrontOffset = 0;
+      mWriting = false;
+      return;
+    }
+
+    if(ec) {
+      mFailed = true;
+      mWriting = false;
+      releaseNoLock();
+      mFrontOffset = 0;
+      std::swap(callback, mDrainCallback);
+    }
+    else {
+      size_t remaining = bytesWritten;
+      while(remaining > 0) {
+        size_t available = mQueue.front().size() - mFrontOffset;
+
+        if(remaining < available) {
+          mFrontOffset += remaining;
+          break;
+        }
+
+        remaining -= available;
+        mQueue.pop_front();
+        mFrontOffset = 0;
+      }
+
+      mQueuedBytes -= bytesWritten;
+      OutputBufferLimits::queuedBytes -= bytesWritten;
+
+      if(mCongested && mQueuedBytes <= kLowWatermark) {
+        mCongested = false;
+        if(!mClosing) std::swap(callback, mDrainCallback);
+      }
+
+      startWriteNoLock();
+
+      if(mClosing && !mWriting) {
+        std::swap(callback, mDrainCallback);
+      }
+    }
+  }
+
+  if(callback) {
+    callback();
+  }
+}
+
+}
@@ -0,0 +1,158 @@
+// ----------------------------------------------------------------------
+// File: AsioOutputQueue.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_ASIO_OUTPUT_QUEUE_HH
+#define QUARKDB_ASIO_OUTPUT_QUEUE_HH
+
+#include <asio.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Output path of a single asio connection. Sending a response only ever
+// appends it to the queue - whoever is sending never touches the socket, and
+// never blocks on a client which isn't reading. The queue is flushed on the
+// connection's strand through async writes, gathering as many queued buffers
+// as possible into a single writev.
+//
+// Completion handlers keep the queue alive through a shared_ptr, and may run
+// after the link is gone. detach() must be called before the socket is
+// destroyed - from then on, handlers no longer touch it.
+//------------------------------------------------------------------------------
+class AsioOutputQueue : public std::enable_shared_from_this<AsioOutputQueue> {
+public:
+  //----------------------------------------------------------------------------
+  // Constructor
+  //----------------------------------------------------------------------------
+  AsioOutputQueue(asio::io_context &context, asio::ip::tcp::socket &socket);
+
+  //----------------------------------------------------------------------------
+  // Destructor
+  //----------------------------------------------------------------------------
+  ~AsioOutputQueue();
+
+  //----------------------------------------------------------------------------
+  // Append to the queue, and kick off a write if there's none in flight.
+  // Returns false if the connection has failed, or has been detached.
+  //----------------------------------------------------------------------------
+  bool enqueue(const char *buff, size_t len);
+
+  //----------------------------------------------------------------------------
+  // The connection is being shut down: Discard anything still queued, fail
+  // any further sends, and run the drain callback, if any.
+  //----------------------------------------------------------------------------
+  void shutdown();
+
+  //----------------------------------------------------------------------------
+  // Thread-safe: Shut the connection down from any thread, through the
+  // strand. Besides shutting the queue down, any pending operation on the
+  // socket is cancelled, so that its handler notices.
+  //----------------------------------------------------------------------------
+  void requestClose();
+
+  //----------------------------------------------------------------------------
+  // Same as shutdown, but the drain callback is discarded without running.
+  // Called when the link is going away.
+  //----------------------------------------------------------------------------
+  void detach();
+
+  //----------------------------------------------------------------------------
+  // Bytes queued, but not yet written into the socket.
+  //----------------------------------------------------------------------------
+  size_t getQueuedBytes() const;
+
+  //----------------------------------------------------------------------------
+  // Backpressure: Once more than kHighWatermark bytes are queued, the queue
+  // is congested until it drains below kLowWatermark. If congested, store the
+  // given callback, to be run on the strand once the queue drains, or the
+  // connection fails, and return true. Otherwise, return false, and don't
+  // store anything.
+  //----------------------------------------------------------------------------
+  bool resumeWhenDrained(std::function<void()> callback);
+
+  //----------------------------------------------------------------------------
+  // The client has stopped sending requests, but may still be reading our
+  // responses to the ones it sent. If anything is left to write, store the
+  // given callback, to be run on the strand once the queue is empty, or the
+  // connection fails, and return true. Otherwise, return false, and don't
+  // store anything - the connection can be closed right away.
+  //----------------------------------------------------------------------------
+  bool closeWhenDrained(std::function<void()> callback);
+
+  static constexpr size_t kHighWatermark = 16 * 1024 * 1024;
+  static constexpr size_t kLowWatermark = 1 * 1024 * 1024;
+
+  //----------------------------------------------------------------------------
+  // Small consecutive sends are merged into a single queued buffer, up to
+  // this size.
+  //----------------------------------------------------------------------------
+  static constexpr size_t kMergeLimit = 64 * 1024;
+
+  //----------------------------------------------------------------------------
+  // Maximum number of buffers gathered into a single write.
+  //----------------------------------------------------------------------------
+  static constexpr size_t kMaxBuffersPerWrite = 64;
+
+  //----------------------------------------------------------------------------
+  // All handlers of the connection are meant to run on this strand, reads
+  // included.
+  //----------------------------------------------------------------------------
+  asio::io_context::strand& getStrand() {
+    return mStrand;
+  }
+
+private:
+  void startWrite();
+  void startWriteNoLock();
+  void handleWrite(const std::error_code &ec, size_t bytesWritten);
+  void releaseNoLock();
+  void handleCloseRequest();
+
+  asio::ip::tcp::socket *mSocket;
+  asio::io_context::strand mStrand;
+
+  std::mutex mMtx;
+  std::deque<std::string> mQueue;
+  size_t mFrontOffset = 0;
+  size_t mBuffersInFlight = 0;
+  std::vector<asio::const_buffer> mGathered;
+
+  std::atomic<size_t> mQueuedBytes {0};
+  bool mWriting = false;
+  bool mFailed = false;
+  bool mDetached = false;
+  bool mCongested = false;
+  bool mClosing = false;
+  std::function<void()> mDrainCallback;
+};
+
+}
+
+#endif
@@ -24,43 +24,83 @@
 #include "netio/AsioPoller.hh"
 #include "Link.hh"
 #include "Connection.hh"
+#include "utils/Macros.hh"
 #include <qclient/TlsFilter.hh>
+#include <string.h>
+#include <sys/socket.h>
 
 namespace quarkdb {
 
+namespace {
+  //----------------------------------------------------------------------------
+  // Adds the time spent in scope to the busy time of a shard
+  //----------------------------------------------------------------------------
+  class BusyTimer {
+  public:
+    BusyTimer(PollerShard *s) : shard(s), start(std::chrono::steady_clock::now()) {}
+
+    ~BusyTimer() {
+      shard->busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+
+  private:
+    PollerShard *shard;
+    std::chrono::steady_clock::time_point start;
+  };
+}
+
+std::string pollerModeToString(PollerMode mode) {
+  if(mode == PollerMode::kShared) return "shared";
+  if(mode == PollerMode::kSharded) return "sharded";
+  qdb_throw("should never happen");
+}
+
+std::string PollerShardStats::toString() const {
+  return SSTR("ID=" << id << " THREADS=" << threads << " CONNECTIONS=" << connections <<
+    " ACCEPTED=" << acceptedConnections << " UTILIZATION=" << utilization);
+}
+
+//------------------------------------------------------------------------------
+// PollerShard constructor
+//------------------------------------------------------------------------------
+PollerShard::PollerShard(size_t i)
+: id(i),
+  acceptor4(context),
+  acceptor6(context),
+  nextSocket4(context),
+  nextSocket6(context),
+  startTime(std::chrono::steady_clock::now()) {}
+
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
-AsioPoller::AsioPoller(int port, size_t threadPoolSize, Dispatcher *disp)
-: mPort(port), mThreadPoolSize(threadPoolSize), mDispatcher(disp),
-  mResolver(mContext),
-  mAcceptor4(mContext),
-  mAcceptor6(mContext),
-  mNextSocket4(mContext),
-  mNextSocket6(mContext)
- {
+AsioPoller::AsioPoller(int port, size_t threadPoolSize, Dispatcher *disp, PollerMode mode)
+: mPort(port), mThreadPoolSize(threadPoolSize), mDispatcher(disp), mMode(mode),
+  mHostnameCache(16384, std::chrono::minutes(10)) {
 
-  std::error_code ec;
-  mAcceptor4.open(asio::ip::tcp::v4(), ec);
-  if(ec.value() == 0) {
-    mAcceptor4.set_option(asio::socket_base::reuse_address(true));
-    mAcceptor4.bind(asio::ip::tcp::endpoint(asio::ip::tcp::v4(), mPort));
-    mAcceptor4.listen();
+  size_t shards = (mMode == PollerMode::kSharded) ? std::max<size_t>(mThreadPoolSize, 1u) : 1u;
+  size_t threadsPerShard = (mMode == PollerMode::kSharded) ? 1u : mThreadPoolSize;
+
+  if(mMode == PollerMode::kSharded) {
+    checkPortAvailable(asio::ip::tcp::v4());
+    checkPortAvailable(asio::ip::tcp::v6());
   }
 
-  mAcceptor6.open(asio::ip::tcp::v6(), ec);
-  if(ec.value() == 0) {
-    mAcceptor6.set_option(asio::socket_base::reuse_address(true));
-    mAcceptor6.set_option(asio::ip::v6_only(true), ec);
-    mAcceptor6.bind(asio::ip::tcp::endpoint(asio::ip::tcp::v6(), mPort));
-    mAcceptor6.listen();
+  for(size_t i = 0; i < shards; i++) {
+    mShards.emplace_back(new PollerShard(i));
+    openAcceptor(mShards[i]->acceptor4, asio::ip::tcp::v4());
+    openAcceptor(mShards[i]->acceptor6, asio::ip::tcp::v6());
   }
 
-  requestAccept4();
-  requestAccept6();
+  for(size_t i = 0; i < shards; i++) {
+    PollerShard *shard = mShards[i].get();
+    requestAccept4(shard);
+    requestAccept6(shard);
 
-  for(size_t i = 0; i < mThreadPoolSize; i++) {
-    mThreadPool.emplace_back(&AsioPoller::workerThread, this);
+    for(size_t j = 0; j < threadsPerShard; j++) {
+      shard->threads.emplace_back(&AsioPoller::workerThread, this, shard);
+    }
   }
 }
 
@@ -70,69 +110,173 @@ AsioPoller::AsioPoller(int port, size_t threadPoolSize, Dispatcher *disp)
 AsioPoller::~AsioPoller() {
   mShutdown = true;
 
-  std::unique_lock lock(mAcceptorMtx);
-  mAcceptor4.close();
-  mAcceptor6.close();
-  lock.unlock();
+  for(size_t i = 0; i < mShards.size(); i++) {
+    std::unique_lock lock(mShards[i]->acceptorMtx);
+    mShards[i]->acceptor4.close();
+    mShards[i]->acceptor6.close();
+    lock.unlock();
+
+    mShards[i]->context.stop();
+  }
 
-  mContext.stop();
   mInFlightTracker.setAcceptingRequests(false);
 
-  for(size_t i = 0; i < mThreadPool.size(); i++) {
-    mThreadPool[i].join();
+  for(size_t i = 0; i < mShards.size(); i++) {
+    for(size_t j = 0; j < mShards[i]->threads.size(); j++) {
+      mShards[i]->threads[j].join();
+    }
+  }
+
+  for(size_t i = 0; i < mShards.size(); i++) {
+    mShards[i]->entries.clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+// SO_REUSEPORT lets a second instance started on our port by mistake bind
+// right next to us, and silently take a share of the connections. Before
+// opening the shard acceptors, bind the port once without it: An existing
+// listener makes us fail with EADDRINUSE, same as in shared mode.
+//------------------------------------------------------------------------------
+void AsioPoller::checkPortAvailable(const asio::ip::tcp &protocol) {
+  asio::io_context context;
+  asio::ip::tcp::acceptor probe(context);
+
+  std::error_code ec;
+  probe.open(protocol, ec);
+  if(ec.value() != 0) {
+    return;
+  }
+
+  probe.set_option(asio::socket_base::reuse_address(true));
+
+  if(protocol == asio::ip::tcp::v6()) {
+    probe.set_option(asio::ip::v6_only(true), ec);
   }
 
-  mEntries.clear();
+  probe.bind(asio::ip::tcp::endpoint(protocol, mPort));
+}
+
+//------------------------------------------------------------------------------
+// Open, bind and start listening on an acceptor. In sharded mode, every shard
+// binds the same port through SO_REUSEPORT, and the kernel balances incoming
+// connections among them.
+//------------------------------------------------------------------------------
+void AsioPoller::openAcceptor(asio::ip::tcp::acceptor &acceptor, const asio::ip::tcp &protocol) {
+  std::error_code ec;
+  acceptor.open(protocol, ec);
+  if(ec.value() != 0) {
+    return;
+  }
+
+  acceptor.set_option(asio::socket_base::reuse_address(true));
+
+  if(protocol == asio::ip::tcp::v6()) {
+    acceptor.set_option(asio::ip::v6_only(true), ec);
+  }
+
+  if(mMode == PollerMode::kSharded) {
+    int one = 1;
+    if(setsockopt(acceptor.native_handle(), SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+      qdb_throw("Unable to set SO_REUSEPORT on acceptor for port " << mPort << ": " << strerror(errno));
+    }
+  }
+
+  acceptor.bind(asio::ip::tcp::endpoint(protocol, mPort));
+  acceptor.listen();
 }
 
 //------------------------------------------------------------------------------
 // Thread pool
 //------------------------------------------------------------------------------
-void AsioPoller::workerThread(ThreadAssistant &assistant) {
-  mContext.run();
+void AsioPoller::workerThread(PollerShard *shard, ThreadAssistant &assistant) {
+  shard->context.run();
+}
+
+//------------------------------------------------------------------------------
+// Statistics
+//------------------------------------------------------------------------------
+std::vector<PollerShardStats> AsioPoller::getStats() {
+  std::vector<PollerShardStats> ret;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  for(size_t i = 0; i < mShards.size(); i++) {
+    PollerShard *shard = mShards[i].get();
+
+    PollerShardStats stats;
+    stats.id = shard->id;
+    stats.threads = shard->threads.size();
+    stats.connections = shard->connections;
+    stats.acceptedConnections = shard->acceptedConnections;
+
+    double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - shard->startTime).count();
+    if(elapsed > 0 && stats.threads > 0) {
+      stats.utilization = shard->busyNanoseconds / (elapsed * stats.threads);
+    }
+
+    ret.emplace_back(stats);
+  }
+
+  return ret;
+}
+
+std::vector<std::string> AsioPoller::describe() {
+  std::vector<std::string> ret;
+
+  for(const PollerShardStats &stats : getStats()) {
+    ret.emplace_back(SSTR(pollerModeToString(mMode) << " " << stats.toString()));
+  }
+
+  return ret;
 }
 
 //------------------------------------------------------------------------------
 // Request next async accept
 //------------------------------------------------------------------------------
-void AsioPoller::requestAccept4() {
-  mNextSocket4 = asio::ip::tcp::socket(mContext);
+void AsioPoller::requestAccept4(PollerShard *shard) {
+  shard->nextSocket4 = asio::ip::tcp::socket(shard->context);
 
-  std::scoped_lock lock(mAcceptorMtx);
-  mAcceptor4.async_accept(mNextSocket4, std::bind(&AsioPoller::handleAccept4, this, std::placeholders::_1));
+  std::scoped_lock lock(shard->acceptorMtx);
+  if(!shard->acceptor4.is_open()) return;
+  shard->acceptor4.async_accept(shard->nextSocket4, std::bind(&AsioPoller::handleAccept4, this, shard, std::placeholders::_1));
 }
 
-void AsioPoller::requestAccept6() {
-  mNextSocket6 = asio::ip::tcp::socket(mContext);
+void AsioPoller::requestAccept6(PollerShard *shard) {
+  shard->nextSocket6 = asio::ip::tcp::socket(shard->context);
 
-  std::scoped_lock lock(mAcceptorMtx);
-  mAcceptor6.async_accept(mNextSocket6, std::bind(&AsioPoller::handleAccept6, this, std::placeholders::_1));
+  std::scoped_lock lock(shard->acceptorMtx);
+  if(!shard->acceptor6.is_open()) return;
+  shard->acceptor6.async_accept(shard->nextSocket6, std::bind(&AsioPoller::handleAccept6, this, shard, std::placeholders::_1));
 }
 
 //------------------------------------------------------------------------------
 // Handle incoming TCP connect
 //------------------------------------------------------------------------------
-void AsioPoller::handleAccept4(const std::error_code& ec) {
+void AsioPoller::handleAccept4(PollerShard *shard, const std::error_code& ec) {
+  BusyTimer timer(shard);
+
   if(!ec) {
-    handleAccept(std::move(mNextSocket4));
+    handleAccept(shard, std::move(shard->nextSocket4));
   }
 
   if(!mShutdown) {
-    requestAccept4();
+    requestAccept4(shard);
   }
 }
 
-void AsioPoller::handleAccept6(const std::error_code& ec) {
+void AsioPoller::handleAccept6(PollerShard *shard, const std::error_code& ec) {
+  BusyTimer timer(shard);
+
   if(!ec) {
-    handleAccept(std::move(mNextSocket6));
+    handleAccept(shard, std::move(shard->nextSocket6));
   }
 
   if(!mShutdown) {
-    requestAccept6();
+    requestAccept6(shard);
   }
 }
 
-void AsioPoller::handleAccept(asio::ip::tcp::socket socket) {
+void AsioPoller::handleAccept(PollerShard *shard, asio::ip::tcp::socket socket) {
   std::error_code ec;
   socket.non_blocking(true, ec);
   if(ec) {
@@ -142,42 +286,30 @@ void AsioPoller::handleAccept(asio::ip::tcp::socket socket) {
   }
 
   asio::ip::tcp::endpoint remoteEndpoint = socket.remote_endpoint(ec);
-
-  std::shared_ptr<asio::ip::tcp::socket> socketPtr;
-  socketPtr.reset(new asio::ip::tcp::socket(std::move(socket)));
-
-  mResolver.async_resolve(remoteEndpoint,
-    std::bind(&AsioPoller::handleResolve, this, socketPtr, std::placeholders::_1, std::placeholders::_2));
-}
-
-//------------------------------------------------------------------------------
-// Handle resolve
-//------------------------------------------------------------------------------
-void AsioPoller::handleResolve(std::shared_ptr<asio::ip::tcp::socket> socketPtr, const std::error_code &ec,
-  asio::ip::tcp::resolver::iterator resultIterator) {
-
-  std::string resolvedHostname = "N/A";
-
-  asio::ip::tcp::resolver::iterator end;
-  if(resultIterator != end) {
-    resolvedHostname = resultIterator->host_name();
+  if(ec) {
+    // already gone
+    return;
   }
 
-  asio::ip::tcp::socket socket = std::move(*socketPtr.get());
+  // Serve the connection right away, identified by its numeric address -
+  // the hostname is only looked up if and when somebody asks for it.
+  std::string address = remoteEndpoint.address().to_string();
 
   std::unique_ptr<ActiveEntry> activeEntry;
   activeEntry.reset(new ActiveEntry(std::move(socket)));
 
   qclient::TlsConfig tlsconfig;
-  activeEntry->link = new Link(activeEntry->socket, resolvedHostname, tlsconfig);
+  activeEntry->shard = shard;
+  activeEntry->link = new Link(shard->context, activeEntry->socket, address, &mHostnameCache, tlsconfig);
   activeEntry->conn = new Connection(activeEntry->link);
 
   ActiveEntry *ptr = activeEntry.get();
+  shard->connections++;
+  shard->acceptedConnections++;
 
-  std::scoped_lock lock(mEntriesMtx);
-  mEntries[ptr] = std::move(activeEntry);
-  ptr->socket.async_wait(asio::ip::tcp::socket::wait_read,
-    std::bind(&AsioPoller::handleWait, this, ptr, std::placeholders::_1));
+  std::scoped_lock lock(shard->entriesMtx);
+  shard->entries[ptr] = std::move(activeEntry);
+  requestWait(ptr);
 }
 
 //------------------------------------------------------------------------------
@@ -186,21 +318,50 @@ void AsioPoller::handleResolve(std::shared_ptr<asio::ip::tcp::socket> socketPtr,
 ActiveEntry::~ActiveEntry() {
   delete conn;
   delete link;
+  shard->connections--;
 }
 
 //------------------------------------------------------------------------------
-// Handle wait
+// Wait until the connection becomes readable
+//------------------------------------------------------------------------------
+void AsioPoller::requestWait(ActiveEntry *entry) {
+  entry->socket.async_wait(asio::ip::tcp::socket::wait_read,
+    asio::bind_executor(entry->link->getAsioStrand(),
+      std::bind(&AsioPoller::handleWait, this, entry, std::placeholders::_1)));
+}
+
+//------------------------------------------------------------------------------
+// Handle wait - runs on the strand of the link, same as its writes. A close
+// requested from another thread cancels the wait, and lands here.
 //------------------------------------------------------------------------------
 void AsioPoller::handleWait(ActiveEntry *entry, const std::error_code& ec) {
+  BusyTimer timer(entry->shard);
+
   LinkStatus status = entry->conn->processRequests(mDispatcher, mInFlightTracker);
   if(ec.value() == 0 && status >= 0) {
-    entry->socket.async_wait(asio::ip::tcp::socket::wait_read,
-      std::bind(&AsioPoller::handleWait, this, entry, std::placeholders::_1));
+    // Backpressure: Don't read any more requests from a client which isn't
+    // reading our responses, until its output queue has drained.
+    if(!entry->link->resumeWhenDrained(std::bind(&AsioPoller::handleWait, this, entry, std::error_code()))) {
+      requestWait(entry);
+    }
   }
   else {
-    std::scoped_lock lock(mEntriesMtx);
-    mEntries.erase(entry);
+    // The client is gone, or has only stopped sending, and may still be
+    // reading: Stop reading from it, but tear the connection down only once
+    // every queued response has been written, or writing fails.
+    if(!entry->link->closeWhenDrained(std::bind(&AsioPoller::removeEntry, this, entry))) {
+      removeEntry(entry);
+    }
   }
 }
 
+//------------------------------------------------------------------------------
+// Tear down a connection
+//------------------------------------------------------------------------------
+void AsioPoller::removeEntry(ActiveEntry *entry) {
+  PollerShard *shard = entry->shard;
+  std::scoped_lock lock(shard->entriesMtx);
+  shard->entries.erase(entry);
+}
+
 }
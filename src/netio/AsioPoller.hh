@@ -27,6 +27,7 @@
 #include "utils/AssistedThread.hh"
 #include "utils/InFlightTracker.hh"
 #include "EventFD.hh"
+#include "netio/HostnameCache.hh"
 #include <asio.hpp>
 #include <map>
 
@@ -35,6 +36,7 @@ namespace quarkdb {
 class Dispatcher;
 class Link;
 class Connection;
+struct PollerShard;
 
 struct ActiveEntry {
   ActiveEntry(asio::ip::tcp::socket &&sock) : socket(std::move(sock)) {}
@@ -42,10 +44,72 @@ struct ActiveEntry {
   asio::ip::tcp::socket socket;
   Link *link;
   Connection *conn;
+  PollerShard *shard;
 
   ~ActiveEntry();
 };
 
+//------------------------------------------------------------------------------
+// How the poller spreads connections over its threads:
+// - kShared: All threads run a single io_context. Handlers of any connection
+//   may run on any thread.
+// - kSharded: Each thread runs an io_context of its own, with its own
+//   SO_REUSEPORT acceptors - the kernel spreads incoming connections over
+//   them, and each connection stays on the thread which accepted it.
+//------------------------------------------------------------------------------
+enum class PollerMode {
+  kShared = 0,
+  kSharded = 1
+};
+
+std::string pollerModeToString(PollerMode mode);
+
+//------------------------------------------------------------------------------
+// Statistics of a single poller shard.
+//------------------------------------------------------------------------------
+struct PollerShardStats {
+  size_t id = 0;
+  size_t threads = 0;
+  int64_t connections = 0;
+  int64_t acceptedConnections = 0;
+
+  //----------------------------------------------------------------------------
+  // Fraction of time the threads of this shard spent handling events, as
+  // opposed to waiting for them, since the shard started.
+  //----------------------------------------------------------------------------
+  double utilization = 0;
+
+  std::string toString() const;
+};
+
+//------------------------------------------------------------------------------
+// An io_context, together with its acceptors, threads, and the connections
+// accepted through them.
+//------------------------------------------------------------------------------
+struct PollerShard {
+  PollerShard(size_t id);
+
+  size_t id;
+  asio::io_context context;
+
+  asio::ip::tcp::acceptor acceptor4;
+  asio::ip::tcp::acceptor acceptor6;
+
+  asio::ip::tcp::socket nextSocket4;
+  asio::ip::tcp::socket nextSocket6;
+  std::mutex acceptorMtx;
+
+  std::mutex entriesMtx;
+  std::map<ActiveEntry*, std::unique_ptr<ActiveEntry>> entries;
+
+  std::vector<AssistedThread> threads;
+
+  std::atomic<int64_t> connections {0};
+  std::atomic<int64_t> acceptedConnections {0};
+  std::atomic<int64_t> busyNanoseconds {0};
+  std::chrono::steady_clock::time_point startTime;
+};
+
 //------------------------------------------------------------------------------
 // Listens at a specific network port, and handles redis connections using
 // the given dispatcher.
@@ -55,7 +119,7 @@ public:
   //----------------------------------------------------------------------------
   // Constructor
   //----------------------------------------------------------------------------
-  AsioPoller(int port, size_t threadPoolSize, Dispatcher *disp);
+  AsioPoller(int port, size_t threadPoolSize, Dispatcher *disp, PollerMode mode = PollerMode::kShared);
 
   //----------------------------------------------------------------------------
   // Destructor
@@ -65,57 +129,69 @@ public:
   //----------------------------------------------------------------------------
   // Thread pool
   //----------------------------------------------------------------------------
-  void workerThread(ThreadAssistant &assistant);
+  void workerThread(PollerShard *shard, ThreadAssistant &assistant);
+
+  //----------------------------------------------------------------------------
+  // Per-shard statistics - in sharded mode, one shard per thread
+  //----------------------------------------------------------------------------
+  std::vector<PollerShardStats> getStats();
+
+  //----------------------------------------------------------------------------
+  // Describe our shards, for QUARKDB_INFO
+  //----------------------------------------------------------------------------
+  std::vector<std::string> describe();
 
 private:
+  //----------------------------------------------------------------------------
+  // Throw if something is listening on our port already
+  //----------------------------------------------------------------------------
+  void checkPortAvailable(const asio::ip::tcp &protocol);
+
+  //----------------------------------------------------------------------------
+  // Open, bind and start listening on an acceptor
+  //----------------------------------------------------------------------------
+  void openAcceptor(asio::ip::tcp::acceptor &acceptor, const asio::ip::tcp &protocol);
+
   //----------------------------------------------------------------------------
   // Request next async accept
   //----------------------------------------------------------------------------
-  void requestAccept4();
-  void requestAccept6();
+  void requestAccept4(PollerShard *shard);
+  void requestAccept6(PollerShard *shard);
 
   //----------------------------------------------------------------------------
   // Handle incoming TCP connect
   //----------------------------------------------------------------------------
-  void handleAccept(asio::ip::tcp::socket socket);
-  void handleAccept4(const std::error_code& ec);
-  void handleAccept6(const std::error_code& ec);
+  void handleAccept(PollerShard *shard, asio::ip::tcp::socket socket);
+  void handleAccept4(PollerShard *shard, const std::error_code& ec);
+  void handleAccept6(PollerShard *shard, const std::error_code& ec);
 
   //----------------------------------------------------------------------------
-  // Handle resolve
+  // Wait until the connection becomes readable
   //----------------------------------------------------------------------------
-  void handleResolve(std::shared_ptr<asio::ip::tcp::socket> socketPtr, const std::error_code &ec,
-    asio::ip::tcp::resolver::iterator resultIterator);
+  void requestWait(ActiveEntry *entry);
 
   //----------------------------------------------------------------------------
   // Handle wait
   //----------------------------------------------------------------------------
   void handleWait(ActiveEntry *entry, const std::error_code& ec);
 
+  //----------------------------------------------------------------------------
+  // Tear down a connection
+  //----------------------------------------------------------------------------
+  void removeEntry(ActiveEntry *entry);
+
 
   std::atomic<bool> mShutdown = false;
 
   int mPort;
   size_t mThreadPoolSize;
   Dispatcher* mDispatcher;
-  AssistedThread mMainThread;
-  std::vector<AssistedThread> mThreadPool;
+  PollerMode mMode;
 
   InFlightTracker mInFlightTracker;
+  HostnameCache mHostnameCache;
 
-  asio::io_context mContext;
-  asio::ip::tcp::resolver mResolver;
-
-  asio::ip::tcp::acceptor mAcceptor4;
-  asio::ip::tcp::acceptor mAcceptor6;
-
-  asio::ip::tcp::socket mNextSocket4;
-  asio::ip::tcp::socket mNextSocket6;
-
-  std::mutex mEntriesMtx;
-  std::map<ActiveEntry*, std::unique_ptr<ActiveEntry>> mEntries;
-
-  std::mutex mAcceptorMtx;
+  std::vector<std::unique_ptr<PollerShard>> mShards;
 };
 
 }
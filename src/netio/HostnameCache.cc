@@ -0,0 +1,210 @@
+// ----------------------------------------------------------------------
+// File: HostnameCache.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "netio/HostnameCache.hh"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+HostnameCache::HostnameCache(size_t capacity, std::chrono::seconds ttl, Resolver resolver)
+: mCapacity(std::max<size_t>(capacity, 1u)), mTTL(ttl), mResolver(resolver) {
+  mThread.reset(&HostnameCache::main, this);
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+HostnameCache::~HostnameCache() {
+  mThread.stop();
+
+  {
+    std::scoped_lock lock(mMtx);
+    mPendingCV.notify_all();
+  }
+
+  mThread.join();
+}
+
+//------------------------------------------------------------------------------
+// Look up a fresh entry, and mark it as most recently used
+//------------------------------------------------------------------------------
+bool HostnameCache::findNoLock(const std::string &address, std::string &hostname) {
+  auto it = mIndex.find(address);
+  if(it == mIndex.end()) {
+    return false;
+  }
+
+  if(it->second->expiry <= std::chrono::steady_clock::now()) {
+    mLRU.erase(it->second);
+    mIndex.erase(it);
+    return false;
+  }
+
+  mLRU.splice(mLRU.begin(), mLRU, it->second);
+  hostname = it->second->hostname;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Insert, evicting the least recently used entries if over capacity
+//------------------------------------------------------------------------------
+void HostnameCache::insert(const std::string &address, const std::string &hostname) {
+  std::scoped_lock lock(mMtx);
+
+  auto it = mIndex.find(address);
+  if(it != mIndex.end()) {
+    mLRU.erase(it->second);
+    mIndex.erase(it);
+  }
+
+  mLRU.push_front(Entry {address, hostname, std::chrono::steady_clock::now() + mTTL});
+  mIndex[address] = mLRU.begin();
+
+  while(mLRU.size() > mCapacity) {
+    mIndex.erase(mLRU.back().address);
+    mLRU.pop_back();
+    mStats.evictions++;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Blocking resolve
+//------------------------------------------------------------------------------
+std::string HostnameCache::resolve(const std::string &address) {
+  std::string hostname;
+
+  {
+    std::scoped_lock lock(mMtx);
+    if(findNoLock(address, hostname)) {
+      mStats.hits++;
+      return hostname;
+    }
+
+    mStats.misses++;
+  }
+
+  if(!mResolver(address, hostname)) {
+    hostname = address;
+  }
+
+  insert(address, hostname);
+  return hostname;
+}
+
+//------------------------------------------------------------------------------
+// Non-blocking lookup
+//------------------------------------------------------------------------------
+bool HostnameCache::lookup(const std::string &address, std::string &hostname) {
+  std::scoped_lock lock(mMtx);
+
+  if(findNoLock(address, hostname)) {
+    mStats.hits++;
+    return true;
+  }
+
+  mStats.misses++;
+
+  if(mPending.size() < kMaxPendingLookups && std::find(mPending.begin(), mPending.end(), address) == mPending.end()) {
+    mPending.emplace_back(address);
+    mPendingCV.notify_one();
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Statistics
+//------------------------------------------------------------------------------
+HostnameCacheStats HostnameCache::getStats() {
+  std::scoped_lock lock(mMtx);
+  HostnameCacheStats stats = mStats;
+  stats.size = mLRU.size();
+  return stats;
+}
+
+//------------------------------------------------------------------------------
+// Background lookups
+//------------------------------------------------------------------------------
+void HostnameCache::main(ThreadAssistant &assistant) {
+  std::unique_lock<std::mutex> lock(mMtx);
+
+  while(!assistant.terminationRequested()) {
+    if(mPending.empty()) {
+      mPendingCV.wait_for(lock, std::chrono::seconds(1));
+      continue;
+    }
+
+    std::string address = mPending.front();
+    lock.unlock();
+
+    std::string hostname;
+    if(!mResolver(address, hostname)) {
+      hostname = address;
+    }
+
+    insert(address, hostname);
+
+    lock.lock();
+    mPending.pop_front();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Reverse lookup through getnameinfo
+//------------------------------------------------------------------------------
+bool HostnameCache::reverseLookup(const std::string &address, std::string &hostname) {
+  sockaddr_storage storage;
+  memset(&storage, 0, sizeof(storage));
+  socklen_t len = 0;
+
+  sockaddr_in *addr4 = reinterpret_cast<sockaddr_in*>(&storage);
+  sockaddr_in6 *addr6 = reinterpret_cast<sockaddr_in6*>(&storage);
+
+  if(inet_pton(AF_INET, address.c_str(), &addr4->sin_addr) == 1) {
+    addr4->sin_family = AF_INET;
+    len = sizeof(sockaddr_in);
+  }
+  else if(inet_pton(AF_INET6, address.c_str(), &addr6->sin6_addr) == 1) {
+    addr6->sin6_family = AF_INET6;
+    len = sizeof(sockaddr_in6);
+  }
+  else {
+    return false;
+  }
+
+  char host[NI_MAXHOST];
+  if(getnameinfo(reinterpret_cast<sockaddr*>(&storage), len, host, sizeof(host), nullptr, 0, NI_NAMEREQD) != 0) {
+    return false;
+  }
+
+  hostname = host;
+  return true;
+}
+
+}
@@ -0,0 +1,129 @@
+// ----------------------------------------------------------------------
+// File: HostnameCache.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_HOSTNAME_CACHE_HH
+#define QUARKDB_HOSTNAME_CACHE_HH
+
+#include "utils/AssistedThread.hh"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Statistics of a HostnameCache.
+//------------------------------------------------------------------------------
+struct HostnameCacheStats {
+  size_t size = 0;
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+};
+
+//------------------------------------------------------------------------------
+// Reverse DNS lookups of client addresses, made lazily and cached. Accepting a
+// connection never waits on the resolver: Connections are identified by their
+// numeric address, and a hostname is only looked up once something asks for
+// it.
+//
+// Entries expire after a TTL, and the least recently used ones are evicted
+// once over capacity. Failed lookups are cached as well, so a slow or absent
+// resolver is hit at most once per address per TTL.
+//------------------------------------------------------------------------------
+class HostnameCache {
+public:
+  //----------------------------------------------------------------------------
+  // Turns a numeric address into a hostname - returns false if there's none.
+  //----------------------------------------------------------------------------
+  using Resolver = std::function<bool(const std::string &address, std::string &hostname)>;
+
+  //----------------------------------------------------------------------------
+  // Constructor
+  //----------------------------------------------------------------------------
+  HostnameCache(size_t capacity, std::chrono::seconds ttl, Resolver resolver = reverseLookup);
+
+  //----------------------------------------------------------------------------
+  // Destructor
+  //----------------------------------------------------------------------------
+  ~HostnameCache();
+
+  //----------------------------------------------------------------------------
+  // Blocking: Resolve the given address, going to the resolver on a cache
+  // miss. Returns the address itself if it has no hostname.
+  //----------------------------------------------------------------------------
+  std::string resolve(const std::string &address);
+
+  //----------------------------------------------------------------------------
+  // Non-blocking: Return true and fill in the hostname if there's a fresh
+  // cached entry for the given address. Otherwise, return false, and
+  // schedule a lookup in the background, so a later call finds it.
+  //----------------------------------------------------------------------------
+  bool lookup(const std::string &address, std::string &hostname);
+
+  HostnameCacheStats getStats();
+
+  //----------------------------------------------------------------------------
+  // Reverse lookup through getnameinfo.
+  //----------------------------------------------------------------------------
+  static bool reverseLookup(const std::string &address, std::string &hostname);
+
+  //----------------------------------------------------------------------------
+  // At most this many background lookups are queued, any more are ignored.
+  //----------------------------------------------------------------------------
+  static constexpr size_t kMaxPendingLookups = 1024;
+
+private:
+  struct Entry {
+    std::string address;
+    std::string hostname;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  bool findNoLock(const std::string &address, std::string &hostname);
+  void insert(const std::string &address, const std::string &hostname);
+  void main(ThreadAssistant &assistant);
+
+  size_t mCapacity;
+  std::chrono::seconds mTTL;
+  Resolver mResolver;
+
+  std::mutex mMtx;
+  std::list<Entry> mLRU; // most recently used in front
+  std::unordered_map<std::string, std::list<Entry>::iterator> mIndex;
+  HostnameCacheStats mStats;
+
+  std::deque<std::string> mPending;
+  std::condition_variable mPendingCV;
+
+  AssistedThread mThread;
+};
+
+}
+
+#endif
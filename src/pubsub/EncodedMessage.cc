@@ -0,0 +1,60 @@
+// ----------------------------------------------------------------------
+// File: EncodedMessage.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "pubsub/EncodedMessage.hh"
+#include "Formatter.hh"
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// Constructor for a message to channel subscribers
+//------------------------------------------------------------------------------
+EncodedMessage::EncodedMessage(std::string_view chan, std::string_view pl)
+: isPattern(false), channel(chan), payload(pl) {}
+
+//------------------------------------------------------------------------------
+// Constructor for a message to subscribers of the given pattern
+//------------------------------------------------------------------------------
+EncodedMessage::EncodedMessage(std::string_view pat, std::string_view chan,
+  std::string_view pl) : isPattern(true), pattern(pat), channel(chan), payload(pl) {}
+
+//------------------------------------------------------------------------------
+// Get the encoded message, for the given protocol variant
+//------------------------------------------------------------------------------
+const SharedEncodedResponse& EncodedMessage::get(bool pushType) {
+  SharedEncodedResponse &target = pushType ? pushEncoded : arrayEncoded;
+
+  if(target.empty()) {
+    encodings++;
+
+    if(isPattern) {
+      target = SharedEncodedResponse(Formatter::pmessage(pushType, pattern, channel, payload));
+    }
+    else {
+      target = SharedEncodedResponse(Formatter::message(pushType, channel, payload));
+    }
+  }
+
+  return target;
+}
@@ -0,0 +1,89 @@
+// ----------------------------------------------------------------------
+// File: EncodedMessage.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_PUBSUB_ENCODED_MESSAGE_HH
+#define QUARKDB_PUBSUB_ENCODED_MESSAGE_HH
+
+#include "redis/RedisEncodedResponse.hh"
+#include <string_view>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// A published message on its way to subscribers, either a "message" for a
+// channel subscription, or a "pmessage" for a pattern subscription.
+//
+// Encoding happens lazily and at most once per protocol variant, no matter
+// how many subscribers receive it: one encoding for connections with push
+// types active, and one with plain RESP2 arrays.
+//
+// Only holds views to pattern, channel and payload, which must outlive this
+// object. Not thread-safe.
+//------------------------------------------------------------------------------
+class EncodedMessage {
+public:
+  //----------------------------------------------------------------------------
+  // Constructor for a message to channel subscribers
+  //----------------------------------------------------------------------------
+  EncodedMessage(std::string_view channel, std::string_view payload);
+
+  //----------------------------------------------------------------------------
+  // Constructor for a message to subscribers of the given pattern
+  //----------------------------------------------------------------------------
+  EncodedMessage(std::string_view pattern, std::string_view channel,
+    std::string_view payload);
+
+  //----------------------------------------------------------------------------
+  // Get the encoded message, for the given protocol variant
+  //----------------------------------------------------------------------------
+  const SharedEncodedResponse& get(bool pushType);
+
+  //----------------------------------------------------------------------------
+  // Get channel this message is published to
+  //----------------------------------------------------------------------------
+  std::string_view getChannel() const {
+    return channel;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get number of times we had to encode - never more than two
+  //----------------------------------------------------------------------------
+  size_t getEncodings() const {
+    return encodings;
+  }
+
+private:
+  bool isPattern;
+  std::string_view pattern;
+  std::string_view channel;
+  std::string_view payload;
+
+  SharedEncodedResponse pushEncoded;
+  SharedEncodedResponse arrayEncoded;
+  size_t encodings = 0;
+};
+
+}
+
+#endif
@@ -22,6 +22,7 @@
  ************************************************************************/
 
 #include "pubsub/Publisher.hh"
+#include "pubsub/EncodedMessage.hh"
 #include "Formatter.hh"
 #include "storage/PatternMatching.hh"
 
@@ -90,10 +91,11 @@ int Publisher::psubscribe(std::shared_ptr<PendingQueue> connection, std::string_
 
 int Publisher::publishChannels(const std::string &channel, std::string_view payload) {
   int hits = 0;
+  EncodedMessage msg(channel, payload);
 
   // publish to matching channels
   for(auto it = channelSubscriptions.findMatching(std::string(channel)); it.valid(); it.next()) {
-    bool stillAlive = it.getValue()->addMessageIfAttached(channel, payload);
+    bool stillAlive = it.getValue()->addMessageIfAttached(channel, msg);
 
     if(!stillAlive) {
       it.erase();
@@ -109,9 +111,18 @@ int Publisher::publishChannels(const std::string &channel, std::string_view payl
 int Publisher::publishPatterns(const std::string& channel, std::string_view payload) {
   int hits = 0;
 
-  // publish to matching patterns
+  // publish to matching patterns - the iterator groups subscribers by pattern,
+  // so each pattern's message only needs to be encoded once
+  std::string pattern;
+  std::unique_ptr<EncodedMessage> msg;
+
   for(auto it = patternMatcher.find(std::string(channel)); it.valid(); it.next()) {
-    bool stillAlive = it.getValue()->addPatternMessageIfAttached(it.getPattern(), channel, payload);
+    if(!msg || pattern != it.getPattern()) {
+      pattern = it.getPattern();
+      msg.reset(new EncodedMessage(pattern, channel, payload));
+    }
+
+    bool stillAlive = it.getValue()->addPatternMessageIfAttached(pattern, *msg);
 
     if(!stillAlive) {
       it.erase();
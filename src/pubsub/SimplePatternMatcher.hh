@@ -26,6 +26,11 @@
 
 #include "../../deps/StringMatchLen.h"
 #include "pubsub/ThreadSafeMultiMap.hh"
+#include "storage/PatternMatching.hh"
+#include <shared_mutex>
+#include <mutex>
+#include <memory>
+#include <vector>
 #include <map>
 #include <set>
 
@@ -36,11 +41,15 @@ namespace quarkdb {
 // - insert a pattern, with a value
 // - check a value against which patterns it matches to
 //
-// Not thread-safe. Also, not safe to modify this structure while holding an
-// iterator.
+// Patterns are indexed in a trie over their literal prefix, ie everything up
+// to the first glob-style special character. Looking up a key walks the trie
+// once along the key - only patterns hanging off visited nodes can possibly
+// match, and for those we only need to evaluate the glob suffix, as the
+// prefix has been matched by the walk already.
 //
-// Matching is not particularly efficient, as we scan through the entire
-// contents to find a match.
+// Safe to modify while iterators are being held, with the same guarantees as
+// ThreadSafeMultiMap: patterns inserted or erased while a lookup is ongoing
+// may or may not be returned.
 //------------------------------------------------------------------------------
 template<typename T>
 class SimplePatternMatcher {
@@ -52,14 +61,45 @@ public:
   // Insert the given pattern and value.
   //----------------------------------------------------------------------------
   bool insert(const Pattern &pattern, const T& value) {
-    return contents.insert(pattern, value);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    if(!contents.insert(pattern, value)) {
+      return false;
+    }
+
+    Node *node = &root;
+    std::string prefix = extractPatternPrefix(pattern);
+
+    for(size_t i = 0; i < prefix.size(); i++) {
+      std::unique_ptr<Node> &child = node->children[prefix[i]];
+      if(!child) {
+        child.reset(new Node());
+      }
+
+      node = child.get();
+    }
+
+    node->patterns.insert(pattern);
+    return true;
   }
 
   //----------------------------------------------------------------------------
   // Erase the given pattern and value, if they exist
   //----------------------------------------------------------------------------
   bool erase(const Pattern &pattern, const T& value) {
-    return contents.erase(pattern, value);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    if(!contents.erase(pattern, value)) {
+      return false;
+    }
+
+    if(!contents.findMatching(pattern, 1).valid()) {
+      // Last value for this pattern is gone, drop it from the index
+      std::string prefix = extractPatternPrefix(pattern);
+      eraseFromNode(&root, pattern, prefix, 0);
+    }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
@@ -77,25 +117,23 @@ public:
     //--------------------------------------------------------------------------
     // Constructor
     //--------------------------------------------------------------------------
-    Iterator(SimplePatternMatcher<T> *obj, const Key &k) :
-      matcher(obj), key(k) {
-
-      keyIterator = matcher->contents.getKeyIterator();
-      advanceFirstIteratorUntilMatch();
+    Iterator(SimplePatternMatcher<T> *obj, const Key &k) : matcher(obj) {
+      matcher->collectMatches(k, matches);
+      advanceUntilValid();
     }
 
     //--------------------------------------------------------------------------
     // Check if iterator is valid
     //--------------------------------------------------------------------------
     bool valid() const {
-      return isValid;
+      return position < matches.size();
     }
 
     //--------------------------------------------------------------------------
     // Get pattern of item this iterator is pointing to
     //--------------------------------------------------------------------------
     Pattern getPattern() const {
-      return keyIterator.getKey();
+      return matches[position];
     }
 
     //--------------------------------------------------------------------------
@@ -112,62 +150,165 @@ public:
       matchIterator.next();
 
       if(!matchIterator.valid()) {
-        keyIterator.next();
-        advanceFirstIteratorUntilMatch();
+        position++;
+        advanceUntilValid();
       }
     }
 
     bool erase() {
-      return matchIterator.erase();
+      return matcher->erase(matches[position], matchIterator.getValue());
     }
 
   private:
     //--------------------------------------------------------------------------
-    // Advance first iterator until there's a pattern match
+    // Advance to the first matching pattern which still holds values
     //--------------------------------------------------------------------------
-    void advanceFirstIteratorUntilMatch() {
-
-      while(keyIterator.valid()) {
-        Key iterKey = keyIterator.getKey();
-
-        if(stringmatchlen(iterKey.data(), iterKey.size(), key.data(), key.size(), 0) == 1) {
-          // We have a match
-          matchIterator = matcher->contents.findMatching(iterKey);
-          if(matchIterator.valid()) {
-            return;
-          }
+    void advanceUntilValid() {
+      for( ; position < matches.size(); position++) {
+        matchIterator = matcher->contents.findMatching(matches[position]);
+        if(matchIterator.valid()) {
+          return;
         }
-
-        keyIterator.next();
       }
-
-      // No match, stop iterating
-      isValid = false;
     }
 
-
     SimplePatternMatcher<T> *matcher;
-    Key key;
-    typename ThreadSafeMultiMap<Pattern, T>::KeyIterator keyIterator;
+    std::vector<Pattern> matches;
+    size_t position = 0;
     typename ThreadSafeMultiMap<Pattern, T>::MatchIterator matchIterator;
-    bool isValid = true;
   };
 
   //----------------------------------------------------------------------------
-  // Find all patterns matching given value
+  // Find all patterns matching given value. Patterns with a shorter literal
+  // prefix come first, patterns sharing the same prefix are sorted.
   //----------------------------------------------------------------------------
   Iterator find(const Key& key) {
     return Iterator(this, key);
   }
 
+  //----------------------------------------------------------------------------
+  // Iterator through the full contents. Erasing through it goes through
+  // SimplePatternMatcher::erase, so the trie is kept in sync.
+  //----------------------------------------------------------------------------
+  class FullIterator {
+  public:
+    //--------------------------------------------------------------------------
+    // Constructor
+    //--------------------------------------------------------------------------
+    FullIterator(SimplePatternMatcher<T> *obj)
+    : matcher(obj), iter(obj->contents.getFullIterator()) {}
+
+    //--------------------------------------------------------------------------
+    // Check if iterator is valid
+    //--------------------------------------------------------------------------
+    bool valid() {
+      return iter.valid();
+    }
+
+    //--------------------------------------------------------------------------
+    // Get pattern of item this iterator is pointing to
+    //--------------------------------------------------------------------------
+    Pattern getPattern() const {
+      return iter.getKey();
+    }
+
+    //--------------------------------------------------------------------------
+    // Get value of item this iterator is pointing to
+    //--------------------------------------------------------------------------
+    T getValue() const {
+      return iter.getValue();
+    }
+
+    //--------------------------------------------------------------------------
+    // Advance iterator
+    //--------------------------------------------------------------------------
+    void next() {
+      iter.next();
+    }
+
+    bool erase() {
+      return matcher->erase(iter.getKey(), iter.getValue());
+    }
+
+  private:
+    SimplePatternMatcher<T> *matcher;
+    typename ThreadSafeMultiMap<Pattern, T>::FullIterator iter;
+  };
+
   //----------------------------------------------------------------------------
   // Get iterator to full contents
   //----------------------------------------------------------------------------
-  typename ThreadSafeMultiMap<Pattern, T>::FullIterator getFullIterator() {
-    return contents.getFullIterator();
+  FullIterator getFullIterator() {
+    return FullIterator(this);
+  }
+
+  //----------------------------------------------------------------------------
+  // Check whether the trie has been pruned down to an empty root
+  //----------------------------------------------------------------------------
+  bool trieEmpty() {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return root.patterns.empty() && root.children.empty();
   }
 
 private:
+  //----------------------------------------------------------------------------
+  // Trie node: patterns whose literal prefix ends exactly here, and children
+  // indexed by the next literal character.
+  //----------------------------------------------------------------------------
+  struct Node {
+    std::map<char, std::unique_ptr<Node>> children;
+    std::set<Pattern> patterns;
+  };
+
+  //----------------------------------------------------------------------------
+  // Walk the trie along the given key, and collect all patterns matching it.
+  //----------------------------------------------------------------------------
+  void collectMatches(const Key &key, std::vector<Pattern> &out) {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+
+    const Node *node = &root;
+    size_t depth = 0;
+
+    while(true) {
+      for(auto it = node->patterns.begin(); it != node->patterns.end(); it++) {
+        // The first 'depth' characters are the literal prefix, which matched
+        // already while walking down the trie.
+        if(stringmatchlen(it->data() + depth, it->size() - depth,
+          key.data() + depth, key.size() - depth, 0) == 1) {
+          out.emplace_back(*it);
+        }
+      }
+
+      if(depth == key.size()) break;
+
+      auto child = node->children.find(key[depth]);
+      if(child == node->children.end()) break;
+
+      node = child->second.get();
+      depth++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Remove pattern from the trie, pruning any nodes left empty. Returns
+  // whether the given node is now empty.
+  //----------------------------------------------------------------------------
+  bool eraseFromNode(Node *node, const Pattern &pattern, const std::string &prefix, size_t depth) {
+    if(depth == prefix.size()) {
+      node->patterns.erase(pattern);
+    }
+    else {
+      auto child = node->children.find(prefix[depth]);
+      if(child != node->children.end() && eraseFromNode(child->second.get(), pattern, prefix, depth+1)) {
+        node->children.erase(child);
+      }
+    }
+
+    return node->patterns.empty() && node->children.empty();
+  }
+
+  std::shared_mutex mtx;
+  Node root;
   ThreadSafeMultiMap<Pattern, T> contents;
 };
 
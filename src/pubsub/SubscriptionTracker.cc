@@ -66,3 +66,10 @@ bool SubscriptionTracker::hasChannel(const std::string &item) const {
 bool SubscriptionTracker::hasPattern(const std::string &item) const {
 	return patterns.find(item) != patterns.end();
 }
+
+//------------------------------------------------------------------------------
+// Check whether we're subscribed to anything at all
+//------------------------------------------------------------------------------
+bool SubscriptionTracker::empty() const {
+	return channels.empty() && patterns.empty();
+}
@@ -70,6 +70,11 @@ public:
   //----------------------------------------------------------------------------
   bool hasPattern(const std::string &item) const;
 
+  //----------------------------------------------------------------------------
+  // Check whether we're subscribed to anything at all
+  //----------------------------------------------------------------------------
+  bool empty() const;
+
 private:
   std::set<std::string> channels;
   std::set<std::string> patterns;
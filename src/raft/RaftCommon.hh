@@ -67,16 +67,54 @@ struct RaftEntry {
   template<typename... Args>
   RaftEntry(RaftTerm term_, Args&&... args) : term(term_), request{args...} {}
 
+  size_t serializedSize() const {
+    size_t size = sizeof(term);
+
+    for(size_t i = 0; i < request.size(); i++) {
+      size += sizeof(int64_t) + request[i].size();
+    }
+
+    return size;
+  }
+
+  //----------------------------------------------------------------------------
+  // Integer headers of the serialized form, in order: term, followed by the
+  // length of each request element. Together with the request contents, they
+  // make up the serialized entry, without having to copy the contents into
+  // one contiguous buffer first.
+  //----------------------------------------------------------------------------
+  void serializeHeaders(std::string &headers) const {
+    headers.resize(sizeof(int64_t) * (request.size() + 1));
+    char *pos = headers.data();
+
+    memcpy(pos, &term, sizeof(term));
+    pos += sizeof(term);
+
+    for(size_t i = 0; i < request.size(); i++) {
+      int64_t len = request[i].size();
+      memcpy(pos, &len, sizeof(len));
+      pos += sizeof(len);
+    }
+  }
+
   RaftSerializedEntry serialize() const {
-    std::ostringstream ss;
-    append_int_to_string(term, ss);
+    RaftSerializedEntry out;
+    out.resize(serializedSize());
+    char *pos = out.data();
+
+    memcpy(pos, &term, sizeof(term));
+    pos += sizeof(term);
 
     for(size_t i = 0; i < request.size(); i++) {
-      append_int_to_string(request[i].size(), ss);
-      ss << request[i];
+      int64_t len = request[i].size();
+      memcpy(pos, &len, sizeof(len));
+      pos += sizeof(len);
+
+      memcpy(pos, request[i].data(), len);
+      pos += len;
     }
 
-    return ss.str();
+    return out;
   }
 
   static void deserialize(RaftEntry &entry, std::string_view data) {
@@ -397,6 +435,8 @@ struct RaftInfo {
   int64_t lastStateChange;
   ReplicationStatus replicationStatus;
   std::string myVersion;
+  int64_t journalCacheHits;
+  int64_t journalCacheMisses;
 
   std::vector<std::string> toVector() {
     std::vector<std::string> ret;
@@ -416,6 +456,8 @@ struct RaftInfo {
     ret.push_back(SSTR("STATUS " << statusToString(status)));
     ret.push_back(SSTR("NODE-HEALTH " << healthStatusAsString(nodeHealthStatus)));
     ret.push_back(SSTR("JOURNAL-FSYNC-POLICY " << fsyncPolicyToString(fsyncPolicy)));
+    ret.push_back(SSTR("JOURNAL-CACHE-HITS " << journalCacheHits));
+    ret.push_back(SSTR("JOURNAL-CACHE-MISSES " << journalCacheMisses));
 
     ret.push_back("----------");
     ret.push_back(SSTR("MEMBERSHIP-EPOCH " << membershipEpoch));
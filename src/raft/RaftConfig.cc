@@ -31,6 +31,8 @@ using namespace quarkdb;
 
 const std::string kTrimConfigKey("raft.trimming");
 const std::string kResilveringEnabledKey("raft.resilvering.enabled");
+const std::string kReplicationMaxInflightBytesKey("raft.replication.max-inflight-bytes");
+const std::string kResilveringBandwidthKey("raft.resilvering.bandwidth");
 
 bool TrimmingConfig::parse(const std::string &str) {
   std::vector<int64_t> parts;
@@ -83,6 +85,80 @@ EncodedConfigChange RaftConfig::setResilveringEnabled(bool value) {
   return { "", req };
 }
 
+int64_t RaftConfig::getReplicationMaxInflightBytes() {
+  const int64_t defaultValue = 64 * 1024 * 1024;
+
+  std::string value;
+  rocksdb::Status st = stateMachine.configGet(kReplicationMaxInflightBytesKey, value);
+
+  if(st.IsNotFound()) {
+    return defaultValue;
+  }
+  else if(!st.ok()) {
+    qdb_throw("Error when retrieving replication max in-flight bytes: " << st.ToString());
+  }
+
+  int64_t ret;
+  if(!ParseUtils::parseInt64(value, ret) || ret <= 0) {
+    qdb_misconfig("Unable to parse replication configuration key: " << kReplicationMaxInflightBytesKey << " => " << value);
+    return defaultValue;
+  }
+
+  return ret;
+}
+
+EncodedConfigChange RaftConfig::setReplicationMaxInflightBytes(int64_t bytes, bool overrideSafety) {
+  if(bytes <= 0) {
+    return { SSTR("new max in-flight bytes must be positive: " << bytes), {} };
+  }
+
+  // Anything below 1 MB would throttle replication to a crawl, and most
+  // likely means an operator error.
+  if(!overrideSafety && bytes < 1024 * 1024) {
+    qdb_critical("attempted to set replication max in-flight bytes to very low value: " << bytes);
+    return { SSTR("new max in-flight bytes too small: " << bytes), {} };
+  }
+
+  RedisRequest req { "CONFIG_SET", kReplicationMaxInflightBytesKey, std::to_string(bytes) };
+  return { "", req };
+}
+
+int64_t RaftConfig::getResilveringBandwidth() {
+  std::string value;
+  rocksdb::Status st = stateMachine.configGet(kResilveringBandwidthKey, value);
+
+  if(st.IsNotFound()) {
+    return 0;
+  }
+  else if(!st.ok()) {
+    qdb_throw("Error when retrieving resilvering bandwidth: " << st.ToString());
+  }
+
+  int64_t ret;
+  if(!ParseUtils::parseInt64(value, ret) || ret < 0) {
+    qdb_misconfig("Unable to parse resilvering configuration key: " << kResilveringBandwidthKey << " => " << value);
+    return 0;
+  }
+
+  return ret;
+}
+
+EncodedConfigChange RaftConfig::setResilveringBandwidth(int64_t bytesPerSecond, bool overrideSafety) {
+  if(bytesPerSecond < 0) {
+    return { SSTR("new resilvering bandwidth must not be negative: " << bytesPerSecond), {} };
+  }
+
+  // Anything below 1 MB per second would make resilvering any real-world
+  // dataset take days, and most likely means an operator error.
+  if(!overrideSafety && bytesPerSecond != 0 && bytesPerSecond < 1024 * 1024) {
+    qdb_critical("attempted to set resilvering bandwidth to very low value: " << bytesPerSecond);
+    return { SSTR("new resilvering bandwidth too small: " << bytesPerSecond), {} };
+  }
+
+  RedisRequest req { "CONFIG_SET", kResilveringBandwidthKey, std::to_string(bytesPerSecond) };
+  return { "", req };
+}
+
 TrimmingConfig RaftConfig::getTrimmingConfig() {
   std::string trimConfig;
   rocksdb::Status st = stateMachine.configGet(kTrimConfigKey, trimConfig);
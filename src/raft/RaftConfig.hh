@@ -62,6 +62,20 @@ public:
   bool getResilveringEnabled();
   EncodedConfigChange setResilveringEnabled(bool value);
 
+  //----------------------------------------------------------------------------
+  // Maximum number of bytes the leader keeps in flight towards any single
+  // follower during streaming replication.
+  //----------------------------------------------------------------------------
+  int64_t getReplicationMaxInflightBytes();
+  EncodedConfigChange setReplicationMaxInflightBytes(int64_t bytes, bool overrideSafety = false);
+
+  //----------------------------------------------------------------------------
+  // Bandwidth cap for resilvering, in bytes per second, shared among all
+  // files in flight towards the same target. Zero means unlimited.
+  //----------------------------------------------------------------------------
+  int64_t getResilveringBandwidth();
+  EncodedConfigChange setResilveringBandwidth(int64_t bytesPerSecond, bool overrideSafety = false);
+
 private:
   StateMachine &stateMachine;
 };
@@ -27,6 +27,7 @@
 #include "raft/RaftWriteTracker.hh"
 #include "raft/RaftState.hh"
 #include "raft/RaftReplicator.hh"
+#include "raft/RaftLease.hh"
 #include "redis/LeaseFilter.hh"
 #include "StateMachine.hh"
 #include "Formatter.hh"
@@ -39,8 +40,8 @@
 
 using namespace quarkdb;
 
-RaftDispatcher::RaftDispatcher(RaftJournal &jour, StateMachine &sm, RaftState &st, RaftHeartbeatTracker &rht, RaftWriteTracker &wt, RaftReplicator &rep, Publisher &pub)
-: journal(jour), stateMachine(sm), state(st), heartbeatTracker(rht), redisDispatcher(sm, pub), writeTracker(wt), replicator(rep), publisher(pub) {
+RaftDispatcher::RaftDispatcher(RaftJournal &jour, StateMachine &sm, RaftState &st, RaftHeartbeatTracker &rht, RaftLease &ls, RaftWriteTracker &wt, RaftReplicator &rep, Publisher &pub, const RaftContactDetails &cd)
+: journal(jour), stateMachine(sm), state(st), heartbeatTracker(rht), lease(ls), redisDispatcher(sm, pub), writeTracker(wt), replicator(rep), publisher(pub), readIndex(cd) {
 }
 
 void RaftDispatcher::notifyDisconnect(Connection *conn) {
@@ -314,6 +315,27 @@ LinkStatus RaftDispatcher::dispatch(Connection *conn, RedisRequest &req) {
       conn->raftStaleReads = true;
       return conn->ok();
     }
+    case RedisCommand::ACTIVATE_FOLLOWER_READS: {
+      conn->raftFollowerReads = true;
+      return conn->ok();
+    }
+    case RedisCommand::RAFT_READ_INDEX: {
+      if(!conn->raftAuthorization) return conn->err("not authorized to issue raft commands");
+      if(req.size() != 1) return conn->errArgs(req[0]);
+
+      RaftStateSnapshotPtr snapshot = state.getSnapshot();
+      if(snapshot->status != RaftStatus::LEADER) return conn->err("not a leader");
+
+      // Same reasoning as for leader reads: Only hand out our commit index if
+      // we're certain no other leader exists.
+      if(lease.getDeadline() < std::chrono::steady_clock::now()) {
+        return conn->err("unavailable");
+      }
+
+      // A freshly elected leader might not know the latest commit index yet,
+      // until its leadership marker is committed.
+      return conn->integer(std::max(journal.getCommitIndex(), snapshot->leadershipMarker));
+    }
     case RedisCommand::RAFT_JOURNAL_SCAN: {
       if(req.size() <= 1) {
         return conn->errArgs(req[0]);
@@ -369,6 +391,46 @@ LinkStatus RaftDispatcher::dispatch(Connection *conn, RedisRequest &req) {
   }
 }
 
+//------------------------------------------------------------------------------
+// Reads don't go through the raft journal. As long as we hold a valid lease,
+// no other node can have been elected leader in the meantime, so serving
+// the read from a snapshot of our state machine is linearizable.
+//
+// Reads on a connection without any outstanding writes are served right
+// away on the network thread. Only reads pipelined behind writes on the
+// same connection are queued, to preserve response ordering - by the time
+// those are serviced, the writes ahead of them have been committed.
+//------------------------------------------------------------------------------
+LinkStatus RaftDispatcher::serviceRead(Connection *conn, Transaction &tx) {
+  if(lease.getDeadline() < std::chrono::steady_clock::now()) {
+    // Our lease has expired, we might no longer be the leader without
+    // knowing it. We're about to step down anyway.
+    return conn->raw(Formatter::multiply(Formatter::err("unavailable"), tx.expectedResponses()));
+  }
+
+  return conn->addPendingTransaction(&redisDispatcher, std::move(tx));
+}
+
+//------------------------------------------------------------------------------
+// ReadIndex protocol: Ask the leader for its commit index, wait until our
+// state machine has applied it, then serve the read locally. The result
+// reflects every write acknowledged before the read arrived.
+//------------------------------------------------------------------------------
+LinkStatus RaftDispatcher::serviceFollowerRead(Connection *conn, Transaction &tx, const RaftStateSnapshotPtr &snapshot) {
+  std::chrono::milliseconds timeout = heartbeatTracker.getTimeouts().getLow();
+
+  LogIndex targetIndex;
+  if(!readIndex.fetch(snapshot->leader, timeout, targetIndex)) {
+    return conn->raw(Formatter::multiply(Formatter::moved(0, snapshot->leader), tx.expectedResponses()));
+  }
+
+  if(!stateMachine.waitUntilTargetLastApplied(targetIndex, timeout)) {
+    return conn->raw(Formatter::multiply(Formatter::moved(0, snapshot->leader), tx.expectedResponses()));
+  }
+
+  return redisDispatcher.dispatch(conn, tx);
+}
+
 LinkStatus RaftDispatcher::service(Connection *conn, Transaction &tx) {
 
   // if not leader, redirect... except if this is a read,
@@ -384,6 +446,10 @@ LinkStatus RaftDispatcher::service(Connection *conn, Transaction &tx) {
       return redisDispatcher.dispatch(conn, tx);
     }
 
+    if(conn->raftFollowerReads && !tx.containsWrites()) {
+      return serviceFollowerRead(conn, tx, snapshot);
+    }
+
     // Redirect.
     return conn->raw(Formatter::multiply(Formatter::moved(0, snapshot->leader), tx.expectedResponses()));
   }
@@ -423,14 +489,14 @@ LinkStatus RaftDispatcher::service(Connection *conn, Transaction &tx) {
   }
 
   if(!tx.containsWrites()) {
-    // Forward request to the state machine, without going through the
-    // raft journal.
-    return conn->addPendingTransaction(&redisDispatcher, std::move(tx));
+    return serviceRead(conn, tx);
   }
 
   // At this point, the received command *must* be a write - verify!
   qdb_assert(tx.containsWrites());
 
+  std::chrono::steady_clock::time_point dispatchTime = std::chrono::steady_clock::now();
+
   // Do lease filtering
   ClockValue txTimestamp = stateMachine.getDynamicClock();
   LeaseFilter::transform(tx, txTimestamp);
@@ -440,7 +506,7 @@ LinkStatus RaftDispatcher::service(Connection *conn, Transaction &tx) {
 
   LogIndex index = journal.getLogSize();
 
-  if(!writeTracker.append(index, snapshot->term, std::move(tx), conn->getQueue(), redisDispatcher)) {
+  if(!writeTracker.append(index, snapshot->term, std::move(tx), conn->getQueue(), redisDispatcher, dispatchTime)) {
     // We were most likely hit by the following race:
     // - We retrieved the state snapshot.
     // - The raft term was changed in the meantime, we lost leadership.
@@ -452,6 +518,23 @@ LinkStatus RaftDispatcher::service(Connection *conn, Transaction &tx) {
   return 1;
 }
 
+//------------------------------------------------------------------------------
+// Internal writes are appended to the journal like any other, only without a
+// connection waiting for the response - the write tracker applies them
+// straight from the journal once committed.
+//------------------------------------------------------------------------------
+bool RaftDispatcher::submitInternalWrite(RedisRequest &&req, LogIndex &index) {
+  RaftStateSnapshotPtr snapshot = state.getSnapshot();
+  if(snapshot->status != RaftStatus::LEADER) return false;
+
+  // Same as client writes, wait until a newly elected leader has caught up
+  if(stateMachine.getLastApplied() < snapshot->leadershipMarker) return false;
+
+  std::scoped_lock lock(raftCommand);
+  index = journal.getLogSize();
+  return writeTracker.appendInternal(index, snapshot->term, std::move(req));
+}
+
 RaftHeartbeatResponse RaftDispatcher::heartbeat(const RaftHeartbeatRequest &req) {
   RaftStateSnapshotPtr snapshot;
   return heartbeat(req, snapshot);
@@ -785,7 +868,7 @@ RaftInfo RaftDispatcher::info() {
   return {journal.getClusterID(), state.getMyself(), snapshot->leader, nodeHealthStatus, journal.getFsyncPolicy(), membership.epoch, membership.nodes, membership.observers, snapshot->term, journal.getLogStart(),
           journal.getLogSize(), snapshot->status, journal.getCommitIndex(), stateMachine.getLastApplied(), writeTracker.size(),
           std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - snapshot->timeCreated).count(),
-          replicationStatus, VERSION_FULL_STRING
+          replicationStatus, VERSION_FULL_STRING, journal.getCacheHits(), journal.getCacheMisses()
         };
 }
 
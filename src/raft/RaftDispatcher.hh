@@ -30,6 +30,7 @@
 #include "raft/RaftUtils.hh"
 #include "raft/RaftTimeouts.hh"
 #include "raft/RaftBlockedWrites.hh"
+#include "raft/RaftReadIndex.hh"
 #include <thread>
 #include <chrono>
 
@@ -40,19 +41,21 @@ namespace quarkdb {
 //------------------------------------------------------------------------------
 class RaftJournal; class RaftState; class RaftHeartbeatTracker;
 class RaftWriteTracker; class RaftReplicator; class Transaction;
+class RaftLease; class RaftContactDetails;
 
 struct RaftStateSnapshot;
 using RaftStateSnapshotPtr = std::shared_ptr<const RaftStateSnapshot>;
 
 class RaftDispatcher : public Dispatcher {
 public:
-  RaftDispatcher(RaftJournal &jour, StateMachine &sm, RaftState &st, RaftHeartbeatTracker &rht, RaftWriteTracker &rt, RaftReplicator &replicator, Publisher &publisher);
+  RaftDispatcher(RaftJournal &jour, StateMachine &sm, RaftState &st, RaftHeartbeatTracker &rht, RaftLease &lease, RaftWriteTracker &rt, RaftReplicator &replicator, Publisher &publisher, const RaftContactDetails &contactDetails);
   DISALLOW_COPY_AND_ASSIGN(RaftDispatcher);
 
   LinkStatus dispatchInfo(Connection *conn, RedisRequest &req);
   virtual LinkStatus dispatch(Connection *conn, RedisRequest &req) override final;
   virtual LinkStatus dispatch(Connection *conn, Transaction &transaction) override final;
   virtual void notifyDisconnect(Connection *conn) override final;
+  virtual bool submitInternalWrite(RedisRequest &&req, LogIndex &index) override final;
   LinkStatus dispatchPubsub(Connection *conn, RedisRequest &req);
 
   RaftInfo info();
@@ -71,6 +74,17 @@ private:
   RaftHeartbeatResponse heartbeat(const RaftHeartbeatRequest &req, RaftStateSnapshotPtr &snapshot);
   LinkStatus service(Connection *conn, Transaction &tx);
 
+  //----------------------------------------------------------------------------
+  // Service a read as leader, without going through the raft journal.
+  //----------------------------------------------------------------------------
+  LinkStatus serviceRead(Connection *conn, Transaction &tx);
+
+  //----------------------------------------------------------------------------
+  // Service a read as follower through the ReadIndex protocol. Falls back to
+  // redirecting the client if the leader cannot be reached in time.
+  //----------------------------------------------------------------------------
+  LinkStatus serviceFollowerRead(Connection *conn, Transaction &tx, const RaftStateSnapshotPtr &snapshot);
+
   //----------------------------------------------------------------------------
   // Check if the removal of the given node would be acceptable
   //----------------------------------------------------------------------------
@@ -88,10 +102,12 @@ private:
   StateMachine &stateMachine;
   RaftState &state;
   RaftHeartbeatTracker &heartbeatTracker;
+  RaftLease &lease;
   RedisDispatcher redisDispatcher;
   RaftWriteTracker& writeTracker;
   RaftReplicator &replicator;
   Publisher &publisher;
+  RaftReadIndex readIndex;
 
   //----------------------------------------------------------------------------
   // Print a message when a follower is too far behind in regular intervals
@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------
+// File: RaftEntryCache.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "raft/RaftEntryCache.hh"
+using namespace quarkdb;
+
+RaftEntryCache::RaftEntryCache(size_t maxEnt, size_t maxB, size_t maxEntSize)
+: maxEntries(maxEnt), maxBytes(maxB), maxEntrySize(maxEntSize) {}
+
+bool RaftEntryCache::accepts(size_t entrySize) const {
+  return maxEntries != 0 && entrySize <= maxEntrySize;
+}
+
+void RaftEntryCache::popFront() {
+  if(ring.front()) totalBytes -= ring.front()->size();
+  ring.pop_front();
+  startIndex++;
+}
+
+void RaftEntryCache::popBack() {
+  if(ring.back()) totalBytes -= ring.back()->size();
+  ring.pop_back();
+}
+
+void RaftEntryCache::append(LogIndex index, EntryPtr entry) {
+  std::scoped_lock lock(mtx);
+  if(maxEntries == 0) return;
+
+  if(ring.empty() || startIndex + (LogIndex) ring.size() != index) {
+    ring.clear();
+    totalBytes = 0;
+    startIndex = index;
+  }
+
+  if(entry) totalBytes += entry->size();
+  ring.emplace_back(std::move(entry));
+
+  while(!ring.empty() && (ring.size() > maxEntries || totalBytes > maxBytes)) {
+    popFront();
+  }
+}
+
+RaftEntryCache::EntryPtr RaftEntryCache::get(LogIndex index) {
+  std::scoped_lock lock(mtx);
+
+  if(index < startIndex || startIndex + (LogIndex) ring.size() <= index || !ring[index - startIndex]) {
+    misses++;
+    return {};
+  }
+
+  hits++;
+  return ring[index - startIndex];
+}
+
+void RaftEntryCache::removeFrom(LogIndex index) {
+  std::scoped_lock lock(mtx);
+  while(!ring.empty() && startIndex + (LogIndex) ring.size() > index) {
+    popBack();
+  }
+}
+
+void RaftEntryCache::trimUntil(LogIndex index) {
+  std::scoped_lock lock(mtx);
+  while(!ring.empty() && startIndex < index) {
+    popFront();
+  }
+}
+
+void RaftEntryCache::clear() {
+  std::scoped_lock lock(mtx);
+  ring.clear();
+  totalBytes = 0;
+}
+
+size_t RaftEntryCache::size() {
+  std::scoped_lock lock(mtx);
+  return ring.size();
+}
+
+size_t RaftEntryCache::bytes() {
+  std::scoped_lock lock(mtx);
+  return totalBytes;
+}
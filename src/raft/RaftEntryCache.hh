@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------
+// File: RaftEntryCache.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_RAFT_ENTRY_CACHE_HH
+#define QUARKDB_RAFT_ENTRY_CACHE_HH
+
+#include "raft/RaftCommon.hh"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Bounded ring of the most recently appended journal entries, in serialized
+// form. Replicating to followers almost always needs entries which were
+// appended just milliseconds earlier - serve those from memory, instead of
+// hitting rocksdb once per entry, per follower.
+//
+// The ring always covers a consecutive range of indexes. Entries too large to
+// be worth caching leave a hole, which simply counts as a miss.
+//------------------------------------------------------------------------------
+class RaftEntryCache {
+public:
+  using EntryPtr = std::shared_ptr<const RaftSerializedEntry>;
+
+  RaftEntryCache(size_t maxEntries, size_t maxBytes, size_t maxEntrySize);
+
+  //----------------------------------------------------------------------------
+  // Should an entry of the given size be cached?
+  //----------------------------------------------------------------------------
+  bool accepts(size_t entrySize) const;
+
+  //----------------------------------------------------------------------------
+  // Record a newly appended entry. A nullptr stands for an entry which was not
+  // cached. Appending anything other than the next index resets the cache.
+  //----------------------------------------------------------------------------
+  void append(LogIndex index, EntryPtr entry);
+
+  //----------------------------------------------------------------------------
+  // Retrieve an entry - nullptr on miss.
+  //----------------------------------------------------------------------------
+  EntryPtr get(LogIndex index);
+
+  //----------------------------------------------------------------------------
+  // Invalidate all entries starting from the given index, when the journal
+  // removes inconsistent entries.
+  //----------------------------------------------------------------------------
+  void removeFrom(LogIndex index);
+
+  //----------------------------------------------------------------------------
+  // Invalidate all entries before the given index, when trimming.
+  //----------------------------------------------------------------------------
+  void trimUntil(LogIndex index);
+
+  void clear();
+
+  int64_t getHits() const { return hits; }
+  int64_t getMisses() const { return misses; }
+  size_t size();
+  size_t bytes();
+
+private:
+  void popFront();
+  void popBack();
+
+  const size_t maxEntries;
+  const size_t maxBytes;
+  const size_t maxEntrySize;
+
+  std::mutex mtx;
+  std::deque<EntryPtr> ring;
+  LogIndex startIndex = 0;
+  size_t totalBytes = 0;
+
+  std::atomic<int64_t> hits {0};
+  std::atomic<int64_t> misses {0};
+};
+
+}
+
+#endif
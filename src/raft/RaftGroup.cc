@@ -121,7 +121,7 @@ RaftJournal* RaftGroup::journal() {
 RaftDispatcher* RaftGroup::dispatcher() {
   std::scoped_lock lock(mtx);
   if(dispatcherptr == nullptr) {
-    dispatcherptr = new RaftDispatcher(*journal(), *stateMachine(), *state(), *heartbeatTracker(), *writeTracker(), *replicator(), *publisher());
+    dispatcherptr = new RaftDispatcher(*journal(), *stateMachine(), *state(), *heartbeatTracker(), *lease(), *writeTracker(), *replicator(), *publisher(), *contactDetails());
   }
   return dispatcherptr;
 }
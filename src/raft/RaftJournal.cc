@@ -33,6 +33,7 @@
 #include "raft/RaftState.hh"
 
 #include <algorithm>
+#include <rocksdb/convenience.h>
 #include <rocksdb/utilities/checkpoint.h>
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/table.h>
@@ -113,9 +114,11 @@ void RaftJournal::ObliterateAndReinitializeJournal(const std::string &path, Raft
 }
 
 void RaftJournal::obliterate(RaftClusterID newClusterID, const std::vector<RaftServer> &newNodes, LogIndex startIndex, FsyncPolicy fsyncPolicy) {
-  IteratorPtr iter(db->NewIterator(rocksdb::ReadOptions()));
-  for(iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    db->Delete(rocksdb::WriteOptions(), iter->key().ToString());
+  for(rocksdb::ColumnFamilyHandle *handle : {defaultHandle, entriesHandle}) {
+    IteratorPtr iter(db->NewIterator(rocksdb::ReadOptions(), handle));
+    for(iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      db->Delete(rocksdb::WriteOptions(), handle, iter->key().ToString());
+    }
   }
 
   this->set_int_or_die(KeyConstants::kJournal_CurrentTerm, 0);
@@ -131,7 +134,7 @@ void RaftJournal::obliterate(RaftClusterID newClusterID, const std::vector<RaftS
   this->set_or_die(KeyConstants::kJournal_FsyncPolicy, fsyncPolicyToString(fsyncPolicy) );
 
   RaftEntry entry(0, "JOURNAL_UPDATE_MEMBERS", newMembers.toString(), newClusterID);
-  this->set_or_die(encodeEntryKey(startIndex), entry.serialize());
+  THROW_ON_ERROR(db->Put(rocksdb::WriteOptions(), entriesHandle, encodeEntryKey(startIndex), entry.serialize()));
 
   initialize();
 }
@@ -148,6 +151,7 @@ void RaftJournal::initializeFsyncPolicy() {
 }
 
 void RaftJournal::initialize() {
+  entryCache.clear();
   currentTerm = this->get_int_or_die(KeyConstants::kJournal_CurrentTerm);
   logSize = this->get_int_or_die(KeyConstants::kJournal_LogSize);
   logStart = this->get_int_or_die(KeyConstants::kJournal_LogStart);
@@ -181,14 +185,83 @@ void RaftJournal::openDB(const std::string &path) {
 
   options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
   options.create_if_missing = true;
+  options.create_missing_column_families = true;
   options.max_manifest_file_size = 1024 * 1024;
 
   // Warn on write stalls
   writeStallWarner.reset(new WriteStallWarner("raft-journal"));
   options.listeners.emplace_back(writeStallWarner);
 
-  rocksdb::Status status = rocksdb::DB::Open(options, path, &db);
+  //----------------------------------------------------------------------------
+  // Entries are appended in order, read back mostly sequentially, and trimmed
+  // from the front: No bloom filters, since we practically never look up an
+  // entry that isn't there, large blocks and write buffers, and universal
+  // compaction to keep write amplification down. (FIFO compaction would throw
+  // away entries based on size alone, whether trimmed or not)
+  //----------------------------------------------------------------------------
+  rocksdb::ColumnFamilyOptions entriesOptions(options);
+  rocksdb::BlockBasedTableOptions entriesTableOptions;
+  entriesTableOptions.block_size = 64 * 1024;
+
+  entriesOptions.table_factory.reset(rocksdb::NewBlockBasedTableFactory(entriesTableOptions));
+  entriesOptions.compaction_style = rocksdb::kCompactionStyleUniversal;
+  entriesOptions.write_buffer_size = 128 * 1024 * 1024;
+  entriesOptions.max_write_buffer_number = 4;
+
+  std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies = {
+    { rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions(options) },
+    { KeyConstants::kJournal_EntriesColumnFamily, entriesOptions }
+  };
+
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
+  rocksdb::Status status = rocksdb::DB::Open(options, path, columnFamilies, &handles, &db);
   if(!status.ok()) qdb_throw("Error while opening journal in " << path << ":" << status.ToString());
+
+  defaultHandle = handles[0];
+  entriesHandle = handles[1];
+  migrateEntries();
+}
+
+//------------------------------------------------------------------------------
+// Journals created by older versions keep their entries in the default column
+// family - move them over. Entries are removed from the default column family
+// only once all of them have been copied, so an interrupted migration simply
+// starts over on the next opening.
+//------------------------------------------------------------------------------
+void RaftJournal::migrateEntries() {
+  IteratorPtr iter(db->NewIterator(rocksdb::ReadOptions(), defaultHandle));
+  iter->Seek("E");
+
+  if(!iter->Valid() || iter->key()[0] != 'E') {
+    return;
+  }
+
+  qdb_event("Migrating raft journal entries into their own column family, this might take a while..");
+
+  rocksdb::WriteBatch batch;
+  int64_t migrated = 0;
+
+  for(; iter->Valid() && iter->key()[0] == 'E'; iter->Next()) {
+    THROW_ON_ERROR(batch.Put(entriesHandle, iter->key(), iter->value()));
+    migrated++;
+
+    if(batch.Count() >= 10000) {
+      THROW_ON_ERROR(db->Write(rocksdb::WriteOptions(), &batch));
+      batch.Clear();
+    }
+  }
+
+  THROW_ON_ERROR(iter->status());
+  iter.reset();
+
+  THROW_ON_ERROR(batch.DeleteRange(defaultHandle, "E", "F"));
+
+  rocksdb::WriteOptions opts;
+  opts.sync = true;
+  THROW_ON_ERROR(db->Write(opts, &batch));
+
+  THROW_ON_ERROR(db->CompactRange(rocksdb::CompactRangeOptions(), defaultHandle, nullptr, nullptr));
+  qdb_event("Migrated " << migrated << " raft journal entries into their own column family.");
 }
 
 RaftJournal::RaftJournal(const std::string &filename, RaftClusterID clusterID, const std::vector<RaftServer> &nodes, LogIndex startIndex, FsyncPolicy fsyncPolicy) {
@@ -201,6 +274,8 @@ RaftJournal::~RaftJournal() {
   fsyncThread.reset();
 
   if(db) {
+    db->DestroyColumnFamilyHandle(entriesHandle);
+    db->DestroyColumnFamilyHandle(defaultHandle);
     delete db;
     db = nullptr;
   }
@@ -402,9 +477,35 @@ bool RaftJournal::appendNoLock(LogIndex index, const RaftEntry &entry, bool impo
 
   KeyBuffer keyBuffer;
   encodeEntryKey(index, keyBuffer);
-  THROW_ON_ERROR(batch.Put(keyBuffer.toView(), entry.serialize()));
+  RaftEntryCache::EntryPtr serialized;
+
+  if(entryCache.accepts(entry.serializedSize())) {
+    // Serialize once - the same bytes will serve replication to followers
+    serialized = std::make_shared<const RaftSerializedEntry>(entry.serialize());
+    THROW_ON_ERROR(batch.Put(entriesHandle, keyBuffer.toView(), *serialized));
+  }
+  else {
+    // Gather the serialized entry straight from the request contents, which
+    // typically still reference the buffers the request was received into -
+    // the only copy made is into the write batch itself.
+    std::string headers;
+    entry.serializeHeaders(headers);
+
+    std::vector<rocksdb::Slice> valueParts;
+    valueParts.reserve(entry.request.size() * 2 + 1);
+    valueParts.emplace_back(headers.data(), sizeof(int64_t));
+
+    for(size_t i = 0; i < entry.request.size(); i++) {
+      valueParts.emplace_back(headers.data() + (i+1)*sizeof(int64_t), sizeof(int64_t));
+      valueParts.emplace_back(entry.request[i].data(), entry.request[i].size());
+    }
+
+    rocksdb::Slice keySlice(keyBuffer.data(), keyBuffer.size());
+    THROW_ON_ERROR(batch.Put(entriesHandle, rocksdb::SliceParts(&keySlice, 1), rocksdb::SliceParts(valueParts.data(), valueParts.size())));
+  }
 
   commitBatch(batch, index+1, important);
+  entryCache.append(index, std::move(serialized));
 
   termOfLastEntry = entry.term;
   logUpdated.notify_all();
@@ -442,15 +543,30 @@ void RaftJournal::trimUntil(LogIndex newLogStart) {
   if(commitIndex < newLogStart) qdb_throw("attempted to trim non-committed entries. commitIndex: " << commitIndex << ", new log start: " << newLogStart);
 
   qdb_info("Trimming raft journal from #" << logStart << " until #" << newLogStart);
-  rocksdb::WriteBatch batch;
 
-  for(LogIndex i = logStart; i < newLogStart; i++) {
-    THROW_ON_ERROR(batch.Delete(encodeEntryKey(i)));
-  }
+  std::string begin = encodeEntryKey(logStart);
+  std::string end = encodeEntryKey(newLogStart);
 
+  rocksdb::WriteBatch batch;
+  THROW_ON_ERROR(batch.DeleteRange(entriesHandle, begin, end));
   THROW_ON_ERROR(batch.Put(KeyConstants::kJournal_LogStart, intToBinaryString(newLogStart)));
+  entryCache.trimUntil(newLogStart);
   commitBatch(batch);
   logStart = newLogStart;
+
+  //----------------------------------------------------------------------------
+  // The range tombstone hides the trimmed entries right away, but compaction
+  // would take a while to reclaim their space. Drop any SST files made up
+  // entirely of trimmed entries straight away. The tombstone itself ends
+  // exactly at 'end', so it never lands in a file which qualifies.
+  //----------------------------------------------------------------------------
+  rocksdb::Slice beginSlice(begin);
+  rocksdb::Slice endSlice(end);
+
+  rocksdb::Status st = rocksdb::DeleteFilesInRange(db, entriesHandle, &beginSlice, &endSlice, false);
+  if(!st.ok()) {
+    qdb_warn("Unable to delete trimmed journal files: " << st.ToString());
+  }
 }
 
 RaftServer RaftJournal::getVotedFor() {
@@ -483,9 +599,11 @@ bool RaftJournal::removeEntries(LogIndex from) {
   if(from <= commitIndex) qdb_throw("attempted to remove committed entries. commitIndex: " << commitIndex << ", from: " << from);
   qdb_warn("Removing inconsistent log entries: [" << from << "," << logSize-1 << "]");
 
+  entryCache.removeFrom(from);
+
   rocksdb::WriteBatch batch;
   for(LogIndex i = from; i < logSize; i++) {
-    THROW_ON_ERROR(batch.Delete(encodeEntryKey(i)));
+    THROW_ON_ERROR(batch.Delete(entriesHandle, encodeEntryKey(i)));
   }
 
   //----------------------------------------------------------------------------
@@ -567,8 +685,14 @@ rocksdb::Status RaftJournal::fetch(LogIndex index, RaftEntry &entry) {
   // catch potential inconsistencies between the counters and what is
   // really contained in the journal
 
+  RaftEntryCache::EntryPtr cached = entryCache.get(index);
+  if(cached) {
+    RaftEntry::deserialize(entry, *cached);
+    return rocksdb::Status::OK();
+  }
+
   std::string data;
-  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), encodeEntryKey(index), &data);
+  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), entriesHandle, encodeEntryKey(index), &data);
   if(!st.ok()) return st;
 
   RaftEntry::deserialize(entry, data);
@@ -576,14 +700,28 @@ rocksdb::Status RaftJournal::fetch(LogIndex index, RaftEntry &entry) {
 }
 
 rocksdb::Status RaftJournal::fetch(LogIndex index, RaftTerm &term) {
-  RaftEntry entry;
-  rocksdb::Status st = fetch(index, entry);
-  term = entry.term;
+  RaftEntryCache::EntryPtr cached = entryCache.get(index);
+  if(cached) {
+    term = RaftEntry::fetchTerm(*cached);
+    return rocksdb::Status::OK();
+  }
+
+  std::string data;
+  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), entriesHandle, encodeEntryKey(index), &data);
+  if(!st.ok()) return st;
+
+  term = RaftEntry::fetchTerm(data);
   return st;
 }
 
 rocksdb::Status RaftJournal::fetch(LogIndex index, RaftSerializedEntry &data) {
-  return db->Get(rocksdb::ReadOptions(), encodeEntryKey(index), &data);
+  RaftEntryCache::EntryPtr cached = entryCache.get(index);
+  if(cached) {
+    data = *cached;
+    return rocksdb::Status::OK();
+  }
+
+  return db->Get(rocksdb::ReadOptions(), entriesHandle, encodeEntryKey(index), &data);
 }
 
 void RaftJournal::fetch_last(int last, std::vector<RaftEntry> &entries) {
@@ -693,14 +831,17 @@ rocksdb::Status RaftJournal::manualCompaction() {
   // (depends on the size of the DB)
   // This is a recommendation by rocksdb devs as a workaround: Disabling auto
   // compactions will disable write-stalling as well.
-  THROW_ON_ERROR(db->SetOptions( { {"disable_auto_compactions", "true"} } ));
-
   rocksdb::CompactRangeOptions opts;
   opts.bottommost_level_compaction = rocksdb::BottommostLevelCompaction::kForce;
 
-  rocksdb::Status st = db->CompactRange(opts, nullptr, nullptr);
+  rocksdb::Status st;
+  for(rocksdb::ColumnFamilyHandle *handle : {defaultHandle, entriesHandle}) {
+    THROW_ON_ERROR(db->SetOptions(handle, { {"disable_auto_compactions", "true"} } ));
+    st = db->CompactRange(opts, handle, nullptr, nullptr);
+    THROW_ON_ERROR(db->SetOptions(handle, { {"disable_auto_compactions", "false"} } ));
 
-  THROW_ON_ERROR(db->SetOptions( { {"disable_auto_compactions", "false"} } ));
+    if(!st.ok()) break;
+  }
 
   qdb_event("Manual journal compaction has completed with status " << st.ToString());
   return st;
@@ -710,18 +851,23 @@ rocksdb::Status RaftJournal::manualCompaction() {
 // Iterator
 //------------------------------------------------------------------------------
 RaftJournal::Iterator RaftJournal::getIterator(LogIndex startingPoint, bool mustMatchStartingPoint) {
-  rocksdb::ReadOptions readOpts;
-  readOpts.total_order_seek = true;
+  return RaftJournal::Iterator(this, startingPoint, mustMatchStartingPoint);
+}
 
-  std::unique_ptr<rocksdb::Iterator> it;
-  it.reset(db->NewIterator(readOpts));
+RaftJournal::Iterator::Iterator(RaftJournal *jr, LogIndex startingPoint, bool mustMatchStartingPoint)
+: journal(jr), currentIndex(startingPoint) {
 
-  return RaftJournal::Iterator(std::move(it), startingPoint, mustMatchStartingPoint);
+  cached = journal->entryCache.get(currentIndex);
+  if(!cached) {
+    seek(mustMatchStartingPoint);
+  }
 }
 
-RaftJournal::Iterator::Iterator(std::unique_ptr<rocksdb::Iterator> it, LogIndex startingPoint, bool mustMatchStartingPoint) {
-  iter = std::move(it);
-  currentIndex = startingPoint;
+void RaftJournal::Iterator::seek(bool mustMatchStartingPoint) {
+  rocksdb::ReadOptions readOpts;
+  readOpts.total_order_seek = true;
+
+  iter.reset(journal->db->NewIterator(readOpts, journal->entriesHandle));
   iter->Seek(encodeEntryKey(currentIndex));
 
   if(!this->valid()) {
@@ -758,12 +904,26 @@ void RaftJournal::Iterator::validate() {
 }
 
 bool RaftJournal::Iterator::valid() {
-  return iter && iter->Valid();
+  return cached || (iter && iter->Valid());
 }
 
 void RaftJournal::Iterator::next() {
   qdb_assert(this->valid());
 
+  cached = journal->entryCache.get(currentIndex+1);
+  if(cached) {
+    currentIndex++;
+    iter.reset();
+    return;
+  }
+
+  if(!iter) {
+    // Fell off the cache, continue from rocksdb
+    currentIndex++;
+    seek(true);
+    return;
+  }
+
   iter->Next();
   if(iter->Valid()) {
     currentIndex++;
@@ -773,6 +933,12 @@ void RaftJournal::Iterator::next() {
 
 void RaftJournal::Iterator::current(RaftSerializedEntry &entry) {
   qdb_assert(this->valid());
+
+  if(cached) {
+    entry = *cached;
+    return;
+  }
+
   entry = iter->value().ToString();
 }
 
@@ -30,6 +30,7 @@
 #include <condition_variable>
 #include "RaftCommon.hh"
 #include "RaftMembers.hh"
+#include "RaftEntryCache.hh"
 #include "utils/FsyncThread.hh"
 #include "storage/WriteStallWarner.hh"
 
@@ -96,16 +97,23 @@ public:
   bool appendLeadershipMarker(LogIndex index, RaftTerm term, const RaftServer &leader);
   bool simulateDataLoss(size_t numberOfEntries);
 
+  //----------------------------------------------------------------------------
+  // Iterates over journal entries, serving them from the recent-entries cache
+  // whenever possible, and falling back to rocksdb otherwise.
+  //----------------------------------------------------------------------------
   class Iterator {
   public:
-    Iterator(std::unique_ptr<rocksdb::Iterator> iter, LogIndex startingPoint, bool mustMatchStartingPoint);
+    Iterator(RaftJournal *journal, LogIndex startingPoint, bool mustMatchStartingPoint);
     bool valid();
     void next();
     void current(RaftSerializedEntry &entry);
     LogIndex getCurrentIndex() const;
   private:
+    void seek(bool mustMatchStartingPoint);
     void validate();
+    RaftJournal *journal;
     LogIndex currentIndex;
+    RaftEntryCache::EntryPtr cached;
     std::unique_ptr<rocksdb::Iterator> iter;
   };
 
@@ -113,8 +121,12 @@ public:
   rocksdb::Status scanContents(LogIndex startingPoint, size_t count, std::string_view match, std::vector<RaftEntryWithIndex> &out, LogIndex &nextCursor);
   rocksdb::Status manualCompaction();
 
+  int64_t getCacheHits() const { return entryCache.getHits(); }
+  int64_t getCacheMisses() const { return entryCache.getMisses(); }
+
 private:
   void openDB(const std::string &path);
+  void migrateEntries();
   void rawSetCommitIndex(LogIndex index);
   void ensureFsyncPolicyInitialized();
   bool shouldSync(bool important);
@@ -124,6 +136,14 @@ private:
   rocksdb::DB* db = nullptr;
   std::string dbPath;
 
+  //----------------------------------------------------------------------------
+  // Metadata (current term, log size, ...) is kept in the default column
+  // family, the entries themselves in a column family of their own, tuned
+  // for sequential appends and trimming from the front.
+  //----------------------------------------------------------------------------
+  rocksdb::ColumnFamilyHandle* defaultHandle = nullptr;
+  rocksdb::ColumnFamilyHandle* entriesHandle = nullptr;
+
   std::unique_ptr<FsyncThread> fsyncThread;
 
   using IteratorPtr = std::unique_ptr<rocksdb::Iterator>;
@@ -167,6 +187,13 @@ private:
 
   RaftTerm termOfLastEntry;
 
+  //----------------------------------------------------------------------------
+  // Most recently appended entries, kept in memory to serve replication:
+  // up to 16k entries or 64 MB. Entries above 1 MB are not worth keeping
+  // around, they're written out without an intermediate serialized copy.
+  //----------------------------------------------------------------------------
+  RaftEntryCache entryCache {16 * 1024, 64 * 1024 * 1024, 1024 * 1024};
+
   //----------------------------------------------------------------------------
   // Helper functions
   //----------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+// ----------------------------------------------------------------------
+// File: RaftReadIndex.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "raft/RaftReadIndex.hh"
+#include "raft/RaftTalker.hh"
+#include "utils/Macros.hh"
+
+using namespace quarkdb;
+
+RaftReadIndex::RaftReadIndex(const RaftContactDetails &cd)
+: contactDetails(cd) {}
+
+RaftReadIndex::~RaftReadIndex() {}
+
+int64_t RaftReadIndex::getRounds() {
+  std::scoped_lock lock(mtx);
+  return completedRound;
+}
+
+bool RaftReadIndex::performRound(const RaftServer &leader, std::chrono::milliseconds timeout, LogIndex &readIndex) {
+  if(!talker || talker->getServer() != leader) {
+    talker.reset(new RaftTalker(leader, contactDetails, "internal-read-index"));
+  }
+
+  std::future<redisReplyPtr> fut = talker->readIndex();
+  if(fut.wait_for(timeout) != std::future_status::ready) {
+    return false;
+  }
+
+  redisReplyPtr reply = fut.get();
+  if(!reply || reply->type != REDIS_REPLY_INTEGER) {
+    return false;
+  }
+
+  readIndex = reply->integer;
+  return true;
+}
+
+bool RaftReadIndex::fetch(const RaftServer &leader, std::chrono::milliseconds timeout, LogIndex &readIndex) {
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+  std::unique_lock<std::mutex> lock(mtx);
+
+  // The earliest round whose result is usable by us - one that has not
+  // started yet.
+  int64_t myRound = startedRound + 1;
+
+  while(completedRound < myRound) {
+    if(!inFlight) {
+      // Nobody is talking to the leader right now, start a new round on
+      // behalf of everyone waiting.
+      inFlight = true;
+      int64_t round = ++startedRound;
+      lock.unlock();
+
+      LogIndex index = -1;
+      bool outcome = performRound(leader, timeout, index);
+
+      lock.lock();
+      inFlight = false;
+      completedRound = round;
+      lastOutcome = outcome;
+      lastReadIndex = index;
+      cv.notify_all();
+      continue;
+    }
+
+    if(cv.wait_until(lock, deadline) == std::cv_status::timeout && completedRound < myRound) {
+      return false;
+    }
+  }
+
+  readIndex = lastReadIndex;
+  return lastOutcome;
+}
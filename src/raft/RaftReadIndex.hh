@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------
+// File: RaftReadIndex.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_RAFT_READ_INDEX_H
+#define QUARKDB_RAFT_READ_INDEX_H
+
+#include "raft/RaftCommon.hh"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace quarkdb {
+
+class RaftTalker; class RaftContactDetails;
+
+//------------------------------------------------------------------------------
+// Follower side of the ReadIndex protocol: Ask the leader for its current
+// commit index, so that we can serve a read locally once our state machine
+// has caught up to it.
+//
+// To stay linearizable, the commit index must be retrieved in a round-trip
+// which started *after* the read arrived. Concurrent readers share rounds:
+// Anyone arriving while a round is in flight waits for the next one, which
+// is then started on behalf of all of them.
+//------------------------------------------------------------------------------
+class RaftReadIndex {
+public:
+  RaftReadIndex(const RaftContactDetails &contactDetails);
+  ~RaftReadIndex();
+
+  //----------------------------------------------------------------------------
+  // Retrieve the read index from the given leader. Returns false if the leader
+  // could not be reached, or did not respond in time.
+  //----------------------------------------------------------------------------
+  bool fetch(const RaftServer &leader, std::chrono::milliseconds timeout, LogIndex &readIndex);
+
+  //----------------------------------------------------------------------------
+  // Number of round-trips made towards a leader - useful to observe batching.
+  //----------------------------------------------------------------------------
+  int64_t getRounds();
+
+private:
+  bool performRound(const RaftServer &leader, std::chrono::milliseconds timeout, LogIndex &readIndex);
+
+  const RaftContactDetails &contactDetails;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  int64_t startedRound = 0;
+  int64_t completedRound = 0;
+  bool inFlight = false;
+
+  bool lastOutcome = false;
+  LogIndex lastReadIndex = -1;
+
+  // Only touched by whoever is performing the round in flight.
+  std::unique_ptr<RaftTalker> talker;
+};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------
+// File: RaftReplicationWindow.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "raft/RaftReplicationWindow.hh"
+#include <algorithm>
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// An acknowledgement is considered a congestion signal if its round-trip time
+// exceeds kRttTolerance times the minimum, plus some slack to absorb jitter
+// on very fast links.
+//------------------------------------------------------------------------------
+static constexpr int64_t kRttTolerance = 4;
+static constexpr std::chrono::milliseconds kRttSlack(2);
+
+//------------------------------------------------------------------------------
+// Re-measure the minimum round-trip time every so often, in case the network
+// path has changed.
+//------------------------------------------------------------------------------
+static constexpr std::chrono::seconds kMinRttLifetime(10);
+
+RaftReplicationWindow::RaftReplicationWindow(int64_t maxBytes)
+: maxInflightBytes(std::max<int64_t>(maxBytes, 1)) {}
+
+void RaftReplicationWindow::setMaxInflightBytes(int64_t bytes) {
+  maxInflightBytes = std::max<int64_t>(bytes, 1);
+}
+
+int64_t RaftReplicationWindow::getPayloadLimit() const {
+  return std::max<int64_t>(0, std::min(window - inflightEntries, kMaxPayloadEntries));
+}
+
+int64_t RaftReplicationWindow::getPayloadByteLimit() const {
+  return std::max<int64_t>(0, maxInflightBytes - inflightBytes);
+}
+
+bool RaftReplicationWindow::isFull() const {
+  return inflightEntries >= window || inflightBytes >= maxInflightBytes;
+}
+
+void RaftReplicationWindow::onSend(int64_t entries, int64_t bytes) {
+  inflightEntries += entries;
+  inflightBytes += bytes;
+}
+
+void RaftReplicationWindow::onAck(int64_t entries, int64_t bytes, Clock::time_point sent, Clock::time_point now) {
+  inflightEntries = std::max<int64_t>(0, inflightEntries - entries);
+  inflightBytes = std::max<int64_t>(0, inflightBytes - bytes);
+
+  Clock::duration rtt = now - sent;
+
+  if(minRtt == Clock::duration::zero() || rtt < minRtt || now - minRttStamp > kMinRttLifetime) {
+    minRtt = rtt;
+    minRttStamp = now;
+  }
+
+  if(smoothedRtt == Clock::duration::zero()) {
+    smoothedRtt = rtt;
+  }
+  else {
+    smoothedRtt = (smoothedRtt * 7 + rtt) / 8;
+  }
+
+  if(rtt > minRtt * kRttTolerance + kRttSlack) {
+    if(sent >= lastDecrease) {
+      decrease(now);
+    }
+    return;
+  }
+
+  if(window < slowStartThreshold) {
+    // Slow start, double the window every round-trip
+    window += entries;
+  }
+  else {
+    // Congestion avoidance, grow by kAdditiveIncrease every window's worth of
+    // acknowledged entries
+    increaseCredit += entries * kAdditiveIncrease;
+    window += increaseCredit / window;
+    increaseCredit %= window;
+  }
+
+  window = std::min(window, kMaxWindow);
+}
+
+void RaftReplicationWindow::onHiccup() {
+  inflightEntries = 0;
+  inflightBytes = 0;
+  decrease(Clock::now());
+}
+
+void RaftReplicationWindow::decrease(Clock::time_point now) {
+  window = std::max(window / 2, kMinWindow);
+  slowStartThreshold = std::max(window, kMinWindow * 2);
+  increaseCredit = 0;
+  lastDecrease = now;
+}
@@ -0,0 +1,124 @@
+// ----------------------------------------------------------------------
+// File: RaftReplicationWindow.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_RAFT_REPLICATION_WINDOW_H
+#define QUARKDB_RAFT_REPLICATION_WINDOW_H
+
+#include <chrono>
+#include <stdint.h>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Congestion window for replicating entries towards a single follower.
+//
+// Bounds the number of entries and bytes which have been sent, but not yet
+// acknowledged. The entry window grows additively as acknowledgements arrive
+// (exponentially at first, until it reaches the slow-start threshold), and is
+// halved whenever we see signs of congestion: A hiccup during replication, or
+// an acknowledgement whose round-trip time is way above the lowest we've
+// measured so far.
+//
+// The byte window is a fixed cap, configurable through RaftConfig.
+//
+// Not thread-safe, the caller must provide synchronization.
+//------------------------------------------------------------------------------
+class RaftReplicationWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int64_t kMinWindow = 1;
+  static constexpr int64_t kMaxWindow = 256 * 1024;
+  static constexpr int64_t kMaxPayloadEntries = 1024;
+  static constexpr int64_t kAdditiveIncrease = 64;
+
+  RaftReplicationWindow(int64_t maxInflightBytes);
+
+  //----------------------------------------------------------------------------
+  // Change the maximum number of bytes in flight.
+  //----------------------------------------------------------------------------
+  void setMaxInflightBytes(int64_t bytes);
+
+  //----------------------------------------------------------------------------
+  // Maximum number of entries and bytes that the next payload may contain.
+  // A payload always carries at least one entry, as long as the window isn't
+  // full.
+  //----------------------------------------------------------------------------
+  int64_t getPayloadLimit() const;
+  int64_t getPayloadByteLimit() const;
+
+  //----------------------------------------------------------------------------
+  // Is the window full? If so, no more payloads should be sent until
+  // acknowledgements arrive.
+  //----------------------------------------------------------------------------
+  bool isFull() const;
+
+  //----------------------------------------------------------------------------
+  // A payload was just sent.
+  //----------------------------------------------------------------------------
+  void onSend(int64_t entries, int64_t bytes);
+
+  //----------------------------------------------------------------------------
+  // A payload sent at the given timepoint was acknowledged successfully.
+  //----------------------------------------------------------------------------
+  void onAck(int64_t entries, int64_t bytes, Clock::time_point sent, Clock::time_point now);
+
+  //----------------------------------------------------------------------------
+  // Replication hiccup: Halve the window, and forget about anything still in
+  // flight, since the caller will re-send it.
+  //----------------------------------------------------------------------------
+  void onHiccup();
+
+  int64_t getWindow() const { return window; }
+  int64_t getInflightEntries() const { return inflightEntries; }
+  int64_t getInflightBytes() const { return inflightBytes; }
+  int64_t getMaxInflightBytes() const { return maxInflightBytes; }
+  Clock::duration getMinRtt() const { return minRtt; }
+  Clock::duration getSmoothedRtt() const { return smoothedRtt; }
+
+private:
+  void decrease(Clock::time_point now);
+
+  int64_t maxInflightBytes;
+
+  int64_t window = kMinWindow;
+  int64_t slowStartThreshold = kMaxWindow;
+  int64_t inflightEntries = 0;
+  int64_t inflightBytes = 0;
+
+  // Remainder of additive increase, so that acknowledgements smaller than
+  // the window are not lost to integer division.
+  int64_t increaseCredit = 0;
+
+  Clock::duration minRtt = Clock::duration::zero();
+  Clock::time_point minRttStamp;
+  Clock::duration smoothedRtt = Clock::duration::zero();
+
+  // Acknowledgements for payloads sent before the last decrease must not
+  // cause another one - they were already in flight when we reacted.
+  Clock::time_point lastDecrease;
+};
+
+}
+
+#endif
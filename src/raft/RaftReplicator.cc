@@ -55,6 +55,7 @@ RaftReplicaTracker::RaftReplicaTracker(const RaftServer &target_, const RaftStat
   state(state_), lease(lease_), commitTracker(ct), trimmer(trim), shardDirectory(sharddir), config(conf), contactDetails(cd),
   matchIndex(commitTracker.getHandler(target)),
   lastContact(lease.getHandler(target)),
+  window(config.getReplicationMaxInflightBytes()),
   trimmingBlock(trimmer, 0) {
   if(target == state.getMyself()) {
     qdb_throw("attempted to run replication on myself");
@@ -90,29 +91,35 @@ RaftReplicaTracker::~RaftReplicaTracker() {
   }
 }
 
-bool RaftReplicaTracker::buildPayload(LogIndex nextIndex, int64_t payloadLimit,
-  std::vector<std::string> &entries, RaftTerm &lastEntryTerm) {
+bool RaftReplicaTracker::buildPayload(LogIndex nextIndex, int64_t payloadLimit, int64_t byteLimit,
+  std::vector<std::string> &entries, int64_t &payloadBytes, RaftTerm &lastEntryTerm) {
 
   int64_t payloadSize = std::min(payloadLimit, journal.getLogSize() - nextIndex);
-  entries.resize(payloadSize);
+  entries.clear();
+  entries.reserve(std::max<int64_t>(payloadSize, 0));
+  payloadBytes = 0;
 
   RaftJournal::Iterator iterator = journal.getIterator(nextIndex, true);
   RaftTerm entryTerm = -1;
 
-  for(int64_t i = nextIndex; i < nextIndex+payloadSize; i++) {
+  // Stop once byteLimit is reached, but always send at least one entry, even
+  // if it's larger than the limit on its own.
+  for(int64_t i = nextIndex; i < nextIndex+payloadSize && payloadBytes < byteLimit; i++) {
     if(!iterator.valid()) {
       qdb_critical("could not fetch entry with index " << i << " .. aborting building payload");
       return false;
     }
 
-    iterator.current(entries[i-nextIndex]);
+    entries.emplace_back();
+    iterator.current(entries.back());
 
-    entryTerm = RaftEntry::fetchTerm(entries[i-nextIndex]);
+    entryTerm = RaftEntry::fetchTerm(entries.back());
     if(snapshot->term < entryTerm) {
       qdb_warn("Found journal entry with higher term than my snapshot, " << snapshot->term << " vs " << entryTerm);
       return false;
     }
 
+    payloadBytes += entries.back().size();
     iterator.next();
   }
 
@@ -187,7 +194,7 @@ void RaftReplicaTracker::triggerResilvering() {
   }
 
   // Start the resilverer
-  resilverer.reset(new RaftResilverer(shardDirectory, target, contactDetails, trimmer));
+  resilverer.reset(new RaftResilverer(shardDirectory, target, contactDetails, trimmer, config.getResilveringBandwidth()));
 }
 
 class ConditionVariableNotifier {
@@ -274,6 +281,7 @@ void RaftReplicaTracker::monitorAckReception(ThreadAssistant &assistant) {
     }
 
     // All clear, acknowledgement is OK, carry on.
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
     updateStatus(true, response.logSize);
     lastContact.heartbeat(item.sent);
 
@@ -286,15 +294,19 @@ void RaftReplicaTracker::monitorAckReception(ThreadAssistant &assistant) {
     // Progress trimming block.
     trimmingBlock.enforce(response.logSize-2);
 
+    // Release the acknowledged payload from the window, and adjust the window
+    // based on the observed round-trip time.
     lock.lock();
+    window.onAck(item.payloadSize, item.payloadBytes, item.sent, now);
+    inFlightPoppedCV.notify_one();
   }
 
   streamingUpdates = false;
 }
 
-bool RaftReplicaTracker::sendPayload(RaftTalker &talker, LogIndex nextIndex, int64_t payloadLimit,
+bool RaftReplicaTracker::sendPayload(RaftTalker &talker, LogIndex nextIndex, int64_t payloadLimit, int64_t byteLimit,
   std::future<redisReplyPtr> &reply, std::chrono::steady_clock::time_point &contact, int64_t &payloadSize,
-  RaftTerm &lastEntryTerm) {
+  int64_t &payloadBytes, RaftTerm &lastEntryTerm) {
   RaftTerm prevTerm;
 
   if(!journal.fetch(nextIndex-1, prevTerm).ok()) {
@@ -323,7 +335,7 @@ bool RaftReplicaTracker::sendPayload(RaftTalker &talker, LogIndex nextIndex, int
   LogIndex commitIndexForTarget = journal.getCommitIndex();
 
   std::vector<RaftSerializedEntry> entries;
-  if(!buildPayload(nextIndex, payloadLimit, entries, lastEntryTerm)) {
+  if(!buildPayload(nextIndex, payloadLimit, byteLimit, entries, payloadBytes, lastEntryTerm)) {
     state.observed(snapshot->term+1, {});
     return false;
   }
@@ -337,7 +349,7 @@ bool RaftReplicaTracker::sendPayload(RaftTalker &talker, LogIndex nextIndex, int
     nextIndex-1,
     prevTerm,
     commitIndexForTarget,
-    entries
+    std::move(entries)
   );
 
   return true;
@@ -354,35 +366,57 @@ LogIndex RaftReplicaTracker::streamUpdates(RaftTalker &talker, LogIndex firstNex
   AssistedThread ackmonitor(&RaftReplicaTracker::monitorAckReception, this);
   ackmonitor.setName(SSTR("streaming-replication-ack-monitor-for-" << SSTR(target.toString())));
 
-  const int64_t payloadLimit = 512;
+  // The amount of data in flight is bounded by the replication window: Wait
+  // until acknowledgements free up enough room before sending each payload.
   LogIndex nextIndex = firstNextIndex;
+  std::chrono::steady_clock::time_point lastConfigRefresh;
 
   while(shutdown == 0 && streamingUpdates && state.isSnapshotCurrent(snapshot.get())) {
     std::chrono::steady_clock::time_point contact;
     std::future<redisReplyPtr> fut;
     int64_t payloadSize;
+    int64_t payloadBytes;
     RaftTerm lastEntryTerm;
 
-    if(!sendPayload(talker, nextIndex, payloadLimit, fut, contact, payloadSize, lastEntryTerm)) {
+    if(std::chrono::steady_clock::now() - lastConfigRefresh > contactDetails.getRaftTimeouts().getHeartbeatInterval()) {
+      int64_t maxInflightBytes = config.getReplicationMaxInflightBytes();
+      lastConfigRefresh = std::chrono::steady_clock::now();
+
+      std::scoped_lock lock(inFlightMtx);
+      window.setMaxInflightBytes(maxInflightBytes);
+    }
+
+    std::unique_lock<std::mutex> lock(inFlightMtx);
+    while(window.isFull() && shutdown == 0 && streamingUpdates && state.isSnapshotCurrent(snapshot.get())) {
+      inFlightPoppedCV.wait_for(lock, contactDetails.getRaftTimeouts().getHeartbeatInterval());
+    }
+
+    bool windowFull = window.isFull();
+    int64_t payloadLimit = window.getPayloadLimit();
+    int64_t byteLimit = window.getPayloadByteLimit();
+    lock.unlock();
+
+    if(windowFull || shutdown != 0 || !streamingUpdates || !state.isSnapshotCurrent(snapshot.get())) {
+      break;
+    }
+
+    if(!sendPayload(talker, nextIndex, payloadLimit, byteLimit, fut, contact, payloadSize, payloadBytes, lastEntryTerm)) {
       qdb_warn("Unexpected error when sending payload to target " << target.toString() << ", halting replication");
       break;
     }
 
-    std::unique_lock<std::mutex> lock(inFlightMtx);
+    lock.lock();
+    window.onSend(payloadSize, payloadBytes);
     inFlight.emplace(
       std::move(fut),
       contact,
       nextIndex,
       payloadSize,
+      payloadBytes,
       lastEntryTerm
     );
 
     inFlightCV.notify_one();
-
-    while(inFlight.size() >= 512 && shutdown == 0 && streamingUpdates && state.isSnapshotCurrent(snapshot.get())) {
-      inFlightPoppedCV.wait_for(lock, contactDetails.getRaftTimeouts().getHeartbeatInterval());
-    }
-
     lock.unlock();
 
     // Assume a positive response from the target, and keep pushing
@@ -476,7 +510,11 @@ void RaftReplicaTracker::main() {
   RaftLastContact &lastContact = lease.getHandler(target);
 
   OnlineTracker onlineTracker;
-  int64_t payloadLimit = 1;
+
+  // Number of consecutive, successful acknowledgements in conservative mode.
+  // We only switch to streaming once the target has proven stable.
+  const int64_t kStableRounds = 3;
+  int64_t consecutiveAcks = 0;
 
   bool warnStreamingHiccup = false;
   bool needResilvering = false;
@@ -487,8 +525,10 @@ void RaftReplicaTracker::main() {
       warnStreamingHiccup = false;
     }
 
-    // Target looks pretty stable, start continuous stream
-    if(onlineTracker.isOnline() && payloadLimit >= 8) {
+    // Target looks pretty stable, start continuous stream. The window only
+    // sizes the payloads - an idle leader never grows it, and must still
+    // switch to streaming.
+    if(onlineTracker.isOnline() && consecutiveAcks >= kStableRounds) {
       qdb_info("Target " << target.toString() << " appears stable, initiating streaming replication.");
       resilverer.reset();
       nextIndex = streamUpdates(talker, nextIndex);
@@ -496,8 +536,10 @@ void RaftReplicaTracker::main() {
       warnStreamingHiccup = true;
       onlineTracker.seenOnline();
       // Something happened when streaming updates, switch back to conservative
-      // mode and wait for each response
-      payloadLimit = 1;
+      // mode and wait for each response. Halve the window, but don't collapse
+      // it entirely - a single slow ack shouldn't reduce us to 1-entry payloads.
+      window.onHiccup();
+      consecutiveAcks = 0;
       continue;
     }
 
@@ -507,9 +549,10 @@ void RaftReplicaTracker::main() {
     std::chrono::steady_clock::time_point contact;
     std::future<redisReplyPtr> fut;
     int64_t payloadSize;
+    int64_t payloadBytes;
     RaftTerm lastEntryTerm;
 
-    if(!sendPayload(talker, nextIndex, payloadLimit, fut, contact, payloadSize, lastEntryTerm)) {
+    if(!sendPayload(talker, nextIndex, window.getPayloadLimit(), window.getPayloadByteLimit(), fut, contact, payloadSize, payloadBytes, lastEntryTerm)) {
       qdb_warn("Unexpected error when sending payload to target " << target.toString() << ", halting replication");
       break;
     }
@@ -517,8 +560,10 @@ void RaftReplicaTracker::main() {
     RaftAppendEntriesResponse resp;
     // Check: Is the target even online?
     if(retrieve_response(fut, resp, std::chrono::milliseconds(500)) != AppendEntriesReception::kOk) {
+      consecutiveAcks = 0;
+
       if(onlineTracker.isOnline()) {
-        payloadLimit = 1;
+        window.onHiccup();
         qdb_event("Replication target " << target.toString() << " went offline.");
         onlineTracker.seenOffline();
       }
@@ -543,7 +588,8 @@ void RaftReplicaTracker::main() {
       if(!needResilvering) {
         qdb_event("Unable to perform replication on " << target.toString() << ", it's too far behind (its logsize: " << resp.logSize << ") and my journal starts at " << journal.getLogStart() << ".");
         needResilvering = true;
-        payloadLimit = 1;
+        window.onHiccup();
+        consecutiveAcks = 0;
       }
 
       if(config.getResilveringEnabled()) {
@@ -583,9 +629,8 @@ void RaftReplicaTracker::main() {
     }
 
     nextIndex = resp.logSize;
-    if(payloadLimit < 1024) {
-      payloadLimit *= 2;
-    }
+    window.onAck(payloadSize, payloadBytes, contact, std::chrono::steady_clock::now());
+    consecutiveAcks++;
 
 nextRound:
     if(onlineTracker.hasBeenOfflineForLong()) {
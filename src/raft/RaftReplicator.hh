@@ -30,6 +30,7 @@
 #include "raft/RaftTalker.hh"
 #include "raft/RaftState.hh"
 #include "raft/RaftTrimmer.hh"
+#include "raft/RaftReplicationWindow.hh"
 #include "utils/AssistedThread.hh"
 #include "utils/Synchronized.hh"
 
@@ -55,15 +56,17 @@ public:
 
   ReplicaStatus getStatus();
   bool isRunning() { return running; }
+  bool isStreaming() { return streamingUpdates; }
 private:
   struct PendingResponse {
-    PendingResponse(std::future<redisReplyPtr> &&f, std::chrono::steady_clock::time_point s, LogIndex pushed, int64_t payload, RaftTerm let)
-    : fut(std::move(f)), sent(s), pushedFrom(pushed), payloadSize(payload), lastEntryTerm(let) {}
+    PendingResponse(std::future<redisReplyPtr> &&f, std::chrono::steady_clock::time_point s, LogIndex pushed, int64_t payload, int64_t bytes, RaftTerm let)
+    : fut(std::move(f)), sent(s), pushedFrom(pushed), payloadSize(payload), payloadBytes(bytes), lastEntryTerm(let) {}
 
     std::future<redisReplyPtr> fut;
     std::chrono::steady_clock::time_point sent;
     LogIndex pushedFrom;
     int64_t payloadSize;
+    int64_t payloadBytes;
     RaftTerm lastEntryTerm;
   };
 
@@ -81,12 +84,12 @@ private:
   LogIndex streamUpdates(RaftTalker &talker, LogIndex nextIndex);
 
   void triggerResilvering();
-  bool buildPayload(LogIndex nextIndex, int64_t payloadLimit, std::vector<RaftSerializedEntry> &entries,
-    RaftTerm &lastEntryTerm);
+  bool buildPayload(LogIndex nextIndex, int64_t payloadLimit, int64_t byteLimit,
+    std::vector<RaftSerializedEntry> &entries, int64_t &payloadBytes, RaftTerm &lastEntryTerm);
 
-  bool sendPayload(RaftTalker &talker, LogIndex nextIndex, int64_t payloadLimit,
+  bool sendPayload(RaftTalker &talker, LogIndex nextIndex, int64_t payloadLimit, int64_t byteLimit,
     std::future<redisReplyPtr> &reply, std::chrono::steady_clock::time_point &contact, int64_t &payloadSize,
-    RaftTerm &lastEntryTerm);
+    int64_t &payloadBytes, RaftTerm &lastEntryTerm);
 
   RaftServer target;
   RaftStateSnapshotPtr snapshot;
@@ -112,6 +115,10 @@ private:
   RaftMatchIndexTracker &matchIndex;
   RaftLastContact &lastContact;
 
+  // Bounds how much we keep in flight - protected by inFlightMtx while
+  // streaming, used only by the main thread otherwise.
+  RaftReplicationWindow window;
+
   std::atomic<bool> running {false};
   std::atomic<bool> shutdown {false};
 
@@ -29,8 +29,11 @@
 #include "utils/Uuid.hh"
 #include "utils/DirectoryIterator.hh"
 #include "utils/FileUtils.hh"
+#include "utils/ParseUtils.hh"
+#include "utils/StringUtils.hh"
 #include <dirent.h>
 #include <fstream>
+#include <algorithm>
 
 using namespace quarkdb;
 
@@ -73,10 +76,51 @@ private:
   std::string error;
 };
 
-RaftResilverer::RaftResilverer(ShardDirectory &dir, const RaftServer &trg, const RaftContactDetails &contactDetails, RaftTrimmer &trimmer)
+class IntegerResponseVerifier {
+public:
+  IntegerResponseVerifier(std::future<redisReplyPtr> &&fut, size_t timeout = 15) {
+    std::future_status status = fut.wait_for(std::chrono::seconds(timeout));
+    if(status != std::future_status::ready) {
+      error = SSTR("Timeout after " << timeout << " seconds");
+      return;
+    }
+
+    redisReplyPtr rep = fut.get();
+    if(rep == nullptr) {
+      error = SSTR("Received nullptr response (should never happen)");
+      return;
+    }
+
+    if(rep->type != REDIS_REPLY_INTEGER) {
+      error = SSTR("Unexpected response type: " << rep->type);
+      return;
+    }
+
+    value = rep->integer;
+  }
+
+  bool ok() {
+    return error.empty();
+  }
+
+  std::string err() {
+    return error;
+  }
+
+  int64_t get() {
+    return value;
+  }
+
+private:
+  std::string error;
+  int64_t value = 0;
+};
+
+RaftResilverer::RaftResilverer(ShardDirectory &dir, const RaftServer &trg, const RaftContactDetails &contactDetails, RaftTrimmer &trimmer, int64_t bandwidth)
 : shardDirectory(dir), target(trg),
   trimmingBlock(new RaftTrimmingBlock(trimmer, 0)),
-  talker(target, contactDetails, "internal-resilverer") {
+  talker(target, contactDetails, "internal-resilverer"),
+  rateLimiter(bandwidth) {
 
   resilveringID = generateUuid();
   setStatus(ResilveringState::INPROGRESS, "");
@@ -114,23 +158,126 @@ void RaftResilverer::cancel(const std::string &reason) {
   talker.resilveringCancel(resilveringID, reason);
 }
 
-bool RaftResilverer::copyFile(const std::string &path, const std::string &prefix, std::string &err) {
-  std::ifstream t(path);
-  std::stringstream buffer;
-  buffer << t.rdbuf();
-
-  OkResponseVerifier verifier(talker.resilveringCopy(resilveringID, prefix, buffer.str()));
+bool RaftResilverer::queryFileSize(const std::string &prefix, int64_t &size, std::string &err) {
+  IntegerResponseVerifier verifier(talker.resilveringFileSize(resilveringID, prefix));
   if(!verifier.ok()) {
-    err = SSTR("Error when coping " << path << ": " << verifier.err());
+    err = verifier.err();
+    return false;
   }
 
+  size = verifier.get();
+  return true;
+}
+
+bool RaftResilverer::copyFile(const FileToCopy &file, ThreadAssistant &assistant, std::string &err) {
+  std::ifstream stream(file.path, std::ios::binary | std::ios::ate);
+  if(!stream.is_open()) {
+    err = SSTR("Unable to open " << file.path << " for reading");
+    return false;
+  }
+
+  const int64_t fileSize = stream.tellg();
+  std::string buffer(std::min<int64_t>(fileSize, kChunkSize), '\0');
+
+  int64_t offset = 0;
+  size_t retries = 0;
+
+  // Even an empty file needs one (empty) chunk, so that it gets created
+  do {
+    if(assistant.terminationRequested() || copyFailed) {
+      err = SSTR("Interrupted while copying " << file.path);
+      return false;
+    }
+
+    size_t length = std::min<int64_t>(fileSize - offset, kChunkSize);
+
+    stream.seekg(offset);
+    stream.read(buffer.data(), length);
+    if(!stream) {
+      err = SSTR("Error when reading " << file.path << " at offset " << offset);
+      return false;
+    }
+
+    std::string_view chunk(buffer.data(), length);
+    rateLimiter.acquire(length, assistant);
+
+    OkResponseVerifier verifier(talker.resilveringCopyChunk(resilveringID, file.prefix, offset,
+      ShardDirectory::resilveringChecksum(chunk), chunk), 60);
+
+    if(verifier.ok()) {
+      offset += length;
+      retries = 0;
+      continue;
+    }
+
+    if(++retries > kMaxRetries) {
+      err = SSTR("Error when copying " << file.path << " at offset " << offset << ", giving up after " << kMaxRetries << " retries: " << verifier.err());
+      return false;
+    }
+
+    qdb_warn("Resilvering: Error when copying " << file.path << " at offset " << offset << ", retrying: " << verifier.err());
+    assistant.wait_for(std::chrono::seconds(retries));
+
+    // Resume from however much the target has - if we can't tell, simply
+    // resend the same chunk, the target discards anything past its offset.
+    int64_t remoteSize;
+    std::string queryErr;
+
+    if(queryFileSize(file.prefix, remoteSize, queryErr) && remoteSize <= fileSize) {
+      offset = remoteSize;
+    }
+  } while(offset < fileSize);
+
   mFilesSent++;
-  return verifier.ok();
+  return true;
 }
 
-bool RaftResilverer::copyDirectory(const std::string &target, const std::string &prefix, std::string &err) {
-  qdb_info("Resilvering: Copying directory " << target << " under prefix '" << prefix << "' of remote target");
+void RaftResilverer::copyWorker(ThreadAssistant &assistant) {
+  while(true) {
+    FileToCopy file;
 
+    {
+      std::scoped_lock lock(copyMtx);
+      if(copyFailed || nextFile >= filesToCopy.size()) return;
+      file = filesToCopy[nextFile++];
+    }
+
+    if(file.reuse) {
+      // The target checks our checksum against its own copy. If they differ,
+      // or compaction on the target got rid of it in the meantime, we send
+      // it after all.
+      uint64_t checksum;
+      std::string err;
+
+      if(!ShardDirectory::resilveringFileChecksum(file.path, checksum, err)) {
+        qdb_warn("Resilvering: " << err << ", sending " << file.prefix << " over in full");
+      }
+      else {
+        OkResponseVerifier verifier(talker.resilveringReuse(resilveringID, file.prefix, checksum));
+        if(verifier.ok()) {
+          mFilesReused++;
+          mFilesSent++;
+          continue;
+        }
+
+        qdb_warn("Resilvering: Target could not reuse " << file.prefix << ", sending it over: " << verifier.err());
+      }
+    }
+
+    std::string err;
+    if(!copyFile(file, assistant, err)) {
+      std::scoped_lock lock(copyMtx);
+      if(!copyFailed) {
+        copyError = err;
+        copyFailed = true;
+      }
+
+      return;
+    }
+  }
+}
+
+bool RaftResilverer::collectFiles(const std::string &target, const std::string &prefix, std::vector<FileToCopy> &files, std::string &err) {
   DirectoryIterator dirIterator(target);
 
   struct dirent *entry;
@@ -148,33 +295,85 @@ bool RaftResilverer::copyDirectory(const std::string &target, const std::string
     }
 
     if(entry->d_type == DT_DIR) {
-      if(!copyDirectory(currentPath, currentPrefix, err)) {
+      if(!collectFiles(currentPath, currentPrefix, files, err)) {
         return false;
       }
     }
     else {
-      if(!copyFile(currentPath, currentPrefix, err)) {
+      int64_t size;
+      if(!getFileSize(currentPath, size, err)) {
         return false;
       }
+
+      FileToCopy file { currentPath, currentPrefix, size, false };
+
+      // Same name and size on the target - a candidate for reuse, if the
+      // contents turn out to be the same, too
+      auto it = targetFiles.find(currentPrefix);
+      if(it != targetFiles.end() && it->second.size == size && StringUtils::endsWith(currentPrefix, ".sst")) {
+        file.reuse = true;
+      }
+
+      files.push_back(file);
     }
   }
 
   if(!dirIterator.ok()) {
-    err = SSTR("copyDirectory failed, unable to iterate directory: " << dirIterator.err());
+    err = SSTR("collectFiles failed, unable to iterate directory: " << dirIterator.err());
     return false;
   }
 
   return true;
 }
 
-void RaftResilverer::main(ThreadAssistant &assistant) {
+//------------------------------------------------------------------------------
+// Ask for an incremental resilvering first. Targets which don't support it
+// reject the extra argument, and we fall back to a full one.
+//------------------------------------------------------------------------------
+bool RaftResilverer::start(std::string &err) {
+  std::future<redisReplyPtr> fut = talker.resilveringStart(resilveringID, true);
+
+  if(fut.wait_for(std::chrono::seconds(60)) != std::future_status::ready) {
+    err = "Timeout after 60 seconds";
+    return false;
+  }
+
+  redisReplyPtr rep = fut.get();
+  if(rep != nullptr && rep->type == REDIS_REPLY_ARRAY && rep->elements % 2 == 0) {
+    for(size_t i = 0; i < rep->elements; i += 2) {
+      std::string filename(rep->element[i]->str, rep->element[i]->len);
+      std::string_view size(rep->element[i+1]->str, rep->element[i+1]->len);
+
+      TargetFile file;
+      if(!ParseUtils::parseInt64(size, file.size)) {
+        err = SSTR("Could not parse reusable file reported by target: " << filename);
+        return false;
+      }
+
+      targetFiles[filename] = file;
+    }
+
+    return true;
+  }
+
+  qdb_info("Resilvering: " << target.toString() << " does not support incremental resilvering, sending everything");
+
   OkResponseVerifier verifier(talker.resilveringStart(resilveringID));
   if(!verifier.ok()) {
-    setStatus(ResilveringState::FAILED, SSTR("Could not initiate resilvering: " << verifier.err()));
-    return;
+    err = verifier.err();
+    return false;
   }
 
+  return true;
+}
+
+void RaftResilverer::main(ThreadAssistant &assistant) {
   std::string err;
+  if(!start(err)) {
+    setStatus(ResilveringState::FAILED, SSTR("Could not initiate resilvering: " << err));
+    return;
+  }
+
   std::unique_ptr<ShardSnapshot> shardSnapshot = shardDirectory.takeSnapshot(resilveringID, err);
 
   if(shardSnapshot == nullptr || !err.empty()) {
@@ -182,19 +381,64 @@ void RaftResilverer::main(ThreadAssistant &assistant) {
     return;
   }
 
-  size_t totalFiles = 0;
-  if(!countFilesInDirectoryRecursively(shardSnapshot->getPath(), err, totalFiles)) {
+  std::vector<FileToCopy> files;
+  if(!collectFiles(shardSnapshot->getPath(), "", files, err)) {
     setStatus(ResilveringState::FAILED, err);
+    return;
   }
 
-  mFilesTotal = totalFiles;
+  // Biggest files first, so the smaller ones fill in the gaps towards the end
+  std::sort(files.begin(), files.end(), [](const FileToCopy &a, const FileToCopy &b) {
+    return a.size > b.size;
+  });
 
-  if(!copyDirectory(shardSnapshot->getPath(), "", err)) {
-    setStatus(ResilveringState::FAILED, err);
+  size_t toReuse = 0;
+  int64_t bytesToReuse = 0, bytesTotal = 0;
+
+  for(const FileToCopy &file : files) {
+    bytesTotal += file.size;
+
+    if(file.reuse) {
+      toReuse++;
+      bytesToReuse += file.size;
+    }
+  }
+
+  mFilesTotal = files.size();
+  qdb_info("Resilvering: Copying " << files.size() << " files (" << bytesTotal << " bytes) to " << target.toString() << ", of which " << toReuse << " (" << bytesToReuse << " bytes) the target already has. Bandwidth limit: " << rateLimiter.getLimit() << " bytes per second");
+
+  {
+    std::scoped_lock lock(copyMtx);
+    filesToCopy = std::move(files);
+    nextFile = 0;
+  }
+
+  std::vector<AssistedThread> workers;
+  workers.reserve(kParallelFiles);
+
+  for(size_t i = 0; i < std::min(kParallelFiles, filesToCopy.size()); i++) {
+    workers.emplace_back(&RaftResilverer::copyWorker, this);
+    workers.back().setName(SSTR("resilvering-worker-targetting-" << target.toString()));
+    assistant.propagateTerminationSignal(workers.back());
+  }
+
+  for(size_t i = 0; i < workers.size(); i++) {
+    workers[i].blockUntilThreadJoins();
+  }
+
+  assistant.dropCallbacks();
+
+  if(copyFailed) {
+    setStatus(ResilveringState::FAILED, copyError);
+    return;
+  }
+
+  if(assistant.terminationRequested()) {
+    setStatus(ResilveringState::FAILED, "Interrupted");
     return;
   }
 
-  verifier = OkResponseVerifier(talker.resilveringFinish(resilveringID), 60);
+  OkResponseVerifier verifier(talker.resilveringFinish(resilveringID), 60);
   if(!verifier.ok()) {
     setStatus(ResilveringState::FAILED, SSTR("Error when finishing resilvering: " << verifier.err()));
     return;
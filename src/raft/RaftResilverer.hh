@@ -29,6 +29,8 @@
 #include "Common.hh"
 #include "raft/RaftTalker.hh"
 #include "utils/Synchronized.hh"
+#include "utils/RateLimiter.hh"
+#include <map>
 
 namespace quarkdb {
 
@@ -49,9 +51,21 @@ struct ResilveringStatus {
 class ShardDirectory; class RaftTrimmer;
 class RaftTrimmingBlock; class RaftContactDetails;
 
+//------------------------------------------------------------------------------
+// Streams a snapshot of our shard over to the given target, replacing its
+// entire contents.
+//
+// Files are sent in checksummed chunks, several files at a time, never
+// exceeding the given bandwidth (bytes per second, zero for unlimited). A
+// chunk which fails to go through is retried a few times, resuming from
+// however much of the file the target reports having received.
+//
+// SST files the target already has, identical to ours, are not sent at all -
+// the target reuses its own copy.
+//------------------------------------------------------------------------------
 class RaftResilverer {
 public:
-  RaftResilverer(ShardDirectory &directory, const RaftServer &target, const RaftContactDetails &cd, RaftTrimmer &trimmer);
+  RaftResilverer(ShardDirectory &directory, const RaftServer &target, const RaftContactDetails &cd, RaftTrimmer &trimmer, int64_t bandwidth = 0);
   ~RaftResilverer();
 
   ResilveringStatus getStatus();
@@ -64,9 +78,21 @@ public:
     return mFilesTotal;
   }
 
+  //----------------------------------------------------------------------------
+  // How many files the target already had, and didn't need sending.
+  //----------------------------------------------------------------------------
+  size_t getReused() const {
+    return mFilesReused;
+  }
+
+  static constexpr size_t kChunkSize = 4 * 1024 * 1024;
+  static constexpr size_t kParallelFiles = 4;
+  static constexpr size_t kMaxRetries = 5;
+
 private:
   std::atomic<size_t> mFilesSent {0};
   std::atomic<size_t> mFilesTotal {0};
+  std::atomic<size_t> mFilesReused {0};
 
   ShardDirectory &shardDirectory;
   RaftServer target;
@@ -82,10 +108,43 @@ private:
 
   AssistedThread mainThread;
   void main(ThreadAssistant &assistant);
-  bool copyDirectory(const std::string &path, const std::string &prefix, std::string &err);
+
+  struct FileToCopy {
+    std::string path;
+    std::string prefix;
+    int64_t size = 0;
+    bool reuse = false;
+  };
+
+  //----------------------------------------------------------------------------
+  // Files the target reported having, by name, when asked for an incremental
+  // resilvering. Empty if it doesn't support that.
+  //----------------------------------------------------------------------------
+  struct TargetFile {
+    int64_t size;
+  };
+
+  std::map<std::string, TargetFile> targetFiles;
+
+  bool start(std::string &err);
+  bool collectFiles(const std::string &path, const std::string &prefix, std::vector<FileToCopy> &files, std::string &err);
 
   void cancel(const std::string &reason);
-  bool copyFile(const std::string &path, const std::string &prefix, std::string &err);
+  void copyWorker(ThreadAssistant &assistant);
+  bool copyFile(const FileToCopy &file, ThreadAssistant &assistant, std::string &err);
+  bool queryFileSize(const std::string &prefix, int64_t &size, std::string &err);
+
+  RateLimiter rateLimiter;
+
+  //----------------------------------------------------------------------------
+  // Files still to be copied, shared among all workers. The first worker to
+  // fail sets copyError, and the rest bail out.
+  //----------------------------------------------------------------------------
+  std::mutex copyMtx;
+  std::vector<FileToCopy> filesToCopy;
+  size_t nextFile = 0;
+  std::string copyError;
+  std::atomic<bool> copyFailed {false};
 };
 
 }
@@ -171,10 +171,14 @@ std::future<redisReplyPtr> RaftTalker::heartbeat(RaftTerm term, const RaftServer
   return qcl->execute(payload);
 }
 
+std::future<redisReplyPtr> RaftTalker::readIndex() {
+  return qcl->exec("RAFT_READ_INDEX");
+}
+
 std::future<redisReplyPtr> RaftTalker::appendEntries(
   RaftTerm term, RaftServer leader, LogIndex prevIndex,
   RaftTerm prevTerm, LogIndex commit,
-  const std::vector<RaftSerializedEntry> &entries) {
+  std::vector<RaftSerializedEntry> entries) {
 
   if(term < prevTerm) {
     qdb_throw(SSTR("term < prevTerm.. " << prevTerm << "," << term));
@@ -196,8 +200,8 @@ std::future<redisReplyPtr> RaftTalker::appendEntries(
   payload.emplace_back(buffer, 5*sizeof(int64_t));
 
   for(size_t i = 0; i < entries.size(); i++) {
-    payload.push_back(entries[i]);
     qdb_assert(RaftEntry::fetchTerm(entries[i]) <= term);
+    payload.emplace_back(std::move(entries[i]));
   }
 
   return qcl->execute(payload);
@@ -230,7 +234,11 @@ std::future<redisReplyPtr> RaftTalker::fetch(LogIndex index) {
   return qcl->execute(payload);
 }
 
-std::future<redisReplyPtr> RaftTalker::resilveringStart(const ResilveringEventID &id) {
+std::future<redisReplyPtr> RaftTalker::resilveringStart(const ResilveringEventID &id, bool incremental) {
+  if(incremental) {
+    return qcl->exec("quarkdb_start_resilvering", id, "incremental");
+  }
+
   return qcl->exec("quarkdb_start_resilvering", id);
 }
 
@@ -238,6 +246,18 @@ std::future<redisReplyPtr> RaftTalker::resilveringCopy(const ResilveringEventID
   return qcl->exec("quarkdb_resilvering_copy_file", id, filename, contents);
 }
 
+std::future<redisReplyPtr> RaftTalker::resilveringCopyChunk(const ResilveringEventID &id, const std::string &filename, int64_t offset, uint64_t checksum, std::string_view contents) {
+  return qcl->exec("quarkdb_resilvering_copy_chunk", id, filename, std::to_string(offset), std::to_string(checksum), contents);
+}
+
+std::future<redisReplyPtr> RaftTalker::resilveringFileSize(const ResilveringEventID &id, const std::string &filename) {
+  return qcl->exec("quarkdb_resilvering_file_size", id, filename);
+}
+
+std::future<redisReplyPtr> RaftTalker::resilveringReuse(const ResilveringEventID &id, const std::string &filename, uint64_t checksum) {
+  return qcl->exec("quarkdb_resilvering_reuse_file", id, filename, std::to_string(checksum));
+}
+
 std::future<redisReplyPtr> RaftTalker::resilveringFinish(const ResilveringEventID &id) {
   return qcl->exec("quarkdb_finish_resilvering", id);
 }
@@ -45,17 +45,21 @@ public:
   RaftTalker(const RaftServer &server, const RaftContactDetails &contactDetails, std::string_view name);
   std::future<redisReplyPtr> appendEntries(RaftTerm term, RaftServer leader, LogIndex prevIndex,
                                            RaftTerm prevTerm, LogIndex commit,
-                                           const std::vector<RaftSerializedEntry> &entries);
+                                           std::vector<RaftSerializedEntry> entries);
 
   std::future<redisReplyPtr> requestVote(const RaftVoteRequest &req, bool preVote = false);
   std::future<redisReplyPtr> fetch(LogIndex index);
 
-  std::future<redisReplyPtr> resilveringStart(const ResilveringEventID &id);
+  std::future<redisReplyPtr> resilveringStart(const ResilveringEventID &id, bool incremental = false);
   std::future<redisReplyPtr> resilveringCopy(const ResilveringEventID &id, const std::string &filename, const std::string &contents);
+  std::future<redisReplyPtr> resilveringCopyChunk(const ResilveringEventID &id, const std::string &filename, int64_t offset, uint64_t checksum, std::string_view contents);
+  std::future<redisReplyPtr> resilveringFileSize(const ResilveringEventID &id, const std::string &filename);
+  std::future<redisReplyPtr> resilveringReuse(const ResilveringEventID &id, const std::string &filename, uint64_t checksum);
   std::future<redisReplyPtr> resilveringFinish(const ResilveringEventID &id);
   std::future<redisReplyPtr> resilveringCancel(const ResilveringEventID &id, const std::string &reason);
 
   std::future<redisReplyPtr> heartbeat(RaftTerm term, const RaftServer &leader);
+  std::future<redisReplyPtr> readIndex();
   RaftServer getServer() { return server; }
   std::string getNodeVersion();
 
@@ -27,6 +27,7 @@
 #include "raft/RaftState.hh"
 #include "Formatter.hh"
 #include "StateMachine.hh"
+#include "storage/StagingArea.hh"
 #include "Utils.hh"
 using namespace quarkdb;
 
@@ -69,10 +70,99 @@ void RaftWriteTracker::applySingleCommit(LogIndex index) {
   }
 }
 
+bool RaftWriteTracker::stageSingleCommit(StagingArea &stagingArea, LogIndex index, std::vector<std::shared_ptr<PendingQueue>> &stagedQueues) {
+  std::shared_ptr<PendingQueue> blockedQueue = blockedWrites.popIndex(index);
+
+  if(blockedQueue.get() == nullptr) {
+    RaftEntry entry;
+
+    if(!journal.fetch(index, entry).ok()) {
+      // serious error, threatens consistency. Bail out
+      qdb_throw("failed to fetch log entry " << index << " when applying commits");
+    }
+
+    RedisEncodedResponse ignored;
+    return redisDispatcher.stageIntoGroup(stagingArea, entry.request, ignored);
+  }
+
+  LogIndex newBlockingIndex = -1;
+  if(!blockedQueue->stagePending(&redisDispatcher, stagingArea, index, newBlockingIndex)) {
+    // Not groupable, put it back for applySingleCommit
+    blockedWrites.insert(index, blockedQueue);
+    return false;
+  }
+
+  if(newBlockingIndex > 0) {
+    blockedWrites.insert(newBlockingIndex, blockedQueue);
+  }
+
+  stagedQueues.emplace_back(std::move(blockedQueue));
+  return true;
+}
+
+LogIndex RaftWriteTracker::applyCommitGroup(LogIndex firstIndex, LogIndex commitIndex) {
+  LogIndex lastIndex = std::min<LogIndex>(commitIndex, firstIndex + RedisDispatcher::getGroupCommitLimit() - 1);
+  std::vector<std::shared_ptr<PendingQueue>> stagedQueues;
+  LogIndex index = firstIndex;
+
+  {
+    StagingArea stagingArea(stateMachine);
+
+    for( ; index <= lastIndex; index++) {
+      if(!stageSingleCommit(stagingArea, index, stagedQueues)) break;
+    }
+
+    if(index != firstIndex) {
+      redisDispatcher.commitGroup(stagingArea, firstIndex, index-1);
+    }
+  }
+
+  // The entire group is now visible in the state machine, safe to respond
+  for(size_t i = 0; i < stagedQueues.size(); i++) {
+    stagedQueues[i]->releaseStaged(&redisDispatcher);
+  }
+
+  if(index <= lastIndex) {
+    // The group was cut short by an entry which must be applied on its own
+    applySingleCommit(index);
+    index++;
+  }
+
+  return index;
+}
+
+void RaftWriteTracker::recordLatencies(LogIndex firstIndex, LogIndex lastIndex, std::chrono::steady_clock::time_point commitTime) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  LatencyTracker &latencyTracker = stateMachine.getRequestCounter().getLatencyTracker();
+
+  auto it = appendedWrites.lower_bound(firstIndex);
+  while(it != appendedWrites.end() && it->first <= lastIndex) {
+    for(RedisCommand cmd : it->second.commands) {
+      latencyTracker.record(cmd, LatencyStage::kCommit, commitTime - it->second.appendTime);
+      latencyTracker.record(cmd, LatencyStage::kApply, now - commitTime);
+    }
+
+    it = appendedWrites.erase(it);
+  }
+}
+
 void RaftWriteTracker::updatedCommitIndex(LogIndex commitIndex) {
   std::scoped_lock lock(mtx);
-  for(LogIndex index = stateMachine.getLastApplied()+1; index <= commitIndex; index++) {
-    applySingleCommit(index);
+  LogIndex index = stateMachine.getLastApplied()+1;
+  std::chrono::steady_clock::time_point commitTime = std::chrono::steady_clock::now();
+
+  while(index <= commitIndex) {
+    LogIndex firstIndex = index;
+
+    if(RedisDispatcher::getGroupCommitLimit() > 1 && index < commitIndex) {
+      index = applyCommitGroup(index, commitIndex);
+    }
+    else {
+      applySingleCommit(index);
+      index++;
+    }
+
+    recordLatencies(firstIndex, index-1, commitTime);
   }
 }
 
@@ -89,12 +179,24 @@ void RaftWriteTracker::applyCommits() {
   commitApplierActive = false;
 }
 
+bool RaftWriteTracker::appendInternal(LogIndex index, RaftTerm term, RedisRequest &&req) {
+  std::scoped_lock lock(mtx);
+
+  if(!journal.append(index, RaftEntry(term, std::move(req)), false)) {
+    qdb_warn("appending internal write to journal failed for index = " << index << " and term " << term);
+    return false;
+  }
+
+  return true;
+}
+
 void RaftWriteTracker::flushQueues(const RedisEncodedResponse &response) {
   std::scoped_lock lock(mtx);
   blockedWrites.flush(response);
+  appendedWrites.clear();
 }
 
-bool RaftWriteTracker::append(LogIndex index, RaftTerm term, Transaction &&tx, const std::shared_ptr<PendingQueue> &queue, RedisDispatcher &dispatcher) {
+bool RaftWriteTracker::append(LogIndex index, RaftTerm term, Transaction &&tx, const std::shared_ptr<PendingQueue> &queue, RedisDispatcher &dispatcher, std::chrono::steady_clock::time_point dispatchTime) {
   std::scoped_lock lock(mtx);
 
   if(!journal.append(index, RaftEntry(term, tx.toRedisRequest()), false)) {
@@ -103,6 +205,16 @@ bool RaftWriteTracker::append(LogIndex index, RaftTerm term, Transaction &&tx, c
     return false;
   }
 
+  AppendedWrite &appended = appendedWrites[index];
+  appended.appendTime = std::chrono::steady_clock::now();
+  appended.commands.reserve(tx.size());
+
+  for(size_t i = 0; i < tx.size(); i++) {
+    appended.commands.emplace_back(tx[i].getCommand());
+  }
+
+  stateMachine.getRequestCounter().recordLatency(tx, LatencyStage::kJournalAppend, appended.appendTime - dispatchTime);
+
   blockedWrites.insert(index, queue);
   queue->addPendingTransaction(&dispatcher, std::move(tx), index);
   return true;
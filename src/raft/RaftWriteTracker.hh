@@ -26,25 +26,32 @@
 
 #include "raft/RaftCommon.hh"
 #include "Dispatcher.hh"
+#include <chrono>
+#include <map>
 
 namespace quarkdb {
 
 //------------------------------------------------------------------------------
 // Forward declarations
 //------------------------------------------------------------------------------
-class RaftJournal; class StateMachine;
+class RaftJournal; class StateMachine; class StagingArea;
 class RedisEncodedResponse; class Publisher;
 
 //------------------------------------------------------------------------------
 // We track the state of pending writes, and apply them to the state machine
 // when necessary.
+//
+// When several entries become committed at once, they're applied as a group:
+// staged into a single StagingArea and committed with one write, with
+// responses held back until the entire group has been committed.
 //------------------------------------------------------------------------------
 class RaftWriteTracker {
 public:
   RaftWriteTracker(RaftJournal &jr, StateMachine &sm, Publisher &pub);
   ~RaftWriteTracker();
 
-  bool append(LogIndex index, RaftTerm term, Transaction &&tx, const std::shared_ptr<PendingQueue> &queue, RedisDispatcher &dispatcher);
+  bool append(LogIndex index, RaftTerm term, Transaction &&tx, const std::shared_ptr<PendingQueue> &queue, RedisDispatcher &dispatcher, std::chrono::steady_clock::time_point dispatchTime);
+  bool appendInternal(LogIndex index, RaftTerm term, RedisRequest &&req);
   void flushQueues(const RedisEncodedResponse &response);
   size_t size() { return blockedWrites.size(); }
 private:
@@ -57,12 +64,27 @@ private:
   RedisDispatcher redisDispatcher;
   RaftBlockedWrites blockedWrites;
 
+  //----------------------------------------------------------------------------
+  // When each of our pending writes was appended to the journal, and which
+  // commands it contains - used to track commit and apply latencies.
+  //----------------------------------------------------------------------------
+  struct AppendedWrite {
+    std::chrono::steady_clock::time_point appendTime;
+    std::vector<RedisCommand> commands;
+  };
+
+  std::map<LogIndex, AppendedWrite> appendedWrites;
+  void recordLatencies(LogIndex firstIndex, LogIndex lastIndex, std::chrono::steady_clock::time_point commitTime);
+
   std::atomic<bool> commitApplierActive {true};
   std::atomic<bool> shutdown {false};
 
   void applyCommits();
   void updatedCommitIndex(LogIndex commitIndex);
   void applySingleCommit(LogIndex index);
+  // Returns the next index to apply
+  LogIndex applyCommitGroup(LogIndex firstIndex, LogIndex commitIndex);
+  bool stageSingleCommit(StagingArea &stagingArea, LogIndex index, std::vector<std::shared_ptr<PendingQueue>> &stagedQueues);
 };
 
 }
@@ -42,25 +42,57 @@ RecoveryEditor::RecoveryEditor(std::string_view path_) : path(path_) {
   rocksdb::Options options;
   options.create_if_missing = false;
   options.disable_auto_compactions = true;
-  rocksdb::Status status = rocksdb::DB::Open(options, path, &tmpdb);
+
+  std::vector<std::string> names;
+  rocksdb::Status status = rocksdb::DB::ListColumnFamilies(options, path, &names);
+  if(!status.ok()) qdb_throw("Cannot list column families of " << quotes(path) << ":" << status.ToString());
+
+  std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies;
+  for(const std::string &name : names) {
+    columnFamilies.emplace_back(name, rocksdb::ColumnFamilyOptions(options));
+  }
+
+  status = rocksdb::DB::Open(options, path, columnFamilies, &handles, &tmpdb);
 
   if(!status.ok()) qdb_throw("Cannot open " << quotes(path) << ":" << status.ToString());
   db.reset(tmpdb);
+
+  for(size_t i = 0; i < names.size(); i++) {
+    if(names[i] == rocksdb::kDefaultColumnFamilyName) {
+      defaultHandle = handles[i];
+    }
+    else if(names[i] == KeyConstants::kJournal_EntriesColumnFamily) {
+      entriesHandle = handles[i];
+    }
+  }
 }
 
 RecoveryEditor::~RecoveryEditor() {
   if(db) {
     qdb_event("RECOVERY EDITOR: Closing rocksdb database at " << quotes(path));
+
+    for(rocksdb::ColumnFamilyHandle *handle : handles) {
+      db->DestroyColumnFamilyHandle(handle);
+    }
+
     db.reset();
   }
 }
 
+rocksdb::ColumnFamilyHandle* RecoveryEditor::getHandle(std::string_view key) {
+  if(entriesHandle && key.size() == 1 + sizeof(int64_t) && key[0] == 'E') {
+    return entriesHandle;
+  }
+
+  return defaultHandle;
+}
+
 std::vector<std::string> RecoveryEditor::retrieveMagicValues() {
   std::vector<std::string> results;
 
   for(auto it = KeyConstants::allKeys.begin(); it != KeyConstants::allKeys.end(); it++) {
     std::string tmp;
-    rocksdb::Status st = db->Get(rocksdb::ReadOptions(), *it, &tmp);
+    rocksdb::Status st = db->Get(rocksdb::ReadOptions(), defaultHandle, *it, &tmp);
 
     if(st.ok()) {
       results.emplace_back(*it);
@@ -75,20 +107,21 @@ std::vector<std::string> RecoveryEditor::retrieveMagicValues() {
 }
 
 rocksdb::Status RecoveryEditor::get(std::string_view key, std::string &value) {
-  return db->Get(rocksdb::ReadOptions(), key, &value);
+  return db->Get(rocksdb::ReadOptions(), getHandle(key), key, &value);
 }
 
 rocksdb::Status RecoveryEditor::set(std::string_view key, std::string_view value) {
-  return db->Put(rocksdb::WriteOptions(), key, value);
+  return db->Put(rocksdb::WriteOptions(), getHandle(key), key, value);
 }
 
 rocksdb::Status RecoveryEditor::del(std::string_view key) {
   std::string tmp;
+  rocksdb::ColumnFamilyHandle *handle = getHandle(key);
 
-  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), key, &tmp);
+  rocksdb::Status st = db->Get(rocksdb::ReadOptions(), handle, key, &tmp);
 
   if(st.IsNotFound()) {
-    rocksdb::Status st2 = db->Delete(rocksdb::WriteOptions(), key);
+    rocksdb::Status st2 = db->Delete(rocksdb::WriteOptions(), handle, key);
     return rocksdb::Status::InvalidArgument("key not found, but I inserted a tombstone anyway. Deletion status: " + st2.ToString());
   }
 
@@ -96,7 +129,7 @@ rocksdb::Status RecoveryEditor::del(std::string_view key) {
     return st;
   }
 
-  return db->Delete(rocksdb::WriteOptions(), key);
+  return db->Delete(rocksdb::WriteOptions(), handle, key);
 }
 
 using IteratorPtr = std::unique_ptr<rocksdb::Iterator>;
@@ -105,7 +138,7 @@ rocksdb::Status RecoveryEditor::scan(std::string_view key, size_t count, std::st
   rocksdb::ReadOptions opts;
   opts.iter_start_seqnum = 1;
 
-  IteratorPtr iter(db->NewIterator(opts));
+  IteratorPtr iter(db->NewIterator(opts, getHandle(key)));
   iter->Seek(key);
 
   size_t processed = 0;
@@ -133,7 +166,7 @@ rocksdb::Status RecoveryEditor::scan(std::string_view key, size_t count, std::st
 
 rocksdb::Status RecoveryEditor::getAllVersions(std::string_view key, std::vector<std::string> &output) {
   std::vector<rocksdb::KeyVersion> versions;
-  rocksdb::GetAllKeyVersions(db.get(), key, key, std::numeric_limits<size_t>::max(), &versions);
+  rocksdb::GetAllKeyVersions(db.get(), getHandle(key), key, key, std::numeric_limits<size_t>::max(), &versions);
 
   for(const rocksdb::KeyVersion& ver : versions) {
     output.emplace_back(SSTR("KEY: " << ver.user_key));
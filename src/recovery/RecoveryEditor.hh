@@ -32,6 +32,9 @@ namespace quarkdb {
 
 //------------------------------------------------------------------------------
 // A class to allow raw access to rocksdb.
+//
+// Journal entries live in a column family of their own - keys which look like
+// one are looked up there, everything else in the default column family.
 //------------------------------------------------------------------------------
 
 class RecoveryEditor {
@@ -47,8 +50,13 @@ public:
   rocksdb::Status getAllVersions(std::string_view key, std::vector<std::string> &output);
 
 private:
+  rocksdb::ColumnFamilyHandle* getHandle(std::string_view key);
+
   std::string path;
   std::unique_ptr<rocksdb::DB> db;
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
+  rocksdb::ColumnFamilyHandle* defaultHandle = nullptr;
+  rocksdb::ColumnFamilyHandle* entriesHandle = nullptr;
 };
 
 }
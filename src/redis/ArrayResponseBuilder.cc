@@ -26,22 +26,80 @@
 using namespace quarkdb;
 
 ArrayResponseBuilder::ArrayResponseBuilder(size_t size, bool phant)
-: itemsRemaining(size), phantom(phant) {
-  qdb_assert(itemsRemaining >= 1);
+: fixedSize(true), itemsExpected(size), phantom(phant) {
+  qdb_assert(itemsExpected >= 1);
+  writeHeader();
+}
+
+ArrayResponseBuilder::ArrayResponseBuilder()
+: fixedSize(false) {}
 
-  if(!phantom) {
-    ss << "*" << size << "\r\n";
+void ArrayResponseBuilder::writeHeader() {
+  if(fixedSize && !phantom) {
+    encoder.arrayHeader(itemsExpected);
   }
 }
 
 void ArrayResponseBuilder::push_back(const RedisEncodedResponse &item) {
-  qdb_assert(itemsRemaining != 0);
-  itemsRemaining--;
+  qdb_assert(!fixedSize || itemsPushed < itemsExpected);
+  itemsPushed++;
+
+  encoder.raw(item.header);
+  encoder.raw(item.val);
+}
+
+void ArrayResponseBuilder::emplace_back(std::string_view str) {
+  qdb_assert(!fixedSize || itemsPushed < itemsExpected);
+  itemsPushed++;
+
+  encoder.string(str);
+}
+
+void ArrayResponseBuilder::clear() {
+  encoder.clear();
+  itemsPushed = 0;
+  writeHeader();
+}
+
+void ArrayResponseBuilder::reserve(size_t bytes) {
+  encoder.reserve(bytes);
+}
 
-  ss << item.val;
+RedisEncodedResponse ArrayResponseBuilder::buildWithPrefix(std::string_view prefix) {
+  itemsPushed = 0;
+  return RedisEncodedResponse(std::string(prefix), encoder.release());
 }
 
-RedisEncodedResponse ArrayResponseBuilder::buildResponse() const {
-  qdb_assert(itemsRemaining == 0);
-  return RedisEncodedResponse(ss.str());
+RedisEncodedResponse ArrayResponseBuilder::buildResponse() {
+  if(!fixedSize) {
+    RespEncoder prefix;
+    prefix.arrayHeader(itemsPushed);
+    return buildWithPrefix(prefix.view());
+  }
+
+  qdb_assert(itemsPushed == itemsExpected);
+  itemsPushed = 0;
+  return encoder.build();
+}
+
+RedisEncodedResponse ArrayResponseBuilder::buildScanResponse(std::string_view cursor) {
+  qdb_assert(!fixedSize);
+
+  RespEncoder prefix(RespEncoder::headerLength(2) + RespEncoder::stringLength(cursor) + RespEncoder::headerLength(itemsPushed));
+  prefix.arrayHeader(2);
+  prefix.string(cursor);
+  prefix.arrayHeader(itemsPushed);
+
+  return buildWithPrefix(prefix.view());
+}
+
+RedisEncodedResponse ArrayResponseBuilder::buildVersionedResponse(uint64_t version) {
+  qdb_assert(!fixedSize);
+
+  RespEncoder prefix;
+  prefix.arrayHeader(2);
+  prefix.uint64(version);
+  prefix.arrayHeader(itemsPushed);
+
+  return buildWithPrefix(prefix.view());
 }
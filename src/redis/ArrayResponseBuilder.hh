@@ -25,20 +25,86 @@
 #define QUARKDB_ARRAY_RESPONSE_BUILDER_H
 
 #include "redis/RedisEncodedResponse.hh"
-#include <sstream>
+#include "redis/RespEncoder.hh"
+#include <string>
+#include <string_view>
 
 namespace quarkdb {
 
+//------------------------------------------------------------------------------
+// Incrementally builds a redis array response, encoding each element directly
+// into a single output buffer.
+//
+// The size of the array can either be given upfront, or determined by the
+// number of elements pushed, in which case the header is only encoded when
+// building the response, and kept apart from the elements - they're never
+// moved to make room for it. The latter allows streaming the results of a
+// rocksdb iteration straight into the response, without first collecting
+// them into a vector of strings.
+//------------------------------------------------------------------------------
 class ArrayResponseBuilder {
 public:
+  //----------------------------------------------------------------------------
+  // Array of fixed size
+  //----------------------------------------------------------------------------
   ArrayResponseBuilder(size_t size, bool phantom = false);
+
+  //----------------------------------------------------------------------------
+  // Array whose size is determined by the number of elements pushed
+  //----------------------------------------------------------------------------
+  ArrayResponseBuilder();
+
+  //----------------------------------------------------------------------------
+  // Append an already encoded response as the next element
+  //----------------------------------------------------------------------------
   void push_back(const RedisEncodedResponse &item);
-  RedisEncodedResponse buildResponse() const;
+
+  //----------------------------------------------------------------------------
+  // Encode the given string as a bulk string, and append it as the next
+  // element. Named after the STL so that the builder can stand in for a
+  // std::vector<std::string> when collecting results.
+  //----------------------------------------------------------------------------
+  void emplace_back(std::string_view str);
+
+  //----------------------------------------------------------------------------
+  // Number of elements pushed so far
+  //----------------------------------------------------------------------------
+  size_t size() const {
+    return itemsPushed;
+  }
+
+  //----------------------------------------------------------------------------
+  // Discard all elements pushed so far
+  //----------------------------------------------------------------------------
+  void clear();
+
+  //----------------------------------------------------------------------------
+  // Reserve space in the output buffer
+  //----------------------------------------------------------------------------
+  void reserve(size_t bytes);
+
+  //----------------------------------------------------------------------------
+  // Build the response. The builder is left empty afterwards.
+  //----------------------------------------------------------------------------
+  RedisEncodedResponse buildResponse();
+
+  //----------------------------------------------------------------------------
+  // Build a two-element response consisting of the given scan cursor, or
+  // version, followed by the array. Only possible when the size of the array
+  // was not given upfront.
+  //----------------------------------------------------------------------------
+  RedisEncodedResponse buildScanResponse(std::string_view cursor);
+  RedisEncodedResponse buildVersionedResponse(uint64_t version);
 
 private:
-  size_t itemsRemaining;
-  bool phantom;
-  std::stringstream ss;
+  RedisEncodedResponse buildWithPrefix(std::string_view prefix);
+  void writeHeader();
+
+  bool fixedSize;
+  size_t itemsExpected = 0;
+  size_t itemsPushed = 0;
+  bool phantom = false;
+  RespEncoder encoder;
 };
 
 }
@@ -37,7 +37,7 @@ void CommandMonitor::broadcast(std::string_view linkDescription, std::string_vie
   auto it = monitors.begin();
 
   while(it != monitors.end()) {
-    bool stillAlive = (*it)->appendIfAttached(Formatter::status(SSTR(linkDescription << ": " << printableString)));
+    bool stillAlive = (*it)->addMonitorMessageIfAttached(Formatter::status(SSTR(linkDescription << ": " << printableString)));
 
     if(!stillAlive) {
       it = monitors.erase(it);
@@ -50,15 +50,15 @@ void CommandMonitor::broadcast(std::string_view linkDescription, std::string_vie
   if(monitors.size() == 0) active = false;
 }
 
-void CommandMonitor::broadcast(std::string_view linkDescription, const RedisRequest& req) {
+void CommandMonitor::broadcast(const Connection *conn, const RedisRequest& req) {
   if(!active) return;
-  return broadcast(linkDescription, req.toPrintableString());
+  return broadcast(conn->describeWithHostname(), req.toPrintableString());
 }
 
-void CommandMonitor::broadcast(std::string_view linkDescription, const Transaction& transaction) {
+void CommandMonitor::broadcast(const Connection *conn, const Transaction& transaction) {
   if(!active) return;
-  if(transaction.size() == 1u) return broadcast(linkDescription, transaction[0].toPrintableString());
-  return broadcast(linkDescription, transaction.toPrintableString());
+  if(transaction.size() == 1u) return broadcast(conn->describeWithHostname(), transaction[0].toPrintableString());
+  return broadcast(conn->describeWithHostname(), transaction.toPrintableString());
 }
 
 void CommandMonitor::addRegistration(Connection *c) {
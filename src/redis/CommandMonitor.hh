@@ -35,8 +35,13 @@ class CommandMonitor {
 public:
   CommandMonitor();
 
-  void broadcast(std::string_view linkDescription, const RedisRequest& received);
-  void broadcast(std::string_view linkDescription, const Transaction& transaction);
+  //----------------------------------------------------------------------------
+  // The connection is described by hostname if cached, by numeric address
+  // otherwise - the reverse lookup is only ever started if somebody is
+  // monitoring, and never waited on.
+  //----------------------------------------------------------------------------
+  void broadcast(const Connection *conn, const RedisRequest& received);
+  void broadcast(const Connection *conn, const Transaction& transaction);
 
   void addRegistration(Connection *c);
   size_t size();
@@ -29,7 +29,8 @@ void InternalFilter::process(RedisRequest &req) {
   switch(req.getCommand()) {
     case RedisCommand::TIMESTAMPED_LEASE_RELEASE:
     case RedisCommand::TIMESTAMPED_LEASE_ACQUIRE:
-    case RedisCommand::TIMESTAMPED_LEASE_GET: {
+    case RedisCommand::TIMESTAMPED_LEASE_GET:
+    case RedisCommand::LAZYFREE_RECLAIM: {
       // Bad client, bad. No cookie for you.
       req.invalidate();
     }
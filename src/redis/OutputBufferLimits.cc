@@ -0,0 +1,182 @@
+// ----------------------------------------------------------------------
+// File: OutputBufferLimits.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "redis/OutputBufferLimits.hh"
+#include "utils/ParseUtils.hh"
+#include "utils/Macros.hh"
+#include <mutex>
+
+using namespace quarkdb;
+
+std::atomic<int64_t> OutputBufferLimits::heldBytes {0};
+std::atomic<int64_t> OutputBufferLimits::queuedBytes {0};
+std::atomic<int64_t> OutputBufferLimits::droppedMessages {0};
+std::atomic<int64_t> OutputBufferLimits::coalescedMessages {0};
+std::atomic<int64_t> OutputBufferLimits::disconnects {0};
+
+namespace {
+  // No external linkage
+  std::mutex limitsMtx;
+
+  // Indexed by ClientClass. Normal clients only ever hold responses to their
+  // own requests, and are left unlimited.
+  OutputBufferLimit limits[3] = {
+    {0, 0, std::chrono::seconds(0), SlowConsumerPolicy::kDisconnect},
+    {32 * 1024 * 1024, 8 * 1024 * 1024, std::chrono::seconds(60), SlowConsumerPolicy::kDisconnect},
+    {32 * 1024 * 1024, 8 * 1024 * 1024, std::chrono::seconds(60), SlowConsumerPolicy::kDropOldest}
+  };
+}
+
+std::string quarkdb::clientClassToString(ClientClass cls) {
+  switch(cls) {
+    case ClientClass::kNormal: return "normal";
+    case ClientClass::kPubSub: return "pubsub";
+    case ClientClass::kMonitor: return "monitor";
+  }
+
+  qdb_throw("should never happen");
+}
+
+bool quarkdb::parseClientClass(std::string_view str, ClientClass &cls) {
+  if(caseInsensitiveEquals(str, "normal")) {
+    cls = ClientClass::kNormal;
+    return true;
+  }
+
+  if(caseInsensitiveEquals(str, "pubsub")) {
+    cls = ClientClass::kPubSub;
+    return true;
+  }
+
+  if(caseInsensitiveEquals(str, "monitor")) {
+    cls = ClientClass::kMonitor;
+    return true;
+  }
+
+  return false;
+}
+
+std::string quarkdb::slowConsumerPolicyToString(SlowConsumerPolicy policy) {
+  switch(policy) {
+    case SlowConsumerPolicy::kDisconnect: return "disconnect";
+    case SlowConsumerPolicy::kDropOldest: return "drop-oldest";
+    case SlowConsumerPolicy::kCoalesce: return "coalesce";
+  }
+
+  qdb_throw("should never happen");
+}
+
+bool quarkdb::parseSlowConsumerPolicy(std::string_view str, SlowConsumerPolicy &policy) {
+  if(caseInsensitiveEquals(str, "disconnect")) {
+    policy = SlowConsumerPolicy::kDisconnect;
+    return true;
+  }
+
+  if(caseInsensitiveEquals(str, "drop-oldest")) {
+    policy = SlowConsumerPolicy::kDropOldest;
+    return true;
+  }
+
+  if(caseInsensitiveEquals(str, "coalesce")) {
+    policy = SlowConsumerPolicy::kCoalesce;
+    return true;
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Parse a size such as "1024", "512kb", "32mb" or "1gb"
+//------------------------------------------------------------------------------
+static bool parseSize(std::string_view str, size_t &out) {
+  size_t multiplier = 1;
+
+  if(str.size() > 2) {
+    std::string_view suffix = str.substr(str.size() - 2);
+
+    if(caseInsensitiveEquals(suffix, "kb")) multiplier = 1024;
+    else if(caseInsensitiveEquals(suffix, "mb")) multiplier = 1024 * 1024;
+    else if(caseInsensitiveEquals(suffix, "gb")) multiplier = 1024 * 1024 * 1024;
+
+    if(multiplier != 1) str.remove_suffix(2);
+  }
+
+  int64_t value;
+  if(!ParseUtils::parseInt64(std::string(str), value) || value < 0) {
+    return false;
+  }
+
+  out = value * multiplier;
+  return true;
+}
+
+std::string OutputBufferLimit::toString() const {
+  return SSTR(hardLimit << " " << softLimit << " " << softSeconds.count() << " " << slowConsumerPolicyToString(policy));
+}
+
+bool OutputBufferLimit::parse(const std::vector<std::string> &words, OutputBufferLimit &out) {
+  if(words.size() != 4) return false;
+
+  OutputBufferLimit limit;
+  int64_t seconds;
+
+  if(!parseSize(words[0], limit.hardLimit)) return false;
+  if(!parseSize(words[1], limit.softLimit)) return false;
+  if(!ParseUtils::parseInt64(words[2], seconds) || seconds < 0) return false;
+  if(!parseSlowConsumerPolicy(words[3], limit.policy)) return false;
+
+  limit.softSeconds = std::chrono::seconds(seconds);
+  out = limit;
+  return true;
+}
+
+void OutputBufferLimits::set(ClientClass cls, const OutputBufferLimit &limit) {
+  std::scoped_lock lock(limitsMtx);
+  limits[static_cast<int>(cls)] = limit;
+}
+
+OutputBufferLimit OutputBufferLimits::get(ClientClass cls) {
+  std::scoped_lock lock(limitsMtx);
+  return limits[static_cast<int>(cls)];
+}
+
+OutputBufferStats OutputBufferLimits::getStats() {
+  OutputBufferStats stats;
+  stats.heldBytes = heldBytes;
+  stats.queuedBytes = queuedBytes;
+  stats.droppedMessages = droppedMessages;
+  stats.coalescedMessages = coalescedMessages;
+  stats.disconnects = disconnects;
+  return stats;
+}
+
+std::vector<std::string> OutputBufferLimits::describe() {
+  std::vector<std::string> ret;
+
+  for(ClientClass cls : {ClientClass::kNormal, ClientClass::kPubSub, ClientClass::kMonitor}) {
+    ret.emplace_back(SSTR(clientClassToString(cls) << " " << get(cls).toString()));
+  }
+
+  return ret;
+}
@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------------
+// File: OutputBufferLimits.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_REDIS_OUTPUT_BUFFER_LIMITS_HH
+#define QUARKDB_REDIS_OUTPUT_BUFFER_LIMITS_HH
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Classes of clients, each with its own output buffer limits - same idea as
+// redis client-output-buffer-limit. A connection is considered pubsub as soon
+// as it subscribes to anything, and monitor after issuing MONITOR.
+//------------------------------------------------------------------------------
+enum class ClientClass {
+  kNormal = 0,
+  kPubSub = 1,
+  kMonitor = 2
+};
+
+std::string clientClassToString(ClientClass cls);
+bool parseClientClass(std::string_view str, ClientClass &cls);
+
+//------------------------------------------------------------------------------
+// What to do with a slow consumer, once over its limits:
+// - kDisconnect: Shut the connection down, and free everything it holds.
+// - kDropOldest: Discard the oldest held messages to make room.
+// - kCoalesce: Keep only the newest held message per channel, then discard
+//   the oldest if that's still not enough. Meant for subscribers which only
+//   care about the latest state of each channel.
+//------------------------------------------------------------------------------
+enum class SlowConsumerPolicy {
+  kDisconnect = 0,
+  kDropOldest = 1,
+  kCoalesce = 2
+};
+
+std::string slowConsumerPolicyToString(SlowConsumerPolicy policy);
+bool parseSlowConsumerPolicy(std::string_view str, SlowConsumerPolicy &policy);
+
+//------------------------------------------------------------------------------
+// Output buffer limit of a client class. The policy kicks in when held bytes
+// exceed the hard limit, or stay above the soft limit for longer than
+// softSeconds. Zero means no limit.
+//------------------------------------------------------------------------------
+struct OutputBufferLimit {
+  size_t hardLimit = 0;
+  size_t softLimit = 0;
+  std::chrono::seconds softSeconds {0};
+  SlowConsumerPolicy policy = SlowConsumerPolicy::kDisconnect;
+
+  bool unlimited() const {
+    return hardLimit == 0 && softLimit == 0;
+  }
+
+  std::string toString() const;
+
+  //----------------------------------------------------------------------------
+  // Parse "<hard> <soft> <soft-seconds> <policy>", with sizes optionally
+  // suffixed by kb, mb or gb, such as "32mb 8mb 60 disconnect".
+  //----------------------------------------------------------------------------
+  static bool parse(const std::vector<std::string> &words, OutputBufferLimit &out);
+};
+
+//------------------------------------------------------------------------------
+// Totals across all connections, for QUARKDB_INFO.
+//------------------------------------------------------------------------------
+struct OutputBufferStats {
+  int64_t heldBytes = 0;
+  int64_t queuedBytes = 0;
+  int64_t droppedMessages = 0;
+  int64_t coalescedMessages = 0;
+  int64_t disconnects = 0;
+};
+
+//------------------------------------------------------------------------------
+// Process-wide output buffer limits and statistics.
+//------------------------------------------------------------------------------
+class OutputBufferLimits {
+public:
+  static void set(ClientClass cls, const OutputBufferLimit &limit);
+  static OutputBufferLimit get(ClientClass cls);
+
+  static OutputBufferStats getStats();
+  static std::vector<std::string> describe();
+
+  static std::atomic<int64_t> heldBytes;
+
+  //----------------------------------------------------------------------------
+  // Bytes handed over to connection output queues, but not yet written into
+  // the socket.
+  //----------------------------------------------------------------------------
+  static std::atomic<int64_t> queuedBytes;
+  static std::atomic<int64_t> droppedMessages;
+  static std::atomic<int64_t> coalescedMessages;
+  static std::atomic<int64_t> disconnects;
+};
+
+}
+
+#endif
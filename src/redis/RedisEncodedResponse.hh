@@ -25,24 +25,71 @@
 #define QUARKDB_REDIS_REDISENCODEDRESPONSE_H
 
 #include <string>
+#include <string_view>
+#include <memory>
 
 namespace quarkdb {
 
 // Phantom type: std::string with a special meaning. Unless explicitly asked
 // with obj.val, this will generate compiler errors when you try to use like
 // plain string.
+//
+// An array whose size is only known after all of its elements have been
+// encoded keeps its header apart from the elements, so the header never has
+// to be spliced in front of them. Such a response goes out as header followed
+// by val - see ArrayResponseBuilder.
 class RedisEncodedResponse {
 public:
   explicit RedisEncodedResponse(std::string &&src) : val(std::move(src)) {}
+  RedisEncodedResponse(std::string &&hdr, std::string &&src) : header(std::move(hdr)), val(std::move(src)) {}
   RedisEncodedResponse() {}
-  bool empty() const { return val.empty(); }
+  bool empty() const { return header.empty() && val.empty(); }
+  size_t size() const { return header.size() + val.size(); }
+  std::string header;
   std::string val;
 
+  //----------------------------------------------------------------------------
+  // Hand the whole response over as a single buffer, for consumers which
+  // need one. Only a response with a separate header is spliced.
+  //----------------------------------------------------------------------------
+  std::string release() {
+    if(!header.empty()) {
+      val.insert(0, header);
+      header.clear();
+    }
+
+    return std::move(val);
+  }
+
   bool operator==(const RedisEncodedResponse &other) const {
-    return val == other.val;
+    if(size() != other.size()) return false;
+    if(header.size() == other.header.size()) {
+      return header == other.header && val == other.val;
+    }
+
+    return (header + val) == (other.header + other.val);
   }
 };
 
+//------------------------------------------------------------------------------
+// Immutable, reference-counted encoded response. Used when the exact same
+// bytes go out to many connections, such as a published message fanning out
+// to its subscribers - it's encoded once, and every connection shares the
+// same buffer.
+//------------------------------------------------------------------------------
+class SharedEncodedResponse {
+public:
+  explicit SharedEncodedResponse(RedisEncodedResponse &&src)
+  : val(std::make_shared<const std::string>(src.release())) {}
+
+  SharedEncodedResponse() {}
+  bool empty() const { return !val || val->empty(); }
+  std::string_view view() const { return val ? std::string_view(*val) : std::string_view(); }
+
+private:
+  std::shared_ptr<const std::string> val;
+};
+
 }
 
 #endif
@@ -0,0 +1,203 @@
+// ----------------------------------------------------------------------
+// File: RespEncoder.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_REDIS_RESP_ENCODER_H
+#define QUARKDB_REDIS_RESP_ENCODER_H
+
+#include "redis/RedisEncodedResponse.hh"
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Append-only RESP encoder over a single contiguous buffer. Integers are
+// formatted with std::to_chars, so there's no locale lookup and no stream
+// involved, and the exact encoded length of every element can be computed
+// upfront - callers who know their elements can reserve the whole response
+// in one go, and never reallocate.
+//------------------------------------------------------------------------------
+class RespEncoder {
+public:
+  RespEncoder() {}
+  explicit RespEncoder(size_t bytes) { buffer.reserve(bytes); }
+
+  //----------------------------------------------------------------------------
+  // Exact encoded lengths
+  //----------------------------------------------------------------------------
+  static size_t digits(uint64_t number) {
+    size_t ret = 1;
+    while(number >= 10) {
+      number /= 10;
+      ret++;
+    }
+    return ret;
+  }
+
+  static size_t integerLength(int64_t number) {
+    if(number < 0) return 1 + 1 + digits(-(uint64_t) number) + 2;
+    return 1 + digits(number) + 2;
+  }
+
+  static size_t uint64Length(uint64_t number) {
+    return 1 + digits(number) + 2;
+  }
+
+  static size_t headerLength(size_t elements) {
+    return 1 + digits(elements) + 2;
+  }
+
+  static size_t stringLength(std::string_view str) {
+    return 1 + digits(str.size()) + 2 + str.size() + 2;
+  }
+
+  static size_t statusLength(std::string_view str) {
+    return 1 + str.size() + 2;
+  }
+
+  static size_t vectorLength(const std::vector<std::string> &vec) {
+    size_t ret = headerLength(vec.size());
+    for(size_t i = 0; i < vec.size(); i++) {
+      ret += stringLength(vec[i]);
+    }
+    return ret;
+  }
+
+  static size_t statusVectorLength(const std::vector<std::string> &vec) {
+    size_t ret = headerLength(vec.size());
+    for(size_t i = 0; i < vec.size(); i++) {
+      ret += statusLength(vec[i]);
+    }
+    return ret;
+  }
+
+  //----------------------------------------------------------------------------
+  // Encoders
+  //----------------------------------------------------------------------------
+  void reserve(size_t bytes) {
+    buffer.reserve(buffer.size() + bytes);
+  }
+
+  void arrayHeader(size_t elements) {
+    number('*', elements);
+  }
+
+  void pushHeader(size_t elements) {
+    number('>', elements);
+  }
+
+  void string(std::string_view str) {
+    number('$', str.size());
+    buffer.append(str);
+    buffer.append("\r\n", 2);
+  }
+
+  void status(std::string_view str) {
+    buffer.append(1, '+');
+    buffer.append(str);
+    buffer.append("\r\n", 2);
+  }
+
+  void error(std::string_view str) {
+    buffer.append(1, '-');
+    buffer.append(str);
+    buffer.append("\r\n", 2);
+  }
+
+  void integer(int64_t num) {
+    number(':', num);
+  }
+
+  void uint64(uint64_t num) {
+    number(':', num);
+  }
+
+  void null() {
+    buffer.append("$-1\r\n", 5);
+  }
+
+  void raw(std::string_view str) {
+    buffer.append(str);
+  }
+
+  void vector(const std::vector<std::string> &vec) {
+    arrayHeader(vec.size());
+    for(size_t i = 0; i < vec.size(); i++) {
+      string(vec[i]);
+    }
+  }
+
+  void statusVector(const std::vector<std::string> &vec) {
+    arrayHeader(vec.size());
+    for(size_t i = 0; i < vec.size(); i++) {
+      status(vec[i]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Accessors
+  //----------------------------------------------------------------------------
+  size_t size() const {
+    return buffer.size();
+  }
+
+  std::string_view view() const {
+    return buffer;
+  }
+
+  void clear() {
+    buffer.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  // Hand the encoded buffer over, leaving the encoder empty
+  //----------------------------------------------------------------------------
+  RedisEncodedResponse build() {
+    return RedisEncodedResponse(release());
+  }
+
+  std::string release() {
+    std::string ret(std::move(buffer));
+    buffer.clear();
+    return ret;
+  }
+
+private:
+  template<typename T>
+  void number(char prefix, T num) {
+    char tmp[24];
+    tmp[0] = prefix;
+    char *end = std::to_chars(tmp + 1, tmp + sizeof(tmp) - 2, num).ptr;
+    end[0] = '\r';
+    end[1] = '\n';
+    buffer.append(tmp, end + 2 - tmp);
+  }
+
+  std::string buffer;
+};
+
+}
+
+#endif
@@ -41,23 +41,39 @@ void Transaction::push_back(RedisRequest &&req) {
   checkNthCommandForWrites();
 }
 
-void serializeRequestToString(std::stringstream &ss, const RedisRequest &req) {
-  ss << intToBinaryString(req.size());
+static void appendIntToString(int64_t num, std::string &target) {
+  char buff[sizeof(int64_t)];
+  intToBinaryString(num, buff);
+  target.append(buff, sizeof(int64_t));
+}
+
+static void serializeRequestToString(std::string &target, const RedisRequest &req) {
+  appendIntToString(req.size(), target);
   for(size_t i = 0; i < req.size(); i++) {
-    ss << intToBinaryString(req[i].size());
-    ss.write(req[i].data(), req[i].size());
+    appendIntToString(req[i].size(), target);
+    target.append(req[i].data(), req[i].size());
   }
 }
 
 std::string Transaction::serialize() const {
-  std::stringstream ss;
-  ss << intToBinaryString(requests.size());
+  // Compute the exact size first, so as to copy the contents only once
+  size_t size = sizeof(int64_t);
+  for(size_t i = 0; i < requests.size(); i++) {
+    size += sizeof(int64_t);
+    for(size_t j = 0; j < requests[i].size(); j++) {
+      size += sizeof(int64_t) + requests[i][j].size();
+    }
+  }
+
+  std::string ret;
+  ret.reserve(size);
+  appendIntToString(requests.size(), ret);
 
   for(size_t i = 0; i < requests.size(); i++) {
-    serializeRequestToString(ss, requests[i]);
+    serializeRequestToString(ret, requests[i]);
   }
 
-  return ss.str();
+  return ret;
 }
 
 void Transaction::checkNthCommandForWrites(int n) {
@@ -0,0 +1,203 @@
+// ----------------------------------------------------------------------
+// File: BulkIngester.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "storage/BulkIngester.hh"
+#include "utils/FileUtils.hh"
+#include "utils/Macros.hh"
+#include "Utils.hh"
+#include <rocksdb/db.h>
+#include <rocksdb/sst_file_writer.h>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace quarkdb;
+
+const size_t BulkIngester::kDefaultChunkBytes = 64 * 1024 * 1024;
+
+BulkIngester::BulkIngester(rocksdb::DB *d, const rocksdb::Options &opts, const std::string &staging, size_t thr, size_t chunk)
+: db(d), options(opts), stagingPath(staging), chunkBytes(chunk), threads(std::max<size_t>(thr, 1u)) {
+
+  mkpath_or_die(stagingPath + "/", 0755);
+  current.reset(new Chunk());
+
+  workers.reserve(threads);
+  for(size_t i = 0; i < threads; i++) {
+    workers.emplace_back(&BulkIngester::worker, this);
+    workers.back().setName("bulk-ingester");
+  }
+}
+
+BulkIngester::~BulkIngester() {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    if(!current->entries.empty()) {
+      sealNoLock(lock);
+    }
+
+    shutdown = true;
+    cv.notify_all();
+  }
+
+  // Workers drain whatever's left in the queue before exiting
+  workers.clear();
+
+  // Every file has been moved into the DB by now
+  ::rmdir(stagingPath.c_str());
+}
+
+void BulkIngester::put(std::string_view key, std::string_view value) {
+  std::unique_lock<std::mutex> lock(mtx);
+
+  Entry entry;
+  entry.offset = current->buffer.size();
+  entry.keySize = key.size();
+  entry.valueSize = value.size();
+
+  current->buffer.append(key);
+  current->buffer.append(value);
+  current->entries.emplace_back(entry);
+
+  stats.keys++;
+  stats.bytes += key.size() + value.size();
+
+  if(current->memoryUsage() >= chunkBytes) {
+    sealNoLock(lock);
+  }
+}
+
+void BulkIngester::sealNoLock(std::unique_lock<std::mutex> &lock) {
+  // Backpressure: Don't let full chunks pile up in memory faster than the
+  // workers can write them out.
+  cv.wait(lock, [this]() { return sealed.size() < threads; });
+
+  current->sequence = nextSequence++;
+  sealed.emplace_back(std::move(current));
+  current.reset(new Chunk());
+
+  inFlight++;
+  cv.notify_all();
+}
+
+void BulkIngester::flush() {
+  std::unique_lock<std::mutex> lock(mtx);
+
+  if(!current->entries.empty()) {
+    sealNoLock(lock);
+  }
+
+  cv.wait(lock, [this]() { return inFlight == 0; });
+}
+
+BulkIngesterStats BulkIngester::getStats() {
+  std::scoped_lock lock(mtx);
+  return stats;
+}
+
+void BulkIngester::worker(ThreadAssistant &assistant) {
+  while(true) {
+    std::unique_ptr<Chunk> chunk;
+
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [this]() { return !sealed.empty() || shutdown; });
+      if(sealed.empty()) return;
+
+      chunk = std::move(sealed.front());
+      sealed.pop_front();
+      cv.notify_all();
+    }
+
+    std::string path = writeChunk(*chunk);
+
+    {
+      std::scoped_lock lock(ingestMtx);
+      written[chunk->sequence] = path;
+    }
+
+    chunk.reset();
+    ingestWritten();
+  }
+}
+
+std::string BulkIngester::writeChunk(Chunk &chunk) {
+  // Stable, so that of several writes to the same key, the last one ends up
+  // last
+  std::stable_sort(chunk.entries.begin(), chunk.entries.end(), [&chunk](const Entry &a, const Entry &b) {
+    return chunk.key(a) < chunk.key(b);
+  });
+
+  std::string path = pathJoin(stagingPath, SSTR(chunk.sequence << ".sst"));
+
+  rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options);
+  rocksdb::Status st = writer.Open(path);
+  if(!st.ok()) qdb_throw("Unable to open SST file " << quotes(path) << " for bulk ingestion: " << st.ToString());
+
+  int64_t overwritten = 0;
+  for(size_t i = 0; i < chunk.entries.size(); i++) {
+    const Entry &entry = chunk.entries[i];
+
+    if(i+1 < chunk.entries.size() && chunk.key(entry) == chunk.key(chunk.entries[i+1])) {
+      overwritten++;
+      continue;
+    }
+
+    st = writer.Put(chunk.key(entry), chunk.value(entry));
+    if(!st.ok()) qdb_throw("Error when writing into SST file " << quotes(path) << ": " << st.ToString());
+  }
+
+  st = writer.Finish();
+  if(!st.ok()) qdb_throw("Error when finishing SST file " << quotes(path) << ": " << st.ToString());
+
+  std::scoped_lock lock(mtx);
+  stats.overwrittenKeys += overwritten;
+  return path;
+}
+
+//------------------------------------------------------------------------------
+// Ingest as many written files as possible, in sequence. If the next file in
+// sequence is still being written, whoever's writing it will pick up the
+// rest once done.
+//------------------------------------------------------------------------------
+void BulkIngester::ingestWritten() {
+  rocksdb::IngestExternalFileOptions ingestOptions;
+  ingestOptions.move_files = true;
+  ingestOptions.snapshot_consistency = false;
+
+  std::scoped_lock lock(ingestMtx);
+
+  while(true) {
+    auto it = written.find(nextToIngest);
+    if(it == written.end()) return;
+
+    rocksdb::Status st = db->IngestExternalFile({it->second}, ingestOptions);
+    if(!st.ok()) qdb_throw("Unable to ingest SST file " << quotes(it->second) << ": " << st.ToString());
+
+    written.erase(it);
+    nextToIngest++;
+
+    std::scoped_lock lock2(mtx);
+    stats.ingestedFiles++;
+    inFlight--;
+    cv.notify_all();
+  }
+}
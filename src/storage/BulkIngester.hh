@@ -0,0 +1,151 @@
+// ----------------------------------------------------------------------
+// File: BulkIngester.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_BULK_INGESTER_HH
+#define QUARKDB_BULK_INGESTER_HH
+
+#include "utils/AssistedThread.hh"
+#include <rocksdb/options.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocksdb {
+  class DB;
+}
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Progress of a bulk ingestion.
+//------------------------------------------------------------------------------
+struct BulkIngesterStats {
+  int64_t keys = 0;
+  int64_t overwrittenKeys = 0;
+  int64_t bytes = 0;
+  int64_t ingestedFiles = 0;
+};
+
+//------------------------------------------------------------------------------
+// Loads data into a fresh DB without going through the memtable at all.
+//
+// Incoming writes are appended into a chunk. Once a chunk is full, a worker
+// thread sorts it, writes it out as an SST file, and ingests the file into
+// the DB through IngestExternalFile. Chunks are ingested strictly in the
+// order they were filled, so a key written twice keeps its latest value -
+// both within a chunk, and across chunks.
+//
+// When the incoming keys are already sorted, the files don't overlap, and
+// rocksdb can usually place them straight into the bottommost level.
+// Otherwise, they pile up in L0 until the next manual compaction.
+//
+// No reads, and no deletions: Only meant for bulkload mode.
+//------------------------------------------------------------------------------
+class BulkIngester {
+public:
+  BulkIngester(rocksdb::DB *db, const rocksdb::Options &options, const std::string &stagingPath, size_t threads, size_t chunkBytes);
+  ~BulkIngester();
+
+  //----------------------------------------------------------------------------
+  // Thread-safe. Blocks while all workers are busy and there's already a
+  // full chunk waiting for them.
+  //----------------------------------------------------------------------------
+  void put(std::string_view key, std::string_view value);
+
+  //----------------------------------------------------------------------------
+  // Seal the chunk currently being filled, and block until every chunk so
+  // far has been ingested.
+  //----------------------------------------------------------------------------
+  void flush();
+
+  BulkIngesterStats getStats();
+
+  static const size_t kDefaultChunkBytes;
+
+private:
+  //----------------------------------------------------------------------------
+  // Keys and values are stored back-to-back in a single buffer, sorting only
+  // shuffles the small entries around.
+  //----------------------------------------------------------------------------
+  struct Entry {
+    size_t offset;
+    uint32_t keySize;
+    uint32_t valueSize;
+  };
+
+  struct Chunk {
+    uint64_t sequence = 0;
+    std::string buffer;
+    std::vector<Entry> entries;
+
+    size_t memoryUsage() const {
+      return buffer.size() + entries.size() * sizeof(Entry);
+    }
+
+    std::string_view key(const Entry &entry) const {
+      return std::string_view(buffer.data() + entry.offset, entry.keySize);
+    }
+
+    std::string_view value(const Entry &entry) const {
+      return std::string_view(buffer.data() + entry.offset + entry.keySize, entry.valueSize);
+    }
+  };
+
+  void sealNoLock(std::unique_lock<std::mutex> &lock);
+  void worker(ThreadAssistant &assistant);
+  std::string writeChunk(Chunk &chunk);
+  void ingestWritten();
+
+  rocksdb::DB *db;
+  rocksdb::Options options;
+  std::string stagingPath;
+  size_t chunkBytes;
+  size_t threads;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool shutdown = false;
+
+  std::unique_ptr<Chunk> current;
+  std::deque<std::unique_ptr<Chunk>> sealed;
+  uint64_t nextSequence = 0;
+  uint64_t inFlight = 0;
+
+  //----------------------------------------------------------------------------
+  // SST files written out, but not yet ingested, by sequence. Only one
+  // thread at a time ingests, always the next file in sequence.
+  //----------------------------------------------------------------------------
+  std::mutex ingestMtx;
+  std::map<uint64_t, std::string> written;
+  uint64_t nextToIngest = 0;
+
+  BulkIngesterStats stats;
+  std::vector<AssistedThread> workers;
+};
+
+}
+
+#endif
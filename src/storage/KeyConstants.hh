@@ -42,10 +42,14 @@ namespace KeyConstants {
   constexpr char kJournal_PreviousMembershipEpoch[]  = "RAFT_PREVIOUS_MEMBERSHIP_EPOCH";
   constexpr char kJournal_FsyncPolicy[]              = "RAFT_FSYNC_POLICY";
 
+  // Not a key: Journal entries live in a column family of their own
+  constexpr char kJournal_EntriesColumnFamily[]      = "journal-entries";
+
   constexpr char kStateMachine_Format[]              = "__format";
   constexpr char kStateMachine_LastApplied[]         = "__last-applied";
   constexpr char kStateMachine_InBulkload[]          = "__in-bulkload";
   constexpr char kStateMachine_Clock[]               = "__clock";
+  constexpr char kStateMachine_ReversedKeyIndex[]    = "__reversed-key-index";
 
   extern std::vector<std::string> allKeys;
 };
@@ -23,15 +23,23 @@
 
 #include "storage/KeyDescriptorBuilder.hh"
 #include "storage/ReverseLocator.hh"
+#include "storage/BulkIngester.hh"
 #include "StateMachine.hh"
 
 
 using namespace quarkdb;
 
-static void appendToWriteBatch(std::string &prefix, std::string &key, KeyDescriptor &descriptor, rocksdb::WriteBatch &wb) {
+static void appendToWriteBatch(std::string &prefix, std::string &key, KeyDescriptor &descriptor, rocksdb::WriteBatch &wb, BulkIngester *ingester, int64_t &collected) {
   if(!key.empty()) {
     DescriptorLocator dlocator(key);
-    wb.Put(dlocator.toView(), descriptor.serialize());
+    collected++;
+
+    if(ingester) {
+      ingester->put(dlocator.toView(), descriptor.serialize());
+    }
+    else {
+      wb.Put(dlocator.toView(), descriptor.serialize());
+    }
   }
 
   prefix.clear();
@@ -39,12 +47,13 @@ static void appendToWriteBatch(std::string &prefix, std::string &key, KeyDescrip
   descriptor = KeyDescriptor();
 }
 
-KeyDescriptorBuilder::KeyDescriptorBuilder(StateMachine &stateMachine) {
+KeyDescriptorBuilder::KeyDescriptorBuilder(StateMachine &stateMachine, BulkIngester *ingester) {
   StateMachine::IteratorPtr iterator = stateMachine.getRawIterator();
 
   qdb_event("Scanning entire database to calculate key descriptors...");
 
   rocksdb::WriteBatch descriptorBatch;
+  int64_t collected = 0;
 
   std::string currentPrefix;
   std::string currentKey;
@@ -61,7 +70,7 @@ KeyDescriptorBuilder::KeyDescriptorBuilder(StateMachine &stateMachine) {
     }
 
     if(!iterator->Valid()) {
-      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch);
+      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch, ingester, collected);
       break;
     }
 
@@ -78,19 +87,19 @@ KeyDescriptorBuilder::KeyDescriptorBuilder(StateMachine &stateMachine) {
     }
 
     if(revlocator.getKeyType() == KeyType::kString) {
-      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch);
+      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch, ingester, collected);
 
       currentKey = revlocator.getOriginalKey();
       descriptor.setKeyType(KeyType::kString);
       descriptor.setSize(iterator->value().size());
 
-      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch);
+      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch, ingester, collected);
       continue;
     }
 
     // We're dealing with a key that has prefix ..
     if(currentPrefix != revlocator.getRawPrefixUntilBoundary()) {
-      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch);
+      appendToWriteBatch(currentPrefix, currentKey, descriptor, descriptorBatch, ingester, collected);
 
       currentPrefix = revlocator.getRawPrefixUntilBoundary();
       currentKey = revlocator.getOriginalKey();
@@ -104,6 +113,11 @@ KeyDescriptorBuilder::KeyDescriptorBuilder(StateMachine &stateMachine) {
     }
   }
 
-  qdb_event("Collected " << descriptorBatch.Count() << " descriptors. Flushing write batch..");
+  if(ingester) {
+    qdb_event("Collected " << collected << " descriptors, handed over for bulk ingestion.");
+    return;
+  }
+
+  qdb_event("Collected " << collected << " descriptors. Flushing write batch..");
   stateMachine.commitBatch(descriptorBatch);
 }
@@ -29,11 +29,14 @@
 namespace quarkdb {
 
 class StateMachine;
+class BulkIngester;
 
 // Scan the entire db contents after a bulkload to build the key descriptors.
+// If given a BulkIngester, the descriptors are handed over to it, instead of
+// being committed in a single write batch.
 class KeyDescriptorBuilder {
 public:
-  KeyDescriptorBuilder(StateMachine &stateMachine);
+  KeyDescriptorBuilder(StateMachine &stateMachine, BulkIngester *ingester = nullptr);
 private:
 
 
@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------
+// File: KeyDescriptorCache.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "storage/KeyDescriptorCache.hh"
+#include "storage/KeyLockTable.hh"
+#include <algorithm>
+
+using namespace quarkdb;
+
+KeyDescriptorCache::KeyDescriptorCache(size_t capacity)
+: mCapacityPerShard(std::max<size_t>(capacity / kShards, 1u)) {}
+
+KeyDescriptorCache::Shard& KeyDescriptorCache::getShard(std::string_view redisKey) {
+  // Same hash as the write lock stripes: A writer holding a handful of
+  // stripes touches only a handful of shards.
+  return mShards[KeyLockTable::getStripe(redisKey) % kShards];
+}
+
+bool KeyDescriptorCache::get(std::string_view redisKey, KeyDescriptor &descriptor) {
+  Shard &shard = getShard(redisKey);
+  std::scoped_lock lock(shard.mtx);
+
+  auto it = shard.index.find(redisKey);
+  if(it == shard.index.end()) {
+    shard.misses++;
+    return false;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  descriptor = it->second->descriptor;
+  shard.hits++;
+  return true;
+}
+
+void KeyDescriptorCache::invalidateNoLock(Shard &shard, std::string_view redisKey) {
+  auto it = shard.index.find(redisKey);
+  if(it != shard.index.end()) {
+    std::list<Entry>::iterator entry = it->second;
+    shard.index.erase(it);
+    shard.lru.erase(entry);
+  }
+}
+
+void KeyDescriptorCache::put(std::string_view redisKey, const KeyDescriptor &descriptor) {
+  Shard &shard = getShard(redisKey);
+  std::scoped_lock lock(shard.mtx);
+
+  if(descriptor.empty()) {
+    invalidateNoLock(shard, redisKey);
+    return;
+  }
+
+  auto it = shard.index.find(redisKey);
+  if(it != shard.index.end()) {
+    it->second->descriptor = descriptor;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  shard.lru.push_front(Entry {std::string(redisKey), descriptor});
+  shard.index[shard.lru.front().redisKey] = shard.lru.begin();
+
+  while(shard.lru.size() > mCapacityPerShard) {
+    shard.index.erase(shard.lru.back().redisKey);
+    shard.lru.pop_back();
+    shard.evictions++;
+  }
+}
+
+void KeyDescriptorCache::invalidate(std::string_view redisKey) {
+  Shard &shard = getShard(redisKey);
+  std::scoped_lock lock(shard.mtx);
+  invalidateNoLock(shard, redisKey);
+}
+
+void KeyDescriptorCache::apply(const StagedDescriptors &staged) {
+  for(auto it = staged.begin(); it != staged.end(); it++) {
+    put(it->first, it->second);
+  }
+}
+
+void KeyDescriptorCache::clear() {
+  for(size_t i = 0; i < kShards; i++) {
+    std::scoped_lock lock(mShards[i].mtx);
+    mShards[i].index.clear();
+    mShards[i].lru.clear();
+  }
+}
+
+KeyDescriptorCacheStats KeyDescriptorCache::getStats() {
+  KeyDescriptorCacheStats stats;
+
+  for(size_t i = 0; i < kShards; i++) {
+    std::scoped_lock lock(mShards[i].mtx);
+    stats.entries += mShards[i].lru.size();
+    stats.hits += mShards[i].hits;
+    stats.misses += mShards[i].misses;
+    stats.evictions += mShards[i].evictions;
+  }
+
+  return stats;
+}
@@ -0,0 +1,131 @@
+// ----------------------------------------------------------------------
+// File: KeyDescriptorCache.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_KEY_DESCRIPTOR_CACHE_HH
+#define QUARKDB_KEY_DESCRIPTOR_CACHE_HH
+
+#include "storage/KeyDescriptor.hh"
+#include <array>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Statistics of a KeyDescriptorCache.
+//------------------------------------------------------------------------------
+struct KeyDescriptorCacheStats {
+  int64_t entries = 0;
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+
+  double hitRate() const {
+    if(hits + misses == 0) return 0;
+    return (double) hits / (double) (hits + misses);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Key descriptors written by a staging area, by redis key. An empty
+// descriptor means the key was deleted, or its new descriptor is unknown.
+//------------------------------------------------------------------------------
+using StagedDescriptors = std::map<std::string, KeyDescriptor, std::less<>>;
+
+//------------------------------------------------------------------------------
+// Bounded cache of decoded key descriptors, as currently committed in the
+// state machine, by redis key. Split into shards by key hash, each with its
+// own lock and LRU list, so that writers to unrelated keys rarely contend.
+//
+// Only ever consulted by read-write staging areas holding the write lock of
+// the key in question, and updated while that lock is still held: Nobody can
+// commit a different descriptor for the same key in between. Only existing
+// keys are cached.
+//------------------------------------------------------------------------------
+class KeyDescriptorCache {
+public:
+  //----------------------------------------------------------------------------
+  // Constructor
+  //----------------------------------------------------------------------------
+  KeyDescriptorCache(size_t capacity = kDefaultCapacity);
+
+  //----------------------------------------------------------------------------
+  // Return true and fill in the descriptor on a hit
+  //----------------------------------------------------------------------------
+  bool get(std::string_view redisKey, KeyDescriptor &descriptor);
+
+  //----------------------------------------------------------------------------
+  // Insert or replace - an empty descriptor is the same as invalidate()
+  //----------------------------------------------------------------------------
+  void put(std::string_view redisKey, const KeyDescriptor &descriptor);
+  void invalidate(std::string_view redisKey);
+
+  //----------------------------------------------------------------------------
+  // Bring the cache up-to-date with a freshly committed staging area
+  //----------------------------------------------------------------------------
+  void apply(const StagedDescriptors &staged);
+
+  //----------------------------------------------------------------------------
+  // Drop everything
+  //----------------------------------------------------------------------------
+  void clear();
+
+  KeyDescriptorCacheStats getStats();
+
+  static constexpr size_t kShards = 16;
+  static constexpr size_t kDefaultCapacity = 256 * 1024;
+
+private:
+  struct Entry {
+    std::string redisKey;
+    KeyDescriptor descriptor;
+  };
+
+  //----------------------------------------------------------------------------
+  // The index points into the keys stored in the LRU list, which never move.
+  //----------------------------------------------------------------------------
+  struct Shard {
+    std::mutex mtx;
+    std::list<Entry> lru; // most recently used in front
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+  };
+
+  Shard& getShard(std::string_view redisKey);
+  void invalidateNoLock(Shard &shard, std::string_view redisKey);
+
+  size_t mCapacityPerShard;
+  std::array<Shard, kShards> mShards;
+};
+
+}
+
+#endif
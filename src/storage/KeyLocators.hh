@@ -37,7 +37,9 @@ enum class InternalKeyType : char {
   kInternal = '_',
   kConfiguration = '~',
   kDescriptor = '!',
-  kExpirationEvent = '@'
+  kExpirationEvent = '@',
+  kReclamation = '%',
+  kReversedDescriptor = '<'
 };
 
 class DescriptorLocator {
@@ -66,6 +68,39 @@ private:
   KeyBuffer keyBuffer;
 };
 
+//------------------------------------------------------------------------------
+// Entry of the reversed key index: The redis key with its bytes in reverse
+// order, so that all keys sharing a common suffix are stored contiguously.
+//------------------------------------------------------------------------------
+class ReversedDescriptorLocator {
+public:
+  ReversedDescriptorLocator() {}
+
+  ReversedDescriptorLocator(std::string_view redisKey) {
+    reset(redisKey);
+  }
+
+  void reset(std::string_view redisKey) {
+    keyBuffer.resize(redisKey.size() + 1);
+    keyBuffer[0] = char(InternalKeyType::kReversedDescriptor);
+
+    for(size_t i = 0; i < redisKey.size(); i++) {
+      keyBuffer[i+1] = redisKey[redisKey.size()-1-i];
+    }
+  }
+
+  std::string_view toView() {
+    return keyBuffer.toView();
+  }
+
+  std::string toString() {
+    return keyBuffer.toString();
+  }
+
+private:
+  KeyBuffer keyBuffer;
+};
+
 class StringLocator {
 public:
   StringLocator(std::string_view redisKey) {
@@ -292,6 +327,31 @@ private:
   KeyBuffer keyBuffer;
 };
 
+//------------------------------------------------------------------------------
+// Marks the elements under the given prefix as pending reclamation, after
+// their container has been unlinked.
+//------------------------------------------------------------------------------
+class ReclamationLocator {
+public:
+  ReclamationLocator(std::string_view prefix) {
+    reset(prefix);
+  }
+
+  void reset(std::string_view prefix) {
+    keyBuffer.resize(1 + prefix.size());
+    keyBuffer[0] = char(InternalKeyType::kReclamation);
+
+    memcpy(keyBuffer.data()+1, prefix.data(), prefix.size());
+  }
+
+  std::string_view toView() {
+    return keyBuffer.toView();
+  }
+
+private:
+  KeyBuffer keyBuffer;
+};
+
 class ConfigurationLocator {
 public:
   ConfigurationLocator(std::string_view key) {
@@ -0,0 +1,83 @@
+// ----------------------------------------------------------------------
+// File: KeyLockTable.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "storage/KeyLockTable.hh"
+#include "../../deps/xxhash/xxhash.hh"
+#include <algorithm>
+
+using namespace quarkdb;
+
+KeyLockSet::KeyLockSet(std::string_view key) {
+  add(key);
+}
+
+void KeyLockSet::add(std::string_view key) {
+  if(global) return;
+
+  size_t stripe = KeyLockTable::getStripe(key);
+  auto it = std::lower_bound(stripes.begin(), stripes.end(), stripe);
+
+  if(it == stripes.end() || *it != stripe) {
+    stripes.insert(it, stripe);
+  }
+}
+
+bool KeyLockSet::covers(std::string_view key) const {
+  if(isGlobal()) return true;
+  return std::binary_search(stripes.begin(), stripes.end(), KeyLockTable::getStripe(key));
+}
+
+size_t KeyLockTable::getStripe(std::string_view key) {
+  constexpr uint64_t kSeed = 0x6b3f19a5;
+  return XXH64(key.data(), key.size(), kSeed) % kStripes;
+}
+
+void KeyLockTable::lock(const KeyLockSet &lockSet) {
+  if(lockSet.isGlobal()) {
+    for(size_t i = 0; i < kStripes; i++) {
+      stripes[i].lock();
+    }
+
+    return;
+  }
+
+  for(size_t stripe : lockSet.getStripes()) {
+    stripes[stripe].lock();
+  }
+}
+
+void KeyLockTable::unlock(const KeyLockSet &lockSet) {
+  if(lockSet.isGlobal()) {
+    for(size_t i = kStripes; i > 0; i--) {
+      stripes[i-1].unlock();
+    }
+
+    return;
+  }
+
+  const std::vector<size_t> &lockedStripes = lockSet.getStripes();
+  for(auto it = lockedStripes.rbegin(); it != lockedStripes.rend(); it++) {
+    stripes[*it].unlock();
+  }
+}
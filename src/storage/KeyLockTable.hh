@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------
+// File: KeyLockTable.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_KEY_LOCK_TABLE_H
+#define QUARKDB_KEY_LOCK_TABLE_H
+
+#include <array>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// The set of lock stripes a single write needs to hold - either a handful of
+// stripes derived from the keys it touches, or all of them. An empty set
+// means "everything": Forgetting to add keys must never result in a write
+// that runs unprotected.
+//------------------------------------------------------------------------------
+class KeyLockSet {
+public:
+  KeyLockSet() {}
+  explicit KeyLockSet(std::string_view key);
+
+  void add(std::string_view key);
+
+  void lockEverything() {
+    global = true;
+    stripes.clear();
+  }
+
+  bool isGlobal() const {
+    return global || stripes.empty();
+  }
+
+  //----------------------------------------------------------------------------
+  // Is the given key protected by this set?
+  //----------------------------------------------------------------------------
+  bool covers(std::string_view key) const;
+
+  //----------------------------------------------------------------------------
+  // Sorted, without duplicates - stripes are always acquired in ascending
+  // order, so two writers can never deadlock against each other.
+  //----------------------------------------------------------------------------
+  const std::vector<size_t>& getStripes() const {
+    return stripes;
+  }
+
+private:
+  bool global = false;
+  std::vector<size_t> stripes;
+};
+
+//------------------------------------------------------------------------------
+// Key-hash striped write lock. Writers touching disjoint sets of keys can
+// stage and commit in parallel; writers which need exclusive access to the
+// entire keyspace, such as FLUSHALL or anything touching the clock, simply
+// grab every stripe.
+//------------------------------------------------------------------------------
+class KeyLockTable {
+public:
+  static constexpr size_t kStripes = 256;
+  static size_t getStripe(std::string_view key);
+
+  void lock(const KeyLockSet &lockSet);
+  void unlock(const KeyLockSet &lockSet);
+
+private:
+  std::array<std::mutex, kStripes> stripes;
+};
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------
+// File: LazyFreer.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "storage/LazyFreer.hh"
+#include "StateMachine.hh"
+#include "Dispatcher.hh"
+
+using namespace quarkdb;
+
+const int64_t LazyFreer::kBatchSize = 1000;
+const std::chrono::milliseconds LazyFreer::kBatchInterval = std::chrono::milliseconds(10);
+const std::chrono::seconds LazyFreer::kIdleInterval = std::chrono::seconds(1);
+
+LazyFreer::LazyFreer(StateMachine &sm, Dispatcher &disp)
+: stateMachine(sm), dispatcher(disp) {
+  thread.reset(&LazyFreer::main, this);
+  thread.setName("lazy-freer");
+}
+
+bool LazyFreer::reclaimBatch() {
+  if(stateMachine.getReclamationStats().pendingPrefixes == 0) {
+    return false;
+  }
+
+  LogIndex index = 0;
+  if(!dispatcher.submitInternalWrite(RedisRequest { "LAZYFREE_RECLAIM", std::to_string(kBatchSize) }, index)) {
+    return false;
+  }
+
+  // Don't pile up batches in the journal faster than they're being applied
+  stateMachine.waitUntilTargetLastApplied(index, std::chrono::seconds(1));
+  return true;
+}
+
+void LazyFreer::main(ThreadAssistant &assistant) {
+  while(!assistant.terminationRequested()) {
+    if(reclaimBatch()) {
+      // Leave some room for client writes in-between
+      assistant.wait_for(kBatchInterval);
+    }
+    else {
+      assistant.wait_for(kIdleInterval);
+    }
+  }
+}
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------
+// File: LazyFreer.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef QUARKDB_LAZY_FREER_HH
+#define QUARKDB_LAZY_FREER_HH
+
+#include "utils/AssistedThread.hh"
+#include <chrono>
+
+namespace quarkdb {
+
+class StateMachine; class Dispatcher;
+
+//------------------------------------------------------------------------------
+// Progress of the background reclamation of unlinked containers.
+//------------------------------------------------------------------------------
+struct ReclamationStats {
+  int64_t pendingPrefixes = 0;
+  int64_t pendingElements = 0;
+  int64_t reclaimedElements = 0;
+};
+
+//------------------------------------------------------------------------------
+// Reclaims the elements of containers dropped through UNLINK, in the
+// background. Every batch is an ordinary write going through the dispatcher,
+// so in raft mode it gets replicated, and only the leader issues any.
+//------------------------------------------------------------------------------
+class LazyFreer {
+public:
+  LazyFreer(StateMachine &stateMachine, Dispatcher &dispatcher);
+  void main(ThreadAssistant &assistant);
+
+  //----------------------------------------------------------------------------
+  // Issue a single batch - returns false if there was nothing to reclaim, or
+  // we're unable to issue writes.
+  //----------------------------------------------------------------------------
+  bool reclaimBatch();
+
+  static const int64_t kBatchSize;
+  static const std::chrono::milliseconds kBatchInterval;
+  static const std::chrono::seconds kIdleInterval;
+
+private:
+  StateMachine &stateMachine;
+  Dispatcher &dispatcher;
+  AssistedThread thread;
+};
+
+}
+
+#endif
@@ -47,6 +47,26 @@ inline std::string extractPatternPrefix(std::string_view pattern) {
   return std::string(pattern);
 }
 
+// Same as above, but extract the maximum suffix which doesn't contain special
+// characters - useful for patterns such as "*:suffix", which can be resolved
+// through the reversed key index.
+//
+// A character right after a backslash is escaped, so we can't tell where the
+// literal part begins: Stop at the escaped character, conservatively.
+
+inline std::string extractPatternSuffix(std::string_view pattern) {
+  for(size_t i = pattern.size(); i > 0; i--) {
+    char c = pattern[i-1];
+
+    if(c == '?' || c == '*' || c == '[' || c == ']' || c == '\\' ||
+       (i >= 2 && pattern[i-2] == '\\')) {
+      return std::string(pattern.begin()+i, pattern.end());
+    }
+  }
+
+  return std::string(pattern);
+}
+
 }
 
 #endif
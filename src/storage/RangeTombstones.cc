@@ -0,0 +1,119 @@
+// ----------------------------------------------------------------------
+// File: RangeTombstones.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "storage/RangeTombstones.hh"
+
+using namespace quarkdb;
+
+void RangeTombstones::add(std::string_view start, std::string_view end) {
+  ranges.emplace_back();
+  ranges.back().start = std::string(start);
+  ranges.back().end = std::string(end);
+}
+
+bool RangeTombstones::covers(std::string_view key) const {
+  std::string_view start, end;
+  return covers(key, start, end);
+}
+
+bool RangeTombstones::covers(std::string_view key, std::string_view &start, std::string_view &end) const {
+  for(size_t i = 0; i < ranges.size(); i++) {
+    if(ranges[i].start <= key && key < ranges[i].end) {
+      start = ranges[i].start;
+      end = ranges[i].end;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+RangeTombstoneIterator::RangeTombstoneIterator(rocksdb::Iterator *it, const RangeTombstones &ts)
+: base(it), tombstones(ts) {}
+
+bool RangeTombstoneIterator::Valid() const {
+  return base->Valid();
+}
+
+void RangeTombstoneIterator::SeekToFirst() {
+  base->SeekToFirst();
+  skipForward();
+}
+
+void RangeTombstoneIterator::SeekToLast() {
+  base->SeekToLast();
+  skipBackward();
+}
+
+void RangeTombstoneIterator::Seek(const rocksdb::Slice &target) {
+  base->Seek(target);
+  skipForward();
+}
+
+void RangeTombstoneIterator::SeekForPrev(const rocksdb::Slice &target) {
+  base->SeekForPrev(target);
+  skipBackward();
+}
+
+void RangeTombstoneIterator::Next() {
+  base->Next();
+  skipForward();
+}
+
+void RangeTombstoneIterator::Prev() {
+  base->Prev();
+  skipBackward();
+}
+
+rocksdb::Slice RangeTombstoneIterator::key() const {
+  return base->key();
+}
+
+rocksdb::Slice RangeTombstoneIterator::value() const {
+  return base->value();
+}
+
+rocksdb::Status RangeTombstoneIterator::status() const {
+  return base->status();
+}
+
+void RangeTombstoneIterator::skipForward() {
+  std::string_view start, end;
+
+  while(base->Valid() && tombstones.covers(base->key().ToStringView(), start, end)) {
+    base->Seek(end);
+  }
+}
+
+void RangeTombstoneIterator::skipBackward() {
+  std::string_view start, end;
+
+  while(base->Valid() && tombstones.covers(base->key().ToStringView(), start, end)) {
+    base->SeekForPrev(start);
+
+    if(base->Valid() && base->key().ToStringView() == start) {
+      base->Prev();
+    }
+  }
+}
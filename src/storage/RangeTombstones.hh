@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------
+// File: RangeTombstones.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_RANGE_TOMBSTONES_HH
+#define QUARKDB_RANGE_TOMBSTONES_HH
+
+#include <rocksdb/iterator.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Key ranges [start, end) deleted through a single range tombstone, while
+// still being staged. rocksdb's WriteBatchWithIndex knows nothing about range
+// deletions, so anyone reading through the batch has to consult these, too.
+//------------------------------------------------------------------------------
+class RangeTombstones {
+public:
+  void add(std::string_view start, std::string_view end);
+
+  bool empty() const {
+    return ranges.empty();
+  }
+
+  //----------------------------------------------------------------------------
+  // Is the given key deleted by any of the tombstones? If so, return the
+  // boundaries of the covering tombstone.
+  //----------------------------------------------------------------------------
+  bool covers(std::string_view key) const;
+  bool covers(std::string_view key, std::string_view &start, std::string_view &end) const;
+
+private:
+  struct Range {
+    std::string start;
+    std::string end;
+  };
+
+  std::vector<Range> ranges;
+};
+
+//------------------------------------------------------------------------------
+// Wraps an iterator over the DB, hiding all keys covered by the given range
+// tombstones - meant to be used as the base of a WriteBatchWithIndex
+// iterator. Takes ownership of the base iterator.
+//------------------------------------------------------------------------------
+class RangeTombstoneIterator : public rocksdb::Iterator {
+public:
+  RangeTombstoneIterator(rocksdb::Iterator *base, const RangeTombstones &tombstones);
+
+  bool Valid() const override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  void Seek(const rocksdb::Slice &target) override;
+  void SeekForPrev(const rocksdb::Slice &target) override;
+  void Next() override;
+  void Prev() override;
+  rocksdb::Slice key() const override;
+  rocksdb::Slice value() const override;
+  rocksdb::Status status() const override;
+
+private:
+  void skipForward();
+  void skipBackward();
+
+  std::unique_ptr<rocksdb::Iterator> base;
+  const RangeTombstones &tombstones;
+};
+
+}
+
+#endif
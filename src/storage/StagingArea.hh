@@ -29,7 +29,10 @@
 #include "KeyDescriptor.hh"
 #include "utils/SmartBuffer.hh"
 #include "storage/VersionedHashRevisionTracker.hh"
+#include "storage/KeyLockTable.hh"
+#include "storage/RangeTombstones.hh"
 #include "StateMachine.hh"
+#include "storage/BulkIngester.hh"
 
 namespace quarkdb {
 
@@ -39,13 +42,14 @@ class StagingArea {
 public:
   StagingArea(StateMachine &sm, bool onlyreads = false)
   : stateMachine(sm), bulkLoad(stateMachine.inBulkLoad()), readOnly(onlyreads),
+    bulkIngester(stateMachine.bulkIngester.get()),
     /* construct writeBatchWithIndex with default arguments for all, apart from
        overwrite_key, which we set to true. This allows iterating over the
        batch + the DB. */
     writeBatchWithIndex(rocksdb::BytewiseComparator(), 0, true, 0) {
 
     if(!bulkLoad && !readOnly) {
-      stateMachine.writeMtx.lock();
+      stateMachine.writeLocks.lock(lockSet);
     }
 
     if(readOnly) {
@@ -54,9 +58,22 @@ public:
     }
   }
 
+  // Read-write staging area which locks only the stripes covering the given
+  // keys - the caller guarantees nothing else will be touched.
+  StagingArea(StateMachine &sm, KeyLockSet &&locks)
+  : stateMachine(sm), bulkLoad(stateMachine.inBulkLoad()), readOnly(false),
+    bulkIngester(stateMachine.bulkIngester.get()),
+    writeBatchWithIndex(rocksdb::BytewiseComparator(), 0, true, 0),
+    lockSet(std::move(locks)) {
+
+    if(!bulkLoad) {
+      stateMachine.writeLocks.lock(lockSet);
+    }
+  }
+
   ~StagingArea() {
     if(!bulkLoad && !readOnly) {
-      stateMachine.writeMtx.unlock();
+      stateMachine.writeLocks.unlock(lockSet);
     }
   }
 
@@ -76,6 +93,10 @@ public:
       return rocksdb::Status::NotFound();
     }
 
+    if(rangeTombstones.covers(slice)) {
+      return writeBatchWithIndex.GetFromBatch(rocksdb::DBOptions(), slice, &value);
+    }
+
     return writeBatchWithIndex.GetFromBatchAndDB(stateMachine.db.get(),
       rocksdb::ReadOptions(), slice, &value);
   }
@@ -91,6 +112,11 @@ public:
       return stateMachine.db->Get(snapshot->opts(), slice, &ignore);
     }
 
+    if(rangeTombstones.covers(slice)) {
+      std::string ignore;
+      return writeBatchWithIndex.GetFromBatch(rocksdb::DBOptions(), slice, &ignore);
+    }
+
     rocksdb::PinnableSlice ignored;
     return writeBatchWithIndex.GetFromBatchAndDB(stateMachine.db.get(), rocksdb::ReadOptions(), slice, &ignored);
   }
@@ -104,6 +130,10 @@ public:
       return stateMachine.db->Get(snapshot->opts(), slice, &value);
     }
 
+    if(rangeTombstones.covers(slice)) {
+      return writeBatchWithIndex.GetFromBatch(rocksdb::DBOptions(), slice, &value);
+    }
+
     return writeBatchWithIndex.GetFromBatchAndDB(stateMachine.db.get(), rocksdb::ReadOptions(), slice, &value);
   }
 
@@ -115,6 +145,13 @@ public:
         return;
       }
 
+      // No reads and no deletions in bulkload mode, every write is final:
+      // Hand it straight over for SST ingestion, if enabled.
+      if(bulkIngester) {
+        bulkIngester->put(slice, value);
+        return;
+      }
+
       // rocksdb transactions have to build an internal index to implement
       // repeatable reads on the same tx. In bulkload mode we don't allow reads,
       // so let's use the much faster write batch.
@@ -123,12 +160,14 @@ public:
     }
 
     THROW_ON_ERROR(writeBatchWithIndex.Put(slice, value));
+    trackDescriptor(slice);
   }
 
   void del(std::string_view slice) {
     if(readOnly) qdb_throw("cannot call del() on a readonly staging area");
     if(bulkLoad) qdb_throw("no deletions allowed during bulk load");
     THROW_ON_ERROR(writeBatchWithIndex.Delete(slice));
+    trackDescriptor(slice);
   }
 
   // SingleDelete() has a performance advantage over del(), but can be used
@@ -145,17 +184,80 @@ public:
     if(readOnly) qdb_throw("cannot call singleDelete() on a readonly staging area");
     if(bulkLoad) qdb_throw("no deletions allowed during bulk load");
     THROW_ON_ERROR(writeBatchWithIndex.SingleDelete(slice));
+    trackDescriptor(slice);
+  }
+
+  // Delete every key within [start, end) using a single range tombstone,
+  // instead of one tombstone per key - the cost no longer depends on how
+  // many keys the range contains.
+  //
+  // The index of the write batch is not aware of range tombstones: Keys
+  // staged earlier within the range are deleted individually, and reads
+  // consult rangeTombstones before falling through to the DB.
+  void deleteRange(std::string_view start, std::string_view end) {
+    if(readOnly) qdb_throw("cannot call deleteRange() on a readonly staging area");
+    if(bulkLoad) qdb_throw("no deletions allowed during bulk load");
+
+    std::vector<std::string> staged;
+    StateMachine::IteratorPtr iter(writeBatchWithIndex.NewIteratorWithBase(rocksdb::NewEmptyIterator()));
+
+    for(iter->Seek(start); iter->Valid() && iter->key().ToStringView() < end; iter->Next()) {
+      staged.emplace_back(iter->key().ToString());
+    }
+
+    for(size_t i = 0; i < staged.size(); i++) {
+      THROW_ON_ERROR(writeBatchWithIndex.Delete(staged[i]));
+    }
+
+    THROW_ON_ERROR(writeBatchWithIndex.GetWriteBatch()->DeleteRange(start, end));
+    rangeTombstones.add(start, end);
+
+    const std::string descriptorsStart(1, char(InternalKeyType::kDescriptor));
+    const std::string descriptorsEnd(1, char(InternalKeyType::kDescriptor) + 1);
+    if(start < descriptorsEnd && descriptorsStart < end) {
+      descriptorsRangeDeleted = true;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Record the decoded form of a key descriptor which was just put(), so the
+  // descriptor cache can be updated with it on commit, instead of dropping
+  // the key.
+  //----------------------------------------------------------------------------
+  void stageDescriptor(std::string_view redisKey, const KeyDescriptor &descriptor) {
+    if(bulkLoad) return;
+
+    auto it = stagedDescriptors.find(redisKey);
+    qdb_assert(it != stagedDescriptors.end());
+    it->second = descriptor;
+  }
+
+  //----------------------------------------------------------------------------
+  // Is the descriptor cache good for the given key? Only if we hold its write
+  // lock, and haven't modified its descriptor ourselves - a readonly staging
+  // area reads through a snapshot, which the cache might be ahead of.
+  //----------------------------------------------------------------------------
+  bool canUseDescriptorCache(std::string_view redisKey) const {
+    if(bulkLoad || readOnly || descriptorsRangeDeleted) return false;
+    if(!lockSet.covers(redisKey)) return false;
+    return stagedDescriptors.find(redisKey) == stagedDescriptors.end();
   }
 
   rocksdb::Status commit(LogIndex index) {
+    return commit(index, index);
+  }
+
+  // Commit a group of consecutive journal entries, all of which were staged
+  // into this area, with a single write.
+  rocksdb::Status commit(LogIndex firstIndex, LogIndex lastIndex) {
     if(readOnly) qdb_throw("cannot call commit() on a readonly staging area");
     if(bulkLoad) {
-      qdb_assert(index == 0);
-      stateMachine.commitBatch(writeBatch);
+      qdb_assert(firstIndex == 0 && lastIndex == 0);
+      if(!bulkIngester) stateMachine.commitBatch(writeBatch);
       return rocksdb::Status::OK();
     }
 
-    stateMachine.commitTransaction(writeBatchWithIndex, index);
+    stateMachine.commitTransaction(writeBatchWithIndex, firstIndex, lastIndex, stagedDescriptors, descriptorsRangeDeleted);
     return rocksdb::Status::OK();
   }
 
@@ -181,8 +283,14 @@ public:
       opts.iter_start_seqnum = 1;
     }
 
+    rocksdb::Iterator *base = stateMachine.db->NewIterator(opts);
+    if(!withInternalKeys && !rangeTombstones.empty()) {
+      // Hide whatever the range tombstones staged so far have deleted
+      base = new RangeTombstoneIterator(base, rangeTombstones);
+    }
+
     return StateMachine::IteratorPtr(
-      writeBatchWithIndex.NewIteratorWithBase(stateMachine.db->NewIterator(opts))
+      writeBatchWithIndex.NewIteratorWithBase(base)
     );
   }
 
@@ -191,15 +299,38 @@ public:
   }
 
 private:
+  //----------------------------------------------------------------------------
+  // Note down every key descriptor we modify - until a decoded version is
+  // staged, the cached entry is to be dropped on commit.
+  //----------------------------------------------------------------------------
+  void trackDescriptor(std::string_view slice) {
+    if(slice.empty() || slice[0] != char(InternalKeyType::kDescriptor)) return;
+
+    std::string_view redisKey = slice.substr(1);
+    auto it = stagedDescriptors.find(redisKey);
+
+    if(it == stagedDescriptors.end()) {
+      stagedDescriptors.emplace(std::string(redisKey), KeyDescriptor());
+    }
+    else {
+      it->second = KeyDescriptor();
+    }
+  }
+
   friend class StateMachine;
   StateMachine &stateMachine;
   bool bulkLoad = false;
   bool readOnly = false;
+  BulkIngester *bulkIngester = nullptr;
 
   std::unique_ptr<StateMachine::Snapshot> snapshot;
   rocksdb::WriteBatch writeBatch;
   rocksdb::WriteBatchWithIndex writeBatchWithIndex;
   VersionedHashRevisionTracker revisionTracker;
+  KeyLockSet lockSet;
+  RangeTombstones rangeTombstones;
+  StagedDescriptors stagedDescriptors;
+  bool descriptorsRangeDeleted = false;
 };
 
 }
@@ -25,6 +25,8 @@
 #include "utils/FileUtils.hh"
 #include "Utils.hh"
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string.h>
 
 namespace quarkdb {
@@ -204,6 +206,63 @@ void write_file_or_die(std::string_view path, std::string_view contents) {
   }
 }
 
+bool getFileSize(const std::string &path, int64_t &size, std::string &err) {
+  struct stat sb;
+
+  if(stat(path.c_str(), &sb) != 0) {
+    int localerrno = errno;
+    err = SSTR("Cannot stat " << path << ": " << strerror(localerrno));
+    return false;
+  }
+
+  size = sb.st_size;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Write contents at the given offset, creating the file if necessary. Anything
+// past the offset is discarded first, so the file ends up exactly
+// offset + contents.size() bytes long.
+//------------------------------------------------------------------------------
+bool writeFileAt(const std::string &path, int64_t offset, std::string_view contents, std::string &err) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if(fd < 0) {
+    int localerrno = errno;
+    err = SSTR("Unable to open path for writing: " << path << ": " << strerror(localerrno));
+    return false;
+  }
+
+  if(::ftruncate(fd, offset) != 0) {
+    int localerrno = errno;
+    err = SSTR("Unable to truncate " << path << " to " << offset << " bytes: " << strerror(localerrno));
+    ::close(fd);
+    return false;
+  }
+
+  size_t written = 0;
+  while(written < contents.size()) {
+    ssize_t rc = ::pwrite(fd, contents.data() + written, contents.size() - written, offset + written);
+    if(rc < 0 && errno == EINTR) continue;
+
+    if(rc < 0) {
+      int localerrno = errno;
+      err = SSTR("Unable to write into " << path << " at offset " << offset + written << ": " << strerror(localerrno));
+      ::close(fd);
+      return false;
+    }
+
+    written += rc;
+  }
+
+  if(::close(fd) != 0) {
+    int localerrno = errno;
+    err = SSTR("Unable to close " << path << ": " << strerror(localerrno));
+    return false;
+  }
+
+  return true;
+}
+
 void rename_directory_or_die(const std::string &source, const std::string &destination) {
   qdb_info("Renaming directory: '" << source << "' to '" << destination << "'");
 
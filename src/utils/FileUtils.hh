@@ -38,6 +38,8 @@ bool readFile(FILE *f, std::string &contents);
 bool readFile(const std::string &path, std::string &contents);
 bool write_file(std::string_view path, std::string_view contents, std::string &err);
 void write_file_or_die(std::string_view path, std::string_view contents);
+bool getFileSize(const std::string &path, int64_t &size, std::string &err);
+bool writeFileAt(const std::string &path, int64_t offset, std::string_view contents, std::string &err);
 void rename_directory_or_die(const std::string &source, const std::string &destination);
 bool areFilePermissionsSecure(mode_t mode);
 bool readPasswordFile(const std::string &path, std::string &contents);
@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------
+// File: LatencyHistogram.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "utils/LatencyHistogram.hh"
+#include <cmath>
+
+namespace quarkdb {
+
+size_t LatencyHistogram::getBucket(uint64_t micros) {
+  if(micros < 2*kSubBuckets) {
+    return micros;
+  }
+
+  constexpr uint64_t kMaxValue = (1ull << kMaxExponent) - 1;
+  if(micros > kMaxValue) {
+    micros = kMaxValue;
+  }
+
+  size_t exponent = 63 - __builtin_clzll(micros);
+  size_t shift = exponent - kSubBucketBits;
+  size_t subBucket = (micros >> shift) - kSubBuckets;
+
+  return 2*kSubBuckets + (exponent - kSubBucketBits - 1) * kSubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(size_t bucket) {
+  if(bucket < 2*kSubBuckets) {
+    return bucket;
+  }
+
+  size_t exponent = (bucket - 2*kSubBuckets) / kSubBuckets + kSubBucketBits + 1;
+  size_t subBucket = (bucket - 2*kSubBuckets) % kSubBuckets;
+  size_t shift = exponent - kSubBucketBits;
+
+  return ((kSubBuckets + subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::reset() {
+  for(size_t i = 0; i < kBuckets; i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyDistribution::add(const LatencyHistogram &histogram) {
+  for(size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+    uint64_t value = histogram.getBucketCount(i);
+    buckets[i] += value;
+    count += value;
+  }
+}
+
+uint64_t LatencyDistribution::getPercentile(double percentile) const {
+  if(count == 0) return 0;
+
+  // The rank of the sample we're looking for, 1-based - rounded up, so that
+  // high percentiles of few samples aren't under-reported
+  uint64_t rank = std::ceil((percentile / 100.0) * count);
+  if(rank == 0) rank = 1;
+  if(rank > count) rank = count;
+
+  uint64_t seen = 0;
+  for(size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+    seen += buckets[i];
+    if(seen >= rank) {
+      return LatencyHistogram::getBucketUpperBound(i);
+    }
+  }
+
+  return LatencyHistogram::getBucketUpperBound(LatencyHistogram::kBuckets - 1);
+}
+
+}
@@ -0,0 +1,94 @@
+// ----------------------------------------------------------------------
+// File: LatencyHistogram.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_LATENCY_HISTOGRAM_HH
+#define QUARKDB_LATENCY_HISTOGRAM_HH
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// Lock-free latency histogram in the spirit of HdrHistogram: Values below
+// 2 * kSubBuckets microseconds get a bucket each, and every power of two
+// above that is split into kSubBuckets linear buckets, bounding the
+// relative error to 1 / kSubBuckets, all the way up to hours.
+//------------------------------------------------------------------------------
+class LatencyHistogram {
+public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = (1 << kSubBucketBits);
+  static constexpr size_t kMaxExponent = 36;
+  static constexpr size_t kBuckets = 2*kSubBuckets + (kMaxExponent - kSubBucketBits - 1) * kSubBuckets;
+
+  static size_t getBucket(uint64_t micros);
+  static uint64_t getBucketUpperBound(size_t bucket);
+
+  void record(uint64_t micros) {
+    buckets[getBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t getBucketCount(size_t bucket) const {
+    return buckets[bucket].load(std::memory_order_relaxed);
+  }
+
+  //----------------------------------------------------------------------------
+  // Not atomic with respect to concurrent record() calls - a sample landing
+  // right in the middle of a reset might survive it.
+  //----------------------------------------------------------------------------
+  void reset();
+
+private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets {};
+};
+
+//------------------------------------------------------------------------------
+// Plain snapshot of one or more histograms merged together, to extract
+// percentiles from.
+//------------------------------------------------------------------------------
+class LatencyDistribution {
+public:
+  void add(const LatencyHistogram &histogram);
+
+  uint64_t getCount() const {
+    return count;
+  }
+
+  //----------------------------------------------------------------------------
+  // Upper bound of the bucket containing the given percentile, in
+  // microseconds. Zero if empty.
+  //----------------------------------------------------------------------------
+  uint64_t getPercentile(double percentile) const;
+
+private:
+  std::array<uint64_t, LatencyHistogram::kBuckets> buckets {};
+  uint64_t count = 0;
+};
+
+}
+
+#endif
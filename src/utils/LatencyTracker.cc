@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------
+// File: LatencyTracker.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "utils/LatencyTracker.hh"
+#include "utils/Macros.hh"
+#include <algorithm>
+
+namespace quarkdb {
+
+std::string latencyStageToString(LatencyStage stage) {
+  switch(stage) {
+    case LatencyStage::kDispatch: return "dispatch";
+    case LatencyStage::kJournalAppend: return "journal-append";
+    case LatencyStage::kCommit: return "commit";
+    case LatencyStage::kApply: return "apply";
+  }
+
+  qdb_throw("should never happen");
+}
+
+LatencyTracker::Shard::~Shard() {
+  for(size_t i = 0; i < histograms.size(); i++) {
+    delete histograms[i].load();
+  }
+}
+
+void LatencyTracker::record(RedisCommand cmd, LatencyStage stage, std::chrono::steady_clock::duration duration) {
+  size_t slot = ((size_t) cmd) * kStages + (size_t) stage;
+  if(slot >= kMaxCommands * kStages) return;
+
+  std::atomic<LatencyHistogram*> &target = shards.access().first->histograms[slot];
+  LatencyHistogram *histogram = target.load(std::memory_order_acquire);
+
+  if(!histogram) {
+    LatencyHistogram *fresh = new LatencyHistogram();
+
+    if(target.compare_exchange_strong(histogram, fresh, std::memory_order_acq_rel)) {
+      histogram = fresh;
+    }
+    else {
+      // Someone else on this core beat us to it
+      delete fresh;
+    }
+  }
+
+  int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  histogram->record(micros < 0 ? 0 : micros);
+}
+
+void LatencyTracker::reset() {
+  for(size_t core = 0; core < shards.size(); core++) {
+    Shard *shard = shards.accessAtCore(core);
+
+    for(size_t i = 0; i < shard->histograms.size(); i++) {
+      LatencyHistogram *histogram = shard->histograms[i].load(std::memory_order_acquire);
+      if(histogram) histogram->reset();
+    }
+  }
+}
+
+static std::string commandToString(size_t cmd) {
+  for(auto it = redis_cmd_map.begin(); it != redis_cmd_map.end(); it++) {
+    if((size_t) it->second.first == cmd) {
+      std::string name = it->first;
+      std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+      return name;
+    }
+  }
+
+  return SSTR("COMMAND-" << cmd);
+}
+
+std::vector<std::string> LatencyTracker::describe() {
+  std::vector<std::string> output;
+
+  for(size_t slot = 0; slot < kMaxCommands * kStages; slot++) {
+    LatencyDistribution distribution;
+
+    for(size_t core = 0; core < shards.size(); core++) {
+      LatencyHistogram *histogram = shards.accessAtCore(core)->histograms[slot].load(std::memory_order_acquire);
+      if(histogram) distribution.add(*histogram);
+    }
+
+    if(distribution.getCount() == 0) continue;
+
+    output.emplace_back(SSTR(commandToString(slot / kStages) << " " <<
+      latencyStageToString(LatencyStage(slot % kStages)) <<
+      " count=" << distribution.getCount() <<
+      " p50=" << distribution.getPercentile(50) << "us" <<
+      " p99=" << distribution.getPercentile(99) << "us" <<
+      " p999=" << distribution.getPercentile(99.9) << "us"));
+  }
+
+  return output;
+}
+
+}
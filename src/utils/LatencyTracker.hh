@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------
+// File: LatencyTracker.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2019 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_LATENCY_TRACKER_HH
+#define QUARKDB_LATENCY_TRACKER_HH
+
+#include "utils/CoreLocalArray.hh"
+#include "utils/LatencyHistogram.hh"
+#include "Commands.hh"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace quarkdb {
+
+//------------------------------------------------------------------------------
+// The stages a request goes through, each one tracked separately:
+// - kDispatch: From being handed over to the dispatcher, until it returns.
+//   For reads and standalone writes, that's the entire service time.
+// - kJournalAppend: Raft leaders only, from dispatch until the write has
+//   been appended to the journal.
+// - kCommit: From journal append, until the write tracker notices the entry
+//   has been committed.
+// - kApply: From noticing the commit, until the entry has been applied
+//   onto the state machine.
+//------------------------------------------------------------------------------
+enum class LatencyStage {
+  kDispatch = 0,
+  kJournalAppend = 1,
+  kCommit = 2,
+  kApply = 3
+};
+
+std::string latencyStageToString(LatencyStage stage);
+
+//------------------------------------------------------------------------------
+// Core-local latency histograms per RedisCommand and LatencyStage. A
+// histogram is only allocated the first time its command and stage
+// combination is recorded on a particular core.
+//------------------------------------------------------------------------------
+class LatencyTracker {
+public:
+  static constexpr size_t kStages = 4;
+  static constexpr size_t kMaxCommands = 256;
+
+  void record(RedisCommand cmd, LatencyStage stage, std::chrono::steady_clock::duration duration);
+
+  //----------------------------------------------------------------------------
+  // Zero out all histograms
+  //----------------------------------------------------------------------------
+  void reset();
+
+  //----------------------------------------------------------------------------
+  // One line per command and stage combination with any samples, listing
+  // count, p50, p99 and p999
+  //----------------------------------------------------------------------------
+  std::vector<std::string> describe();
+
+private:
+  struct alignas(CoreLocal::kCacheLine) Shard {
+    Shard() {}
+    ~Shard();
+
+    std::array<std::atomic<LatencyHistogram*>, kMaxCommands * kStages> histograms {};
+  };
+
+  CoreLocalArray<Shard> shards;
+};
+
+}
+
+#endif
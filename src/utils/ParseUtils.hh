@@ -26,6 +26,7 @@
 
 #include "Utils.hh"
 
+#include <cerrno>
 #include <climits>
 
 namespace quarkdb { namespace ParseUtils {
@@ -52,6 +53,20 @@ inline bool parseInt64(std::string_view str, int64_t &ret) {
   return true;
 }
 
+inline bool parseUInt64(std::string_view str, uint64_t &ret) {
+  if(str.empty() || str[0] == '-') {
+    return false;
+  }
+
+  char *endptr = NULL;
+  errno = 0;
+  ret = strtoull(str.data(), &endptr, 10);
+  if(endptr != str.data() + str.size() || errno == ERANGE) {
+    return false;
+  }
+  return true;
+}
+
 inline bool parseIntegerList(const std::string &buffer, const std::string &separator, std::vector<int64_t> &results) {
   results.clear();
 
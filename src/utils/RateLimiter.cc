@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------
+// File: RateLimiter.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "utils/RateLimiter.hh"
+#include "utils/AssistedThread.hh"
+#include <algorithm>
+
+using namespace quarkdb;
+
+RateLimiter::RateLimiter(int64_t bps) : bytesPerSecond(bps) {}
+
+std::chrono::nanoseconds RateLimiter::reserve(int64_t bytes, std::chrono::steady_clock::time_point now) {
+  if(bytesPerSecond <= 0) {
+    return std::chrono::nanoseconds(0);
+  }
+
+  std::scoped_lock lock(mtx);
+
+  std::chrono::steady_clock::time_point start = std::max(nextFree, now);
+  nextFree = start + std::chrono::nanoseconds((bytes * 1000000000) / bytesPerSecond);
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(start - now);
+}
+
+void RateLimiter::acquire(int64_t bytes, ThreadAssistant &assistant) {
+  std::chrono::nanoseconds delay = reserve(bytes, std::chrono::steady_clock::now());
+
+  if(delay.count() > 0) {
+    assistant.wait_for(delay);
+  }
+}
@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------
+// File: RateLimiter.hh
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#ifndef QUARKDB_RATE_LIMITER_HH
+#define QUARKDB_RATE_LIMITER_HH
+
+#include <chrono>
+#include <mutex>
+
+namespace quarkdb {
+
+class ThreadAssistant;
+
+//------------------------------------------------------------------------------
+// Caps the average throughput of whoever shares this object, in bytes per
+// second. Each reservation pushes back the point in time at which the next
+// one may proceed, so bursts never exceed a single reservation.
+//
+// A limit of zero or less means unlimited.
+//------------------------------------------------------------------------------
+class RateLimiter {
+public:
+  RateLimiter(int64_t bytesPerSecond);
+
+  //----------------------------------------------------------------------------
+  // Reserve the given number of bytes, and return how long the caller has to
+  // wait before sending them.
+  //----------------------------------------------------------------------------
+  std::chrono::nanoseconds reserve(int64_t bytes, std::chrono::steady_clock::time_point now);
+
+  //----------------------------------------------------------------------------
+  // Reserve, and sleep for as long as needed - or until termination is
+  // requested.
+  //----------------------------------------------------------------------------
+  void acquire(int64_t bytes, ThreadAssistant &assistant);
+
+  int64_t getLimit() const {
+    return bytesPerSecond;
+  }
+
+private:
+  std::mutex mtx;
+  int64_t bytesPerSecond;
+  std::chrono::steady_clock::time_point nextFree;
+};
+
+}
+
+#endif
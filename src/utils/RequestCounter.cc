@@ -97,6 +97,22 @@ void RequestCounter::mainThread(ThreadAssistant &assistant) {
   }
 }
 
+void RequestCounter::recordLatency(const Transaction &transaction,
+  LatencyStage stage, std::chrono::steady_clock::duration duration) {
+
+  for(size_t i = 0; i < transaction.size(); i++) {
+    latencyTracker.record(transaction[i].getCommand(), stage, duration);
+  }
+}
+
+void RequestCounter::recordLatency(const std::vector<RedisCommand> &commands,
+  LatencyStage stage, std::chrono::steady_clock::duration duration) {
+
+  for(size_t i = 0; i < commands.size(); i++) {
+    latencyTracker.record(commands[i], stage, duration);
+  }
+}
+
 void RequestCounter::fillHistorical(std::vector<std::string> &headers,
   std::vector<std::vector<std::string>> &data) {
 
@@ -106,5 +122,8 @@ void RequestCounter::fillHistorical(std::vector<std::string> &headers,
   headers.emplace_back("TOTALS");
   data.emplace_back(aggregator.getOverallStats().serialize());
 
+  headers.emplace_back("LATENCIES");
+  data.emplace_back(latencyTracker.describe());
+
   historical.serialize(headers, data);
 }
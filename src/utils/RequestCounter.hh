@@ -26,6 +26,7 @@
 
 #include "utils/AssistedThread.hh"
 #include "utils/Statistics.hh"
+#include "utils/LatencyTracker.hh"
 #include <atomic>
 
 namespace quarkdb {
@@ -54,6 +55,18 @@ public:
   void fillHistorical(std::vector<std::string> &headers,
     std::vector<std::vector<std::string>> &data);
 
+  //----------------------------------------------------------------------------
+  // Per-command latency histograms
+  //----------------------------------------------------------------------------
+  LatencyTracker& getLatencyTracker() {
+    return latencyTracker;
+  }
+
+  void recordLatency(const Transaction &transaction, LatencyStage stage,
+    std::chrono::steady_clock::duration duration);
+  void recordLatency(const std::vector<RedisCommand> &commands, LatencyStage stage,
+    std::chrono::steady_clock::duration duration);
+
 private:
   void account(const RedisRequest &req, Statistics *stats);
 
@@ -65,6 +78,7 @@ private:
 
   std::chrono::seconds interval;
   HistoricalStatistics historical;
+  LatencyTracker latencyTracker;
   AssistedThread thread;
 };
 
@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------------
+// File: formatter.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "Formatter.hh"
+#include "redis/ArrayResponseBuilder.hh"
+#include "../test-utils.hh"
+#include "bench-utils.hh"
+#include <gtest/gtest.h>
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// Measure how many replies per second Formatter can encode. Small replies,
+// such as integers and short bulk strings, make up the bulk of what a busy
+// leader sends out, so per-reply overhead matters more than raw bandwidth.
+//------------------------------------------------------------------------------
+class formatter : public ::testing::TestWithParam<int64_t> {
+public:
+  template<typename F>
+  void run(const std::string &description, F encode) {
+    const int64_t events = GetParam();
+
+    qdb_info("Starting benchmark: encoding " << events << " replies, " << description);
+    Stopwatch stopwatch(events);
+
+    size_t totalBytes = 0;
+    for(int64_t i = 0; i < events; i++) {
+      totalBytes += encode(i).val.size();
+    }
+
+    stopwatch.stop();
+    ASSERT_GT(totalBytes, 0u);
+    qdb_info("Benchmark has ended. Rate: " << stopwatch.rate() << " Hz");
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(Benchmark,
+                        formatter,
+                        ::testing::ValuesIn(testconfig.benchmarkEvents.get()),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(formatter, integer) {
+  run("integer", [](int64_t i) {
+    return Formatter::integer(i);
+  });
+}
+
+TEST_P(formatter, string) {
+  std::string value = "some_contents";
+
+  run("short bulk string", [&value](int64_t i) {
+    return Formatter::string(value);
+  });
+}
+
+TEST_P(formatter, status_vector) {
+  std::vector<std::string> vec;
+  for(size_t i = 0; i < 10; i++) {
+    vec.emplace_back(SSTR("LINE-" << i << " some status"));
+  }
+
+  run("status vector of 10 elements", [&vec](int64_t i) {
+    return Formatter::statusVector(vec);
+  });
+}
+
+TEST_P(formatter, array_response_builder) {
+  run("hgetall of 10 fields", [](int64_t i) {
+    ArrayResponseBuilder builder;
+    for(size_t j = 0; j < 10; j++) {
+      builder.emplace_back("field");
+      builder.emplace_back("value");
+    }
+    return builder.buildResponse();
+  });
+}
+
+TEST_P(formatter, multiply) {
+  RedisEncodedResponse moved = Formatter::moved(0, RaftServer("example.com", 7777));
+
+  run("MOVED repeated for a transaction of 10", [&moved](int64_t i) {
+    return Formatter::multiply(moved, 10);
+  });
+}
@@ -159,7 +159,7 @@ public:
   void run(Executor &executor, size_t nthreads) {
     qdb_info("Starting benchmark: " << executor.describe());
     float rate = measureRate(executor, nthreads);
-    qdb_info("Benchmark has ended. Rate: " << rate << " Hz");
+    qdb_info("Benchmark has ended. Rate: " << rate << " Hz, " << rate / nthreads << " Hz per thread with " << nthreads << " threads");
   }
 };
 
@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------
+// File: network.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "netio/AsioPoller.hh"
+#include "Dispatcher.hh"
+#include "../test-utils.hh"
+#include "bench-utils.hh"
+#include <gtest/gtest.h>
+#include <qclient/QClient.hh>
+
+using namespace quarkdb;
+
+struct NetworkBenchmarkParams {
+  int nthreads;
+  int events;
+  PollerMode mode;
+
+  NetworkBenchmarkParams(int threads, int ev, PollerMode m) : nthreads(threads), events(ev), mode(m) {}
+  operator std::string() const {
+    return SSTR("threads" << nthreads << "_events" << events << "_" << pollerModeToString(mode));
+  }
+};
+
+//------------------------------------------------------------------------------
+// Measure request throughput through the poller alone: Many connections, each
+// issuing pipelined PINGs, which never touch the state machine. Compare the
+// shared and sharded poller modes with --benchmark-threads 1,16,64.
+//------------------------------------------------------------------------------
+class network : public TestCluster3Nodes, public ::testing::TestWithParam<NetworkBenchmarkParams> {
+public:
+  void clientThread(int64_t events) {
+    const int64_t pipeline = 256;
+    qclient::QClient tunnel("localhost", port, {} );
+
+    for(int64_t i = 0; i < events; i += pipeline) {
+      std::vector<std::future<qclient::redisReplyPtr>> replies;
+      for(int64_t j = i; j < std::min(events, i + pipeline); j++) {
+        replies.emplace_back(tunnel.exec("PING"));
+      }
+
+      for(size_t j = 0; j < replies.size(); j++) {
+        ASSERT_NE(replies[j].get(), nullptr);
+      }
+    }
+  }
+
+protected:
+  int port = 34568;
+};
+
+static std::vector<NetworkBenchmarkParams> generateParams() {
+  std::vector<NetworkBenchmarkParams> ret;
+
+  for(size_t threads : testconfig.benchmarkThreads.get() ) {
+    for(size_t events : testconfig.benchmarkEvents.get() ) {
+      for(PollerMode mode : {PollerMode::kShared, PollerMode::kSharded}) {
+        ret.emplace_back(threads, events, mode);
+      }
+    }
+  }
+  return ret;
+}
+
+struct NetworkBenchmarkParamsPrinter {
+  template <class T>
+  std::string operator()(const T& info) const {
+    return info.param;
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(Benchmark,
+                        network,
+                        ::testing::ValuesIn(generateParams()),
+                        NetworkBenchmarkParamsPrinter());
+
+TEST_P(network, ping) {
+  const NetworkBenchmarkParams params = GetParam();
+
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  AsioPoller poller(port, 10, &dispatcher, params.mode);
+
+  qdb_info("Starting benchmark: " << std::string(params));
+  Stopwatch stopwatch(params.events);
+
+  std::vector<std::thread> threads;
+  for(int i = 0; i < params.nthreads; i++) {
+    int64_t events = params.events / params.nthreads + (i < params.events % params.nthreads);
+    threads.emplace_back(&network::clientThread, this, events);
+  }
+
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  stopwatch.stop();
+  qdb_info("Benchmark has ended. Rate: " << stopwatch.rate() << " Hz with " << params.nthreads << " connections");
+
+  std::vector<PollerShardStats> stats = poller.getStats();
+  for(size_t i = 0; i < stats.size(); i++) {
+    qdb_info("Poller shard: " << stats[i].toString());
+  }
+}
@@ -0,0 +1,110 @@
+// ----------------------------------------------------------------------
+// File: pattern-matching.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+
+#include "pubsub/SimplePatternMatcher.hh"
+#include "../test-utils.hh"
+#include "bench-utils.hh"
+#include <gtest/gtest.h>
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// Measure publish fan-out throughput against the number of registered
+// patterns: how many channels per second we can resolve to the set of
+// matching pattern subscribers. Patterns look like the ones FST monitoring
+// agents subscribe to, one per node, plus a couple of catch-alls.
+//
+// The "linear" variant evaluates every pattern against every channel, which
+// is what publishing used to cost before patterns were indexed by prefix.
+//------------------------------------------------------------------------------
+class pattern_matching : public ::testing::TestWithParam<int64_t> {
+public:
+  static constexpr int64_t kPublishes = 100000;
+
+  void SetUp() override {
+    for(int64_t i = 0; i < GetParam(); i++) {
+      patterns.emplace_back(SSTR("__vhash@/eos/fst" << i << "/*"));
+    }
+
+    patterns.emplace_back("__vhash@*");
+    patterns.emplace_back("*status");
+
+    for(size_t i = 0; i < patterns.size(); i++) {
+      ASSERT_TRUE(matcher.insert(patterns[i], i));
+    }
+
+    for(int64_t i = 0; i < 1000; i++) {
+      channels.emplace_back(SSTR("__vhash@/eos/fst" << (i % GetParam()) << "/status"));
+    }
+  }
+
+  template<typename Lookup>
+  void run(const std::string &description, const Lookup &lookup) {
+    qdb_info("Starting benchmark: " << description << ", " << patterns.size() << " patterns, " << kPublishes << " publishes");
+    Stopwatch stopwatch(kPublishes);
+
+    int64_t hits = 0;
+    for(int64_t i = 0; i < kPublishes; i++) {
+      hits += lookup(channels[i % channels.size()]);
+    }
+
+    stopwatch.stop();
+    ASSERT_EQ(hits, kPublishes * 3);
+    qdb_info("Benchmark has ended. Rate: " << stopwatch.rate() << " Hz");
+  }
+
+protected:
+  std::vector<std::string> patterns;
+  std::vector<std::string> channels;
+  SimplePatternMatcher<int64_t> matcher;
+};
+
+INSTANTIATE_TEST_CASE_P(Benchmark,
+                        pattern_matching,
+                        ::testing::Values(10, 100, 1000, 10000),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(pattern_matching, trie) {
+  run("trie lookup", [&](const std::string &channel) {
+    int64_t hits = 0;
+    for(auto it = matcher.find(channel); it.valid(); it.next()) {
+      hits++;
+    }
+
+    return hits;
+  });
+}
+
+TEST_P(pattern_matching, linear) {
+  run("linear scan", [&](const std::string &channel) {
+    int64_t hits = 0;
+    for(const std::string &pattern : patterns) {
+      if(stringmatchlen(pattern.data(), pattern.size(), channel.data(), channel.size(), 0) == 1) {
+        hits++;
+      }
+    }
+
+    return hits;
+  });
+}
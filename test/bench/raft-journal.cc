@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------
+// File: raft-journal.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "raft/RaftJournal.hh"
+#include "../test-utils.hh"
+#include "bench-utils.hh"
+#include <gtest/gtest.h>
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// Measure journal append throughput, followed by the cost of trimming the
+// journal back down in batches of the default trimming size. Run with a large
+// event count to get a realistic picture, ie --benchmark-events 100000000.
+//------------------------------------------------------------------------------
+class raft_journal : public ::testing::TestWithParam<int64_t> {
+public:
+  void SetUp() override {
+    std::vector<RaftServer> nodes = { {"server1", 7776}, {"server2", 7777}, {"server3", 7778} };
+    RaftJournal::ObliterateAndReinitializeJournal(dbpath, "bench-cluster-id", nodes, 0, FsyncPolicy::kAsync);
+  }
+
+  void TearDown() override {
+    ASSERT_EQ(system(SSTR("rm -rf " << dbpath).c_str()), 0);
+  }
+
+protected:
+  std::string dbpath = "/tmp/quarkdb-bench-raft-journal";
+};
+
+INSTANTIATE_TEST_CASE_P(Benchmark,
+                        raft_journal,
+                        ::testing::ValuesIn(testconfig.benchmarkEvents.get()),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(raft_journal, append_and_trim) {
+  const int64_t events = GetParam();
+  const int64_t trimBatch = 200000;
+
+  RaftJournal journal(dbpath);
+  ASSERT_TRUE(journal.setCurrentTerm(1, RaftServer()));
+
+  qdb_info("Starting benchmark: appending " << events << " journal entries");
+  Stopwatch appendStopwatch(events);
+
+  for(int64_t i = 1; i <= events; i++) {
+    ASSERT_TRUE(journal.append(i, RaftEntry(1, "HSET", SSTR("key-" << i), "field", "some_contents")));
+  }
+
+  appendStopwatch.stop();
+  qdb_info("Appends have ended. Rate: " << appendStopwatch.rate() << " Hz");
+
+  journal.setCommitIndex(events);
+
+  int64_t trims = (events + trimBatch - 1) / trimBatch;
+  qdb_info("Trimming the journal in " << trims << " batches of " << trimBatch << " entries");
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration slowest {0};
+
+  for(LogIndex newLogStart = trimBatch; newLogStart <= events; newLogStart += trimBatch) {
+    std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+    journal.trimUntil(newLogStart);
+    slowest = std::max(slowest, std::chrono::steady_clock::now() - before);
+  }
+
+  auto total = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  qdb_info("Trimming has ended. Total: " << total.count() << " ms, slowest batch: " <<
+    std::chrono::duration_cast<std::chrono::milliseconds>(slowest).count() << " ms");
+
+  RaftEntry entry;
+  ASSERT_TRUE(journal.fetch(events, entry).ok());
+}
@@ -0,0 +1,98 @@
+// ----------------------------------------------------------------------
+// File: redis-parser.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "RedisParser.hh"
+#include "Formatter.hh"
+#include "../test-utils.hh"
+#include "bench-utils.hh"
+#include <gtest/gtest.h>
+
+using namespace quarkdb;
+
+//------------------------------------------------------------------------------
+// Measure how many requests per second RedisParser can get through, for
+// pipelined requests made up of many small arguments - the kind of load where
+// parsing of "*N\r\n" and "$N\r\n" headers dominates.
+//------------------------------------------------------------------------------
+class redis_parser : public ::testing::TestWithParam<int64_t> {
+public:
+  static std::string encode(const RedisRequest &req) {
+    std::ostringstream ss;
+    ss << "*" << req.size() << "\r\n";
+    for(size_t i = 0; i < req.size(); i++) {
+      ss << "$" << req[i].size() << "\r\n" << req[i] << "\r\n";
+    }
+
+    return ss.str();
+  }
+
+  void run(const RedisRequest &req) {
+    const size_t batchSize = 1000;
+    const int64_t events = GetParam();
+
+    std::string encoded = encode(req);
+    std::string batch;
+    for(size_t i = 0; i < batchSize; i++) {
+      batch += encoded;
+    }
+
+    Link link;
+    RedisParser parser(&link);
+    RedisRequest parsed;
+
+    qdb_info("Starting benchmark: parsing " << events << " requests, " << encoded.size() << " bytes each");
+    Stopwatch stopwatch(events);
+
+    int64_t parsedRequests = 0;
+    while(parsedRequests < events) {
+      link.Send(batch);
+
+      while(parser.fetch(parsed, true) == 1) {
+        parsedRequests++;
+      }
+    }
+
+    stopwatch.stop();
+    ASSERT_EQ(parsed, req);
+    qdb_info("Benchmark has ended. Rate: " << stopwatch.rate() << " Hz");
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(Benchmark,
+                        redis_parser,
+                        ::testing::ValuesIn(testconfig.benchmarkEvents.get()),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(redis_parser, hmset_many_fields) {
+  RedisRequest req = {"HMSET", "some-hash"};
+  for(size_t i = 0; i < 100; i++) {
+    req.push_back(SSTR("field-" << i));
+    req.push_back(SSTR("value-" << i));
+  }
+
+  run(req);
+}
+
+TEST_P(redis_parser, hget) {
+  run(RedisRequest {"HGET", "some-hash", "field-1"});
+}
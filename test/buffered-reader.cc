@@ -123,3 +123,48 @@ TEST_P(Buffered_Reader, IntoPinnedBuffers) {
   ASSERT_EQ(link.Close(), 0);
   ASSERT_LT(reader->consume(1, buff), 0);
 }
+
+TEST_P(Buffered_Reader, LinesInPlace) {
+  std::string_view line;
+  std::string buffer;
+
+  ASSERT_EQ(reader->consumeLineInPlace(line), 0);
+  ASSERT_EQ(link.Send("*3\r\n$12\r\n"), 9);
+
+  LinkStatus rlen = reader->consumeLineInPlace(line);
+  if(GetParam() >= 100) {
+    ASSERT_EQ(rlen, 4);
+  }
+
+  if(rlen > 0) {
+    ASSERT_EQ(rlen, 4);
+    ASSERT_EQ(line, "*3\r\n");
+  }
+  else {
+    // straddles a buffer boundary, fall back to consume()
+    ASSERT_EQ(rlen, 0);
+    ASSERT_EQ(reader->consume(4, buffer), 4);
+    ASSERT_EQ(buffer, "*3\r\n");
+  }
+
+  rlen = reader->consumeLineInPlace(line);
+  if(GetParam() >= 100) {
+    ASSERT_EQ(rlen, 5);
+  }
+
+  if(rlen > 0) {
+    ASSERT_EQ(rlen, 5);
+    ASSERT_EQ(line, "$12\r\n");
+  }
+  else {
+    ASSERT_EQ(rlen, 0);
+    ASSERT_EQ(reader->consume(5, buffer), 5);
+    ASSERT_EQ(buffer, "$12\r\n");
+  }
+
+  // Incomplete line, nothing is consumed
+  ASSERT_EQ(link.Send("$4"), 2);
+  ASSERT_EQ(reader->consumeLineInPlace(line), 0);
+  ASSERT_EQ(reader->consume(2, buffer), 2);
+  ASSERT_EQ(buffer, "$4");
+}
@@ -320,3 +320,111 @@ TEST(Configuration, T10) {
 
   ASSERT_FALSE(Configuration::fromString(c, config));
 }
+
+TEST(Configuration, ReversedKeyIndex) {
+  Configuration config;
+  std::string c;
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "fi\n";
+
+  ASSERT_TRUE(Configuration::fromString(c, config));
+  ASSERT_FALSE(config.getReversedKeyIndex());
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.reversed_key_index true\n"
+      "fi\n";
+
+  ASSERT_TRUE(Configuration::fromString(c, config));
+  ASSERT_TRUE(config.getReversedKeyIndex());
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.reversed_key_index maybe\n"
+      "fi\n";
+
+  ASSERT_FALSE(Configuration::fromString(c, config));
+}
+
+TEST(Configuration, NetworkSharding) {
+  Configuration config;
+  std::string c;
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "fi\n";
+
+  ASSERT_TRUE(Configuration::fromString(c, config));
+  ASSERT_FALSE(config.getNetworkSharding());
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.network_sharding true\n"
+      "fi\n";
+
+  ASSERT_TRUE(Configuration::fromString(c, config));
+  ASSERT_TRUE(config.getNetworkSharding());
+}
+
+TEST(Configuration, OutputBufferLimits) {
+  Configuration config;
+  std::string c;
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.client_output_buffer_limit pubsub 64mb 16mb 30 coalesce\n"
+      "redis.client_output_buffer_limit monitor 1024 0 0 disconnect\n"
+      "fi\n";
+
+  ASSERT_TRUE(Configuration::fromString(c, config));
+  ASSERT_EQ(config.getOutputBufferLimits().size(), 2u);
+
+  ASSERT_EQ(config.getOutputBufferLimits()[0].first, ClientClass::kPubSub);
+  ASSERT_EQ(config.getOutputBufferLimits()[0].second.hardLimit, 64u * 1024 * 1024);
+  ASSERT_EQ(config.getOutputBufferLimits()[0].second.softLimit, 16u * 1024 * 1024);
+  ASSERT_EQ(config.getOutputBufferLimits()[0].second.softSeconds, std::chrono::seconds(30));
+  ASSERT_EQ(config.getOutputBufferLimits()[0].second.policy, SlowConsumerPolicy::kCoalesce);
+  ASSERT_EQ(config.getOutputBufferLimits()[0].second.toString(), "67108864 16777216 30 coalesce");
+
+  ASSERT_EQ(config.getOutputBufferLimits()[1].first, ClientClass::kMonitor);
+  ASSERT_EQ(config.getOutputBufferLimits()[1].second.toString(), "1024 0 0 disconnect");
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.client_output_buffer_limit pubsub 64mb 16mb 30 shrug\n"
+      "fi\n";
+
+  ASSERT_FALSE(Configuration::fromString(c, config));
+
+  c = "if exec xrootd\n"
+      "xrd.protocol redis:7776 libXrdQuarkDB.so\n"
+      "redis.mode standalone\n"
+      "redis.database /home/user/mydb\n"
+      "redis.client_output_buffer_limit replica 64mb 16mb 30 disconnect\n"
+      "fi\n";
+
+  ASSERT_FALSE(Configuration::fromString(c, config));
+
+  OutputBufferLimit limit;
+  ASSERT_TRUE(OutputBufferLimit::parse({"1gb", "512KB", "0", "drop-oldest"}, limit));
+  ASSERT_EQ(limit.toString(), "1073741824 524288 0 drop-oldest");
+  ASSERT_FALSE(OutputBufferLimit::parse({"1gb", "512KB", "0"}, limit));
+  ASSERT_FALSE(OutputBufferLimit::parse({"-1", "512KB", "0", "disconnect"}, limit));
+  ASSERT_FALSE(OutputBufferLimit::parse({"1tb", "512KB", "0", "disconnect"}, limit));
+}
@@ -25,6 +25,7 @@
 #include "RedisParser.hh"
 #include "StateMachine.hh"
 #include "Dispatcher.hh"
+#include "utils/InFlightTracker.hh"
 #include "test-utils.hh"
 #include <gtest/gtest.h>
 
@@ -81,3 +82,80 @@ TEST_F(tConnection, basic_sanity) {
 
   ASSERT_THROW(conn.addPendingTransaction(&dispatcher, Transaction({"set", "asdf", "qwerty"}), 1), FatalException);
 }
+
+TEST_F(tConnection, SlowConsumerPolicies) {
+  const int BUFFER_SIZE = 1024 * 16;
+  char buffer[BUFFER_SIZE];
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  OutputBufferLimit oldLimit = OutputBufferLimits::get(ClientClass::kPubSub);
+
+  Link link;
+  Connection conn(&link);
+  conn.setResponseBuffering(false);
+
+  std::shared_ptr<PendingQueue> queue = conn.getQueue();
+  ASSERT_EQ(queue->getOutputBufferInfo().clientClass, ClientClass::kNormal);
+  queue->subscribe("ch1");
+  queue->subscribe("ch2");
+  ASSERT_EQ(queue->getOutputBufferInfo().clientClass, ClientClass::kPubSub);
+
+  // Not blocked, goes straight out
+  EncodedMessage msg1("ch1", "aaaa");
+  ASSERT_TRUE(queue->addMessageIfAttached("ch1", msg1));
+  int len = link.Recv(buffer, BUFFER_SIZE, 0);
+  ASSERT_EQ(std::string(buffer, len), msg1.get(false).view());
+  ASSERT_EQ(queue->getOutputBufferInfo().heldBytes, 0u);
+
+  // Blocked behind a write, messages are held
+  const size_t messageSize = msg1.get(false).view().size();
+  OutputBufferLimits::set(ClientClass::kPubSub, {messageSize * 3, 0, std::chrono::seconds(0), SlowConsumerPolicy::kCoalesce});
+  conn.addPendingTransaction(&dispatcher, Transaction({"set", "abc", "qwerty"}), 1);
+
+  EncodedMessage msg2("ch1", "bbbb");
+  EncodedMessage msg3("ch2", "cccc");
+  EncodedMessage msg4("ch1", "dddd");
+  EncodedMessage msg5("ch2", "eeee");
+  ASSERT_TRUE(queue->addMessageIfAttached("ch1", msg2));
+  ASSERT_TRUE(queue->addMessageIfAttached("ch2", msg3));
+  ASSERT_TRUE(queue->addMessageIfAttached("ch1", msg4));
+  ASSERT_EQ(queue->getOutputBufferInfo().heldBytes, messageSize * 3);
+
+  // Over the hard limit, msg3 is superseded by msg5
+  ASSERT_TRUE(queue->addMessageIfAttached("ch2", msg5));
+  OutputBufferInfo info = queue->getOutputBufferInfo();
+  ASSERT_EQ(info.heldBytes, messageSize * 3);
+  ASSERT_EQ(info.peakBytes, messageSize * 3);
+  ASSERT_EQ(info.coalescedMessages, 1);
+  ASSERT_EQ(info.droppedMessages, 0);
+
+  // Drop-oldest, msg2 goes
+  EncodedMessage msg6("ch1", "ffff");
+  OutputBufferLimits::set(ClientClass::kPubSub, {messageSize * 3, 0, std::chrono::seconds(0), SlowConsumerPolicy::kDropOldest});
+  ASSERT_TRUE(queue->addMessageIfAttached("ch1", msg6));
+  info = queue->getOutputBufferInfo();
+  ASSERT_EQ(info.heldBytes, messageSize * 3);
+  ASSERT_EQ(info.droppedMessages, 1);
+
+  ASSERT_EQ(conn.dispatchPending(&dispatcher, 1), -1);
+  len = link.Recv(buffer, BUFFER_SIZE, 0);
+  ASSERT_EQ(std::string(buffer, len), SSTR("+OK\r\n" << msg4.get(false).view() << msg5.get(false).view() << msg6.get(false).view()));
+  ASSERT_EQ(queue->getOutputBufferInfo().heldBytes, 0u);
+
+  // Disconnect
+  OutputBufferLimits::set(ClientClass::kPubSub, {messageSize, 0, std::chrono::seconds(0), SlowConsumerPolicy::kDisconnect});
+  conn.addPendingTransaction(&dispatcher, Transaction({"set", "abc", "qwerty"}), 2);
+  ASSERT_TRUE(queue->addMessageIfAttached("ch1", msg1));
+  ASSERT_FALSE(queue->addMessageIfAttached("ch1", msg2));
+  ASSERT_FALSE(queue->addMessageIfAttached("ch1", msg4));
+  ASSERT_EQ(queue->getOutputBufferInfo().heldBytes, 0u);
+
+  // The link is left alone, but is reported as broken on its next wakeup
+  InFlightTracker tracker;
+  ASSERT_LT(conn.processRequests(&dispatcher, tracker), 0);
+
+  // The write is still applied, even though the link is gone
+  ASSERT_EQ(conn.dispatchPending(&dispatcher, 2), -1);
+  ASSERT_EQ(stateMachine()->getLastApplied(), 2);
+
+  OutputBufferLimits::set(ClientClass::kPubSub, oldLimit);
+}
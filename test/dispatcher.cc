@@ -25,6 +25,7 @@
 #include "BufferedReader.hh"
 #include "StateMachine.hh"
 #include "pubsub/Publisher.hh"
+#include "redis/Transaction.hh"
 #include <gtest/gtest.h>
 
 using namespace quarkdb;
@@ -156,3 +157,38 @@ TEST_F(Dispatcher_, T1) {
   assert_reply( {"sscan", "asdf", "0"}, "*2\r\n$1\r\n0\r\n*0\r\n");
 
 }
+
+TEST(RedisDispatcher, LockSet) {
+  KeyLockSet locks = RedisDispatcher::getLockSet(RedisRequest{"hset", "key", "f", "v"});
+  ASSERT_FALSE(locks.isGlobal());
+  ASSERT_EQ(locks.getStripes(), std::vector<size_t>{KeyLockTable::getStripe("key")});
+
+  locks = RedisDispatcher::getLockSet(RedisRequest{"del", "key", "key", "key"});
+  ASSERT_EQ(locks.getStripes(), std::vector<size_t>{KeyLockTable::getStripe("key")});
+
+  locks = RedisDispatcher::getLockSet(RedisRequest{"unlink", "key"});
+  ASSERT_EQ(locks.getStripes(), std::vector<size_t>{KeyLockTable::getStripe("key")});
+  ASSERT_TRUE(RedisDispatcher::getLockSet(RedisRequest{"lazyfree_reclaim", "1000"}).isGlobal());
+
+  locks = RedisDispatcher::getLockSet(RedisRequest{"smove", "src", "dst", "item"});
+  ASSERT_FALSE(locks.isGlobal());
+  ASSERT_LE(locks.getStripes().size(), 2u);
+
+  ASSERT_TRUE(RedisDispatcher::getLockSet(RedisRequest{"flushall"}).isGlobal());
+  ASSERT_TRUE(RedisDispatcher::getLockSet(RedisRequest{"config_set", "a", "b"}).isGlobal());
+  ASSERT_TRUE(RedisDispatcher::getLockSet(RedisRequest{"timestamped_lease_get", "a", "1"}).isGlobal());
+  ASSERT_TRUE(RedisDispatcher::getLockSet(RedisRequest{"hset"}).isGlobal());
+
+  // Pipelined requests: Only lock the keys being written
+  Transaction tx;
+  tx.emplace_back("get", "aaa");
+  tx.emplace_back("set", "bbb", "ccc");
+  tx.setPhantom(true);
+
+  locks = RedisDispatcher::getLockSet(tx);
+  ASSERT_EQ(locks.getStripes(), std::vector<size_t>{KeyLockTable::getStripe("bbb")});
+
+  // Real MULTI / EXEC: Lock everything
+  tx.setPhantom(false);
+  ASSERT_TRUE(RedisDispatcher::getLockSet(tx).isGlobal());
+}
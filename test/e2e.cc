@@ -1095,6 +1095,35 @@ TEST_F(Raft_e2e, leader_steps_down_after_follower_loss) {
   ASSERT_TRUE(state(leaderID)->getSnapshot()->leader.empty());
 }
 
+TEST_F(Raft_e2e, lease_reads) {
+  spinup(0); spinup(1);
+  RETRY_ASSERT_TRUE(checkStateConsensus(0, 1));
+
+  int leaderID = getLeaderID();
+  ASSERT_GE(leaderID, 0);
+  ASSERT_LE(leaderID, 1);
+  int followerID = (leaderID + 1) % 2;
+
+  // Reads pipelined right behind writes on the same connection must observe them
+  std::vector<std::future<redisReplyPtr>> replies;
+  for(size_t i = 0; i < 10; i++) {
+    replies.emplace_back(tunnel(leaderID)->exec("set", "abc", SSTR(i)));
+    replies.emplace_back(tunnel(leaderID)->exec("get", "abc"));
+  }
+
+  for(size_t i = 0; i < 10; i++) {
+    ASSERT_REPLY(replies[2*i], "OK");
+    ASSERT_REPLY(replies[2*i+1], SSTR(i));
+  }
+
+  // Read-only connection
+  ASSERT_REPLY(tunnel(leaderID)->exec("get", "abc"), "9");
+
+  // Lose the quorum: The leader must stop serving reads
+  spindown(followerID);
+  RETRY_ASSERT_TRUE(qclient::describeRedisReply(tunnel(leaderID)->exec("get", "abc").get()) == "(error) ERR unavailable");
+}
+
 TEST_F(Raft_e2e, stale_reads) {
   spinup(0); spinup(1); spinup(2);
   RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
@@ -1114,6 +1143,29 @@ TEST_F(Raft_e2e, stale_reads) {
   ASSERT_REPLY(tunnel(follower)->exec("get", "abc"), "1234");
 }
 
+TEST_F(Raft_e2e, follower_reads) {
+  spinup(0); spinup(1); spinup(2);
+  RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
+
+  int leaderID = getLeaderID();
+  int follower = (getLeaderID() + 1) % 3;
+
+  // RAFT_READ_INDEX is for internal use only
+  ASSERT_ERR(tunnel(leaderID)->exec("raft-read-index"), "ERR not authorized to issue raft commands");
+
+  ASSERT_REPLY(tunnel(follower)->exec("activate-follower-reads"), "OK");
+
+  // Every read on the follower must observe the write acknowledged right
+  // before it
+  for(size_t i = 0; i < 100; i++) {
+    ASSERT_REPLY(tunnel(leaderID)->exec("set", "abc", SSTR(i)), "OK");
+    ASSERT_REPLY(tunnel(follower)->exec("get", "abc"), SSTR(i));
+  }
+
+  // Writes are still redirected
+  ASSERT_REPLY(tunnel(follower)->exec("set", "abc", "123"), SSTR("MOVED 0 " << myself(leaderID).toString()));
+}
+
 TEST_F(Raft_e2e, monitor) {
   spinup(0); spinup(1); spinup(2);
   RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
@@ -1243,6 +1295,42 @@ TEST_F(Raft_e2e, hincrbymulti) {
   ASSERT_REPLY(tunnel(leaderID)->exec("hget", "h4", "h8"), "13");
 }
 
+TEST_F(Raft_e2e, UnlinkReclamation) {
+  spinup(0); spinup(1); spinup(2);
+  RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
+
+  int leaderID = getLeaderID();
+
+  std::vector<std::future<redisReplyPtr>> replies;
+  for(size_t i = 0; i < 3000; i++) {
+    replies.emplace_back(tunnel(leaderID)->exec("sadd", "myset", SSTR("item-" << i)));
+  }
+
+  for(size_t i = 0; i < replies.size(); i++) {
+    ASSERT_REPLY(replies[i], 1);
+  }
+
+  ASSERT_REPLY(tunnel(leaderID)->exec("unlink", "myset", "not-existing"), 1);
+  ASSERT_REPLY(tunnel(leaderID)->exec("scard", "myset"), 0);
+  ASSERT_REPLY(tunnel(leaderID)->exec("exists", "myset"), 0);
+
+  // Clients may not issue reclamation batches themselves
+  ASSERT_REPLY(tunnel(leaderID)->exec("lazyfree_reclaim", "1000"), "ERR unknown command 'lazyfree_reclaim'");
+
+  // The leader reclaims the elements in the background, through the journal
+  RETRY_ASSERT_EQ(stateMachine(leaderID)->getReclamationStats().pendingPrefixes, 0);
+  RETRY_ASSERT_TRUE(checkFullConsensus(0, 1, 2));
+
+  for(int i = 0; i < 3; i++) {
+    ReclamationStats stats = stateMachine(i)->getReclamationStats();
+    ASSERT_EQ(stats.pendingPrefixes, 0);
+    ASSERT_EQ(stats.pendingElements, 0);
+  }
+
+  ASSERT_REPLY(tunnel(leaderID)->exec("sadd", "myset", "item-1"), 1);
+  ASSERT_REPLY(tunnel(leaderID)->exec("scard", "myset"), 1);
+}
+
 TEST_F(Raft_e2e, smove) {
   spinup(0); spinup(1); spinup(2);
   RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
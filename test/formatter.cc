@@ -23,6 +23,8 @@
 
 #include "Formatter.hh"
 #include "redis/ArrayResponseBuilder.hh"
+#include "redis/RespEncoder.hh"
+#include "pubsub/EncodedMessage.hh"
 #include "qclient/ResponseBuilder.hh"
 #include "qclient/QClient.hh"
 #include <gtest/gtest.h>
@@ -56,6 +58,101 @@ TEST(ArrayResponseBuilder, BasicSanity) {
   ASSERT_EQ(resp.val, "*3\r\n+OK\r\n:999\r\n$4\r\nwhee\r\n");
 }
 
+TEST(ArrayResponseBuilder, Streaming) {
+  std::vector<std::string> vec = { "abc", "", "123456789012" };
+
+  ArrayResponseBuilder builder;
+  ASSERT_EQ(builder.buildResponse().release(), "*0\r\n");
+
+  for(size_t i = 0; i < vec.size(); i++) {
+    builder.emplace_back(vec[i]);
+  }
+
+  ASSERT_EQ(builder.size(), 3u);
+  RedisEncodedResponse resp = builder.buildResponse();
+  ASSERT_EQ(resp.header, "*3\r\n");
+  ASSERT_EQ(resp, Formatter::vector(vec));
+  ASSERT_EQ(builder.size(), 0u);
+
+  ArrayResponseBuilder outer(2);
+  outer.push_back(resp);
+  outer.push_back(Formatter::integer(5));
+  ASSERT_EQ(outer.buildResponse().val, "*2\r\n*3\r\n$3\r\nabc\r\n$0\r\n\r\n$12\r\n123456789012\r\n:5\r\n");
+  ASSERT_EQ(resp.release(), Formatter::vector(vec).val);
+
+  builder.emplace_back("discarded");
+  builder.clear();
+
+  for(size_t i = 0; i < vec.size(); i++) {
+    builder.emplace_back(vec[i]);
+  }
+
+  ASSERT_EQ(builder.buildScanResponse("next:abc"), Formatter::scan("next:abc", vec));
+
+  for(size_t i = 0; i < vec.size(); i++) {
+    builder.emplace_back(vec[i]);
+  }
+
+  ASSERT_EQ(builder.buildVersionedResponse(17), Formatter::versionedVector(17, vec));
+  ASSERT_EQ(builder.buildScanResponse("0"), Formatter::scan("0", {}));
+
+  ArrayResponseBuilder fixed(2);
+  fixed.emplace_back("abc");
+  fixed.push_back(Formatter::integer(5));
+  ASSERT_THROW(fixed.emplace_back("abc"), FatalException);
+  ASSERT_THROW(fixed.buildScanResponse("0"), FatalException);
+  ASSERT_EQ(fixed.buildResponse().val, "*2\r\n$3\r\nabc\r\n:5\r\n");
+}
+
+TEST(RespEncoder, BasicSanity) {
+  RespEncoder encoder;
+  encoder.arrayHeader(6);
+  encoder.string("abc");
+  encoder.string("");
+  encoder.status("OK");
+  encoder.integer(-42);
+  encoder.uint64(std::numeric_limits<uint64_t>::max());
+  encoder.null();
+  ASSERT_EQ(encoder.view(), "*6\r\n$3\r\nabc\r\n$0\r\n\r\n+OK\r\n:-42\r\n:18446744073709551615\r\n$-1\r\n");
+
+  RedisEncodedResponse resp = encoder.build();
+  ASSERT_EQ(encoder.size(), 0u);
+  ASSERT_EQ(resp.val, "*6\r\n$3\r\nabc\r\n$0\r\n\r\n+OK\r\n:-42\r\n:18446744073709551615\r\n$-1\r\n");
+
+  encoder.pushHeader(1);
+  encoder.error("ERR nope");
+  ASSERT_EQ(encoder.build().val, ">1\r\n-ERR nope\r\n");
+}
+
+TEST(RespEncoder, ExactLengths) {
+  std::vector<int64_t> numbers = { 0, 1, 9, 10, 99, 100, -1, -9, -10, 123456789,
+    std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() };
+
+  for(int64_t num : numbers) {
+    RespEncoder encoder;
+    encoder.integer(num);
+    ASSERT_EQ(encoder.size(), RespEncoder::integerLength(num)) << num;
+    ASSERT_EQ(encoder.view(), SSTR(":" << num << "\r\n"));
+  }
+
+  for(uint64_t num : {0ull, 9ull, 10ull, 18446744073709551615ull}) {
+    RespEncoder encoder;
+    encoder.uint64(num);
+    ASSERT_EQ(encoder.size(), RespEncoder::uint64Length(num)) << num;
+  }
+
+  std::vector<std::string> vec = { "", "a", std::string(9, 'b'), std::string(10, 'c'), std::string(1000, 'd') };
+
+  RespEncoder encoder;
+  encoder.vector(vec);
+  ASSERT_EQ(encoder.size(), RespEncoder::vectorLength(vec));
+  ASSERT_EQ(encoder.build(), Formatter::vector(vec));
+
+  encoder.statusVector({"one", "two"});
+  ASSERT_EQ(encoder.size(), RespEncoder::statusVectorLength({"one", "two"}));
+  ASSERT_EQ(encoder.build(), Formatter::statusVector({"one", "two"}));
+}
+
 TEST(Formatter, subscribe) {
   qclient::ResponseBuilder builder;
   builder.feed(Formatter::subscribe(false, "channel-name", 3).val);
@@ -200,6 +297,31 @@ TEST(Formatter, PushPMessage) {
     "5) \"payload\"\n");
 }
 
+TEST(EncodedMessage, EncodeOncePerVariant) {
+  EncodedMessage msg("channel", "payload");
+  ASSERT_EQ(msg.getEncodings(), 0u);
+
+  SharedEncodedResponse first = msg.get(false);
+  for(size_t i = 0; i < 100; i++) {
+    ASSERT_EQ(msg.get(false).view().data(), first.view().data());
+  }
+
+  ASSERT_EQ(first.view(), Formatter::message(false, "channel", "payload").val);
+  ASSERT_EQ(msg.getEncodings(), 1u);
+
+  for(size_t i = 0; i < 100; i++) {
+    ASSERT_EQ(msg.get(true).view(), Formatter::message(true, "channel", "payload").val);
+    ASSERT_EQ(msg.get(false).view().data(), first.view().data());
+  }
+
+  ASSERT_EQ(msg.getEncodings(), 2u);
+
+  EncodedMessage pmsg("pattern", "channel", "payload");
+  ASSERT_EQ(pmsg.get(true).view(), Formatter::pmessage(true, "pattern", "channel", "payload").val);
+  ASSERT_EQ(pmsg.get(false).view(), Formatter::pmessage(false, "pattern", "channel", "payload").val);
+  ASSERT_EQ(pmsg.getEncodings(), 2u);
+}
+
 TEST(Formatter, VersionedVector) {
   qclient::ResponseBuilder builder;
   builder.feed(Formatter::versionedVector(999, {"one", "two", "three", "four" } ).val);
@@ -23,6 +23,7 @@
 
 #include "Dispatcher.hh"
 #include "redis/Transaction.hh"
+#include "storage/StagingArea.hh"
 #include "raft/RaftContactDetails.hh"
 #include "test-utils.hh"
 #include "test-reply-macros.hh"
@@ -51,6 +52,43 @@ TEST_F(Multi, Dispatching) {
   ASSERT_EQ(resp.val, "$3\r\nbbb\r\n");
 }
 
+TEST_F(Multi, GroupCommit) {
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  RedisEncodedResponse resp1, resp2, resp3;
+
+  RedisRequest req1 = {"SET", "aaa", "bbb"};
+  Transaction tx2;
+  tx2.emplace_back("GET", "aaa");
+  tx2.emplace_back("SET", "ccc", "ddd");
+  tx2.setPhantom(false);
+
+  RedisRequest vhset = {"VHSET", "vh", "f1", "v1"};
+  RedisRequest marker = {"JOURNAL_LEADERSHIP_MARKER", "1", "127.0.0.1:1234"};
+
+  {
+    StagingArea stagingArea(*stateMachine());
+    ASSERT_TRUE(dispatcher.stageIntoGroup(stagingArea, req1, resp1));
+    ASSERT_TRUE(dispatcher.stageIntoGroup(stagingArea, tx2, resp2));
+
+    // versioned hashes and journal markers must be applied on their own
+    ASSERT_FALSE(dispatcher.stageIntoGroup(stagingArea, vhset, resp3));
+    ASSERT_FALSE(dispatcher.stageIntoGroup(stagingArea, marker, resp3));
+    ASSERT_TRUE(resp3.empty());
+
+    ASSERT_THROW(dispatcher.commitGroup(stagingArea, 2, 3), FatalException);
+    dispatcher.commitGroup(stagingArea, 1, 2);
+  }
+
+  ASSERT_EQ(resp1.val, "+OK\r\n");
+  ASSERT_EQ(resp2.val, "*2\r\n$3\r\nbbb\r\n+OK\r\n");
+  ASSERT_EQ(stateMachine()->getLastApplied(), 2);
+
+  RedisRequest req = {"GET", "ccc"};
+  ASSERT_EQ(dispatcher.dispatch(req, 0).val, "$3\r\nddd\r\n");
+  ASSERT_EQ(dispatcher.dispatch(vhset, 3).val, ":1\r\n");
+  ASSERT_EQ(stateMachine()->getLastApplied(), 3);
+}
+
 TEST_F(Multi, HandlerBasicSanity) {
   spinup(0); spinup(1); spinup(2);
   RETRY_ASSERT_TRUE(checkStateConsensus(0, 1, 2));
@@ -23,7 +23,12 @@
 
 #include "Dispatcher.hh"
 #include "netio/AsioPoller.hh"
+#include "netio/HostnameCache.hh"
+#include "pubsub/Publisher.hh"
+#include "redis/OutputBufferLimits.hh"
 #include "test-utils.hh"
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <gtest/gtest.h>
 #include <qclient/QClient.hh>
 #include <qclient/ReconnectionListener.hh>
@@ -79,6 +84,210 @@ TEST_F(tPoller, T1) {
   ASSERT_REPLY(reply, "asdf");
 }
 
+static int connectRaw(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(fd < 0) return -1;
+
+  sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if(connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static std::string pipelinedGets(const std::string &key, size_t count) {
+  std::string batch;
+  for(size_t i = 0; i < count; i++) {
+    batch += SSTR("*2\r\n$3\r\nGET\r\n$" << key.size() << "\r\n" << key << "\r\n");
+  }
+  return batch;
+}
+
+TEST_F(tPoller, HalfClosedClientReceivesAllResponses) {
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  AsioPoller smPoller(myself().port, 3, &dispatcher);
+
+  std::string value(1024 * 1024, 'a');
+  QClient tunnel(myself().hostname, myself().port, {} );
+  redisReplyPtr reply = tunnel.exec("set", "big", value).get();
+  ASSERT_REPLY(reply, "OK");
+
+  // Pipeline a bunch of requests, and shut down our sending side right away,
+  // like "cat requests | nc" would - way more responses than fit into the
+  // socket buffers are still queued by the time the poller sees EOF.
+  const size_t count = 32;
+  int fd = connectRaw(myself().port);
+  ASSERT_GE(fd, 0);
+
+  std::string batch = pipelinedGets("big", count);
+  ASSERT_EQ(send(fd, batch.c_str(), batch.size(), 0), (ssize_t) batch.size());
+  ASSERT_EQ(shutdown(fd, SHUT_WR), 0);
+
+  // Every single response arrives, then the connection is closed
+  std::string expected = SSTR("$" << value.size() << "\r\n" << value << "\r\n");
+  std::string received;
+
+  char buff[64 * 1024];
+  while(true) {
+    ssize_t rc = recv(fd, buff, sizeof(buff), 0);
+    ASSERT_GE(rc, 0);
+    if(rc == 0) break;
+    received.append(buff, rc);
+  }
+
+  close(fd);
+  ASSERT_EQ(received.size(), expected.size() * count);
+
+  for(size_t i = 0; i < count; i++) {
+    ASSERT_TRUE(received.compare(i * expected.size(), expected.size(), expected) == 0);
+  }
+
+  RETRY_ASSERT_EQ(OutputBufferLimits::queuedBytes, 0);
+}
+
+TEST_F(tPoller, NonReadingClientDoesNotBlockPollerThread) {
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+
+  // A single poller thread - blocking it on a client would stall everyone
+  AsioPoller smPoller(myself().port, 1, &dispatcher);
+
+  QClient tunnel(myself().hostname, myself().port, {} );
+  redisReplyPtr reply = tunnel.exec("set", "big", std::string(1024 * 1024, 'a')).get();
+  ASSERT_REPLY(reply, "OK");
+
+  // A client which floods us with requests, and never reads the responses
+  int fd = connectRaw(myself().port);
+  ASSERT_GE(fd, 0);
+
+  std::string batch = pipelinedGets("big", 64);
+  ASSERT_EQ(send(fd, batch.c_str(), batch.size(), 0), (ssize_t) batch.size());
+
+  // Its responses pile up in its output queue..
+  RETRY_ASSERT_TRUE(OutputBufferLimits::queuedBytes > 0);
+
+  // .. while the one and only poller thread keeps serving everyone else
+  for(size_t i = 0; i < 100; i++) {
+    std::future<redisReplyPtr> fut = tunnel.exec("set", SSTR("key-" << i), "value");
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    reply = fut.get();
+    ASSERT_REPLY(reply, "OK");
+  }
+
+  reply = tunnel.exec("get", "key-99").get();
+  ASSERT_REPLY(reply, "value");
+
+  // Closing with unread data resets the connection - writing into it fails,
+  // and its queue goes away
+  close(fd);
+  RETRY_ASSERT_EQ(OutputBufferLimits::queuedBytes, 0);
+}
+
+//------------------------------------------------------------------------------
+// Pub/sub commands go to the publisher, everything else to the state machine.
+//------------------------------------------------------------------------------
+class PubSubDispatcher : public Dispatcher {
+public:
+  PubSubDispatcher(StateMachine &sm, Publisher &pub) : redisDispatcher(sm, pub), publisher(pub) {}
+
+  LinkStatus dispatch(Connection *conn, RedisRequest &req) override {
+    if(req.getCommandType() == CommandType::PUBSUB) return publisher.dispatch(conn, req);
+    return redisDispatcher.dispatch(conn, req);
+  }
+
+  LinkStatus dispatch(Connection *conn, Transaction &tx) override {
+    return redisDispatcher.dispatch(conn, tx);
+  }
+
+  void notifyDisconnect(Connection *conn) override {}
+
+private:
+  RedisDispatcher redisDispatcher;
+  Publisher &publisher;
+};
+
+TEST_F(tPoller, SlowSubscriberIsDisconnected) {
+  PubSubDispatcher dispatcher(*stateMachine(), *publisher());
+  AsioPoller smPoller(myself().port, 1, &dispatcher);
+
+  OutputBufferLimit oldLimit = OutputBufferLimits::get(ClientClass::kPubSub);
+  OutputBufferLimits::set(ClientClass::kPubSub, {1024 * 1024, 0, std::chrono::seconds(0), SlowConsumerPolicy::kDisconnect});
+
+  // A subscriber which never reads anything
+  int fd = connectRaw(myself().port);
+  ASSERT_GE(fd, 0);
+
+  std::string subscribe = "*2\r\n$9\r\nSUBSCRIBE\r\n$2\r\nch\r\n";
+  ASSERT_EQ(send(fd, subscribe.c_str(), subscribe.size(), 0), (ssize_t) subscribe.size());
+  RETRY_ASSERT_EQ(publisher()->publish("ch", "ping"), 1);
+
+  // Publish until it's cut off, from a thread other than the poller's
+  std::string payload(64 * 1024, 'a');
+  int64_t disconnects = OutputBufferLimits::disconnects;
+
+  for(size_t i = 0; i < 10000 && publisher()->publish("ch", payload) == 1; i++) ;
+  ASSERT_EQ(OutputBufferLimits::disconnects, disconnects + 1);
+
+  // The poller thread closes the socket on our behalf - we read whatever
+  // made it out, then see the connection go away
+  char buff[64 * 1024];
+  while(recv(fd, buff, sizeof(buff), 0) > 0) ;
+  close(fd);
+
+  RETRY_ASSERT_EQ(smPoller.getStats()[0].connections, 0);
+  RETRY_ASSERT_EQ(OutputBufferLimits::queuedBytes, 0);
+
+  // Everyone else is unaffected
+  QClient tunnel(myself().hostname, myself().port, {} );
+  redisReplyPtr reply = tunnel.exec("set", "abc", "123").get();
+  ASSERT_REPLY(reply, "OK");
+
+  OutputBufferLimits::set(ClientClass::kPubSub, oldLimit);
+}
+
+TEST_F(tPoller, Sharded) {
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  AsioPoller smPoller(myself().port, 4, &dispatcher, PollerMode::kSharded);
+
+  std::vector<std::unique_ptr<QClient>> tunnels;
+  for(size_t i = 0; i < 16; i++) {
+    tunnels.emplace_back(new QClient(myself().hostname, myself().port, {} ));
+    redisReplyPtr reply = tunnels.back()->exec("set", SSTR("key-" << i), SSTR("value-" << i)).get();
+    ASSERT_REPLY(reply, "OK");
+  }
+
+  // Every connection sees the writes of all others, regardless of shard
+  for(size_t i = 0; i < tunnels.size(); i++) {
+    redisReplyPtr reply = tunnels[i]->exec("get", SSTR("key-" << (tunnels.size() - i - 1))).get();
+    ASSERT_REPLY(reply, SSTR("value-" << (tunnels.size() - i - 1)));
+  }
+
+  std::vector<PollerShardStats> stats = smPoller.getStats();
+  ASSERT_EQ(stats.size(), 4u);
+
+  int64_t connections = 0;
+  for(size_t i = 0; i < stats.size(); i++) {
+    ASSERT_EQ(stats[i].id, i);
+    ASSERT_EQ(stats[i].threads, 1u);
+    connections += stats[i].connections;
+  }
+
+  ASSERT_EQ(connections, 16);
+  ASSERT_EQ(smPoller.describe().size(), 4u);
+
+  // Something's listening on our port already - no silent sharing of the
+  // connections through SO_REUSEPORT
+  ASSERT_THROW(AsioPoller(myself().port, 4, &dispatcher, PollerMode::kSharded), std::system_error);
+
+  tunnels.clear();
+  RETRY_ASSERT_EQ(smPoller.getStats()[0].connections + smPoller.getStats()[1].connections +
+    smPoller.getStats()[2].connections + smPoller.getStats()[3].connections, 0);
+}
 
 class ReconnectionCounter : public ReconnectionListener {
 public:
@@ -129,3 +338,64 @@ TEST_F(tPoller, test_reconnect) {
   std::cout << "Number of reconnections in total: " << listener->getEpoch() << std::endl;
   ASSERT_GE(listener->getEpoch(), 5u);
 }
+
+TEST(HostnameCache, LazyAndCached) {
+  std::atomic<int64_t> lookups {0};
+
+  HostnameCache cache(2, std::chrono::minutes(10), [&lookups](const std::string &address, std::string &hostname) {
+    lookups++;
+    if(address == "10.0.0.3") return false;
+
+    hostname = SSTR("host-" << address);
+    return true;
+  });
+
+  ASSERT_EQ(cache.resolve("10.0.0.1"), "host-10.0.0.1");
+  ASSERT_EQ(cache.resolve("10.0.0.1"), "host-10.0.0.1");
+  ASSERT_EQ(lookups, 1);
+
+  // No hostname - the address itself is cached
+  ASSERT_EQ(cache.resolve("10.0.0.3"), "10.0.0.3");
+  ASSERT_EQ(cache.resolve("10.0.0.3"), "10.0.0.3");
+  ASSERT_EQ(lookups, 2);
+
+  // Non-blocking lookups miss at first, then find the result of the
+  // background lookup
+  std::string hostname;
+  ASSERT_FALSE(cache.lookup("10.0.0.2", hostname));
+  RETRY_ASSERT_TRUE_3(cache.lookup("10.0.0.2", hostname), 1000, 10);
+  ASSERT_EQ(hostname, "host-10.0.0.2");
+  ASSERT_EQ(lookups, 3);
+
+  // Capacity is two - "10.0.0.1" was used least recently, and is gone
+  HostnameCacheStats stats = cache.getStats();
+  ASSERT_EQ(stats.size, 2u);
+  ASSERT_EQ(stats.evictions, 1);
+
+  ASSERT_TRUE(cache.lookup("10.0.0.3", hostname));
+  ASSERT_FALSE(cache.lookup("10.0.0.1", hostname));
+}
+
+TEST(HostnameCache, Expiry) {
+  std::atomic<int64_t> lookups {0};
+
+  HostnameCache cache(10, std::chrono::seconds(1), [&lookups](const std::string &address, std::string &hostname) {
+    lookups++;
+    hostname = "some-host";
+    return true;
+  });
+
+  ASSERT_EQ(cache.resolve("10.0.0.1"), "some-host");
+  ASSERT_EQ(cache.resolve("10.0.0.1"), "some-host");
+  ASSERT_EQ(lookups, 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  ASSERT_EQ(cache.resolve("10.0.0.1"), "some-host");
+  ASSERT_EQ(lookups, 2);
+}
+
+TEST(HostnameCache, ReverseLookup) {
+  std::string hostname;
+  ASSERT_FALSE(HostnameCache::reverseLookup("not-an-address", hostname));
+  ASSERT_FALSE(HostnameCache::reverseLookup("", hostname));
+}
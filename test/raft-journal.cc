@@ -22,7 +22,9 @@
  ************************************************************************/
 
 #include "raft/RaftJournal.hh"
+#include "storage/KeyConstants.hh"
 #include "test-utils.hh"
+#include <rocksdb/db.h>
 #include <gtest/gtest.h>
 
 using namespace quarkdb;
@@ -294,6 +296,182 @@ TEST_F(Raft_Journal, T1) {
 }
 }
 
+TEST_F(Raft_Journal, SerializedEntries) {
+  RaftJournal journal(dbpath);
+  ASSERT_TRUE(journal.setCurrentTerm(3, srv));
+
+  RaftEntry entry(3, "HSET", "myhash", "field", std::string(1024 * 1024, 'a'));
+  ASSERT_TRUE(journal.append(1, entry));
+
+  std::string expected;
+  for(int64_t num : {int64_t(3), int64_t(4)}) {
+    expected.append((const char*) &num, sizeof(num));
+  }
+
+  ASSERT_EQ(entry.serialize().substr(0, 16), expected);
+  ASSERT_EQ(entry.serialize().size(), entry.serializedSize());
+
+  // Too large for the recent-entries cache
+  RaftSerializedEntry serialized;
+  ASSERT_TRUE(journal.fetch(1, serialized).ok());
+  ASSERT_EQ(serialized, entry.serialize());
+  ASSERT_EQ(journal.getCacheHits(), 0);
+
+  // A term lookup which misses counts as a single miss
+  int64_t misses = journal.getCacheMisses();
+  RaftTerm fetchedTerm;
+  ASSERT_TRUE(journal.fetch(1, fetchedTerm).ok());
+  ASSERT_EQ(fetchedTerm, 3);
+  ASSERT_EQ(journal.getCacheMisses(), misses + 1);
+  ASSERT_TRUE(journal.fetch(5, fetchedTerm).IsNotFound());
+
+  RaftEntry entry2(3, "SET", "abc", "123");
+  ASSERT_TRUE(journal.append(2, entry2));
+
+  RaftSerializedEntry serialized2;
+  ASSERT_TRUE(journal.fetch(2, serialized2).ok());
+  ASSERT_EQ(serialized2, entry2.serialize());
+  ASSERT_EQ(journal.getCacheHits(), 1);
+
+  RaftJournal::Iterator iter = journal.getIterator(0, true);
+  for(LogIndex i = 0; i <= 2; i++) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(iter.getCurrentIndex(), i);
+    iter.current(serialized2);
+
+    RaftSerializedEntry fromFetch;
+    ASSERT_TRUE(journal.fetch(i, fromFetch).ok());
+    ASSERT_EQ(serialized2, fromFetch);
+    iter.next();
+  }
+  ASSERT_FALSE(iter.valid());
+
+  RaftEntry fetched;
+  RaftEntry::deserialize(fetched, serialized);
+  ASSERT_EQ(fetched, entry);
+}
+
+TEST_F(Raft_Journal, EntriesColumnFamilyMigration) {
+  {
+    RaftJournal journal(dbpath);
+    ASSERT_TRUE(journal.setCurrentTerm(2, srv));
+
+    for(LogIndex i = 1; i <= 100; i++) {
+      ASSERT_TRUE(journal.append(i, RaftEntry(2, "SET", SSTR("key-" << i), SSTR("value-" << i))));
+    }
+
+    journal.setCommitIndex(100);
+  }
+
+  // Turn the journal into what an older version would have left behind:
+  // Entries in the default column family, no dedicated one.
+  {
+    rocksdb::DB *db = nullptr;
+    std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies = {
+      { rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions() },
+      { KeyConstants::kJournal_EntriesColumnFamily, rocksdb::ColumnFamilyOptions() }
+    };
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    ASSERT_OK(rocksdb::DB::Open(rocksdb::DBOptions(), dbpath, columnFamilies, &handles, &db));
+
+    std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rocksdb::ReadOptions(), handles[1]));
+    size_t count = 0;
+    for(iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_OK(db->Put(rocksdb::WriteOptions(), handles[0], iter->key(), iter->value()));
+      count++;
+    }
+    iter.reset();
+    ASSERT_EQ(count, 101u);
+
+    ASSERT_OK(db->DropColumnFamily(handles[1]));
+    for(rocksdb::ColumnFamilyHandle *handle : handles) {
+      ASSERT_OK(db->DestroyColumnFamilyHandle(handle));
+    }
+    delete db;
+  }
+
+  RaftJournal journal(dbpath);
+  ASSERT_EQ(journal.getLogSize(), 101);
+  ASSERT_EQ(journal.getCommitIndex(), 100);
+
+  RaftEntry entry;
+  for(LogIndex i = 1; i <= 100; i++) {
+    ASSERT_OK(journal.fetch(i, entry));
+    ASSERT_EQ(entry, RaftEntry(2, "SET", SSTR("key-" << i), SSTR("value-" << i)));
+  }
+
+  RaftJournal::Iterator it = journal.getIterator(0, true);
+  for(LogIndex i = 0; i <= 100; i++) {
+    ASSERT_TRUE(it.valid());
+    ASSERT_EQ(it.getCurrentIndex(), i);
+    it.next();
+  }
+  ASSERT_FALSE(it.valid());
+
+  // Trimming works on the migrated entries
+  journal.trimUntil(60);
+  ASSERT_EQ(journal.getLogStart(), 60);
+  ASSERT_NOTFOUND(journal.fetch(1, entry));
+  ASSERT_NOTFOUND(journal.fetch(59, entry));
+  ASSERT_OK(journal.fetch(60, entry));
+
+  // Appends land in the new column family, next to the migrated entries
+  ASSERT_TRUE(journal.append(101, RaftEntry(2, "SET", "key-101", "value-101")));
+  ASSERT_OK(journal.fetch(101, entry));
+  ASSERT_EQ(entry, RaftEntry(2, "SET", "key-101", "value-101"));
+}
+
+TEST(RaftEntryCache, BasicSanity) {
+  RaftEntryCache cache(4, 100, 20);
+
+  ASSERT_TRUE(cache.accepts(20));
+  ASSERT_FALSE(cache.accepts(21));
+  ASSERT_EQ(cache.get(1), nullptr);
+  ASSERT_EQ(cache.getMisses(), 1);
+
+  for(LogIndex i = 1; i <= 6; i++) {
+    cache.append(i, std::make_shared<const RaftSerializedEntry>(SSTR("entry-" << i)));
+  }
+
+  // only the last four are retained
+  ASSERT_EQ(cache.size(), 4u);
+  ASSERT_EQ(cache.get(2), nullptr);
+  ASSERT_EQ(*cache.get(3), "entry-3");
+  ASSERT_EQ(*cache.get(6), "entry-6");
+  ASSERT_EQ(cache.get(7), nullptr);
+  ASSERT_EQ(cache.getHits(), 2);
+  ASSERT_EQ(cache.getMisses(), 3);
+
+  // holes
+  cache.append(7, {});
+  ASSERT_EQ(cache.get(7), nullptr);
+  ASSERT_EQ(*cache.get(6), "entry-6");
+
+  cache.removeFrom(6);
+  ASSERT_EQ(cache.get(6), nullptr);
+  ASSERT_EQ(*cache.get(5), "entry-5");
+  ASSERT_EQ(cache.bytes(), 14u);
+
+  cache.trimUntil(5);
+  ASSERT_EQ(cache.get(4), nullptr);
+  ASSERT_EQ(cache.size(), 1u);
+
+  // gaps reset the cache
+  cache.append(10, std::make_shared<const RaftSerializedEntry>("entry-10"));
+  ASSERT_EQ(cache.get(5), nullptr);
+  ASSERT_EQ(*cache.get(10), "entry-10");
+  ASSERT_EQ(cache.size(), 1u);
+
+  // byte limit
+  for(LogIndex i = 11; i <= 13; i++) {
+    cache.append(i, std::make_shared<const RaftSerializedEntry>(std::string(40, 'a')));
+  }
+
+  ASSERT_EQ(cache.size(), 2u);
+  ASSERT_EQ(cache.bytes(), 80u);
+}
+
 TEST(FsyncPolicy, Parsing) {
   FsyncPolicy policy;
 
@@ -32,6 +32,8 @@
 #include "raft/RaftLease.hh"
 #include "raft/RaftContactDetails.hh"
 #include "raft/RaftVoteRegistry.hh"
+#include "raft/RaftReplicationWindow.hh"
+#include "raft/RaftConfig.hh"
 #include "Version.hh"
 #include "test-utils.hh"
 #include "RedisParser.hh"
@@ -143,6 +145,22 @@ TEST_F(Raft_Replicator, test_replication_with_empty_journals) {
   ASSERT_EQ(journal(1)->getLogSize(), 2);
 }
 
+TEST_F(Raft_Replicator, idle_leader_switches_to_streaming) {
+  // Nothing to replicate besides the leadership marker - the acks are all
+  // empty, and the window never grows. The follower is stable all the same.
+  ASSERT_TRUE(state(0)->observed(2, {}));
+  ASSERT_TRUE(state(0)->becomeCandidate(2));
+  ASSERT_TRUE(state(0)->ascend(2));
+
+  poller(1);
+
+  RaftReplicaTracker tracker(myself(1), state(0)->getSnapshot(), *journal(), *state(), *lease(), *commitTracker(), *trimmer(), *shardDirectory(), *raftconfig(), *contactDetails());
+  ASSERT_TRUE(tracker.isRunning());
+
+  RETRY_ASSERT_EQ(journal(1)->getLogSize(), 2);
+  RETRY_ASSERT_TRUE(tracker.isStreaming());
+}
+
 TEST_F(Raft_Replicator, follower_has_larger_journal_than_leader) {
   // through the addition of several inconsistent entries, a follower
   // ended up with a larger journal than the leader
@@ -1097,6 +1115,151 @@ TEST(RaftHeartbeatTracker, BasicSanity) {
   ASSERT_EQ(TimeoutStatus::kNo, tracker.timeout(now+timeout+std::chrono::milliseconds(1)));
 }
 
+TEST_F(Raft_Replicator, MaxInflightBytesConfig) {
+  ASSERT_EQ(raftconfig()->getReplicationMaxInflightBytes(), 64 * 1024 * 1024);
+
+  EncodedConfigChange change = raftconfig()->setReplicationMaxInflightBytes(1000);
+  ASSERT_FALSE(change.error.empty());
+
+  change = raftconfig()->setReplicationMaxInflightBytes(-1, true);
+  ASSERT_FALSE(change.error.empty());
+
+  change = raftconfig()->setReplicationMaxInflightBytes(1000, true);
+  ASSERT_TRUE(change.error.empty());
+  ASSERT_EQ(change.request, make_req("CONFIG_SET", "raft.replication.max-inflight-bytes", "1000"));
+
+  ASSERT_OK(stateMachine()->configSet(change.request[1], change.request[2]));
+  ASSERT_EQ(raftconfig()->getReplicationMaxInflightBytes(), 1000);
+}
+
+TEST_F(Raft_Replicator, ResilveringBandwidthConfig) {
+  ASSERT_EQ(raftconfig()->getResilveringBandwidth(), 0);
+
+  EncodedConfigChange change = raftconfig()->setResilveringBandwidth(1000);
+  ASSERT_FALSE(change.error.empty());
+
+  change = raftconfig()->setResilveringBandwidth(-1, true);
+  ASSERT_FALSE(change.error.empty());
+
+  change = raftconfig()->setResilveringBandwidth(100 * 1024 * 1024);
+  ASSERT_TRUE(change.error.empty());
+  ASSERT_EQ(change.request, make_req("CONFIG_SET", "raft.resilvering.bandwidth", "104857600"));
+
+  ASSERT_OK(stateMachine()->configSet(change.request[1], change.request[2]));
+  ASSERT_EQ(raftconfig()->getResilveringBandwidth(), 100 * 1024 * 1024);
+
+  change = raftconfig()->setResilveringBandwidth(0);
+  ASSERT_TRUE(change.error.empty());
+  ASSERT_OK(stateMachine()->configSet(change.request[1], change.request[2]));
+  ASSERT_EQ(raftconfig()->getResilveringBandwidth(), 0);
+}
+
+TEST(RaftReplicationWindow, BasicSanity) {
+  RaftReplicationWindow window(1024 * 1024);
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::milliseconds rtt(10);
+
+  ASSERT_EQ(window.getWindow(), 1);
+  ASSERT_EQ(window.getPayloadLimit(), 1);
+  ASSERT_FALSE(window.isFull());
+
+  window.onSend(1, 100);
+  ASSERT_TRUE(window.isFull());
+  ASSERT_EQ(window.getPayloadLimit(), 0);
+  ASSERT_EQ(window.getPayloadByteLimit(), 1024 * 1024 - 100);
+
+  // Slow start: The window doubles every round-trip
+  window.onAck(1, 100, now, now + rtt);
+  ASSERT_EQ(window.getWindow(), 2);
+  ASSERT_EQ(window.getInflightEntries(), 0);
+  ASSERT_EQ(window.getInflightBytes(), 0);
+  ASSERT_EQ(window.getMinRtt(), rtt);
+
+  window.onSend(2, 200);
+  window.onAck(2, 200, now, now + rtt);
+  ASSERT_EQ(window.getWindow(), 4);
+
+  // Payloads are capped
+  for(size_t i = 0; i < 20; i++) {
+    int64_t entries = window.getWindow();
+    window.onSend(entries, 0);
+    window.onAck(entries, 0, now, now + rtt);
+  }
+
+  ASSERT_EQ(window.getWindow(), RaftReplicationWindow::kMaxWindow);
+  ASSERT_EQ(window.getPayloadLimit(), RaftReplicationWindow::kMaxPayloadEntries);
+
+  // A hiccup halves the window, and forgets whatever was in flight
+  window.onSend(100, 1000);
+  window.onHiccup();
+  ASSERT_EQ(window.getWindow(), RaftReplicationWindow::kMaxWindow / 2);
+  ASSERT_EQ(window.getInflightEntries(), 0);
+  ASSERT_EQ(window.getInflightBytes(), 0);
+
+  // Congestion avoidance: Additive increase from now on
+  int64_t previous = window.getWindow();
+  now = std::chrono::steady_clock::now();
+  window.onSend(previous, 0);
+  window.onAck(previous, 0, now, now + rtt);
+  ASSERT_EQ(window.getWindow(), previous + RaftReplicationWindow::kAdditiveIncrease);
+}
+
+TEST(RaftReplicationWindow, SlowAcknowledgements) {
+  RaftReplicationWindow window(1024 * 1024);
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  for(size_t i = 0; i < 6; i++) {
+    window.onAck(window.getWindow(), 0, now, now + std::chrono::milliseconds(10));
+  }
+
+  ASSERT_EQ(window.getWindow(), 64);
+
+  // Way too slow ack, halve the window
+  window.onAck(1, 0, now, now + std::chrono::milliseconds(100));
+  ASSERT_EQ(window.getWindow(), 32);
+
+  // More slow acks for payloads sent before we reacted: Don't halve again
+  window.onAck(1, 0, now, now + std::chrono::milliseconds(100));
+  window.onAck(1, 0, now, now + std::chrono::milliseconds(100));
+  ASSERT_EQ(window.getWindow(), 32);
+
+  // Slow ack for a payload sent after we reacted
+  now += std::chrono::milliseconds(200);
+  window.onAck(1, 0, now, now + std::chrono::milliseconds(100));
+  ASSERT_EQ(window.getWindow(), 16);
+
+  // Never go below the minimum
+  for(size_t i = 0; i < 10; i++) {
+    window.onHiccup();
+  }
+
+  ASSERT_EQ(window.getWindow(), RaftReplicationWindow::kMinWindow);
+  ASSERT_EQ(window.getPayloadLimit(), 1);
+}
+
+TEST(RaftReplicationWindow, ByteLimit) {
+  RaftReplicationWindow window(1000);
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  for(size_t i = 0; i < 6; i++) {
+    window.onAck(window.getWindow(), 0, now, now + std::chrono::milliseconds(10));
+  }
+
+  window.onSend(2, 600);
+  ASSERT_FALSE(window.isFull());
+  ASSERT_EQ(window.getPayloadByteLimit(), 400);
+
+  window.onSend(2, 600);
+  ASSERT_TRUE(window.isFull());
+  ASSERT_EQ(window.getPayloadByteLimit(), 0);
+
+  window.onAck(2, 600, now, now + std::chrono::milliseconds(10));
+  ASSERT_FALSE(window.isFull());
+
+  window.setMaxInflightBytes(500);
+  ASSERT_TRUE(window.isFull());
+}
+
 TEST(RaftVoteRequest, Describe) {
   RaftVoteRequest voteReq;
 
@@ -52,7 +52,7 @@ TEST(Recovery, BasicSanity) {
 
     std::vector<std::string> magicValues = recovery.retrieveMagicValues();
 
-    ASSERT_EQ(magicValues.size(), 19u);
+    ASSERT_EQ(magicValues.size(), 20u);
 
     int i = 0;
     ASSERT_EQ(magicValues[i++], "RAFT_CURRENT_TERM: NotFound: ");
@@ -74,6 +74,7 @@ TEST(Recovery, BasicSanity) {
     ASSERT_EQ(magicValues[i++], boolToString(false));
     ASSERT_EQ(magicValues[i++], "__clock");
     ASSERT_EQ(magicValues[i++], unsignedIntToBinaryString(0u));
+    ASSERT_EQ(magicValues[i++], "__reversed-key-index: NotFound: ");
   }
 
   RedisRequest req {"recovery-get", "__last-applied"};
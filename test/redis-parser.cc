@@ -154,3 +154,15 @@ TEST_F(Redis_Parser, T8) {
   link.Send("*1\n\nabc");
   ASSERT_LT(parser->fetch(request, true), 0);
 }
+
+TEST_F(Redis_Parser, T9) {
+  // overflowing integer
+  link.Send("*99999999999\r\n");
+  ASSERT_LT(parser->fetch(request, true), 0);
+}
+
+TEST_F(Redis_Parser, T10) {
+  // missing digits
+  link.Send("*\r\n");
+  ASSERT_LT(parser->fetch(request, true), 0);
+}
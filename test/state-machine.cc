@@ -27,6 +27,8 @@
 #include "storage/PatternMatching.hh"
 #include "storage/ExpirationEventIterator.hh"
 #include "storage/ConsistencyScanner.hh"
+#include "storage/KeyLockTable.hh"
+#include "storage/KeyDescriptorCache.hh"
 #include "StateMachine.hh"
 #include "test-utils.hh"
 #include <gtest/gtest.h>
@@ -637,6 +639,339 @@ TEST_F(State_Machine, BatchedWrites) {
   ASSERT_EQ(keyDescr, keyDescr2);
 }
 
+TEST_F(State_Machine, StripedWrites) {
+  // Find two keys hashing to different stripes
+  std::string key1 = "key-1";
+  std::string key2;
+  for(size_t i = 2; key2.empty(); i++) {
+    std::string candidate = SSTR("key-" << i);
+    if(KeyLockTable::getStripe(candidate) != KeyLockTable::getStripe(key1)) {
+      key2 = candidate;
+    }
+  }
+
+  std::atomic<bool> globalAcquired {false};
+  std::thread flusher;
+
+  {
+    // Both are held at the same time - no global lock involved
+    StagingArea stagingArea1(*stateMachine(), KeyLockSet(key1));
+    StagingArea stagingArea2(*stateMachine(), KeyLockSet(key2));
+
+    EXPECT_TRUE(stateMachine()->set(stagingArea1, key1, "v1").ok());
+    EXPECT_TRUE(stateMachine()->set(stagingArea2, key2, "v2").ok());
+
+    // ... but anyone needing the entire keyspace has to wait
+    flusher = std::thread([&]() {
+      StagingArea stagingArea(*stateMachine());
+      globalAcquired = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(globalAcquired);
+
+    stagingArea2.commit(0);
+    stagingArea1.commit(0);
+  }
+
+  flusher.join();
+  ASSERT_TRUE(globalAcquired);
+
+  std::string val;
+  ASSERT_OK(stateMachine()->get(key1, val));
+  ASSERT_EQ(val, "v1");
+  ASSERT_OK(stateMachine()->get(key2, val));
+  ASSERT_EQ(val, "v2");
+}
+
+TEST_F(State_Machine, RangeDeletion) {
+  int64_t oldThreshold = StateMachine::getRangeDeletionThreshold();
+  StateMachine::setRangeDeletionThreshold(5);
+
+  bool created;
+  for(size_t i = 0; i < 10; i++) {
+    ASSERT_OK(stateMachine()->hset("big-hash", SSTR("f" << i), SSTR("v" << i), created));
+    ASSERT_OK(stateMachine()->hset("small-hash", SSTR("f" << i), SSTR("v" << i), created));
+    ASSERT_OK(stateMachine()->lhset("big-lhash", SSTR("f" << i), "hint", SSTR("v" << i), created));
+  }
+
+  int64_t count;
+  RedisRequest elem = {"big-hash"};
+
+  {
+    StagingArea stagingArea(*stateMachine());
+    ASSERT_OK(stateMachine()->hset(stagingArea, "big-hash", "staged", "value", created));
+    ASSERT_OK(stateMachine()->del(stagingArea, elem.begin(), elem.end(), count));
+    ASSERT_EQ(count, 1);
+
+    // Re-create within the same batch, on top of the range tombstone
+    ASSERT_OK(stateMachine()->hset(stagingArea, "big-hash", "f3", "new-value", created));
+    ASSERT_TRUE(created);
+
+    size_t len;
+    ASSERT_OK(stateMachine()->hlen(stagingArea, "big-hash", len));
+    ASSERT_EQ(len, 1u);
+
+    std::vector<std::string> contents;
+    ASSERT_OK(stateMachine()->hgetall(stagingArea, "big-hash", contents));
+    ASSERT_EQ(contents, make_vec("f3", "new-value"));
+
+    ASSERT_OK(stateMachine()->hgetall(stagingArea, "small-hash", contents));
+    ASSERT_EQ(contents.size(), 20u);
+    stagingArea.commit(0);
+  }
+
+  std::string val;
+  ASSERT_OK(stateMachine()->hget("big-hash", "f3", val));
+  ASSERT_EQ(val, "new-value");
+  ASSERT_NOTFOUND(stateMachine()->hget("big-hash", "f4", val));
+  ASSERT_NOTFOUND(stateMachine()->hget("big-hash", "staged", val));
+
+  std::vector<std::string> contents;
+  ASSERT_OK(stateMachine()->hgetall("big-hash", contents));
+  ASSERT_EQ(contents, make_vec("f3", "new-value"));
+
+  elem = {"big-lhash", "small-hash"};
+  ASSERT_OK(stateMachine()->del(elem.begin(), elem.end(), count));
+  ASSERT_EQ(count, 2);
+
+  size_t len;
+  ASSERT_OK(stateMachine()->lhlen("big-lhash", len));
+  ASSERT_EQ(len, 0u);
+  ASSERT_NOTFOUND(stateMachine()->lhget("big-lhash", "f1", "hint", val));
+
+  std::vector<std::string> keys;
+  ASSERT_OK(stateMachine()->keys("*", keys));
+  ASSERT_EQ(keys, make_vec("big-hash"));
+
+  // The deleted container must be completely gone, re-creating it starts
+  // from scratch
+  ASSERT_OK(stateMachine()->lhset("big-lhash", "f1", "hint", "v", created));
+  ASSERT_TRUE(created);
+  ASSERT_OK(stateMachine()->lhlen("big-lhash", len));
+  ASSERT_EQ(len, 1u);
+
+  StateMachine::setRangeDeletionThreshold(oldThreshold);
+}
+
+TEST_F(State_Machine, Unlink) {
+  bool created;
+  for(size_t i = 0; i < 100; i++) {
+    ASSERT_OK(stateMachine()->hset("big-hash", SSTR("f" << i), SSTR("v" << i), created));
+    ASSERT_OK(stateMachine()->lhset("big-lhash", SSTR("f" << i), "hint", SSTR("v" << i), created));
+  }
+
+  ASSERT_OK(stateMachine()->hset("small-hash", "f", "v", created));
+  ASSERT_OK(stateMachine()->set("string", "v"));
+
+  int64_t count;
+  RedisRequest elem = {"big-hash", "small-hash", "string", "not-existing"};
+  ASSERT_OK(stateMachine()->unlink(elem.begin(), elem.end(), count));
+  ASSERT_EQ(count, 3);
+
+  // Only the big hash is left pending reclamation, the rest is gone
+  ReclamationStats stats = stateMachine()->getReclamationStats();
+  ASSERT_EQ(stats.pendingPrefixes, 1);
+  ASSERT_EQ(stats.pendingElements, 100);
+
+  std::vector<std::string> keys;
+  ASSERT_OK(stateMachine()->keys("*", keys));
+  ASSERT_EQ(keys, make_vec("big-lhash"));
+
+  size_t len;
+  ASSERT_OK(stateMachine()->hlen("big-hash", len));
+  ASSERT_EQ(len, 0u);
+
+  int64_t reclaimed;
+  ASSERT_OK(stateMachine()->reclaim(30, reclaimed));
+  ASSERT_EQ(reclaimed, 30);
+
+  stats = stateMachine()->getReclamationStats();
+  ASSERT_EQ(stats.pendingPrefixes, 1);
+  ASSERT_EQ(stats.pendingElements, 70);
+  ASSERT_EQ(stats.reclaimedElements, 30);
+
+  ASSERT_OK(stateMachine()->reclaim(1000, reclaimed));
+  ASSERT_EQ(reclaimed, 70);
+
+  stats = stateMachine()->getReclamationStats();
+  ASSERT_EQ(stats.pendingPrefixes, 0);
+  ASSERT_EQ(stats.pendingElements, 0);
+  ASSERT_EQ(stats.reclaimedElements, 100);
+
+  ASSERT_OK(stateMachine()->reclaim(1000, reclaimed));
+  ASSERT_EQ(reclaimed, 0);
+
+  // Re-create a container before its old elements have been reclaimed
+  elem = {"big-lhash"};
+  ASSERT_OK(stateMachine()->unlink(elem.begin(), elem.end(), count));
+  ASSERT_EQ(count, 1);
+
+  stats = stateMachine()->getReclamationStats();
+  ASSERT_EQ(stats.pendingPrefixes, 2);
+  ASSERT_EQ(stats.pendingElements, 200);
+
+  ASSERT_OK(stateMachine()->lhset("big-lhash", "f1", "hint", "new-value", created));
+  ASSERT_TRUE(created);
+
+  stats = stateMachine()->getReclamationStats();
+  ASSERT_EQ(stats.pendingPrefixes, 0);
+  ASSERT_EQ(stats.pendingElements, 0);
+
+  ASSERT_OK(stateMachine()->lhlen("big-lhash", len));
+  ASSERT_EQ(len, 1u);
+
+  std::string val;
+  ASSERT_OK(stateMachine()->lhget("big-lhash", "f1", "", val));
+  ASSERT_EQ(val, "new-value");
+  ASSERT_NOTFOUND(stateMachine()->lhget("big-lhash", "f2", "hint", val));
+
+  ASSERT_OK(stateMachine()->reclaim(1000, reclaimed));
+  ASSERT_EQ(reclaimed, 0);
+}
+
+TEST(KeyLockSet, BasicSanity) {
+  KeyLockSet locks;
+  ASSERT_TRUE(locks.isGlobal());
+
+  locks.add("abc");
+  locks.add("abc");
+  ASSERT_FALSE(locks.isGlobal());
+  ASSERT_EQ(locks.getStripes(), std::vector<size_t>{KeyLockTable::getStripe("abc")});
+  ASSERT_TRUE(locks.covers("abc"));
+
+  for(size_t i = 0; i < 100; i++) {
+    locks.add(SSTR("key-" << i));
+  }
+
+  ASSERT_TRUE(std::is_sorted(locks.getStripes().begin(), locks.getStripes().end()));
+  ASSERT_EQ(std::adjacent_find(locks.getStripes().begin(), locks.getStripes().end()), locks.getStripes().end());
+
+  locks.lockEverything();
+  locks.add("abc");
+  ASSERT_TRUE(locks.isGlobal());
+  ASSERT_TRUE(locks.covers("anything"));
+  ASSERT_TRUE(locks.getStripes().empty());
+}
+
+TEST(KeyDescriptorCache, BasicSanity) {
+  KeyDescriptorCache cache(KeyDescriptorCache::kShards * 2);
+
+  KeyDescriptor hash;
+  hash.setKeyType(KeyType::kHash);
+  hash.setSize(3);
+
+  KeyDescriptor descriptor;
+  ASSERT_FALSE(cache.get("abc", descriptor));
+  cache.put("abc", hash);
+  ASSERT_TRUE(cache.get("abc", descriptor));
+  ASSERT_EQ(descriptor.getKeyType(), KeyType::kHash);
+  ASSERT_EQ(descriptor.getSize(), 3);
+
+  hash.setSize(4);
+  cache.put("abc", hash);
+  ASSERT_TRUE(cache.get("abc", descriptor));
+  ASSERT_EQ(descriptor.getSize(), 4);
+
+  cache.invalidate("abc");
+  ASSERT_FALSE(cache.get("abc", descriptor));
+
+  KeyDescriptorCacheStats stats = cache.getStats();
+  ASSERT_EQ(stats.entries, 0);
+  ASSERT_EQ(stats.hits, 2);
+  ASSERT_EQ(stats.misses, 2);
+  ASSERT_EQ(stats.hitRate(), 0.5);
+
+  // Staged descriptors: Empty ones drop the key
+  cache.put("one", hash);
+  cache.put("two", hash);
+
+  StagedDescriptors staged;
+  staged["one"] = KeyDescriptor();
+  staged["three"] = hash;
+  cache.apply(staged);
+
+  ASSERT_FALSE(cache.get("one", descriptor));
+  ASSERT_TRUE(cache.get("two", descriptor));
+  ASSERT_TRUE(cache.get("three", descriptor));
+
+  // Bounded, the least recently used entries go first
+  for(size_t i = 0; i < 1000; i++) {
+    cache.put(SSTR("key-" << i), hash);
+  }
+
+  stats = cache.getStats();
+  ASSERT_LE(stats.entries, (int64_t) KeyDescriptorCache::kShards * 2);
+  ASSERT_GE(stats.evictions, 1000 - (int64_t) KeyDescriptorCache::kShards * 2);
+  ASSERT_TRUE(cache.get("key-999", descriptor));
+
+  cache.clear();
+  ASSERT_EQ(cache.getStats().entries, 0);
+}
+
+TEST_F(State_Machine, KeyDescriptorCache) {
+  bool created;
+  for(size_t i = 0; i < 100; i++) {
+    ASSERT_OK(stateMachine()->hset("hot", SSTR("f" << i), "v", created));
+    ASSERT_TRUE(created);
+  }
+
+  // Every write but the first found the descriptor in the cache
+  KeyDescriptorCacheStats stats = stateMachine()->getKeyDescriptorCacheStats();
+  ASSERT_EQ(stats.entries, 1);
+  ASSERT_GE(stats.hits, 99);
+
+  size_t len;
+  ASSERT_OK(stateMachine()->hlen("hot", len));
+  ASSERT_EQ(len, 100u);
+
+  {
+    // Never committed - the cache must not see any of this
+    StagingArea stagingArea(*stateMachine());
+    ASSERT_OK(stateMachine()->hset(stagingArea, "hot", "uncommitted", "v", created));
+    ASSERT_OK(stateMachine()->hlen(stagingArea, "hot", len));
+    ASSERT_EQ(len, 101u);
+  }
+
+  {
+    // Several writes to the same key within one batch
+    StagingArea stagingArea(*stateMachine());
+    ASSERT_OK(stateMachine()->hset(stagingArea, "hot", "staged-1", "v", created));
+    ASSERT_OK(stateMachine()->hset(stagingArea, "hot", "staged-2", "v", created));
+    ASSERT_OK(stateMachine()->hlen(stagingArea, "hot", len));
+    ASSERT_EQ(len, 102u);
+    stagingArea.commit(0);
+  }
+
+  ASSERT_OK(stateMachine()->hset("hot", "f100", "v", created));
+  ASSERT_TRUE(created);
+  ASSERT_OK(stateMachine()->hlen("hot", len));
+  ASSERT_EQ(len, 103u);
+
+  int64_t count;
+  RedisRequest elem = {"hot"};
+  ASSERT_OK(stateMachine()->del(elem.begin(), elem.end(), count));
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(stateMachine()->getKeyDescriptorCacheStats().entries, 0);
+
+  ASSERT_OK(stateMachine()->hset("hot", "f1", "v", created));
+  ASSERT_TRUE(created);
+  ASSERT_OK(stateMachine()->hlen("hot", len));
+  ASSERT_EQ(len, 1u);
+
+  ASSERT_OK(stateMachine()->set("str", "abc"));
+  ASSERT_OK(stateMachine()->set("str", "abcd"));
+  ASSERT_EQ(stateMachine()->getKeyDescriptorCacheStats().entries, 2);
+
+  ASSERT_OK(stateMachine()->flushall());
+  ASSERT_EQ(stateMachine()->getKeyDescriptorCacheStats().entries, 0);
+
+  ASSERT_OK(stateMachine()->hset("hot", "f1", "v", created));
+  ASSERT_TRUE(created);
+  ASSERT_OK(stateMachine()->hlen("hot", len));
+  ASSERT_EQ(len, 1u);
+}
+
 TEST_F(State_Machine, scan) {
   ASSERT_OK(stateMachine()->set("key1", "1"));
   ASSERT_OK(stateMachine()->set("key2", "2"));
@@ -1033,6 +1368,117 @@ TEST(StateMachine, RawScanTombstones) {
   ASSERT_EQ(elements[1], "atest-key");
 }
 
+static std::vector<std::string> reversedKeyIndexContents(StateMachine &stateMachine) {
+  StagingArea stagingArea(stateMachine, true);
+
+  std::vector<std::string> elements;
+  EXPECT_TRUE(stateMachine.rawScan(stagingArea, "<", 1000, elements).ok());
+
+  std::vector<std::string> keys;
+  for(size_t i = 0; i < elements.size(); i += 2) {
+    if(elements[i][0] != '<') break;
+    keys.emplace_back(elements[i]);
+  }
+
+  return keys;
+}
+
+TEST(StateMachine, ReversedKeyIndex) {
+  ASSERT_EQ(system("rm -rf /tmp/quarkdb-reversed-key-index-test"), 0);
+  StateMachine::setReversedKeyIndex(true);
+
+  std::unique_ptr<StateMachine> stateMachine(new StateMachine("/tmp/quarkdb-reversed-key-index-test"));
+  ASSERT_TRUE(stateMachine->hasReversedKeyIndex());
+
+  bool created;
+  ASSERT_OK(stateMachine->set("a:suffix", "1"));
+  ASSERT_OK(stateMachine->set("b:suffix", "2"));
+  ASSERT_OK(stateMachine->set("c:other", "3"));
+  ASSERT_OK(stateMachine->set("suffix", "4"));
+  ASSERT_OK(stateMachine->hset("d:suffix", "f", "v", created));
+  ASSERT_OK(stateMachine->hset("d:suffix", "f2", "v", created));
+
+  int64_t count;
+  RedisRequest req;
+  for(size_t i = 0; i < 100; i++) {
+    req.push_back(SSTR("item-" << i));
+  }
+
+  ASSERT_OK(stateMachine->sadd("e:suffix", req.begin(), req.end(), count));
+  ASSERT_EQ(count, 100);
+
+  ASSERT_EQ(reversedKeyIndexContents(*stateMachine), make_vec("<rehto:c", "<xiffus", "<xiffus:a", "<xiffus:b", "<xiffus:d", "<xiffus:e"));
+
+  std::vector<std::string> keys;
+  ASSERT_OK(stateMachine->keys("*:suffix", keys));
+  ASSERT_EQ(keys, make_vec("a:suffix", "b:suffix", "d:suffix", "e:suffix"));
+
+  ASSERT_OK(stateMachine->keys("*suffix", keys));
+  ASSERT_EQ(keys, make_vec("suffix", "a:suffix", "b:suffix", "d:suffix", "e:suffix"));
+
+  ASSERT_OK(stateMachine->keys("[ab]*x", keys));
+  ASSERT_EQ(keys, make_vec("a:suffix", "b:suffix"));
+
+  std::string newcursor;
+  keys.clear();
+  ASSERT_OK(stateMachine->scan("", "*:suffix", 2, newcursor, keys));
+  ASSERT_EQ(keys, make_vec("a:suffix", "b:suffix"));
+  ASSERT_EQ(newcursor, "d:suffix");
+
+  keys.clear();
+  ASSERT_OK(stateMachine->scan(newcursor, "*:suffix", 2, newcursor, keys));
+  ASSERT_EQ(keys, make_vec("d:suffix", "e:suffix"));
+  ASSERT_EQ(newcursor, "");
+
+  // Deleted keys disappear from the index, whichever way they went
+  req = {"b:suffix"};
+  ASSERT_OK(stateMachine->del(req.begin(), req.end(), count));
+  ASSERT_EQ(count, 1);
+
+  req = {"e:suffix"};
+  ASSERT_OK(stateMachine->unlink(req.begin(), req.end(), count));
+  ASSERT_EQ(count, 1);
+
+  req = {"f", "f2"};
+  ASSERT_OK(stateMachine->hdel("d:suffix", req.begin(), req.end(), count));
+  ASSERT_EQ(count, 2);
+
+  ASSERT_OK(stateMachine->keys("*:suffix", keys));
+  ASSERT_EQ(keys, make_vec("a:suffix"));
+  ASSERT_EQ(reversedKeyIndexContents(*stateMachine), make_vec("<rehto:c", "<xiffus", "<xiffus:a"));
+
+  // Re-open with the index disabled - it's dropped, and SCAN falls back to
+  // going through all keys
+  StateMachine::setReversedKeyIndex(false);
+  stateMachine.reset();
+  stateMachine.reset(new StateMachine("/tmp/quarkdb-reversed-key-index-test"));
+  ASSERT_FALSE(stateMachine->hasReversedKeyIndex());
+  ASSERT_TRUE(reversedKeyIndexContents(*stateMachine).empty());
+
+  ASSERT_OK(stateMachine->set("f:suffix", "5"));
+  ASSERT_OK(stateMachine->keys("*:suffix", keys));
+  ASSERT_EQ(keys, make_vec("a:suffix", "f:suffix"));
+
+  // Re-enable, the index is re-built from scratch
+  StateMachine::setReversedKeyIndex(true);
+  stateMachine.reset();
+  stateMachine.reset(new StateMachine("/tmp/quarkdb-reversed-key-index-test"));
+  ASSERT_TRUE(stateMachine->hasReversedKeyIndex());
+  ASSERT_EQ(reversedKeyIndexContents(*stateMachine), make_vec("<rehto:c", "<xiffus", "<xiffus:a", "<xiffus:f"));
+
+  ASSERT_OK(stateMachine->keys("*:suffix", keys));
+  ASSERT_EQ(keys, make_vec("a:suffix", "f:suffix"));
+
+  // FLUSHALL wipes out the index, too
+  ASSERT_OK(stateMachine->flushall());
+  ASSERT_TRUE(reversedKeyIndexContents(*stateMachine).empty());
+  ASSERT_OK(stateMachine->keys("*:suffix", keys));
+  ASSERT_TRUE(keys.empty());
+
+  stateMachine.reset();
+  StateMachine::setReversedKeyIndex(false);
+}
+
 static std::string sliceToString(const std::string_view &slice) {
   return std::string(slice.data(), slice.size());
 }
@@ -1284,6 +1730,14 @@ TEST(PatternMatching, BasicSanity) {
   ASSERT_EQ(extractPatternPrefix("ab?abc"), "ab");
   ASSERT_EQ(extractPatternPrefix("1234[a-z]*134"), "1234");
   ASSERT_EQ(extractPatternPrefix("?134"), "");
+
+  ASSERT_EQ(extractPatternSuffix("*abc"), "abc");
+  ASSERT_EQ(extractPatternSuffix("abc"), "abc");
+  ASSERT_EQ(extractPatternSuffix("abc?ab"), "ab");
+  ASSERT_EQ(extractPatternSuffix("1234[a-z]*134"), "134");
+  ASSERT_EQ(extractPatternSuffix("134?"), "");
+  ASSERT_EQ(extractPatternSuffix("*ab\\*cd"), "cd");
+  ASSERT_EQ(extractPatternSuffix("*ab\\?"), "");
 }
 
 TEST(EscapedPrefixExtractor, CrashCase) {
@@ -32,6 +32,8 @@
 #include "../test-utils.hh"
 #include "RedisParser.hh"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
 #include <qclient/QClient.hh>
 #include "utils/AssistedThread.hh"
 #include "../test-reply-macros.hh"
@@ -39,7 +41,28 @@
 #define ASSERT_OK(msg) ASSERT_TRUE(msg.ok())
 using namespace quarkdb;
 
-TEST(BulkLoad, BasicSanity) {
+//------------------------------------------------------------------------------
+// Restores the bulkload path to the default when going out of scope.
+//------------------------------------------------------------------------------
+class BulkloadIngestionGuard {
+public:
+  BulkloadIngestionGuard(bool ingestion) : previous(StateMachine::getBulkloadIngestion()) {
+    StateMachine::setBulkloadIngestion(ingestion);
+  }
+
+  ~BulkloadIngestionGuard() {
+    StateMachine::setBulkloadIngestion(previous);
+  }
+
+private:
+  bool previous;
+};
+
+class BulkLoadPaths : public ::testing::TestWithParam<bool> {};
+INSTANTIATE_TEST_CASE_P(BulkLoad, BulkLoadPaths, ::testing::Values(true, false));
+
+TEST_P(BulkLoadPaths, BasicSanity) {
+  BulkloadIngestionGuard guard(GetParam());
   system("rm -rf /tmp/quarkdb-bulkload-test");
 
   {
@@ -78,10 +101,17 @@ TEST(BulkLoad, BasicSanity) {
     ASSERT_TRUE(created);
   }
 
+  // Staging files are kept out of the DB directory
+  std::string err;
+  ASSERT_EQ(directoryExists("/tmp/quarkdb-bulkload-test-bulkload-staging", err), GetParam());
+  ASSERT_FALSE(directoryExists("/tmp/quarkdb-bulkload-test/bulkload-staging", err));
 
   stateMachine.finalizeBulkload();
   }
 
+  std::string err;
+  ASSERT_FALSE(directoryExists("/tmp/quarkdb-bulkload-test-bulkload-staging", err));
+
   size_t len;
   StateMachine stateMachine("/tmp/quarkdb-bulkload-test");
   ASSERT_OK(stateMachine.hlen("some-key", len));
@@ -143,7 +173,8 @@ TEST(BulkLoad, BasicSanity) {
   }
 }
 
-TEST(BulkLoad, PanicWhenOpeningUnfinalizedStateMachine) {
+TEST_P(BulkLoadPaths, PanicWhenOpeningUnfinalizedStateMachine) {
+  BulkloadIngestionGuard guard(GetParam());
   ASSERT_EQ(system("rm -rf /tmp/quarkdb-bulkload-test"), 0);
 
   {
@@ -160,6 +191,65 @@ TEST(BulkLoad, PanicWhenOpeningUnfinalizedStateMachine) {
   ASSERT_THROW(StateMachine("/tmp/quarkdb-bulkload-test"), FatalException);
 }
 
+//------------------------------------------------------------------------------
+// Load the same, shuffled contents through SST ingestion and through the
+// memtable, and compare.
+//------------------------------------------------------------------------------
+static std::chrono::milliseconds timedBulkload(bool ingestion, const std::vector<size_t> &order) {
+  BulkloadIngestionGuard guard(ingestion);
+  EXPECT_EQ(system("rm -rf /tmp/quarkdb-bulkload-bench"), 0);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  {
+    StateMachine stateMachine("/tmp/quarkdb-bulkload-bench", false, true);
+
+    for(size_t i : order) {
+      bool created;
+      EXPECT_TRUE(stateMachine.set(SSTR("string-" << i), SSTR("value-" << i)).ok());
+      EXPECT_TRUE(stateMachine.hset(SSTR("hash-" << i % 1000), SSTR("field-" << i), SSTR("value-" << i), created).ok());
+    }
+
+    stateMachine.finalizeBulkload();
+  }
+
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+}
+
+TEST(BulkLoad, IngestionVersusMemtable) {
+  const size_t kEntries = 500000;
+
+  std::vector<size_t> order;
+  for(size_t i = 0; i < kEntries; i++) {
+    order.emplace_back(i);
+  }
+
+  std::mt19937 gen(42);
+  std::shuffle(order.begin(), order.end(), gen);
+
+  for(bool ingestion : {false, true}) {
+    std::chrono::milliseconds duration = timedBulkload(ingestion, order);
+    std::cerr << (ingestion ? "SST ingestion: " : "memtable: ") << kEntries * 2 << " writes, including finalization, took " << duration.count() << " ms" << std::endl;
+
+    StateMachine stateMachine("/tmp/quarkdb-bulkload-bench");
+
+    size_t len;
+    ASSERT_OK(stateMachine.hlen("hash-7", len));
+    ASSERT_EQ(len, kEntries / 1000);
+
+    std::string value;
+    ASSERT_OK(stateMachine.get(SSTR("string-" << kEntries - 1), value));
+    ASSERT_EQ(value, SSTR("value-" << kEntries - 1));
+
+    ASSERT_OK(stateMachine.hget("hash-123", "field-4123", value));
+    ASSERT_EQ(value, "value-4123");
+
+    std::vector<std::string> keys;
+    ASSERT_OK(stateMachine.keys("*", keys));
+    ASSERT_EQ(keys.size(), kEntries + 1000);
+  }
+}
+
 TEST(Bulkload, RaftJournalAtNonZeroIndex) {
   ASSERT_EQ(system("rm -rf /tmp/quarkdb-tests-raft-journal"), 0);
 
@@ -0,0 +1,111 @@
+// ----------------------------------------------------------------------
+// File: connections.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "Dispatcher.hh"
+#include "netio/AsioPoller.hh"
+#include "../test-utils.hh"
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace quarkdb;
+class Connections : public TestCluster3NodesFixture {};
+
+//------------------------------------------------------------------------------
+// Open a fresh connection, do a single PING over it, and close it again.
+//------------------------------------------------------------------------------
+static bool pingOverFreshConnection(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(fd < 0) return false;
+
+  sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  bool success = false;
+  if(connect(fd, (sockaddr*) &addr, sizeof(addr)) == 0) {
+    const std::string ping = "*1\r\n$4\r\nPING\r\n";
+    const std::string pong = "+PONG\r\n";
+
+    if(send(fd, ping.c_str(), ping.size(), 0) == (ssize_t) ping.size()) {
+      std::string response;
+      char buff[64];
+
+      while(response.size() < pong.size()) {
+        ssize_t rc = recv(fd, buff, sizeof(buff), 0);
+        if(rc <= 0) break;
+        response.append(buff, rc);
+      }
+
+      success = (response == pong);
+    }
+  }
+
+  close(fd);
+  return success;
+}
+
+//------------------------------------------------------------------------------
+// Simulate a reconnection storm: Many clients connecting at once, each
+// issuing a single request. Accepting a connection doesn't involve the
+// resolver at all, so this measures how fast we can get connections to their
+// first response.
+//------------------------------------------------------------------------------
+TEST_F(Connections, EstablishmentRate) {
+  RedisDispatcher dispatcher(*stateMachine(), *publisher());
+  AsioPoller poller(myself().port, 8, &dispatcher);
+  Link::setConnectionLogging(false);
+
+  const size_t threads = 8;
+  const size_t connectionsPerThread = 1000;
+
+  std::atomic<int64_t> failures {0};
+  std::vector<std::thread> clients;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(size_t i = 0; i < threads; i++) {
+    clients.emplace_back([&]() {
+      for(size_t j = 0; j < connectionsPerThread; j++) {
+        if(!pingOverFreshConnection(myself().port)) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  for(size_t i = 0; i < clients.size(); i++) {
+    clients[i].join();
+  }
+
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  Link::setConnectionLogging(true);
+
+  size_t total = threads * connectionsPerThread;
+  qdb_info("Established " << total << " connections in " << duration.count() << " ms, " <<
+    (1000 * total) / std::max<int64_t>(duration.count(), 1) << " connections per second");
+
+  ASSERT_EQ(failures, 0);
+}
@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------
+// File: range-deletion.cc
+// Author: Georgios Bitzes - CERN
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * quarkdb - a redis-like highly available key-value store              *
+ * Copyright (C) 2016 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "StateMachine.hh"
+#include "storage/StagingArea.hh"
+#include "utils/Macros.hh"
+#include "Utils.hh"
+#include "../test-utils.hh"
+#include <gtest/gtest.h>
+#include <chrono>
+
+#define ASSERT_OK(msg) ASSERT_TRUE(msg.ok())
+using namespace quarkdb;
+
+static void fillHash(StateMachine &stateMachine, const std::string &key, size_t elements) {
+  const size_t batchSize = 10000;
+  LogIndex index = stateMachine.getLastApplied();
+
+  for(size_t i = 0; i < elements; i += batchSize) {
+    StagingArea stagingArea(stateMachine);
+
+    for(size_t j = i; j < std::min(elements, i + batchSize); j++) {
+      bool created;
+      ASSERT_OK(stateMachine.hset(stagingArea, key, SSTR("field-" << j), "value", created));
+    }
+
+    stagingArea.commit(++index);
+  }
+}
+
+//------------------------------------------------------------------------------
+// How long does the apply thread stall when deleting a container of the given
+// size? Measure both with per-element and range deletions.
+//------------------------------------------------------------------------------
+static std::chrono::microseconds measureDeletion(StateMachine &stateMachine, size_t elements, int64_t threshold) {
+  std::string key = SSTR("hash-" << elements << "-" << threshold);
+  fillHash(stateMachine, key, elements);
+
+  StateMachine::setRangeDeletionThreshold(threshold);
+
+  RedisRequest req = { key };
+  int64_t removed;
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(stateMachine.del(req.begin(), req.end(), removed, stateMachine.getLastApplied() + 1).ok());
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+  EXPECT_EQ(removed, 1);
+
+  size_t len;
+  EXPECT_TRUE(stateMachine.hlen(key, len).ok());
+  EXPECT_EQ(len, 0u);
+
+  return duration;
+}
+
+TEST(RangeDeletion, ApplyLatency) {
+  ASSERT_EQ(system("rm -rf /tmp/quarkdb-range-deletion-test"), 0);
+  int64_t oldThreshold = StateMachine::getRangeDeletionThreshold();
+
+  {
+    StateMachine stateMachine("/tmp/quarkdb-range-deletion-test");
+
+    for(size_t elements = 1000; elements <= 1000000; elements *= 10) {
+      std::chrono::microseconds pointDeletes = measureDeletion(stateMachine, elements, std::numeric_limits<int64_t>::max());
+      std::chrono::microseconds rangeDeletes = measureDeletion(stateMachine, elements, 0);
+
+      qdb_info("Deleting a hash with " << elements << " elements: " << pointDeletes.count() << " us with point deletions, "
+        << rangeDeletes.count() << " us with a range deletion");
+    }
+  }
+
+  StateMachine::setRangeDeletionThreshold(oldThreshold);
+  ASSERT_EQ(system("rm -rf /tmp/quarkdb-range-deletion-test"), 0);
+}
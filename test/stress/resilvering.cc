@@ -29,6 +29,7 @@
 #include "Connection.hh"
 #include "raft/RaftResilverer.hh"
 #include "raft/RaftJournal.hh"
+#include "utils/FileUtils.hh"
 
 using namespace quarkdb;
 class Trimming : public TestCluster3NodesFixture {};
@@ -127,6 +128,112 @@ TEST_F(Resilvering, manual) {
   ASSERT_TRUE(journal(2)->getCommitIndex() == commitIndex);
 }
 
+TEST_F(Resilvering, Incremental) {
+  spinup(0); spinup(1);
+  RETRY_ASSERT_TRUE(checkStateConsensus(0, 1));
+
+  int leaderID = getLeaderID();
+
+  const int64_t NENTRIES = 5000;
+  for(size_t i = 0; i < NENTRIES; i++) {
+    ASSERT_REPLY(tunnel(leaderID)->exec("set", SSTR("key-" << i), SSTR("value-" << i)), "OK");
+  }
+
+  RETRY_ASSERT_EQ(journal(0)->getCommitIndex(), journal(leaderID)->getCommitIndex());
+  RETRY_ASSERT_EQ(journal(1)->getCommitIndex(), journal(leaderID)->getCommitIndex());
+
+  spindown(0);
+  spindown(1);
+  spinup(2);
+
+  // First resilvering: #2 has nothing in common with #0
+  {
+    RaftResilverer resilverer(*shardDirectory(0), myself(2), *contactDetails(), *trimmer(0));
+    RETRY_ASSERT_EQ(resilverer.getStatus().state, ResilveringState::SUCCEEDED);
+    ASSERT_EQ(resilverer.getReused(), 0u);
+  }
+
+  // Second resilvering: The SST files from the first one are still there, no
+  // need to send them again
+  {
+    RaftResilverer resilverer(*shardDirectory(0), myself(2), *contactDetails(), *trimmer(0));
+    RETRY_ASSERT_EQ(resilverer.getStatus().state, ResilveringState::SUCCEEDED);
+    ASSERT_GE(resilverer.getReused(), 1u);
+    ASSERT_EQ(resilverer.getProgress(), resilverer.getTotalToSend());
+  }
+
+  for(size_t i = 0; i < NENTRIES; i++) {
+    std::string value;
+    ASSERT_TRUE(stateMachine(2)->get(SSTR("key-" << i), value).ok());
+    ASSERT_EQ(value, SSTR("value-" << i));
+  }
+}
+
+TEST_F(Resilvering, ChunkedCopy) {
+  ShardDirectory *dir = shardDirectory(0);
+  ResilveringEventID id = "chunked-copy";
+  std::string err, contents;
+  int64_t size;
+
+  ASSERT_FALSE(dir->resilveringFileSize(id, "some-file", size, err));
+  ASSERT_TRUE(dir->resilveringStart(id, err));
+
+  ASSERT_TRUE(dir->resilveringFileSize(id, "dir/some-file", size, err));
+  ASSERT_EQ(size, 0);
+
+  ASSERT_TRUE(dir->resilveringCopyChunk(id, "dir/some-file", 0, ShardDirectory::resilveringChecksum("aaa"), "aaa", err));
+  ASSERT_TRUE(dir->resilveringCopyChunk(id, "dir/some-file", 3, ShardDirectory::resilveringChecksum("bbb"), "bbb", err));
+  ASSERT_TRUE(dir->resilveringFileSize(id, "dir/some-file", size, err));
+  ASSERT_EQ(size, 6);
+
+  // Corrupted chunk
+  ASSERT_FALSE(dir->resilveringCopyChunk(id, "dir/some-file", 6, ShardDirectory::resilveringChecksum("ccc"), "ccd", err));
+
+  // Gap
+  ASSERT_FALSE(dir->resilveringCopyChunk(id, "dir/some-file", 7, ShardDirectory::resilveringChecksum("ccc"), "ccc", err));
+
+  ASSERT_TRUE(dir->resilveringFileSize(id, "dir/some-file", size, err));
+  ASSERT_EQ(size, 6);
+
+  // Resend of an earlier chunk, as after a network blip
+  ASSERT_TRUE(dir->resilveringCopyChunk(id, "dir/some-file", 3, ShardDirectory::resilveringChecksum("BBB"), "BBB", err));
+  ASSERT_TRUE(dir->resilveringCopyChunk(id, "dir/some-file", 6, ShardDirectory::resilveringChecksum("ccc"), "ccc", err));
+
+  ASSERT_TRUE(dir->resilveringFileSize(id, "dir/some-file", size, err));
+  ASSERT_EQ(size, 9);
+}
+
+TEST_F(Resilvering, ReuseRequiresMatchingChecksum) {
+  ShardDirectory *dir = shardDirectory(0);
+
+  for(size_t i = 0; i < 1000; i++) {
+    ASSERT_TRUE(stateMachine(0)->set(SSTR("key-" << i), SSTR("value-" << i)).ok());
+  }
+
+  ASSERT_TRUE(stateMachine(0)->manualCompaction().ok());
+
+  std::vector<ResilveringFileInfo> files = dir->listReusableFiles();
+  ASSERT_FALSE(files.empty());
+
+  std::string err;
+  std::unique_ptr<ShardSnapshot> snapshot = dir->takeSnapshot("reuse-snapshot", err);
+  ASSERT_NE(snapshot, nullptr);
+
+  uint64_t checksum;
+  ASSERT_TRUE(ShardDirectory::resilveringFileChecksum(pathJoin(snapshot->getPath(), files[0].filename), checksum, err));
+
+  ResilveringEventID id = "reuse";
+  ASSERT_TRUE(dir->resilveringStart(id, err));
+
+  // Same name and size prove nothing, the contents have to match as well
+  ASSERT_FALSE(dir->resilveringReuse(id, files[0].filename, checksum + 1, err));
+  ASSERT_TRUE(dir->resilveringReuse(id, files[0].filename, checksum, err));
+
+  int64_t size;
+  ASSERT_TRUE(dir->resilveringFileSize(id, files[0].filename, size, err));
+  ASSERT_EQ(size, files[0].size);
+}
+
 TEST_F(Resilvering, automatic) {
   // Don't spin up #2 yet.. Will be resilvered later on.
   spinup(0); spinup(1); prepare(2);
@@ -347,7 +347,11 @@ QuarkDBNode* TestNode::quarkdbNode() {
 }
 
 TestNode::~TestNode() {
-  if(pollerptr) delete pollerptr;
+  if(pollerptr) {
+    qdbnodeptr->attachPoller(nullptr);
+    delete pollerptr;
+  }
+
   if(tunnelptr) delete tunnelptr;
   if(qdbnodeptr) delete qdbnodeptr;
 }
@@ -374,6 +378,7 @@ qclient::Members TestNode::members() {
 AsioPoller* TestNode::poller() {
   if(pollerptr == nullptr) {
     pollerptr = new AsioPoller(myself().port, 5, quarkdbNode());
+    quarkdbNode()->attachPoller(pollerptr);
   }
   return pollerptr;
 }
@@ -415,6 +420,7 @@ void TestNode::spinup() {
 
 void TestNode::spindown() {
   if(pollerptr) {
+    quarkdbNode()->attachPoller(nullptr);
     delete pollerptr;
     pollerptr = nullptr;
   }
@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include "raft/RaftCommon.hh"
 #include "utils/Statistics.hh"
+#include "utils/LatencyTracker.hh"
 #include "utils/IntToBinaryString.hh"
 #include "utils/ParseUtils.hh"
 #include "utils/StringUtils.hh"
@@ -33,6 +34,7 @@
 #include "utils/CommandParsing.hh"
 #include "utils/TimeFormatting.hh"
 #include "utils/Random.hh"
+#include "utils/RateLimiter.hh"
 #include "utils/AssistedThread.hh"
 #include "utils/CoreLocalArray.hh"
 #include "utils/Synchronized.hh"
@@ -187,6 +189,19 @@ TEST(Utils, replication_status) {
   ASSERT_THROW(status.getReplicaStatus(RaftServer("localhost", 456)).target, FatalException);
 }
 
+TEST(Utils, parseUInt64) {
+  uint64_t value;
+  ASSERT_TRUE(ParseUtils::parseUInt64("0", value));
+  ASSERT_EQ(value, 0u);
+  ASSERT_TRUE(ParseUtils::parseUInt64("18446744073709551615", value));
+  ASSERT_EQ(value, 18446744073709551615ull);
+
+  ASSERT_FALSE(ParseUtils::parseUInt64("18446744073709551616", value));
+  ASSERT_FALSE(ParseUtils::parseUInt64("-1", value));
+  ASSERT_FALSE(ParseUtils::parseUInt64("", value));
+  ASSERT_FALSE(ParseUtils::parseUInt64("12a", value));
+}
+
 TEST(Utils, parseIntegerList) {
   std::vector<int64_t> res, tmp;
   ASSERT_TRUE(ParseUtils::parseIntegerList("1,4,7", ",", res));
@@ -551,6 +566,11 @@ TEST(InternalFilter, BasicSanity) {
   InternalFilter::process(req);
   ASSERT_EQ(req.getCommand(), RedisCommand::INVALID);
 
+  req = {"lazyfree_reclaim", "1000" };
+  ASSERT_EQ(req.getCommand(), RedisCommand::LAZYFREE_RECLAIM);
+  InternalFilter::process(req);
+  ASSERT_EQ(req.getCommand(), RedisCommand::INVALID);
+
   req = {"set", "adsfasf", "qerq"};
   ASSERT_EQ(req.getCommand(), RedisCommand::SET);
   InternalFilter::process(req);
@@ -828,6 +848,97 @@ TEST(SimplePatternMatcher, BasicSanity) {
   ASSERT_EQ(matcher.size(), 0u);
 }
 
+TEST(SimplePatternMatcher, SharedPrefixes) {
+  SimplePatternMatcher<int64_t> matcher;
+  std::vector<std::string> patterns = {
+    "fst-*", "fst-1*", "fst-12*", "fst-1?", "fst-12", "fst-123", "fst-1\\*",
+    "fst-[12]*", "f*t-12", "mgm-*", "*", "fst-12*3", "fst-12[3-5]"
+  };
+
+  for(size_t i = 0; i < patterns.size(); i++) {
+    ASSERT_TRUE(matcher.insert(patterns[i], i));
+  }
+
+  std::vector<std::string> keys = {
+    "", "f", "fst-", "fst-1", "fst-12", "fst-123", "fst-124", "fst-1*",
+    "fst-2", "fst-3", "mgm-1", "fst-1234", "fxt-12"
+  };
+
+  for(const std::string &key : keys) {
+    std::set<std::string> expected;
+    for(const std::string &pattern : patterns) {
+      if(stringmatchlen(pattern.data(), pattern.size(), key.data(), key.size(), 0) == 1) {
+        expected.insert(pattern);
+      }
+    }
+
+    std::set<std::string> found;
+    for(auto it = matcher.find(key); it.valid(); it.next()) {
+      ASSERT_TRUE(found.insert(it.getPattern()).second) << key;
+    }
+
+    ASSERT_EQ(found, expected) << key;
+  }
+
+  // Shorter literal prefixes come first
+  auto it = matcher.find("fst-12");
+  ASSERT_TRUE(it.valid());
+  ASSERT_EQ(it.getPattern(), "*");
+  it.next();
+  ASSERT_EQ(it.getPattern(), "f*t-12");
+  it.next();
+  ASSERT_EQ(it.getPattern(), "fst-*");
+
+  // Erase everything, the trie should be pruned down to the root
+  for(size_t i = 0; i < patterns.size(); i++) {
+    ASSERT_TRUE(matcher.erase(patterns[i], i));
+  }
+
+  ASSERT_EQ(matcher.size(), 0u);
+  ASSERT_TRUE(matcher.trieEmpty());
+  ASSERT_FALSE(matcher.find("fst-12").valid());
+
+  ASSERT_TRUE(matcher.insert("fst-12*", 1));
+  ASSERT_TRUE(matcher.insert("fst-12*", 2));
+  it = matcher.find("fst-123");
+  ASSERT_TRUE(it.valid());
+  ASSERT_TRUE(it.erase());
+  it.next();
+  ASSERT_TRUE(it.valid());
+  ASSERT_EQ(it.getValue(), 2);
+  ASSERT_TRUE(it.erase());
+  it.next();
+  ASSERT_FALSE(it.valid());
+  ASSERT_EQ(matcher.size(), 0u);
+  ASSERT_TRUE(matcher.trieEmpty());
+  ASSERT_FALSE(matcher.find("fst-123").valid());
+}
+
+TEST(SimplePatternMatcher, PurgeThroughFullIterator) {
+  SimplePatternMatcher<int64_t> matcher;
+  std::vector<std::string> patterns = { "fst-*", "fst-1*", "mgm-*", "*", "abc" };
+
+  for(size_t i = 0; i < patterns.size(); i++) {
+    ASSERT_TRUE(matcher.insert(patterns[i], i));
+    ASSERT_TRUE(matcher.insert(patterns[i], i + 100));
+  }
+
+  ASSERT_FALSE(matcher.trieEmpty());
+
+  // Same as Publisher::purgeListeners
+  std::set<std::pair<std::string, int64_t>> seen;
+  for(auto it = matcher.getFullIterator(); it.valid(); it.next()) {
+    ASSERT_TRUE(seen.emplace(it.getPattern(), it.getValue()).second);
+    ASSERT_TRUE(it.erase());
+  }
+
+  ASSERT_EQ(seen.size(), patterns.size() * 2);
+  ASSERT_EQ(matcher.size(), 0u);
+  ASSERT_TRUE(matcher.trieEmpty());
+  ASSERT_FALSE(matcher.find("fst-1").valid());
+  ASSERT_FALSE(matcher.find("abc").valid());
+}
+
 TEST(ThreadSafeMultiMap, BasicSanity) {
   std::vector<size_t> stageSizesToTest = {1, 2, 3, 4, 5, 6, 7, 10, 20, 100, 1000, 2000 };
 
@@ -1131,6 +1242,95 @@ TEST(HistoricalStatistics, BasicSanity) {
 
 }
 
+TEST(LatencyHistogram, Buckets) {
+  for(uint64_t i = 0; i < 16; i++) {
+    ASSERT_EQ(LatencyHistogram::getBucket(i), i);
+    ASSERT_EQ(LatencyHistogram::getBucketUpperBound(i), i);
+  }
+
+  ASSERT_EQ(LatencyHistogram::getBucket(16), 16u);
+  ASSERT_EQ(LatencyHistogram::getBucket(17), 16u);
+  ASSERT_EQ(LatencyHistogram::getBucketUpperBound(16), 17u);
+  ASSERT_EQ(LatencyHistogram::getBucket(18), 17u);
+  ASSERT_EQ(LatencyHistogram::getBucket(31), 23u);
+  ASSERT_EQ(LatencyHistogram::getBucket(32), 24u);
+
+  size_t previous = 0;
+  for(uint64_t value = 1; value < (1ull << 40); value = value * 3 / 2 + 1) {
+    size_t bucket = LatencyHistogram::getBucket(value);
+    ASSERT_LT(bucket, LatencyHistogram::kBuckets);
+    ASSERT_GE(bucket, previous);
+    previous = bucket;
+
+    if(value < (1ull << LatencyHistogram::kMaxExponent)) {
+      uint64_t upperBound = LatencyHistogram::getBucketUpperBound(bucket);
+      ASSERT_GE(upperBound, value);
+      ASSERT_LE(upperBound - value, value / LatencyHistogram::kSubBuckets);
+    }
+  }
+
+  ASSERT_EQ(LatencyHistogram::getBucket(1ull << 50), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(LatencyHistogram, Percentiles) {
+  LatencyHistogram histogram;
+  LatencyDistribution empty;
+  empty.add(histogram);
+  ASSERT_EQ(empty.getCount(), 0u);
+  ASSERT_EQ(empty.getPercentile(99), 0u);
+
+  for(uint64_t i = 1; i <= 1000; i++) {
+    histogram.record(i);
+  }
+
+  LatencyDistribution distribution;
+  distribution.add(histogram);
+  ASSERT_EQ(distribution.getCount(), 1000u);
+
+  ASSERT_GE(distribution.getPercentile(50), 500u);
+  ASSERT_LE(distribution.getPercentile(50), 500u + 500u / 8);
+  ASSERT_GE(distribution.getPercentile(99), 990u);
+  ASSERT_LE(distribution.getPercentile(99), 990u + 990u / 8);
+  ASSERT_GE(distribution.getPercentile(99.9), 999u);
+  ASSERT_LE(distribution.getPercentile(100), 1000u + 1000u / 8);
+
+  // A single slow sample out of ten is the p99
+  LatencyHistogram few;
+  for(size_t i = 0; i < 9; i++) {
+    few.record(1);
+  }
+  few.record(1000);
+
+  LatencyDistribution fewDistribution;
+  fewDistribution.add(few);
+  ASSERT_LE(fewDistribution.getPercentile(50), 1u);
+  ASSERT_GE(fewDistribution.getPercentile(99), 1000u);
+
+  histogram.reset();
+  LatencyDistribution afterReset;
+  afterReset.add(histogram);
+  ASSERT_EQ(afterReset.getCount(), 0u);
+}
+
+TEST(LatencyTracker, BasicSanity) {
+  LatencyTracker tracker;
+  ASSERT_TRUE(tracker.describe().empty());
+
+  tracker.record(RedisCommand::HSET, LatencyStage::kDispatch, std::chrono::microseconds(10));
+  tracker.record(RedisCommand::HSET, LatencyStage::kDispatch, std::chrono::microseconds(10));
+  tracker.record(RedisCommand::GET, LatencyStage::kApply, std::chrono::milliseconds(1));
+
+  std::vector<std::string> expected = {
+    "GET apply count=1 p50=1023us p99=1023us p999=1023us",
+    "HSET dispatch count=2 p50=10us p99=10us p999=10us"
+  };
+
+  ASSERT_EQ(tracker.describe(), expected);
+
+  tracker.reset();
+  ASSERT_TRUE(tracker.describe().empty());
+}
+
 TEST(Synchronized, String) {
   Synchronized<std::string> syncstr;
   ASSERT_EQ(syncstr.get(), "");
@@ -1185,6 +1385,52 @@ TEST(FileUtils, RecursiveFileCount) {
   ASSERT_EQ(nitems, 4u);
 }
 
+TEST(FileUtils, WriteFileAt) {
+  ASSERT_EQ(system("rm -rf /tmp/qdb-test-write-file-at/"), 0);
+  ASSERT_EQ(system("mkdir /tmp/qdb-test-write-file-at/"), 0);
+
+  std::string path = "/tmp/qdb-test-write-file-at/file";
+  std::string error, contents;
+  int64_t size;
+
+  ASSERT_FALSE(getFileSize(path, size, error));
+
+  ASSERT_TRUE(writeFileAt(path, 0, "abc", error));
+  ASSERT_TRUE(writeFileAt(path, 3, "def", error));
+  ASSERT_TRUE(getFileSize(path, size, error));
+  ASSERT_EQ(size, 6);
+  ASSERT_TRUE(readFile(path, contents));
+  ASSERT_EQ(contents, "abcdef");
+
+  // Rewriting an earlier offset discards everything past it
+  ASSERT_TRUE(writeFileAt(path, 2, "xy", error));
+  ASSERT_TRUE(readFile(path, contents));
+  ASSERT_EQ(contents, "abxy");
+
+  ASSERT_TRUE(writeFileAt(path, 0, "", error));
+  ASSERT_TRUE(getFileSize(path, size, error));
+  ASSERT_EQ(size, 0);
+}
+
+TEST(RateLimiter, BasicSanity) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  RateLimiter unlimited(0);
+  ASSERT_EQ(unlimited.reserve(1000000, now), std::chrono::nanoseconds(0));
+  ASSERT_EQ(unlimited.reserve(1000000, now), std::chrono::nanoseconds(0));
+
+  RateLimiter limiter(1000);
+  ASSERT_EQ(limiter.reserve(500, now), std::chrono::nanoseconds(0));
+  ASSERT_EQ(limiter.reserve(500, now), std::chrono::milliseconds(500));
+  ASSERT_EQ(limiter.reserve(1000, now), std::chrono::milliseconds(1000));
+  ASSERT_EQ(limiter.reserve(1000, now + std::chrono::milliseconds(1500)), std::chrono::milliseconds(500));
+
+  // Idle time doesn't accumulate into a burst
+  now += std::chrono::seconds(10);
+  ASSERT_EQ(limiter.reserve(2000, now), std::chrono::nanoseconds(0));
+  ASSERT_EQ(limiter.reserve(1, now), std::chrono::seconds(2));
+}
+
 TEST(ParanoidManifestChecker, BasicSanity) {
   struct timespec manifest, newestSst;
 
@@ -132,7 +132,9 @@ int runServer(const std::string &optConfiguration) {
   // Let's get this party started
   //----------------------------------------------------------------------------
   std::unique_ptr<QuarkDBNode> node(new QuarkDBNode(configuration, defaultTimeouts));
-  std::unique_ptr<AsioPoller> poller(new AsioPoller(configuration.getMyself().port, 10, node.get()));
+  std::unique_ptr<AsioPoller> poller(new AsioPoller(configuration.getMyself().port, 10, node.get(),
+    configuration.getNetworkSharding() ? PollerMode::kSharded : PollerMode::kShared));
+  node->attachPoller(poller.get());
 
   signal(SIGINT, handle_sigint);
   signal(SIGTERM, handle_sigint);
@@ -146,6 +148,7 @@ int runServer(const std::string &optConfiguration) {
   //----------------------------------------------------------------------------
   qdb_event("Received request to shut down. Waiting until all requests in flight (" << inFlightTracker.getInFlight() << ") have been processed..");
 
+  node->attachPoller(nullptr);
   poller.reset();
   node.reset();
 